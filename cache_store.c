@@ -0,0 +1,365 @@
+// cache_store.c - Private on-disk cache files
+//
+// The script bytecode, Lua chunk and HTTP caches kept their files in
+// /tmp under names anyone could predict, wrote them with fopen("wb") on a
+// fixed temporary name and trusted whatever they read back. Another user
+// could plant a file there (bytecode is executed as-is by JS_ReadObject
+// and lua_load), or a symlink that the next write followed. They now share
+// this helper:
+//
+//  - each cache has its own directory, 0700 and checked to belong to us
+//    before it is used;
+//  - entries are written to a fresh O_EXCL temporary file and renamed
+//    onto their name, so two processes never write the same file and a
+//    reader never sees half of one;
+//  - an entry is named after its SHA-256 key, and its header repeats the
+//    key and carries the SHA-256 of the payload, both checked on every
+//    read. A damaged entry is removed, never returned.
+//
+// cache_store_get() reads an entry into memory. cache_store_open() maps
+// it instead for callers that only pass the bytes on; file_source turns a
+// file truncated under the mapping into zeros and says so, not a SIGBUS.
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef PAUK_HOST
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#else
+#include <vfs/vfs.h>
+#include <task.h>
+#endif
+
+#include "cache_store.h"
+
+// Writes go to temporary files with this prefix, never a valid key name
+#define CACHE_STORE_TMP_PREFIX ".tmp-"
+
+static void cache_store_path(char *path, size_t size, const char *dir,
+    const uint8_t key[SHA256_DIGEST_LEN])
+{
+    char hex[2 * SHA256_DIGEST_LEN + 1];
+    sha256_hex(key, hex);
+    snprintf(path, size, "%s%s", dir, hex);
+}
+
+// ===== Directory =====
+
+#ifdef PAUK_HOST
+
+// mkdir 0700 unless it exists; then it has to be a real directory (not a
+// symlink), owned by us, closed to group and others
+static errno_t cache_store_private_dir(const char *path)
+{
+    if (mkdir(path, 0700) != 0 && errno != EEXIST)
+        return EIO;
+
+    struct stat st;
+    if (lstat(path, &st) != 0)
+        return EIO;
+    if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid() ||
+        (st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+        return EPERM;
+    return EOK;
+}
+
+errno_t cache_store_dir(const char *name, char *path, size_t size)
+{
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char base[CACHE_STORE_PATH_MAX];
+    int n;
+
+    if ((xdg && xdg[0] == '/') || (home && home[0] == '/')) {
+        // The user's own cache home; only make sure it is there
+        char cache_home[CACHE_STORE_PATH_MAX];
+        if (xdg && xdg[0] == '/')
+            n = snprintf(cache_home, sizeof(cache_home), "%s", xdg);
+        else
+            n = snprintf(cache_home, sizeof(cache_home), "%s/.cache", home);
+        if (n < 0 || (size_t)n >= sizeof(cache_home))
+            return ELIMIT;
+        mkdir(cache_home, 0700);
+        n = snprintf(base, sizeof(base), "%s/pauk", cache_home);
+    } else {
+        n = snprintf(base, sizeof(base), "/tmp/pauk-%u", (unsigned)geteuid());
+    }
+    if (n < 0 || (size_t)n >= sizeof(base))
+        return ELIMIT;
+
+    errno_t rc = cache_store_private_dir(base);
+    if (rc != EOK)
+        return rc;
+
+    n = snprintf(path, size, "%s/%s", base, name);
+    if (n < 0 || (size_t)n + 2 > size)
+        return ELIMIT;
+    rc = cache_store_private_dir(path);
+    if (rc != EOK)
+        return rc;
+
+    path[n] = '/';
+    path[n + 1] = '\0';
+    return EOK;
+}
+
+static FILE *cache_store_temp(const char *dir, char *tmp_path, size_t size)
+{
+    int n = snprintf(tmp_path, size, "%s" CACHE_STORE_TMP_PREFIX "XXXXXX", dir);
+    if (n < 0 || (size_t)n >= size)
+        return NULL;
+
+    int fd = mkstemp(tmp_path);
+    if (fd < 0)
+        return NULL;
+    FILE *f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        remove(tmp_path);
+    }
+    return f;
+}
+
+#else
+
+// HelenOS has a single user: the directory only has to exist
+static errno_t cache_store_private_dir(const char *path)
+{
+    errno_t rc = vfs_link_path(path, KIND_DIRECTORY, NULL);
+    return (rc == EOK || rc == EEXIST) ? EOK : rc;
+}
+
+errno_t cache_store_dir(const char *name, char *path, size_t size)
+{
+    errno_t rc = cache_store_private_dir("/tmp/pauk");
+    if (rc != EOK)
+        return rc;
+
+    int n = snprintf(path, size, "/tmp/pauk/%s", name);
+    if (n < 0 || (size_t)n + 2 > size)
+        return ELIMIT;
+    rc = cache_store_private_dir(path);
+    if (rc != EOK)
+        return rc;
+
+    path[n] = '/';
+    path[n + 1] = '\0';
+    return EOK;
+}
+
+// Task id plus a counter names the file; WALK_MUST_CREATE makes the
+// create exclusive, so a name already taken is just skipped
+static FILE *cache_store_temp(const char *dir, char *tmp_path, size_t size)
+{
+    static unsigned counter = 0;
+
+    for (int attempt = 0; attempt < 16; attempt++) {
+        int n = snprintf(tmp_path, size, "%s" CACHE_STORE_TMP_PREFIX "%llx-%x", dir,
+            (unsigned long long)task_get_id(), counter++);
+        if (n < 0 || (size_t)n >= size)
+            return NULL;
+
+        int fd;
+        errno_t rc = vfs_lookup_open(tmp_path, WALK_REGULAR | WALK_MUST_CREATE,
+            MODE_WRITE, &fd);
+        if (rc == EEXIST)
+            continue;
+        if (rc != EOK)
+            return NULL;
+
+        FILE *f = fdopen(fd, "wb");
+        if (!f) {
+            vfs_put(fd);
+            remove(tmp_path);
+        }
+        return f;
+    }
+    return NULL;
+}
+
+#endif
+
+// ===== Write =====
+
+errno_t cache_store_begin(cache_store_writer_t *w, const char *dir,
+    uint32_t magic, const uint8_t key[SHA256_DIGEST_LEN])
+{
+    memset(w, 0, sizeof(*w));
+    if (strlen(dir) >= sizeof(w->dir))
+        return ELIMIT;
+    strcpy(w->dir, dir);
+
+    w->f = cache_store_temp(dir, w->tmp_path, sizeof(w->tmp_path));
+    if (!w->f)
+        return EIO;
+
+    w->header.magic = magic;
+    w->header.header_size = sizeof(w->header);
+    memcpy(w->header.key, key, SHA256_DIGEST_LEN);
+    sha256_init(&w->hash);
+
+    // Placeholder: length and hash are filled in by commit
+    if (fwrite(&w->header, sizeof(w->header), 1, w->f) != 1) {
+        cache_store_abort(w);
+        return EIO;
+    }
+    return EOK;
+}
+
+errno_t cache_store_write(cache_store_writer_t *w, const void *data, size_t len)
+{
+    if (!w->f)
+        return EIO;
+    if (len > 0 && fwrite(data, 1, len, w->f) != len) {
+        cache_store_abort(w);
+        return EIO;
+    }
+    sha256_update(&w->hash, data, len);
+    w->header.payload_len += len;
+    return EOK;
+}
+
+errno_t cache_store_commit(cache_store_writer_t *w)
+{
+    if (!w->f)
+        return EIO;
+
+    sha256_final(&w->hash, w->header.payload_hash);
+    bool ok = fseek(w->f, 0, SEEK_SET) == 0 &&
+        fwrite(&w->header, sizeof(w->header), 1, w->f) == 1;
+    ok = (fclose(w->f) == 0) && ok;
+    w->f = NULL;
+
+    char path[CACHE_STORE_PATH_MAX + 2 * SHA256_DIGEST_LEN + 1];
+    cache_store_path(path, sizeof(path), w->dir, w->header.key);
+    if (!ok || rename(w->tmp_path, path) != 0) {
+        remove(w->tmp_path);
+        return EIO;
+    }
+    return EOK;
+}
+
+void cache_store_abort(cache_store_writer_t *w)
+{
+    if (!w->f)
+        return;
+    fclose(w->f);
+    w->f = NULL;
+    remove(w->tmp_path);
+}
+
+errno_t cache_store_put(const char *dir, uint32_t magic,
+    const uint8_t key[SHA256_DIGEST_LEN], const void *data, size_t len)
+{
+    cache_store_writer_t w;
+    errno_t rc = cache_store_begin(&w, dir, magic, key);
+    if (rc == EOK)
+        rc = cache_store_write(&w, data, len);
+    if (rc == EOK)
+        rc = cache_store_commit(&w);
+    return rc;
+}
+
+// ===== Read =====
+
+errno_t cache_store_get(const char *dir, uint32_t magic,
+    const uint8_t key[SHA256_DIGEST_LEN], size_t max_len,
+    uint8_t **data, size_t *len)
+{
+    char path[CACHE_STORE_PATH_MAX + 2 * SHA256_DIGEST_LEN + 1];
+    cache_store_path(path, sizeof(path), dir, key);
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return ENOENT;
+
+    cache_store_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != magic || header.header_size != sizeof(header) ||
+        memcmp(header.key, key, SHA256_DIGEST_LEN) != 0) {
+        fclose(f);
+        remove(path);
+        return EIO;
+    }
+    if (header.payload_len > max_len) {
+        fclose(f);
+        return ELIMIT;
+    }
+
+    size_t payload_len = (size_t)header.payload_len;
+    uint8_t *buf = malloc(payload_len + 1);
+    if (!buf) {
+        fclose(f);
+        return ENOMEM;
+    }
+    size_t got = fread(buf, 1, payload_len, f);
+    fclose(f);
+
+    uint8_t digest[SHA256_DIGEST_LEN];
+    if (got == payload_len)
+        sha256(buf, payload_len, digest);
+    if (got != payload_len ||
+        memcmp(digest, header.payload_hash, SHA256_DIGEST_LEN) != 0) {
+        free(buf);
+        remove(path);
+        return EIO;
+    }
+
+    buf[payload_len] = '\0';
+    *data = buf;
+    *len = payload_len;
+    return EOK;
+}
+
+errno_t cache_store_open(const char *dir, uint32_t magic,
+    const uint8_t key[SHA256_DIGEST_LEN], size_t max_len, cache_store_view_t *view)
+{
+    char path[CACHE_STORE_PATH_MAX + 2 * SHA256_DIGEST_LEN + 1];
+    cache_store_path(path, sizeof(path), dir, key);
+
+    memset(view, 0, sizeof(*view));
+    cache_store_header_t header;
+    errno_t rc = file_source_open(&view->src, path, max_len + sizeof(header),
+        FILE_SOURCE_SEQUENTIAL);
+    if (rc != EOK)
+        return rc;
+
+    bool ok = view->src.len >= sizeof(header);
+    if (ok) {
+        memcpy(&header, view->src.data, sizeof(header));
+        ok = header.magic == magic && header.header_size == sizeof(header) &&
+            memcmp(header.key, key, SHA256_DIGEST_LEN) == 0 &&
+            header.payload_len == view->src.len - sizeof(header);
+    }
+    if (ok) {
+        uint8_t digest[SHA256_DIGEST_LEN];
+        sha256(view->src.data + sizeof(header), (size_t)header.payload_len, digest);
+        ok = memcmp(digest, header.payload_hash, SHA256_DIGEST_LEN) == 0 &&
+            file_source_intact(&view->src);
+    }
+    if (!ok) {
+        file_source_close(&view->src);
+        remove(path);
+        return EIO;
+    }
+
+    view->data = (const uint8_t *)view->src.data + sizeof(header);
+    view->len = (size_t)header.payload_len;
+    return EOK;
+}
+
+void cache_store_close(cache_store_view_t *view)
+{
+    file_source_close(&view->src);
+    view->data = NULL;
+    view->len = 0;
+}
+
+void cache_store_remove(const char *dir, const uint8_t key[SHA256_DIGEST_LEN])
+{
+    char path[CACHE_STORE_PATH_MAX + 2 * SHA256_DIGEST_LEN + 1];
+    cache_store_path(path, sizeof(path), dir, key);
+    remove(path);
+}
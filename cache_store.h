@@ -0,0 +1,76 @@
+// cache_store.h - Private on-disk cache files
+#ifndef CACHE_STORE_H
+#define CACHE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "sha256.h"
+#include "file_source.h"
+
+// Longest directory path cache_store_dir() hands out
+#define CACHE_STORE_PATH_MAX 512
+
+typedef struct {
+    uint32_t magic;
+    uint32_t header_size;
+    uint8_t key[SHA256_DIGEST_LEN];
+    uint64_t payload_len;
+    uint8_t payload_hash[SHA256_DIGEST_LEN];    // SHA-256 of the payload
+} cache_store_header_t;
+
+// An entry being written: created under a temporary name, renamed onto
+// its key by cache_store_commit()
+typedef struct {
+    FILE *f;
+    char dir[CACHE_STORE_PATH_MAX];
+    char tmp_path[CACHE_STORE_PATH_MAX + 32];
+    cache_store_header_t header;
+    sha256_t hash;
+} cache_store_writer_t;
+
+// Directory (ending in '/') for the cache called name, created if needed.
+// On the host it is $XDG_CACHE_HOME/pauk/<name>/, ~/.cache/pauk/<name>/ or
+// /tmp/pauk-<uid>/<name>/; EPERM when it exists but is not a directory of
+// ours closed to everyone else, and the caller should then not cache.
+errno_t cache_store_dir(const char *name, char *path, size_t size);
+
+// Start an entry for key in dir: EOK, or ENOMEM / EIO
+errno_t cache_store_begin(cache_store_writer_t *w, const char *dir,
+    uint32_t magic, const uint8_t key[SHA256_DIGEST_LEN]);
+errno_t cache_store_write(cache_store_writer_t *w, const void *data, size_t len);
+// Seal the entry and make it visible under its key; aborts it on failure
+errno_t cache_store_commit(cache_store_writer_t *w);
+void cache_store_abort(cache_store_writer_t *w);
+
+// begin + write + commit
+errno_t cache_store_put(const char *dir, uint32_t magic,
+    const uint8_t key[SHA256_DIGEST_LEN], const void *data, size_t len);
+
+// Payload stored under key, in a malloc'd buffer (one '\0' after it),
+// only after its magic, key and SHA-256 have been checked: EOK, ENOENT,
+// ELIMIT when over max_len, ENOMEM, or EIO for a damaged or foreign file,
+// which is removed
+errno_t cache_store_get(const char *dir, uint32_t magic,
+    const uint8_t key[SHA256_DIGEST_LEN], size_t max_len,
+    uint8_t **data, size_t *len);
+
+// A checked entry read in place: data/len is the payload inside src
+typedef struct {
+    file_source_t src;
+    const uint8_t *data;
+    size_t len;
+} cache_store_view_t;
+
+// cache_store_get() without the copy: the file is mapped where possible
+// and checked the same way before the view is handed out. Whoever reads
+// the view to its end asks file_source_intact(&view->src) afterwards.
+errno_t cache_store_open(const char *dir, uint32_t magic,
+    const uint8_t key[SHA256_DIGEST_LEN], size_t max_len, cache_store_view_t *view);
+void cache_store_close(cache_store_view_t *view);
+
+void cache_store_remove(const char *dir, const uint8_t key[SHA256_DIGEST_LEN]);
+
+#endif // CACHE_STORE_H
@@ -264,6 +264,9 @@ if (pauk_ui->content_image) {
     }
     
     fibril_usleep(1000);
+    // Viewport changed - resize the backing store and repaint
+    if (pauk_ui->html_renderer)
+        html_renderer_resize_viewport(pauk_ui);
     ui_window_paint(pauk_ui->window);
      gfx_update(pauk_ui->gc);
    // printf("UI resized successfully\n");
@@ -0,0 +1,637 @@
+// charset_decoder.c - Document charset detection and transcoding to UTF-8
+//
+// lexbor's chunk parser takes UTF-8 and nothing else. Every byte the
+// engine fed it was assumed to be UTF-8, so a page in windows-1250 or
+// KOI8-R came out as replacement characters, and UTF-16 pages did not
+// parse at all. Documents now pass through this decoder first. It picks
+// the charset the way browsers do: a byte order mark, then the
+// Content-Type charset, then a <meta charset> or http-equiv found in the
+// first CHARSET_PRESCAN_BYTES, and UTF-8 when there is none of these. It
+// then converts the text to UTF-8.
+//
+// Most documents need no conversion. UTF-8 goes to the sink as it came,
+// without being copied. In single-byte charsets the decoder scans eight
+// bytes at a time for the high bit. Long ASCII runs are also handed on
+// from the input uncopied, and only the other bytes are looked up and
+// written into the small output buffer, which is reused for every piece.
+#include <string.h>
+#include <ctype.h>
+
+#include "charset_decoder.h"
+
+// Bytes 0x80..0xff of the single-byte charsets. Bytes a code page leaves
+// undefined map to the C1 control of the same value, as in browsers.
+static const uint16_t cp_windows_1250[128] = {
+    0x20ac, 0x0081, 0x201a, 0x0083, 0x201e, 0x2026, 0x2020, 0x2021,
+    0x0088, 0x2030, 0x0160, 0x2039, 0x015a, 0x0164, 0x017d, 0x0179,
+    0x0090, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+    0x0098, 0x2122, 0x0161, 0x203a, 0x015b, 0x0165, 0x017e, 0x017a,
+    0x00a0, 0x02c7, 0x02d8, 0x0141, 0x00a4, 0x0104, 0x00a6, 0x00a7,
+    0x00a8, 0x00a9, 0x015e, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x017b,
+    0x00b0, 0x00b1, 0x02db, 0x0142, 0x00b4, 0x00b5, 0x00b6, 0x00b7,
+    0x00b8, 0x0105, 0x015f, 0x00bb, 0x013d, 0x02dd, 0x013e, 0x017c,
+    0x0154, 0x00c1, 0x00c2, 0x0102, 0x00c4, 0x0139, 0x0106, 0x00c7,
+    0x010c, 0x00c9, 0x0118, 0x00cb, 0x011a, 0x00cd, 0x00ce, 0x010e,
+    0x0110, 0x0143, 0x0147, 0x00d3, 0x00d4, 0x0150, 0x00d6, 0x00d7,
+    0x0158, 0x016e, 0x00da, 0x0170, 0x00dc, 0x00dd, 0x0162, 0x00df,
+    0x0155, 0x00e1, 0x00e2, 0x0103, 0x00e4, 0x013a, 0x0107, 0x00e7,
+    0x010d, 0x00e9, 0x0119, 0x00eb, 0x011b, 0x00ed, 0x00ee, 0x010f,
+    0x0111, 0x0144, 0x0148, 0x00f3, 0x00f4, 0x0151, 0x00f6, 0x00f7,
+    0x0159, 0x016f, 0x00fa, 0x0171, 0x00fc, 0x00fd, 0x0163, 0x02d9
+};
+static const uint16_t cp_windows_1251[128] = {
+    0x0402, 0x0403, 0x201a, 0x0453, 0x201e, 0x2026, 0x2020, 0x2021,
+    0x20ac, 0x2030, 0x0409, 0x2039, 0x040a, 0x040c, 0x040b, 0x040f,
+    0x0452, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+    0x0098, 0x2122, 0x0459, 0x203a, 0x045a, 0x045c, 0x045b, 0x045f,
+    0x00a0, 0x040e, 0x045e, 0x0408, 0x00a4, 0x0490, 0x00a6, 0x00a7,
+    0x0401, 0x00a9, 0x0404, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x0407,
+    0x00b0, 0x00b1, 0x0406, 0x0456, 0x0491, 0x00b5, 0x00b6, 0x00b7,
+    0x0451, 0x2116, 0x0454, 0x00bb, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041a, 0x041b, 0x041c, 0x041d, 0x041e, 0x041f,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042a, 0x042b, 0x042c, 0x042d, 0x042e, 0x042f,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043a, 0x043b, 0x043c, 0x043d, 0x043e, 0x043f,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044a, 0x044b, 0x044c, 0x044d, 0x044e, 0x044f
+};
+static const uint16_t cp_windows_1252[128] = {
+    0x20ac, 0x0081, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021,
+    0x02c6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008d, 0x017d, 0x008f,
+    0x0090, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+    0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0x009d, 0x017e, 0x0178,
+    0x00a0, 0x00a1, 0x00a2, 0x00a3, 0x00a4, 0x00a5, 0x00a6, 0x00a7,
+    0x00a8, 0x00a9, 0x00aa, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+    0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x00b4, 0x00b5, 0x00b6, 0x00b7,
+    0x00b8, 0x00b9, 0x00ba, 0x00bb, 0x00bc, 0x00bd, 0x00be, 0x00bf,
+    0x00c0, 0x00c1, 0x00c2, 0x00c3, 0x00c4, 0x00c5, 0x00c6, 0x00c7,
+    0x00c8, 0x00c9, 0x00ca, 0x00cb, 0x00cc, 0x00cd, 0x00ce, 0x00cf,
+    0x00d0, 0x00d1, 0x00d2, 0x00d3, 0x00d4, 0x00d5, 0x00d6, 0x00d7,
+    0x00d8, 0x00d9, 0x00da, 0x00db, 0x00dc, 0x00dd, 0x00de, 0x00df,
+    0x00e0, 0x00e1, 0x00e2, 0x00e3, 0x00e4, 0x00e5, 0x00e6, 0x00e7,
+    0x00e8, 0x00e9, 0x00ea, 0x00eb, 0x00ec, 0x00ed, 0x00ee, 0x00ef,
+    0x00f0, 0x00f1, 0x00f2, 0x00f3, 0x00f4, 0x00f5, 0x00f6, 0x00f7,
+    0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x00fd, 0x00fe, 0x00ff
+};
+static const uint16_t cp_iso_8859_2[128] = {
+    0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+    0x0088, 0x0089, 0x008a, 0x008b, 0x008c, 0x008d, 0x008e, 0x008f,
+    0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+    0x0098, 0x0099, 0x009a, 0x009b, 0x009c, 0x009d, 0x009e, 0x009f,
+    0x00a0, 0x0104, 0x02d8, 0x0141, 0x00a4, 0x013d, 0x015a, 0x00a7,
+    0x00a8, 0x0160, 0x015e, 0x0164, 0x0179, 0x00ad, 0x017d, 0x017b,
+    0x00b0, 0x0105, 0x02db, 0x0142, 0x00b4, 0x013e, 0x015b, 0x02c7,
+    0x00b8, 0x0161, 0x015f, 0x0165, 0x017a, 0x02dd, 0x017e, 0x017c,
+    0x0154, 0x00c1, 0x00c2, 0x0102, 0x00c4, 0x0139, 0x0106, 0x00c7,
+    0x010c, 0x00c9, 0x0118, 0x00cb, 0x011a, 0x00cd, 0x00ce, 0x010e,
+    0x0110, 0x0143, 0x0147, 0x00d3, 0x00d4, 0x0150, 0x00d6, 0x00d7,
+    0x0158, 0x016e, 0x00da, 0x0170, 0x00dc, 0x00dd, 0x0162, 0x00df,
+    0x0155, 0x00e1, 0x00e2, 0x0103, 0x00e4, 0x013a, 0x0107, 0x00e7,
+    0x010d, 0x00e9, 0x0119, 0x00eb, 0x011b, 0x00ed, 0x00ee, 0x010f,
+    0x0111, 0x0144, 0x0148, 0x00f3, 0x00f4, 0x0151, 0x00f6, 0x00f7,
+    0x0159, 0x016f, 0x00fa, 0x0171, 0x00fc, 0x00fd, 0x0163, 0x02d9
+};
+static const uint16_t cp_iso_8859_15[128] = {
+    0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+    0x0088, 0x0089, 0x008a, 0x008b, 0x008c, 0x008d, 0x008e, 0x008f,
+    0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+    0x0098, 0x0099, 0x009a, 0x009b, 0x009c, 0x009d, 0x009e, 0x009f,
+    0x00a0, 0x00a1, 0x00a2, 0x00a3, 0x20ac, 0x00a5, 0x0160, 0x00a7,
+    0x0161, 0x00a9, 0x00aa, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+    0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x017d, 0x00b5, 0x00b6, 0x00b7,
+    0x017e, 0x00b9, 0x00ba, 0x00bb, 0x0152, 0x0153, 0x0178, 0x00bf,
+    0x00c0, 0x00c1, 0x00c2, 0x00c3, 0x00c4, 0x00c5, 0x00c6, 0x00c7,
+    0x00c8, 0x00c9, 0x00ca, 0x00cb, 0x00cc, 0x00cd, 0x00ce, 0x00cf,
+    0x00d0, 0x00d1, 0x00d2, 0x00d3, 0x00d4, 0x00d5, 0x00d6, 0x00d7,
+    0x00d8, 0x00d9, 0x00da, 0x00db, 0x00dc, 0x00dd, 0x00de, 0x00df,
+    0x00e0, 0x00e1, 0x00e2, 0x00e3, 0x00e4, 0x00e5, 0x00e6, 0x00e7,
+    0x00e8, 0x00e9, 0x00ea, 0x00eb, 0x00ec, 0x00ed, 0x00ee, 0x00ef,
+    0x00f0, 0x00f1, 0x00f2, 0x00f3, 0x00f4, 0x00f5, 0x00f6, 0x00f7,
+    0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x00fd, 0x00fe, 0x00ff
+};
+static const uint16_t cp_koi8_r[128] = {
+    0x2500, 0x2502, 0x250c, 0x2510, 0x2514, 0x2518, 0x251c, 0x2524,
+    0x252c, 0x2534, 0x253c, 0x2580, 0x2584, 0x2588, 0x258c, 0x2590,
+    0x2591, 0x2592, 0x2593, 0x2320, 0x25a0, 0x2219, 0x221a, 0x2248,
+    0x2264, 0x2265, 0x00a0, 0x2321, 0x00b0, 0x00b2, 0x00b7, 0x00f7,
+    0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556,
+    0x2557, 0x2558, 0x2559, 0x255a, 0x255b, 0x255c, 0x255d, 0x255e,
+    0x255f, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565,
+    0x2566, 0x2567, 0x2568, 0x2569, 0x256a, 0x256b, 0x256c, 0x00a9,
+    0x044e, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433,
+    0x0445, 0x0438, 0x0439, 0x043a, 0x043b, 0x043c, 0x043d, 0x043e,
+    0x043f, 0x044f, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432,
+    0x044c, 0x044b, 0x0437, 0x0448, 0x044d, 0x0449, 0x0447, 0x044a,
+    0x042e, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413,
+    0x0425, 0x0418, 0x0419, 0x041a, 0x041b, 0x041c, 0x041d, 0x041e,
+    0x041f, 0x042f, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412,
+    0x042c, 0x042b, 0x0417, 0x0428, 0x042d, 0x0429, 0x0427, 0x042a
+};
+
+typedef struct {
+    const char *label;
+    charset_t charset;
+} charset_label_t;
+
+// The WHATWG labels of the charsets supported here
+static const charset_label_t charset_labels[] = {
+    { "utf-8", CHARSET_UTF8 },
+    { "utf8", CHARSET_UTF8 },
+    { "unicode-1-1-utf-8", CHARSET_UTF8 },
+    { "utf-16le", CHARSET_UTF16LE },
+    { "utf-16", CHARSET_UTF16LE },
+    { "unicode", CHARSET_UTF16LE },
+    { "utf-16be", CHARSET_UTF16BE },
+    { "unicodefffe", CHARSET_UTF16BE },
+    { "windows-1250", CHARSET_WINDOWS_1250 },
+    { "cp1250", CHARSET_WINDOWS_1250 },
+    { "x-cp1250", CHARSET_WINDOWS_1250 },
+    { "windows-1251", CHARSET_WINDOWS_1251 },
+    { "cp1251", CHARSET_WINDOWS_1251 },
+    { "x-cp1251", CHARSET_WINDOWS_1251 },
+    { "windows-1252", CHARSET_WINDOWS_1252 },
+    { "cp1252", CHARSET_WINDOWS_1252 },
+    { "x-cp1252", CHARSET_WINDOWS_1252 },
+    { "iso-8859-1", CHARSET_WINDOWS_1252 },
+    { "iso8859-1", CHARSET_WINDOWS_1252 },
+    { "iso_8859-1", CHARSET_WINDOWS_1252 },
+    { "latin1", CHARSET_WINDOWS_1252 },
+    { "l1", CHARSET_WINDOWS_1252 },
+    { "cp819", CHARSET_WINDOWS_1252 },
+    { "ibm819", CHARSET_WINDOWS_1252 },
+    { "us-ascii", CHARSET_WINDOWS_1252 },
+    { "ascii", CHARSET_WINDOWS_1252 },
+    { "iso-8859-2", CHARSET_ISO_8859_2 },
+    { "iso8859-2", CHARSET_ISO_8859_2 },
+    { "iso_8859-2", CHARSET_ISO_8859_2 },
+    { "latin2", CHARSET_ISO_8859_2 },
+    { "l2", CHARSET_ISO_8859_2 },
+    { "iso-8859-15", CHARSET_ISO_8859_15 },
+    { "iso8859-15", CHARSET_ISO_8859_15 },
+    { "iso_8859-15", CHARSET_ISO_8859_15 },
+    { "latin-9", CHARSET_ISO_8859_15 },
+    { "l9", CHARSET_ISO_8859_15 },
+    { "koi8-r", CHARSET_KOI8_R },
+    { "koi8_r", CHARSET_KOI8_R },
+    { "koi8", CHARSET_KOI8_R },
+    { "koi", CHARSET_KOI8_R },
+    { "cskoi8r", CHARSET_KOI8_R },
+    { NULL, CHARSET_UNKNOWN }
+};
+
+charset_t charset_from_label(const char *label, size_t len)
+{
+    while (len > 0 && isspace((unsigned char)label[0])) {
+        label++;
+        len--;
+    }
+    while (len > 0 && isspace((unsigned char)label[len - 1]))
+        len--;
+
+    for (const charset_label_t *l = charset_labels; l->label; l++) {
+        if (strlen(l->label) == len && strncasecmp(l->label, label, len) == 0)
+            return l->charset;
+    }
+    return CHARSET_UNKNOWN;
+}
+
+charset_t charset_from_content_type(const char *content_type, size_t len)
+{
+    const char *p = content_type;
+    const char *end = content_type + len;
+    while (p + 7 <= end) {
+        if (strncasecmp(p, "charset", 7) != 0) {
+            p++;
+            continue;
+        }
+        p += 7;
+        while (p < end && isspace((unsigned char)*p))
+            p++;
+        if (p == end || *p != '=')
+            continue;
+        p++;
+        while (p < end && isspace((unsigned char)*p))
+            p++;
+
+        const char *value = p;
+        if (p < end && (*p == '"' || *p == '\'')) {
+            char q = *p++;
+            value = p;
+            while (p < end && *p != q)
+                p++;
+        } else {
+            while (p < end && *p != ';' && !isspace((unsigned char)*p))
+                p++;
+        }
+        return charset_from_label(value, (size_t)(p - value));
+    }
+    return CHARSET_UNKNOWN;
+}
+
+// ===== <meta> prescan =====
+
+static bool charset_word_eq(const uint8_t *p, size_t len, const char *lower)
+{
+    return strlen(lower) == len && strncasecmp((const char *)p, lower, len) == 0;
+}
+
+// Next attribute of a tag from *pos; false at '>' or the end
+static bool charset_next_attr(const uint8_t *p, size_t len, size_t *pos,
+    const uint8_t **name, size_t *name_len, const uint8_t **value, size_t *value_len)
+{
+    size_t i = *pos;
+    while (i < len && (isspace(p[i]) || p[i] == '/'))
+        i++;
+    if (i >= len || p[i] == '>')
+        return false;
+
+    *name = p + i;
+    while (i < len && !isspace(p[i]) && p[i] != '=' && p[i] != '>' && p[i] != '/')
+        i++;
+    *name_len = (size_t)(p + i - *name);
+
+    while (i < len && isspace(p[i]))
+        i++;
+    *value = p + i;
+    *value_len = 0;
+    if (i < len && p[i] == '=') {
+        i++;
+        while (i < len && isspace(p[i]))
+            i++;
+        if (i < len && (p[i] == '"' || p[i] == '\'')) {
+            uint8_t q = p[i++];
+            *value = p + i;
+            while (i < len && p[i] != q)
+                i++;
+            *value_len = (size_t)(p + i - *value);
+            if (i < len)
+                i++;
+        } else {
+            *value = p + i;
+            while (i < len && !isspace(p[i]) && p[i] != '>')
+                i++;
+            *value_len = (size_t)(p + i - *value);
+        }
+    }
+    *pos = i;
+    return true;
+}
+
+// The charset a <meta charset> or <meta http-equiv="content-type"> in the
+// first bytes declares (the HTML prescan, without the rarer corners)
+static charset_t charset_prescan(const uint8_t *p, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        if (p[i] != '<') {
+            i++;
+            continue;
+        }
+
+        if (len - i >= 4 && memcmp(p + i, "<!--", 4) == 0) {
+            size_t j = i + 4;
+            while (j + 3 <= len && memcmp(p + j, "-->", 3) != 0)
+                j++;
+            i = j + 3;
+            continue;
+        }
+
+        if (len - i >= 6 && charset_word_eq(p + i + 1, 4, "meta") &&
+            (isspace(p[i + 5]) || p[i + 5] == '/')) {
+            size_t pos = i + 5;
+            const uint8_t *name, *value;
+            size_t name_len, value_len;
+            bool pragma = false;
+            charset_t declared = CHARSET_UNKNOWN, content = CHARSET_UNKNOWN;
+            while (charset_next_attr(p, len, &pos, &name, &name_len, &value, &value_len)) {
+                if (charset_word_eq(name, name_len, "charset"))
+                    declared = charset_from_label((const char *)value, value_len);
+                else if (charset_word_eq(name, name_len, "http-equiv"))
+                    pragma = charset_word_eq(value, value_len, "content-type");
+                else if (charset_word_eq(name, name_len, "content"))
+                    content = charset_from_content_type((const char *)value, value_len);
+            }
+            charset_t found = declared != CHARSET_UNKNOWN ? declared :
+                pragma ? content : CHARSET_UNKNOWN;
+            // A document that could be read this far is not UTF-16
+            if (found == CHARSET_UTF16LE || found == CHARSET_UTF16BE)
+                found = CHARSET_UTF8;
+            if (found != CHARSET_UNKNOWN)
+                return found;
+            i = pos;
+            continue;
+        }
+
+        // Any other tag, </...>, <!...> or <?...>: skip to its end
+        i++;
+        while (i < len && p[i] != '>')
+            i++;
+    }
+    return CHARSET_UNKNOWN;
+}
+
+// ===== Output =====
+
+static errno_t charset_flush(charset_decoder_t *dec)
+{
+    if (dec->out_len == 0)
+        return EOK;
+    size_t n = dec->out_len;
+    dec->out_len = 0;
+    return dec->sink ? dec->sink(dec->out, n, dec->arg) : EOK;
+}
+
+static errno_t charset_put(charset_decoder_t *dec, uint32_t cp)
+{
+    if (dec->out_len + 4 > sizeof(dec->out)) {
+        errno_t rc = charset_flush(dec);
+        if (rc != EOK)
+            return rc;
+    }
+    uint8_t *o = dec->out + dec->out_len;
+    if (cp < 0x80) {
+        o[0] = (uint8_t)cp;
+        dec->out_len += 1;
+    } else if (cp < 0x800) {
+        o[0] = (uint8_t)(0xc0 | cp >> 6);
+        o[1] = (uint8_t)(0x80 | (cp & 0x3f));
+        dec->out_len += 2;
+    } else if (cp < 0x10000) {
+        o[0] = (uint8_t)(0xe0 | cp >> 12);
+        o[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+        o[2] = (uint8_t)(0x80 | (cp & 0x3f));
+        dec->out_len += 3;
+    } else {
+        o[0] = (uint8_t)(0xf0 | cp >> 18);
+        o[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3f));
+        o[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+        o[3] = (uint8_t)(0x80 | (cp & 0x3f));
+        dec->out_len += 4;
+    }
+    return EOK;
+}
+
+// Leading bytes below 0x80, eight at a time
+static size_t charset_ascii_run(const uint8_t *p, size_t len)
+{
+    size_t i = 0;
+    while (i + 8 <= len) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        if (w & 0x8080808080808080ULL)
+            break;
+        i += 8;
+    }
+    while (i < len && p[i] < 0x80)
+        i++;
+    return i;
+}
+
+// ===== Transcoding =====
+
+static errno_t charset_single_byte(charset_decoder_t *dec, const uint8_t *p, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        size_t run = charset_ascii_run(p + i, len - i);
+        if (run >= CHARSET_DIRECT_RUN) {
+            errno_t rc = charset_flush(dec);
+            if (rc == EOK && dec->sink)
+                rc = dec->sink(p + i, run, dec->arg);
+            if (rc != EOK)
+                return rc;
+        } else {
+            size_t done = 0;
+            while (done < run) {
+                size_t room = sizeof(dec->out) - dec->out_len;
+                if (room == 0) {
+                    errno_t rc = charset_flush(dec);
+                    if (rc != EOK)
+                        return rc;
+                    continue;
+                }
+                size_t n = run - done < room ? run - done : room;
+                memcpy(dec->out + dec->out_len, p + i + done, n);
+                dec->out_len += n;
+                done += n;
+            }
+        }
+        i += run;
+
+        while (i < len && p[i] >= 0x80) {
+            errno_t rc = charset_put(dec, dec->table[p[i] - 0x80]);
+            if (rc != EOK)
+                return rc;
+            i++;
+        }
+    }
+    return EOK;
+}
+
+static errno_t charset_utf16(charset_decoder_t *dec, const uint8_t *p, size_t len)
+{
+    bool be = dec->charset == CHARSET_UTF16BE;
+    size_t i = 0;
+    while (i < len) {
+        uint8_t b0, b1;
+        if (dec->odd_byte >= 0) {
+            b0 = (uint8_t)dec->odd_byte;
+            b1 = p[i++];
+            dec->odd_byte = -1;
+        } else if (i + 1 < len) {
+            b0 = p[i];
+            b1 = p[i + 1];
+            i += 2;
+        } else {
+            dec->odd_byte = p[i++];
+            break;
+        }
+        uint16_t unit = be ? (uint16_t)(b0 << 8 | b1) : (uint16_t)(b1 << 8 | b0);
+
+        uint32_t cp;
+        if (dec->high_surrogate) {
+            if (unit >= 0xdc00 && unit <= 0xdfff) {
+                cp = 0x10000 + ((uint32_t)(dec->high_surrogate - 0xd800) << 10) + (unit - 0xdc00);
+                dec->high_surrogate = 0;
+            } else {
+                // Unpaired: replaced, and this unit stands on its own
+                errno_t rc = charset_put(dec, 0xfffd);
+                if (rc != EOK)
+                    return rc;
+                dec->high_surrogate = 0;
+                if (unit >= 0xd800 && unit <= 0xdbff) {
+                    dec->high_surrogate = unit;
+                    continue;
+                }
+                cp = unit >= 0xdc00 && unit <= 0xdfff ? 0xfffd : unit;
+            }
+        } else if (unit >= 0xd800 && unit <= 0xdbff) {
+            dec->high_surrogate = unit;
+            continue;
+        } else {
+            cp = unit >= 0xdc00 && unit <= 0xdfff ? 0xfffd : unit;
+        }
+
+        errno_t rc = charset_put(dec, cp);
+        if (rc != EOK)
+            return rc;
+    }
+    return EOK;
+}
+
+static errno_t charset_convert(charset_decoder_t *dec, const uint8_t *p, size_t len)
+{
+    if (len == 0)
+        return EOK;
+    switch (dec->charset) {
+    case CHARSET_UTF16LE:
+    case CHARSET_UTF16BE:
+        return charset_utf16(dec, p, len);
+    case CHARSET_UTF8:
+    case CHARSET_UNKNOWN:
+        // Already what the parser takes
+        return dec->sink ? dec->sink(p, len, dec->arg) : EOK;
+    default:
+        return charset_single_byte(dec, p, len);
+    }
+}
+
+// ===== API =====
+
+void charset_decoder_init(charset_decoder_t *dec, charset_sink_t sink, void *arg)
+{
+    dec->sink = sink;
+    dec->arg = arg;
+    dec->header = CHARSET_UNKNOWN;
+    dec->charset = CHARSET_UNKNOWN;
+    dec->decided = false;
+    dec->table = NULL;
+    dec->prescan_len = 0;
+    dec->odd_byte = -1;
+    dec->high_surrogate = 0;
+    dec->out_len = 0;
+}
+
+void charset_decoder_set_content_type(charset_decoder_t *dec, const char *content_type)
+{
+    if (content_type)
+        dec->header = charset_from_content_type(content_type, strlen(content_type));
+}
+
+static void charset_use(charset_decoder_t *dec, charset_t charset)
+{
+    dec->charset = charset;
+    dec->decided = true;
+    switch (charset) {
+    case CHARSET_WINDOWS_1250:
+        dec->table = cp_windows_1250;
+        break;
+    case CHARSET_WINDOWS_1251:
+        dec->table = cp_windows_1251;
+        break;
+    case CHARSET_WINDOWS_1252:
+        dec->table = cp_windows_1252;
+        break;
+    case CHARSET_ISO_8859_2:
+        dec->table = cp_iso_8859_2;
+        break;
+    case CHARSET_ISO_8859_15:
+        dec->table = cp_iso_8859_15;
+        break;
+    case CHARSET_KOI8_R:
+        dec->table = cp_koi8_r;
+        break;
+    default:
+        dec->table = NULL;
+        break;
+    }
+}
+
+// Settle the charset from what is held back; false = wait for more.
+// *skip gets the length of the byte order mark.
+static bool charset_decide(charset_decoder_t *dec, bool final, size_t *skip)
+{
+    const uint8_t *p = dec->prescan;
+    size_t n = dec->prescan_len;
+    *skip = 0;
+
+    if (n < 3 && !final)
+        return false;
+    if (n >= 3 && p[0] == 0xef && p[1] == 0xbb && p[2] == 0xbf) {
+        *skip = 3;
+        charset_use(dec, CHARSET_UTF8);
+        return true;
+    }
+    if (n >= 2 && p[0] == 0xfe && p[1] == 0xff) {
+        *skip = 2;
+        charset_use(dec, CHARSET_UTF16BE);
+        return true;
+    }
+    if (n >= 2 && p[0] == 0xff && p[1] == 0xfe) {
+        *skip = 2;
+        charset_use(dec, CHARSET_UTF16LE);
+        return true;
+    }
+
+    if (dec->header != CHARSET_UNKNOWN) {
+        charset_use(dec, dec->header);
+        return true;
+    }
+    if (n < sizeof(dec->prescan) && !final)
+        return false;
+
+    charset_t meta = charset_prescan(p, n);
+    charset_use(dec, meta != CHARSET_UNKNOWN ? meta : CHARSET_UTF8);
+    return true;
+}
+
+errno_t charset_decoder_feed(charset_decoder_t *dec, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    errno_t rc;
+
+    if (!dec->decided) {
+        size_t take = sizeof(dec->prescan) - dec->prescan_len;
+        if (take > len)
+            take = len;
+        memcpy(dec->prescan + dec->prescan_len, p, take);
+        dec->prescan_len += take;
+        p += take;
+        len -= take;
+
+        // The buffer is full whenever input is left over, so this decides
+        size_t skip;
+        if (!charset_decide(dec, false, &skip))
+            return EOK;
+        rc = charset_convert(dec, dec->prescan + skip, dec->prescan_len - skip);
+        if (rc != EOK)
+            return rc;
+    }
+
+    rc = charset_convert(dec, p, len);
+    if (rc == EOK)
+        rc = charset_flush(dec);
+    return rc;
+}
+
+errno_t charset_decoder_finish(charset_decoder_t *dec)
+{
+    errno_t rc = EOK;
+    if (!dec->decided) {
+        size_t skip;
+        charset_decide(dec, true, &skip);
+        rc = charset_convert(dec, dec->prescan + skip, dec->prescan_len - skip);
+    }
+
+    // A unit or pair cut off by the end of the document
+    if (rc == EOK && (dec->odd_byte >= 0 || dec->high_surrogate)) {
+        dec->odd_byte = -1;
+        dec->high_surrogate = 0;
+        rc = charset_put(dec, 0xfffd);
+    }
+    if (rc == EOK)
+        rc = charset_flush(dec);
+    return rc;
+}
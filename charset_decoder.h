@@ -0,0 +1,75 @@
+// charset_decoder.h - Document charset detection and transcoding to UTF-8
+#ifndef CHARSET_DECODER_H
+#define CHARSET_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Without a BOM or a header charset, this much of the document is held
+// back and searched for <meta charset> before anything is passed on
+#define CHARSET_PRESCAN_BYTES 1024
+
+// Transcoded output is collected in a buffer of this size
+#define CHARSET_OUT_CHUNK 4096
+
+// ASCII runs at least this long go to the sink straight from the input
+#define CHARSET_DIRECT_RUN 64
+
+typedef enum {
+    CHARSET_UNKNOWN,
+    CHARSET_UTF8,
+    CHARSET_UTF16LE,
+    CHARSET_UTF16BE,
+    CHARSET_WINDOWS_1250,
+    CHARSET_WINDOWS_1251,
+    CHARSET_WINDOWS_1252,       // also what "iso-8859-1" and "us-ascii" mean on the web
+    CHARSET_ISO_8859_2,
+    CHARSET_ISO_8859_15,
+    CHARSET_KOI8_R
+} charset_t;
+
+// UTF-8 text in order; anything but EOK aborts with that code
+typedef errno_t (*charset_sink_t)(const void *data, size_t len, void *arg);
+
+typedef struct {
+    charset_sink_t sink;
+    void *arg;
+
+    charset_t header;           // from Content-Type, CHARSET_UNKNOWN if none
+    charset_t charset;          // in use once decided
+    bool decided;
+    const uint16_t *table;      // single-byte charsets: 0x80..0xff
+
+    uint8_t prescan[CHARSET_PRESCAN_BYTES];
+    size_t prescan_len;
+
+    // UTF-16: odd byte of a unit split across pieces, pending high surrogate
+    int16_t odd_byte;           // -1 = none
+    uint16_t high_surrogate;    // 0 = none
+
+    uint8_t out[CHARSET_OUT_CHUNK];
+    size_t out_len;
+} charset_decoder_t;
+
+// WHATWG encoding label ("latin2", "windows-1251", ...), any case;
+// CHARSET_UNKNOWN for labels not supported here
+charset_t charset_from_label(const char *label, size_t len);
+
+// The charset= parameter of a Content-Type value (or of a <meta content>)
+charset_t charset_from_content_type(const char *content_type, size_t len);
+
+void charset_decoder_init(charset_decoder_t *dec, charset_sink_t sink, void *arg);
+
+// Content-Type of the response, before the first feed. A byte order mark
+// still wins over it; it wins over <meta>.
+void charset_decoder_set_content_type(charset_decoder_t *dec, const char *content_type);
+
+// Next piece of the document, any split
+errno_t charset_decoder_feed(charset_decoder_t *dec, const void *data, size_t len);
+
+// End of the document: whatever is held back goes out
+errno_t charset_decoder_finish(charset_decoder_t *dec);
+
+#endif // CHARSET_DECODER_H
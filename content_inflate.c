@@ -0,0 +1,681 @@
+// content_inflate.c - Streaming gzip/deflate decoding of response bodies
+//
+// Requests said "Accept-Encoding: identity", so every page and script came
+// over the wire uncompressed, often three to five times the bytes it
+// could have been. Bodies may now arrive gzip or deflate encoded, and this
+// decoder inflates them as they come off the socket. It keeps its place
+// anywhere in the stream, down to single bytes, so nothing is buffered
+// beyond the 32 KiB deflate window. That window is also the output buffer:
+// decoded bytes are handed to the sink straight from it, whenever it wraps
+// and at the end of every piece of input, and the next bytes overwrite
+// them.
+//
+// A length/distance pair is only decoded once all of its bits are in, so
+// a piece that ends in the middle of one just leaves the bits buffered.
+// The decoder needs no state inside a symbol. Huffman codes up to
+// CONTENT_INFLATE_FAST_BITS long take one table lookup; longer ones walk
+// the canonical code. The gzip CRC-32 and size and the zlib Adler-32
+// trailers are checked. A gzip body may hold several members, one after
+// the other (gzip -c a b); they are decoded as one stream, and anything
+// else after a member is an error.
+#include <string.h>
+
+#include "content_inflate.h"
+
+#define INFLATE_MASK (CONTENT_INFLATE_WINDOW - 1)
+
+enum {
+    INF_GZIP_HEADER,            // magic, method, flags
+    INF_GZIP_FIXED,             // mtime, xfl, os
+    INF_GZIP_EXTRA_LEN,
+    INF_GZIP_EXTRA,
+    INF_GZIP_NAME,
+    INF_GZIP_COMMENT,
+    INF_GZIP_HCRC,
+    INF_ZLIB_HEADER,            // or raw deflate: told apart here
+    INF_BLOCK,
+    INF_STORED_LEN,
+    INF_STORED,
+    INF_TABLE_COUNTS,
+    INF_TABLE_CODELENS,
+    INF_TABLE_LENS,
+    INF_CODES,
+    INF_TRAILER,                // to the byte boundary, output flushed
+    INF_GZIP_CRC,
+    INF_GZIP_SIZE,
+    INF_ZLIB_ADLER,
+    INF_DONE,
+    INF_ERROR
+};
+
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t codelen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// CRC-32 (reflected 0xEDB88320), four bits at a time
+static const uint32_t crc_nibble[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+content_encoding_t content_encoding_parse(const char *header)
+{
+    if (!header || !header[0])
+        return CONTENT_ENCODING_IDENTITY;
+    if (strcasecmp(header, "gzip") == 0 || strcasecmp(header, "x-gzip") == 0)
+        return CONTENT_ENCODING_GZIP;
+    if (strcasecmp(header, "deflate") == 0)
+        return CONTENT_ENCODING_DEFLATE;
+    if (strcasecmp(header, "identity") == 0)
+        return CONTENT_ENCODING_IDENTITY;
+    return CONTENT_ENCODING_UNKNOWN;
+}
+
+void content_inflate_init(content_inflate_t *inf, content_encoding_t encoding,
+    content_inflate_sink_t sink, void *arg)
+{
+    // The window and tables need no clearing
+    inf->encoding = encoding;
+    inf->sink = sink;
+    inf->arg = arg;
+    inf->state = encoding == CONTENT_ENCODING_GZIP ? INF_GZIP_HEADER : INF_ZLIB_HEADER;
+    inf->final_block = false;
+    inf->bits = 0;
+    inf->nbits = 0;
+    inf->gzip_flags = 0;
+    inf->skip = 0;
+    inf->check = 0;
+    inf->total = 0;
+    inf->zlib = false;
+    inf->wpos = 0;
+    inf->flushed = 0;
+    inf->produced = 0;
+}
+
+// ===== Bits =====
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} inflate_input_t;
+
+// At least n (<= 57) bits buffered? Takes what input there is.
+static bool inflate_need(content_inflate_t *inf, inflate_input_t *in, unsigned n)
+{
+    while (inf->nbits <= 56 && in->p < in->end) {
+        inf->bits |= (uint64_t)*in->p++ << inf->nbits;
+        inf->nbits += 8;
+    }
+    return inf->nbits >= n;
+}
+
+static void inflate_drop(content_inflate_t *inf, unsigned n)
+{
+    inf->bits >>= n;
+    inf->nbits -= n;
+}
+
+// ===== Huffman codes =====
+
+// Canonical code from code lengths; false if over-subscribed
+static bool inflate_build(content_huffman_t *h, const uint8_t *lens, unsigned n)
+{
+    memset(h->count, 0, sizeof(h->count));
+    for (unsigned i = 0; i < n; i++)
+        h->count[lens[i]]++;
+    h->count[0] = 0;
+
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0)
+            return false;
+    }
+
+    uint16_t offs[16];
+    uint16_t next[16];
+    offs[1] = 0;
+    for (int len = 1; len < 15; len++)
+        offs[len + 1] = offs[len] + h->count[len];
+    unsigned code = 0;
+    for (int len = 1; len < 16; len++) {
+        code = (code + h->count[len - 1]) << 1;
+        next[len] = (uint16_t)code;
+    }
+
+    memset(h->fast, 0, sizeof(h->fast));
+    for (unsigned sym = 0; sym < n; sym++) {
+        unsigned len = lens[sym];
+        if (len == 0)
+            continue;
+        h->symbol[offs[len]++] = (uint16_t)sym;
+
+        unsigned c = next[len]++;
+        if (len > CONTENT_INFLATE_FAST_BITS)
+            continue;
+        // Codes go on the wire most significant bit first
+        unsigned rev = 0;
+        for (unsigned i = 0; i < len; i++)
+            rev |= ((c >> i) & 1) << (len - 1 - i);
+        for (unsigned j = rev; j < (1u << CONTENT_INFLATE_FAST_BITS); j += 1u << len)
+            h->fast[j] = (uint16_t)(sym << 4 | len);
+    }
+    return true;
+}
+
+// Symbol at the front of bits (nbits of them valid), its code length in
+// *len; -1 when more bits are needed, -2 for a code that does not exist
+static int inflate_peek(const content_huffman_t *h, uint64_t bits, unsigned nbits,
+    unsigned *len)
+{
+    uint16_t e = h->fast[bits & ((1u << CONTENT_INFLATE_FAST_BITS) - 1)];
+    if (e) {
+        if ((e & 15) > nbits)
+            return -1;
+        *len = e & 15;
+        return e >> 4;
+    }
+
+    int code = 0, first = 0, index = 0;
+    for (unsigned l = 1; l < 16; l++) {
+        if (l > nbits)
+            return -1;
+        code |= (int)((bits >> (l - 1)) & 1);
+        int count = h->count[l];
+        if (code - count < first) {
+            *len = l;
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -2;
+}
+
+static void inflate_fixed(content_inflate_t *inf)
+{
+    uint8_t *lens = inf->lens;
+    unsigned i = 0;
+    for (; i < 144; i++)
+        lens[i] = 8;
+    for (; i < 256; i++)
+        lens[i] = 9;
+    for (; i < 280; i++)
+        lens[i] = 7;
+    for (; i < 288; i++)
+        lens[i] = 8;
+    inflate_build(&inf->litlen, lens, 288);
+    for (i = 0; i < 30; i++)
+        lens[i] = 5;
+    inflate_build(&inf->dist, lens, 30);
+}
+
+// ===== Output =====
+
+static void inflate_checksum(content_inflate_t *inf, const uint8_t *p, size_t len)
+{
+    if (inf->encoding == CONTENT_ENCODING_GZIP) {
+        uint32_t c = ~inf->check;
+        for (size_t i = 0; i < len; i++) {
+            c ^= p[i];
+            c = (c >> 4) ^ crc_nibble[c & 15];
+            c = (c >> 4) ^ crc_nibble[c & 15];
+        }
+        inf->check = ~c;
+        inf->total += (uint32_t)len;
+    } else if (inf->zlib) {
+        uint32_t a = inf->check & 0xffff, b = inf->check >> 16;
+        while (len > 0) {
+            // Largest run before the sums can overflow
+            size_t n = len < 5552 ? len : 5552;
+            len -= n;
+            while (n--) {
+                a += *p++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        inf->check = b << 16 | a;
+    }
+}
+
+// Hand window[flushed, wpos) to the sink
+static errno_t inflate_flush(content_inflate_t *inf)
+{
+    size_t n = inf->wpos - inf->flushed;
+    if (n == 0)
+        return EOK;
+    const uint8_t *p = inf->window + inf->flushed;
+    inflate_checksum(inf, p, n);
+    inf->flushed = inf->wpos;
+    return inf->sink ? inf->sink(p, n, inf->arg) : EOK;
+}
+
+static inline errno_t inflate_put(content_inflate_t *inf, uint8_t byte)
+{
+    inf->window[inf->wpos++] = byte;
+    inf->produced++;
+    if (inf->wpos < CONTENT_INFLATE_WINDOW)
+        return EOK;
+    errno_t rc = inflate_flush(inf);
+    inf->wpos = 0;
+    inf->flushed = 0;
+    return rc;
+}
+
+static errno_t inflate_copy(content_inflate_t *inf, unsigned dist, unsigned len)
+{
+    while (len--) {
+        errno_t rc = inflate_put(inf, inf->window[(inf->wpos - dist) & INFLATE_MASK]);
+        if (rc != EOK)
+            return rc;
+    }
+    return EOK;
+}
+
+// ===== Blocks =====
+
+// Literals and length/distance pairs until the end of block or of input
+static errno_t inflate_codes(content_inflate_t *inf, inflate_input_t *in)
+{
+    for (;;) {
+        inflate_need(inf, in, 48);
+        uint64_t bits = inf->bits;
+        unsigned nbits = inf->nbits;
+
+        unsigned len;
+        int sym = inflate_peek(&inf->litlen, bits, nbits, &len);
+        if (sym == -1)
+            return EOK;
+        if (sym < 0)
+            return EIO;
+
+        if (sym < 256) {
+            inflate_drop(inf, len);
+            errno_t rc = inflate_put(inf, (uint8_t)sym);
+            if (rc != EOK)
+                return rc;
+            continue;
+        }
+        if (sym == 256) {
+            inflate_drop(inf, len);
+            inf->state = inf->final_block ? INF_TRAILER : INF_BLOCK;
+            return EOK;
+        }
+
+        sym -= 257;
+        if (sym >= 29)
+            return EIO;
+        unsigned used = len;
+        unsigned extra = length_extra[sym];
+        if (used + extra > nbits)
+            return EOK;
+        unsigned length = length_base[sym] + (unsigned)((bits >> used) & ((1u << extra) - 1));
+        used += extra;
+
+        unsigned dlen;
+        int dsym = inflate_peek(&inf->dist, bits >> used, nbits - used, &dlen);
+        if (dsym == -1)
+            return EOK;
+        if (dsym < 0 || dsym >= 30)
+            return EIO;
+        used += dlen;
+        extra = dist_extra[dsym];
+        if (used + extra > nbits)
+            return EOK;
+        unsigned dist = dist_base[dsym] + (unsigned)((bits >> used) & ((1u << extra) - 1));
+        used += extra;
+
+        if (dist > inf->produced)
+            return EIO;
+        inflate_drop(inf, used);
+        errno_t rc = inflate_copy(inf, dist, length);
+        if (rc != EOK)
+            return rc;
+    }
+}
+
+// Code lengths of a dynamic block, run-length coded with the code length code
+static errno_t inflate_lengths(content_inflate_t *inf, inflate_input_t *in)
+{
+    unsigned total = inf->nlen + inf->ndist;
+    while (inf->have < total) {
+        inflate_need(inf, in, 32);
+        unsigned len;
+        int sym = inflate_peek(&inf->litlen, inf->bits, inf->nbits, &len);
+        if (sym == -1)
+            return EOK;
+        if (sym < 0)
+            return EIO;
+
+        if (sym < 16) {
+            inflate_drop(inf, len);
+            inf->lens[inf->have++] = (uint8_t)sym;
+            continue;
+        }
+
+        unsigned extra = sym == 16 ? 2 : sym == 17 ? 3 : 7;
+        if (len + extra > inf->nbits)
+            return EOK;
+        unsigned repeat = (unsigned)((inf->bits >> len) & ((1u << extra) - 1));
+        uint8_t value = 0;
+        if (sym == 16) {
+            if (inf->have == 0)
+                return EIO;
+            value = inf->lens[inf->have - 1];
+            repeat += 3;
+        } else {
+            repeat += sym == 17 ? 3 : 11;
+        }
+        if (inf->have + repeat > total)
+            return EIO;
+        inflate_drop(inf, len + extra);
+        while (repeat--)
+            inf->lens[inf->have++] = value;
+    }
+
+    // A block without an end code could never finish
+    if (inf->lens[256] == 0)
+        return EIO;
+    if (!inflate_build(&inf->litlen, inf->lens, inf->nlen) ||
+        !inflate_build(&inf->dist, inf->lens + inf->nlen, inf->ndist))
+        return EIO;
+    inf->state = INF_CODES;
+    return EOK;
+}
+
+// Skip inf->skip bytes, or up to and including a NUL
+static bool inflate_skip_bytes(content_inflate_t *inf, inflate_input_t *in, bool to_nul)
+{
+    for (;;) {
+        if (!to_nul && inf->skip == 0)
+            return true;
+        if (!inflate_need(inf, in, 8))
+            return false;
+        uint8_t b = inf->bits & 0xff;
+        inflate_drop(inf, 8);
+        if (to_nul && b == 0)
+            return true;
+        if (!to_nul)
+            inf->skip--;
+    }
+}
+
+static errno_t inflate_run(content_inflate_t *inf, inflate_input_t *in)
+{
+    for (;;) {
+        switch (inf->state) {
+        case INF_GZIP_HEADER:
+            if (!inflate_need(inf, in, 32))
+                return EOK;
+            if ((inf->bits & 0xffffff) != 0x088b1f)
+                return EIO;
+            inf->gzip_flags = (uint8_t)(inf->bits >> 24);
+            inflate_drop(inf, 32);
+            inf->skip = 6;
+            inf->state = INF_GZIP_FIXED;
+            break;
+
+        case INF_GZIP_FIXED:
+            if (!inflate_skip_bytes(inf, in, false))
+                return EOK;
+            inf->state = INF_GZIP_EXTRA_LEN;
+            break;
+
+        case INF_GZIP_EXTRA_LEN:
+            if (inf->gzip_flags & GZIP_FEXTRA) {
+                if (!inflate_need(inf, in, 16))
+                    return EOK;
+                inf->skip = inf->bits & 0xffff;
+                inflate_drop(inf, 16);
+            }
+            inf->state = INF_GZIP_EXTRA;
+            break;
+
+        case INF_GZIP_EXTRA:
+            if (!inflate_skip_bytes(inf, in, false))
+                return EOK;
+            inf->state = INF_GZIP_NAME;
+            break;
+
+        case INF_GZIP_NAME:
+            if ((inf->gzip_flags & GZIP_FNAME) && !inflate_skip_bytes(inf, in, true))
+                return EOK;
+            inf->state = INF_GZIP_COMMENT;
+            break;
+
+        case INF_GZIP_COMMENT:
+            if ((inf->gzip_flags & GZIP_FCOMMENT) && !inflate_skip_bytes(inf, in, true))
+                return EOK;
+            inf->state = INF_GZIP_HCRC;
+            break;
+
+        case INF_GZIP_HCRC:
+            if (inf->gzip_flags & GZIP_FHCRC) {
+                if (!inflate_need(inf, in, 16))
+                    return EOK;
+                inflate_drop(inf, 16);
+            }
+            inf->state = INF_BLOCK;
+            break;
+
+        case INF_ZLIB_HEADER: {
+            if (!inflate_need(inf, in, 16))
+                return EOK;
+            unsigned cmf = inf->bits & 0xff, flg = (inf->bits >> 8) & 0xff;
+            if ((cmf & 0x0f) == 8 && (cmf >> 4) <= 7 && ((cmf << 8) | flg) % 31 == 0) {
+                // A preset dictionary is never used over HTTP
+                if (flg & 0x20)
+                    return EIO;
+                inf->zlib = true;
+                inf->check = 1;
+                inflate_drop(inf, 16);
+            }
+            inf->state = INF_BLOCK;
+            break;
+        }
+
+        case INF_BLOCK: {
+            if (!inflate_need(inf, in, 3))
+                return EOK;
+            inf->final_block = inf->bits & 1;
+            unsigned type = (inf->bits >> 1) & 3;
+            inflate_drop(inf, 3);
+            if (type == 0) {
+                inflate_drop(inf, inf->nbits & 7);
+                inf->state = INF_STORED_LEN;
+            } else if (type == 1) {
+                inflate_fixed(inf);
+                inf->state = INF_CODES;
+            } else if (type == 2) {
+                inf->state = INF_TABLE_COUNTS;
+            } else {
+                return EIO;
+            }
+            break;
+        }
+
+        case INF_STORED_LEN: {
+            if (!inflate_need(inf, in, 32))
+                return EOK;
+            uint32_t len = inf->bits & 0xffff;
+            uint32_t nlen = (inf->bits >> 16) & 0xffff;
+            if (len != (~nlen & 0xffff))
+                return EIO;
+            inflate_drop(inf, 32);
+            inf->skip = len;
+            inf->state = INF_STORED;
+            break;
+        }
+
+        case INF_STORED:
+            // Bytes already in the bit buffer first, then straight from the input
+            while (inf->skip > 0 && inf->nbits >= 8) {
+                errno_t rc = inflate_put(inf, inf->bits & 0xff);
+                inflate_drop(inf, 8);
+                inf->skip--;
+                if (rc != EOK)
+                    return rc;
+            }
+            while (inf->skip > 0 && in->p < in->end) {
+                errno_t rc = inflate_put(inf, *in->p++);
+                inf->skip--;
+                if (rc != EOK)
+                    return rc;
+            }
+            if (inf->skip > 0)
+                return EOK;
+            inf->state = inf->final_block ? INF_TRAILER : INF_BLOCK;
+            break;
+
+        case INF_TABLE_COUNTS:
+            if (!inflate_need(inf, in, 14))
+                return EOK;
+            inf->nlen = (inf->bits & 31) + 257;
+            inf->ndist = ((inf->bits >> 5) & 31) + 1;
+            inf->ncode = ((inf->bits >> 10) & 15) + 4;
+            inflate_drop(inf, 14);
+            if (inf->nlen > 286 || inf->ndist > 30)
+                return EIO;
+            memset(inf->lens, 0, 19);
+            inf->have = 0;
+            inf->state = INF_TABLE_CODELENS;
+            break;
+
+        case INF_TABLE_CODELENS:
+            while (inf->have < inf->ncode) {
+                if (!inflate_need(inf, in, 3))
+                    return EOK;
+                inf->lens[codelen_order[inf->have++]] = inf->bits & 7;
+                inflate_drop(inf, 3);
+            }
+            // The code length code lives in the literal table until the
+            // real one is built over it
+            if (!inflate_build(&inf->litlen, inf->lens, 19))
+                return EIO;
+            inf->have = 0;
+            inf->state = INF_TABLE_LENS;
+            break;
+
+        case INF_TABLE_LENS: {
+            errno_t rc = inflate_lengths(inf, in);
+            if (rc != EOK || inf->state == INF_TABLE_LENS)
+                return rc;
+            break;
+        }
+
+        case INF_CODES: {
+            errno_t rc = inflate_codes(inf, in);
+            if (rc != EOK || inf->state == INF_CODES)
+                return rc;
+            break;
+        }
+
+        case INF_TRAILER: {
+            inflate_drop(inf, inf->nbits & 7);
+            // The check covers everything, including what is still in the window
+            errno_t rc = inflate_flush(inf);
+            if (rc != EOK)
+                return rc;
+            if (inf->encoding == CONTENT_ENCODING_GZIP)
+                inf->state = INF_GZIP_CRC;
+            else
+                inf->state = inf->zlib ? INF_ZLIB_ADLER : INF_DONE;
+            break;
+        }
+
+        case INF_GZIP_CRC:
+            if (!inflate_need(inf, in, 32))
+                return EOK;
+            if ((uint32_t)inf->bits != inf->check)
+                return EIO;
+            inflate_drop(inf, 32);
+            inf->state = INF_GZIP_SIZE;
+            break;
+
+        case INF_GZIP_SIZE:
+            if (!inflate_need(inf, in, 32))
+                return EOK;
+            if ((uint32_t)inf->bits != inf->total)
+                return EIO;
+            inflate_drop(inf, 32);
+            inf->state = INF_DONE;
+            break;
+
+        case INF_ZLIB_ADLER: {
+            if (!inflate_need(inf, in, 32))
+                return EOK;
+            uint32_t v = (uint32_t)inf->bits;
+            uint32_t adler = v >> 24 | (v >> 8 & 0xff00) | (v << 8 & 0xff0000) | v << 24;
+            if (adler != inf->check)
+                return EIO;
+            inflate_drop(inf, 32);
+            inf->state = INF_DONE;
+            break;
+        }
+
+        case INF_DONE:
+            // More after a gzip member is the next member; its header
+            // rejects anything else
+            if (inf->encoding == CONTENT_ENCODING_GZIP &&
+                (inf->nbits > 0 || in->p < in->end)) {
+                inf->final_block = false;
+                inf->check = 0;
+                inf->total = 0;
+                inf->state = INF_GZIP_HEADER;
+                break;
+            }
+            // zlib and raw deflate: padding after the end is ignored
+            in->p = in->end;
+            return EOK;
+
+        default:
+            return EIO;
+        }
+    }
+}
+
+errno_t content_inflate_feed(content_inflate_t *inf, const void *data, size_t len)
+{
+    if (inf->state == INF_ERROR)
+        return EIO;
+
+    inflate_input_t in = { data, (const uint8_t *)data + len };
+    errno_t rc = inflate_run(inf, &in);
+    // Everything decoded so far goes out now, not when the window fills
+    if (rc == EOK)
+        rc = inflate_flush(inf);
+    if (rc != EOK)
+        inf->state = INF_ERROR;
+    return rc;
+}
+
+errno_t content_inflate_finish(content_inflate_t *inf)
+{
+    return inf->state == INF_DONE ? EOK : EIO;
+}
@@ -0,0 +1,75 @@
+// content_inflate.h - Streaming gzip/deflate decoding of response bodies
+#ifndef CONTENT_INFLATE_H
+#define CONTENT_INFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Back-reference window of deflate; decoded bytes are handed out from it
+#define CONTENT_INFLATE_WINDOW (32 * 1024)
+
+// Codes up to this long are decoded with one table lookup
+#define CONTENT_INFLATE_FAST_BITS 9
+
+typedef enum {
+    CONTENT_ENCODING_IDENTITY,
+    CONTENT_ENCODING_GZIP,
+    CONTENT_ENCODING_DEFLATE,       // zlib wrapper, or raw deflate as some servers send
+    CONTENT_ENCODING_UNKNOWN        // br, compress, ...: not requested, not decoded
+} content_encoding_t;
+
+// Decoded bytes, in order; anything but EOK aborts the decode with that code
+typedef errno_t (*content_inflate_sink_t)(const void *data, size_t len, void *arg);
+
+typedef struct {
+    uint16_t fast[1 << CONTENT_INFLATE_FAST_BITS];  // symbol << 4 | length, 0 = slow path
+    uint16_t count[16];                             // codes per length
+    uint16_t symbol[288];                           // symbols in canonical order
+} content_huffman_t;
+
+typedef struct {
+    content_encoding_t encoding;
+    content_inflate_sink_t sink;
+    void *arg;
+
+    int state;
+    bool final_block;
+    uint64_t bits;              // unread input bits, LSB first
+    unsigned nbits;
+
+    // Wrapper
+    uint8_t gzip_flags;
+    uint32_t skip;              // header bytes still to skip / stored bytes to copy
+    uint32_t check;             // CRC-32 (gzip) or Adler-32 (zlib) of the output
+    uint32_t total;             // output size mod 2^32 (gzip)
+    bool zlib;                  // deflate with a zlib header
+
+    // Dynamic block header
+    unsigned nlen, ndist, ncode, have;
+    uint8_t lens[320];
+    content_huffman_t litlen;
+    content_huffman_t dist;
+
+    // Output: the window doubles as the buffer handed to the sink
+    uint8_t window[CONTENT_INFLATE_WINDOW];
+    size_t wpos;                // next byte written
+    size_t flushed;             // window[flushed, wpos) not yet handed out
+    uint64_t produced;
+} content_inflate_t;
+
+// Content-Encoding header value (NULL/"" = identity)
+content_encoding_t content_encoding_parse(const char *header);
+
+// encoding must be GZIP or DEFLATE
+void content_inflate_init(content_inflate_t *inf, content_encoding_t encoding,
+    content_inflate_sink_t sink, void *arg);
+
+// Decode the next piece of the body (any split). EIO on corrupt data.
+errno_t content_inflate_feed(content_inflate_t *inf, const void *data, size_t len);
+
+// End of the body: EIO if the stream stopped short or its check failed
+errno_t content_inflate_finish(content_inflate_t *inf);
+
+#endif // CONTENT_INFLATE_H
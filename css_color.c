@@ -0,0 +1,244 @@
+// css_color.c - CSS color string parsing (named, #hex, rgb(), rgba())
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <str.h>
+
+#include "css_color.h"
+
+// Named colors laid out by a perfect hash (css_color_hash() & CSS_COLOR_HASH_MASK),
+// so a lookup is one hash, one slot, one compare. Regenerate the slots (and the
+// seed, if two names collide) whenever a color is added.
+#define CSS_COLOR_HASH_SEED 0x3e2d0u
+#define CSS_COLOR_HASH_MASK 63u
+#define CSS_COLOR_NAME_MAX 10
+
+static const css_named_color_t css_named_colors[CSS_COLOR_HASH_MASK + 1] = {
+    [1] = {"navy", 0xFF000080},
+    [4] = {"maroon", 0xFF800000},
+    [8] = {"magenta", 0xFFFF00FF},
+    [9] = {"lightred", 0xFFFF6347},
+    [11] = {"red", 0xFFFF0000},
+    [12] = {"lime", 0xFF00FF00},
+    [15] = {"cyan", 0xFF00FFFF},
+    [16] = {"silver", 0xFFC0C0C0},
+    [17] = {"lightgray", 0xFFD3D3D3},
+    [18] = {"grey", 0xFF808080},
+    [19] = {"gold", 0xFFFFD700},
+    [20] = {"lightblue", 0xFFADD8E6},
+    [21] = {"lightgreen", 0xFF90EE90},
+    [22] = {"brown", 0xFFA52A2A},
+    [25] = {"dimgray", 0xFF696969},
+    [26] = {"orange", 0xFFFFA500},
+    [27] = {"lightgrey", 0xFFD3D3D3},
+    [28] = {"gray", 0xFF808080},
+    [30] = {"darkgrey", 0xFFA9A9A9},
+    [31] = {"olive", 0xFF808000},
+    [34] = {"yellow", 0xFFFFFF00},
+    [35] = {"darkgray", 0xFFA9A9A9},
+    [37] = {"violet", 0xFFEE82EE},
+    [38] = {"purple", 0xFF800080},
+    [39] = {"darkblue", 0xFF00008B},
+    [40] = {"blue", 0xFF0000FF},
+    [46] = {"dimgrey", 0xFF696969},
+    [50] = {"fuchsia", 0xFFFF00FF},
+    [53] = {"darkred", 0xFF8B0000},
+    [54] = {"green", 0xFF008000},
+    [55] = {"white", 0xFFFFFFFF},
+    [57] = {"aqua", 0xFF00FFFF},
+    [59] = {"darkgreen", 0xFF006400},
+    [60] = {"teal", 0xFF008080},
+    [61] = {"pink", 0xFFFFC0CB},
+    [63] = {"black", 0xFF000000},
+};
+
+/**
+ * @brief FNV-1a over the lowercased name, with a final xor-fold so the
+ *        low bits (the slot) depend on the whole hash.
+ */
+static uint32_t css_color_hash(const char *name, size_t len)
+{
+    uint32_t x = CSS_COLOR_HASH_SEED;
+    for (size_t i = 0; i < len; i++) {
+        x ^= (uint8_t)tolower((unsigned char)name[i]);
+        x *= 16777619u;
+    }
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * @brief Looks up a named color.
+ * @param name Color name (case-insensitive, not necessarily NUL-terminated).
+ * @param len Length of the name.
+ * @param out Receives the ARGB value when found.
+ * @return true if the name is a known color.
+ */
+bool css_named_color_lookup(const char *name, size_t len, uint32_t *out)
+{
+    if (len == 0 || len > CSS_COLOR_NAME_MAX)
+        return false;
+
+    const css_named_color_t *nc =
+        &css_named_colors[css_color_hash(name, len) & CSS_COLOR_HASH_MASK];
+    if (nc->name == NULL || strlen(nc->name) != len ||
+        str_ncasecmp(name, nc->name, len) != 0)
+        return false;
+
+    *out = nc->value;
+    return true;
+}
+
+/**
+ * @brief Parses a hex color string (#RGB, #RRGGBB).
+ * @param str Hex string starting after '#'.
+ * @param len Length of the hex part (3 or 6).
+ * @return 32-bit ARGB color.
+ */
+uint32_t parse_hex_color(const char *str, size_t len) {
+    uint32_t color = 0xFF000000;  // Default: opaque black
+    
+    if (len == 3) {
+        // #RGB -> #RRGGBB (your implementation is perfect)
+        for (int i = 0; i < 3; i++) {
+            int d = hex_digit(str[i]);
+            if (d == -1) return 0xFF000000;
+            uint8_t byte = (d * 16) + d;
+            // Shift: R=16, G=8, B=0
+            color |= (uint32_t)byte << (16 - i * 8);
+        }
+    } else if (len == 6) {
+        // #RRGGBB (your implementation is perfect)
+        int d1 = hex_digit(str[0]);
+        int d2 = hex_digit(str[1]);
+        int d3 = hex_digit(str[2]);
+        int d4 = hex_digit(str[3]);
+        int d5 = hex_digit(str[4]);
+        int d6 = hex_digit(str[5]);
+        
+        if (d1 == -1 || d2 == -1 || d3 == -1 || d4 == -1 || d5 == -1 || d6 == -1)
+            return 0xFF000000;
+        
+        uint8_t r = (d1 * 16) + d2;
+        uint8_t g = (d3 * 16) + d4;
+        uint8_t b = (d5 * 16) + d6;
+        
+        color = 0xFF000000 | (r << 16) | (g << 8) | b;
+    } else if (len == 8) {
+        // #RRGGBBAA (ADDED: Support 8-digit hex with alpha)
+        int d1 = hex_digit(str[0]);
+        int d2 = hex_digit(str[1]);
+        int d3 = hex_digit(str[2]);
+        int d4 = hex_digit(str[3]);
+        int d5 = hex_digit(str[4]);
+        int d6 = hex_digit(str[5]);
+        int d7 = hex_digit(str[6]);
+        int d8 = hex_digit(str[7]);
+        
+        if (d1 == -1 || d2 == -1 || d3 == -1 || d4 == -1 || 
+            d5 == -1 || d6 == -1 || d7 == -1 || d8 == -1)
+            return 0xFF000000;
+        
+        uint8_t r = (d1 * 16) + d2;
+        uint8_t g = (d3 * 16) + d4;
+        uint8_t b = (d5 * 16) + d6;
+        uint8_t a = (d7 * 16) + d8;  // Alpha channel
+        
+        // ARGB format: a << 24 | r << 16 | g << 8 | b
+        color = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+    // Note: len == 4 (#RGBA) could also be supported if needed
+    
+    return color;
+}
+
+/**
+ * @brief Converts a hex character ('0'-'9', 'a'-'f', 'A'-'F') to its integer value.
+ */
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+
+/**
+ * @brief Parses a CSS color value into 32-bit ARGB.
+ * @param color_str Color string (named, #hex, rgb(), rgba()).
+ * @param out Receives the color when recognized.
+ * @return true if the value was a color this parser understands.
+ */
+bool css_color_parse(const char *color_str, uint32_t *out)
+{
+    if (!color_str) return false;
+
+    while (isspace((unsigned char)*color_str)) color_str++;
+    size_t len = strlen(color_str);
+
+    // Trim whitespace
+    while (len > 0 && isspace((unsigned char)color_str[len-1])) len--;
+    if (len == 0) return false;
+
+    // 1. Check for Hex color (#...)
+    if (color_str[0] == '#') {
+        if (len == 4 || len == 7 || len == 9) {
+            for (size_t i = 1; i < len; i++) {
+                if (hex_digit(color_str[i]) == -1) return false;
+            }
+            *out = parse_hex_color(color_str + 1, len - 1);
+            return true;
+        }
+        return false;
+    }
+
+    // 2. Check for Named color (case-insensitive)
+    if (css_named_color_lookup(color_str, len, out))
+        return true;
+
+    // 3. Check for rgb() functional notation
+    if (str_ncasecmp(color_str, "rgb(", 4) == 0 && len > 4) {
+        int r, g, b;
+        // Try to parse rgb(r, g, b) format
+        if (sscanf(color_str + 4, "%d ,%d ,%d", &r, &g, &b) == 3) {
+            // Clamp values
+            r = (r < 0) ? 0 : (r > 255) ? 255 : r;
+            g = (g < 0) ? 0 : (g > 255) ? 255 : g;
+            b = (b < 0) ? 0 : (b > 255) ? 255 : b;
+
+            *out = 0xFF000000 | (r << 16) | (g << 8) | b;
+            return true;
+        }
+    }
+
+    // 4. Check for rgba() functional notation
+    if (str_ncasecmp(color_str, "rgba(", 5) == 0 && len > 5) {
+        int r, g, b;
+        float a;
+        if (sscanf(color_str + 5, "%d ,%d ,%d ,%f", &r, &g, &b, &a) == 4) {
+            // Clamp values
+            r = (r < 0) ? 0 : (r > 255) ? 255 : r;
+            g = (g < 0) ? 0 : (g > 255) ? 255 : g;
+            b = (b < 0) ? 0 : (b > 255) ? 255 : b;
+            a = (a < 0.0f) ? 0.0f : (a > 1.0f) ? 1.0f : a;
+
+            uint8_t alpha = (uint8_t)(a * 255);
+            *out = ((uint32_t)alpha << 24) | (r << 16) | (g << 8) | b;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t css_color_to_uint32(const char *color_str) {
+    uint32_t color;
+
+    if (css_color_parse(color_str, &color))
+        return color;
+
+    return 0xFF000000; // Default black if unrecognized
+}
@@ -0,0 +1,40 @@
+// css_color.h - CSS color string parsing (named, #hex, rgb(), rgba())
+#ifndef CSS_COLOR_H
+#define CSS_COLOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct {
+    const char *name;
+    uint32_t value;
+} css_named_color_t;
+
+// Parse any supported CSS color into 32-bit ARGB; false when unrecognized
+bool css_color_parse(const char *color_str, uint32_t *out);
+
+// Same, but black when unrecognized
+uint32_t css_color_to_uint32(const char *color_str);
+
+// Perfect-hash lookup of a named color (case-insensitive)
+bool css_named_color_lookup(const char *name, size_t len, uint32_t *out);
+
+// Composite a translucent ARGB color over white, result is opaque
+static inline uint32_t css_color_over_white(uint32_t argb)
+{
+    uint32_t a = argb >> 24;
+    if (a == 0xFF)
+        return argb;
+
+    uint32_t inv = 255 - a;
+    uint32_t r = (((argb >> 16) & 0xFF) * a + 255 * inv) / 255;
+    uint32_t g = (((argb >> 8) & 0xFF) * a + 255 * inv) / 255;
+    uint32_t b = ((argb & 0xFF) * a + 255 * inv) / 255;
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+uint32_t parse_hex_color(const char *str, size_t len);
+int hex_digit(char c);
+
+#endif // CSS_COLOR_H
@@ -0,0 +1,387 @@
+// dom_id_index.c - Per-document id -> element hash index
+//
+// getElementById, the JS style bridge and the layout merge used to walk the
+// whole DOM (attr_by_name("id") + memcmp on every element) for each lookup.
+// The index is built once after parsing and updated when scripts change ids;
+// lookups are one FNV-1a hash and a short linear probe.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dom_id_index.h"
+
+#define DOM_ID_INDEX_MIN_CAPACITY 64
+
+typedef struct {
+    char *id;                       // NULL = empty slot
+    size_t len;
+    uint32_t hash;
+    bool deleted;                   // tombstone, keeps probe chains intact
+    bool refill;                    // element removed, look for the next holder
+    lxb_dom_element_t *element;     // NULL when only a layout entry exists
+    cJSON *layout;
+} dom_id_entry_t;
+
+static lxb_html_document_t *indexed_document = NULL;
+static dom_id_entry_t *entries = NULL;
+static size_t capacity = 0;
+static size_t used = 0;             // live + tombstones
+
+static uint32_t dom_id_hash(const char *id, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)id[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static dom_id_entry_t *dom_id_lookup(const char *id, size_t len, uint32_t hash)
+{
+    if (!entries)
+        return NULL;
+
+    size_t mask = capacity - 1;
+    for (size_t i = hash & mask, n = 0; n < capacity; i = (i + 1) & mask, n++) {
+        dom_id_entry_t *e = &entries[i];
+        if (!e->id && !e->deleted)
+            return NULL;
+        if (e->id && e->hash == hash && e->len == len && memcmp(e->id, id, len) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+static errno_t dom_id_grow(void)
+{
+    size_t new_capacity = capacity ? capacity * 2 : DOM_ID_INDEX_MIN_CAPACITY;
+    dom_id_entry_t *new_entries = calloc(new_capacity, sizeof(dom_id_entry_t));
+    if (!new_entries)
+        return ENOMEM;
+
+    size_t live = 0;
+    for (size_t i = 0; i < capacity; i++) {
+        dom_id_entry_t *e = &entries[i];
+        if (!e->id)
+            continue;
+        size_t j = e->hash & (new_capacity - 1);
+        while (new_entries[j].id)
+            j = (j + 1) & (new_capacity - 1);
+        new_entries[j] = *e;
+        live++;
+    }
+
+    free(entries);
+    entries = new_entries;
+    capacity = new_capacity;
+    used = live;
+    return EOK;
+}
+
+// Find the entry for id, creating an empty one if missing
+static dom_id_entry_t *dom_id_get_or_add(const char *id, size_t len)
+{
+    uint32_t hash = dom_id_hash(id, len);
+    dom_id_entry_t *e = dom_id_lookup(id, len, hash);
+    if (e)
+        return e;
+
+    // Keep the load (including tombstones) under 3/4
+    if ((used + 1) * 4 > capacity * 3 && dom_id_grow() != EOK)
+        return NULL;
+
+    char *key = malloc(len + 1);
+    if (!key)
+        return NULL;
+    memcpy(key, id, len);
+    key[len] = '\0';
+
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    while (entries[i].id)
+        i = (i + 1) & mask;
+
+    e = &entries[i];
+    if (!e->deleted)
+        used++;
+    e->id = key;
+    e->len = len;
+    e->hash = hash;
+    e->deleted = false;
+    e->element = NULL;
+    e->layout = NULL;
+    return e;
+}
+
+static void dom_id_remove(dom_id_entry_t *e)
+{
+    free(e->id);
+    e->id = NULL;
+    e->deleted = true;
+    e->element = NULL;
+    e->layout = NULL;
+}
+
+typedef bool (*dom_id_visit_t)(lxb_dom_element_t *, const lxb_char_t *, size_t, void *);
+
+// Pre-order walk, calling visit() for every element with a non-empty id.
+// The subtree at prune (if any) is left out. Stops early when visit()
+// returns true.
+static lxb_dom_element_t *dom_id_walk_pruned(lxb_dom_node_t *root,
+    lxb_dom_node_t *prune, dom_id_visit_t visit, void *arg)
+{
+    lxb_dom_node_t *node = root;
+
+    while (node) {
+        if (node != prune && node->type == LXB_DOM_NODE_TYPE_ELEMENT) {
+            lxb_dom_element_t *element = lxb_dom_interface_element(node);
+            size_t id_len = 0;
+            const lxb_char_t *id = lxb_dom_element_id(element, &id_len);
+            if (id && id_len > 0 && visit(element, id, id_len, arg))
+                return element;
+        }
+
+        lxb_dom_node_t *next = (node != prune) ? lxb_dom_node_first_child(node) : NULL;
+        while (!next && node && node != root) {
+            next = lxb_dom_node_next(node);
+            if (!next)
+                node = lxb_dom_node_parent(node);
+        }
+        node = next;
+    }
+
+    return NULL;
+}
+
+static lxb_dom_element_t *dom_id_walk(lxb_dom_node_t *root, dom_id_visit_t visit, void *arg)
+{
+    return dom_id_walk_pruned(root, NULL, visit, arg);
+}
+
+static bool dom_id_build_visit(lxb_dom_element_t *element, const lxb_char_t *id,
+    size_t len, void *arg)
+{
+    errno_t *rc = arg;
+    dom_id_entry_t *e = dom_id_get_or_add((const char *)id, len);
+    if (!e) {
+        *rc = ENOMEM;
+        return true;
+    }
+    // Duplicate ids: the first one in document order wins
+    if (!e->element)
+        e->element = element;
+    return false;
+}
+
+typedef struct {
+    const char *id;
+    size_t len;
+    lxb_dom_element_t *skip;
+} dom_id_match_t;
+
+static bool dom_id_match_visit(lxb_dom_element_t *element, const lxb_char_t *id,
+    size_t len, void *arg)
+{
+    dom_id_match_t *m = arg;
+    return element != m->skip && len == m->len && memcmp(id, m->id, len) == 0;
+}
+
+errno_t dom_id_index_build(lxb_html_document_t *document)
+{
+    if (!document)
+        return EINVAL;
+    if (document == indexed_document)
+        return EOK;
+
+    dom_id_index_clear();
+
+    errno_t rc = EOK;
+    dom_id_walk(lxb_dom_interface_node(document), dom_id_build_visit, &rc);
+    if (rc != EOK) {
+        dom_id_index_clear();
+        return rc;
+    }
+
+    indexed_document = document;
+    printf("DOM id index: %zu ids\n", used);
+    return EOK;
+}
+
+void dom_id_index_clear(void)
+{
+    for (size_t i = 0; i < capacity; i++)
+        free(entries[i].id);
+    free(entries);
+    entries = NULL;
+    capacity = 0;
+    used = 0;
+    indexed_document = NULL;
+}
+
+bool dom_id_index_is_built(lxb_html_document_t *document)
+{
+    return document && document == indexed_document;
+}
+
+lxb_dom_element_t *dom_id_index_find(const char *id, size_t len)
+{
+    if (!id || len == 0)
+        return NULL;
+
+    dom_id_entry_t *e = dom_id_lookup(id, len, dom_id_hash(id, len));
+    return e ? e->element : NULL;
+}
+
+void dom_id_index_id_changed(lxb_dom_element_t *element,
+    const char *old_id, size_t old_len, const char *new_id, size_t new_len)
+{
+    if (!element || !indexed_document)
+        return;
+    if (old_len == new_len && (old_len == 0 || memcmp(old_id, new_id, old_len) == 0))
+        return;
+
+    if (old_id && old_len > 0) {
+        dom_id_entry_t *e = dom_id_lookup(old_id, old_len, dom_id_hash(old_id, old_len));
+        if (e && e->element == element) {
+            // Rare: fall back to a walk for another element with the old id
+            dom_id_match_t m = { old_id, old_len, element };
+            e->element = dom_id_walk(lxb_dom_interface_node(indexed_document),
+                dom_id_match_visit, &m);
+            if (!e->element && !e->layout)
+                dom_id_remove(e);
+        }
+    }
+
+    if (new_id && new_len > 0) {
+        dom_id_entry_t *e = dom_id_get_or_add(new_id, new_len);
+        // An id already taken keeps its element; document order is not
+        // re-checked for script-made duplicates
+        if (e && !e->element)
+            e->element = element;
+    }
+}
+
+typedef struct {
+    lxb_dom_element_t *keep;
+    size_t count;
+} dom_id_unlink_t;
+
+static bool dom_id_unlink_visit(lxb_dom_element_t *element, const lxb_char_t *id,
+    size_t len, void *arg)
+{
+    dom_id_unlink_t *u = arg;
+    if (element == u->keep)
+        return false;
+
+    dom_id_entry_t *e = dom_id_lookup((const char *)id, len, dom_id_hash((const char *)id, len));
+    if (e && e->element == element) {
+        e->element = NULL;
+        e->refill = true;
+        u->count++;
+    }
+    return false;
+}
+
+static bool dom_id_refill_visit(lxb_dom_element_t *element, const lxb_char_t *id,
+    size_t len, void *arg)
+{
+    (void)arg;
+    dom_id_entry_t *e = dom_id_lookup((const char *)id, len, dom_id_hash((const char *)id, len));
+    if (e && e->refill && !e->element)
+        e->element = element;
+    return false;
+}
+
+void dom_id_index_remove_subtree(lxb_dom_node_t *root, bool keep_root)
+{
+    if (!root || !indexed_document)
+        return;
+
+    dom_id_unlink_t u = { keep_root ? lxb_dom_interface_element(root) : NULL, 0 };
+    if (root->type != LXB_DOM_NODE_TYPE_ELEMENT)
+        u.keep = NULL;
+    dom_id_walk(root, dom_id_unlink_visit, &u);
+    if (u.count == 0)
+        return;
+
+    // One walk of the rest of the document hands each id to its next holder
+    dom_id_walk_pruned(lxb_dom_interface_node(indexed_document), root,
+        dom_id_refill_visit, NULL);
+
+    for (size_t i = 0; i < capacity; i++) {
+        dom_id_entry_t *e = &entries[i];
+        if (!e->id || !e->refill)
+            continue;
+        e->refill = false;
+        if (!e->element && !e->layout)
+            dom_id_remove(e);
+    }
+}
+
+errno_t dom_id_index_set_attribute(lxb_dom_element_t *element,
+    const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    if (!element || !name || !value)
+        return EINVAL;
+
+    bool is_id = (name_len == 2 && memcmp(name, "id", 2) == 0);
+    char *old_id = NULL;
+    size_t old_len = 0;
+
+    if (is_id) {
+        const lxb_char_t *cur = lxb_dom_element_id(element, &old_len);
+        if (cur && old_len > 0) {
+            old_id = malloc(old_len);
+            if (!old_id)
+                return ENOMEM;
+            memcpy(old_id, cur, old_len);
+        } else {
+            old_len = 0;
+        }
+    }
+
+    lxb_dom_attr_t *attr = lxb_dom_element_set_attribute(element,
+        (const lxb_char_t *)name, name_len, (const lxb_char_t *)value, value_len);
+    if (!attr) {
+        free(old_id);
+        return ENOMEM;
+    }
+
+    if (is_id)
+        dom_id_index_id_changed(element, old_id, old_len, value, value_len);
+
+    free(old_id);
+    return EOK;
+}
+
+void dom_id_index_attach_layout(cJSON *elements)
+{
+    // Drop stale layout pointers from a previous layout pass
+    for (size_t i = 0; i < capacity; i++)
+        entries[i].layout = NULL;
+
+    if (!elements)
+        return;
+
+    cJSON *item;
+    cJSON_ArrayForEach(item, elements) {
+        if (!item->string || !cJSON_IsObject(item))
+            continue;
+        size_t len = strlen(item->string);
+        // Only id-keyed entries; anonymous ones are "element_<n>"
+        dom_id_entry_t *e = dom_id_lookup(item->string, len, dom_id_hash(item->string, len));
+        if (e && !e->layout)
+            e->layout = item;
+    }
+}
+
+cJSON *dom_id_index_find_layout(const char *id, size_t len)
+{
+    if (!id || len == 0)
+        return NULL;
+
+    dom_id_entry_t *e = dom_id_lookup(id, len, dom_id_hash(id, len));
+    return e ? e->layout : NULL;
+}
@@ -0,0 +1,41 @@
+// dom_id_index.h - Per-document id -> element hash index
+#ifndef DOM_ID_INDEX_H
+#define DOM_ID_INDEX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <lexbor/html/html.h>
+#include <lexbor/dom/dom.h>
+
+#include "cjson.h"
+
+// Build the index for document (one DOM walk). Rebuilding for the document
+// that is already indexed is a no-op.
+errno_t dom_id_index_build(lxb_html_document_t *document);
+void dom_id_index_clear(void);
+bool dom_id_index_is_built(lxb_html_document_t *document);
+
+// getElementById: first element in document order with that id, or NULL
+lxb_dom_element_t *dom_id_index_find(const char *id, size_t len);
+
+// Keep the index in sync when an element's id changes (NULL/0 = no id)
+void dom_id_index_id_changed(lxb_dom_element_t *element,
+    const char *old_id, size_t old_len, const char *new_id, size_t new_len);
+
+// The subtree at root (root itself too unless keep_root) is about to be
+// destroyed or detached: its elements leave the index, and each id they
+// held passes to the next element in document order that carries it
+void dom_id_index_remove_subtree(lxb_dom_node_t *root, bool keep_root);
+
+// Set an attribute through the index, so "id" changes are tracked
+errno_t dom_id_index_set_attribute(lxb_dom_element_t *element,
+    const char *name, size_t name_len, const char *value, size_t value_len);
+
+// Layout entries (calculate_document_layout "elements", keyed by id) share
+// the same slots, so the layout merge finds them without scanning.
+// NULL detaches (the layout tree is about to be freed).
+void dom_id_index_attach_layout(cJSON *elements);
+cJSON *dom_id_index_find_layout(const char *id, size_t len);
+
+#endif // DOM_ID_INDEX_H
@@ -1,307 +1,871 @@
-// event_handler.c - Simple and correct implementation
+// event_handler.c - Inline and script event handlers, keyed by element
+//
+// Handlers used to sit in a fixed EventHandler[100] array as source text:
+// the 101st was dropped and get_element_events_json() scanned the whole
+// array for every element it serialized. They are now kept per node in a
+// growable open-addressing table, each node with a bitmask of the event
+// types it listens for, so "does this node care about click" is a hash
+// lookup and a bit test. Inline on* attributes stay as source until their
+// first dispatch and are compiled to a JS function once.
 #include "event_handler.h"
 #include "js_executor_quickjs.h"
+#include "js_element.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
-#define MAX_EVENT_HANDLERS 100
+#define EVENT_TABLE_MIN 64
+
+// Known events get one mask bit each; anything else shares the last bit
+// and is told apart by name
+static const char *const event_names[] = {
+    "click", "dblclick", "mousedown", "mouseup", "mouseover",
+    "mouseout", "mousemove", "keydown", "keyup", "keypress",
+    "submit", "change", "focus", "blur", "load", "unload",
+    "resize", "scroll", "contextmenu", "input", "select",
+    "abort", "error", "hashchange", "popstate", "pageshow",
+    "pagehide", "online", "offline", NULL
+};
+
+#define EVENT_TYPE_OTHER 31
+
+enum {
+    EVENT_PHASE_CAPTURING = 1,
+    EVENT_PHASE_AT_TARGET = 2,
+    EVENT_PHASE_BUBBLING = 3
+};
+
+typedef enum {
+    EVENT_LISTENER_SOURCE,      // inline code, not compiled yet
+    EVENT_LISTENER_READY,       // func is callable
+    EVENT_LISTENER_FAILED       // inline code that did not compile
+} event_listener_state_t;
+
+typedef struct event_listener {
+    int type;                   // index into event_names or EVENT_TYPE_OTHER
+    char *type_name;            // only for EVENT_TYPE_OTHER
+    char *code;                 // on* attribute source, NULL for addEventListener
+    JSValue func;
+    event_listener_state_t state;
+    bool capture;
+    bool removed;               // unlinked once no dispatch is running
+    struct event_listener *next;
+} event_listener_t;
+
+typedef struct {
+    lxb_dom_element_t *element;     // NULL = empty
+    uint32_t bubble_mask;           // types with non-capture listeners
+    uint32_t capture_mask;          // types with capture listeners
+    event_listener_t *head;         // in registration order
+    event_listener_t *tail;
+} event_node_t;
+
+static event_node_t *nodes = NULL;
+static size_t node_capacity = 0;
+static size_t node_count = 0;
+
+// Elements in the order they got their first handler, for the JSON output
+static lxb_dom_element_t **node_order = NULL;
+static size_t node_order_capacity = 0;
 
-static EventHandler event_handlers[MAX_EVENT_HANDLERS];
 static int handler_count = 0;
+static int dispatch_depth = 0;
+static bool prune_pending = false;
+
+// Listeners of destroyed elements, freed once no dispatch is running
+static event_listener_t *orphans = NULL;
+
+static JSContext *handler_ctx = NULL;  // owner of every func / event_proto
+static JSValue event_proto;
+static bool event_proto_ready = false;
+
+
+// ===== Event types =====
+
+static int event_type_index(const char *name, size_t len) {
+    for (int i = 0; event_names[i] != NULL; i++) {
+        if (strlen(event_names[i]) == len && memcmp(event_names[i], name, len) == 0)
+            return i;
+    }
+    return EVENT_TYPE_OTHER;
+}
+
+static uint32_t event_type_bit(int type) {
+    return (uint32_t)1 << type;
+}
+
+static const char *event_listener_type(const event_listener_t *l) {
+    return l->type == EVENT_TYPE_OTHER ? l->type_name : event_names[l->type];
+}
+
+static bool event_listener_matches(const event_listener_t *l, int type, const char *name) {
+    if (l->type != type)
+        return false;
+    return type != EVENT_TYPE_OTHER || strcmp(l->type_name, name) == 0;
+}
+
+
+// ===== Node table =====
+
+static size_t event_node_hash(const lxb_dom_element_t *element) {
+    uintptr_t p = (uintptr_t)element;
+    p ^= p >> 17;
+    p *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (size_t)(p ^ (p >> 29));
+}
+
+static event_node_t *event_node_find(const lxb_dom_element_t *element) {
+    if (!nodes || !element)
+        return NULL;
+
+    size_t mask = node_capacity - 1;
+    for (size_t i = event_node_hash(element) & mask; nodes[i].element; i = (i + 1) & mask) {
+        if (nodes[i].element == element)
+            return &nodes[i];
+    }
+    return NULL;
+}
+
+static bool event_node_grow(void) {
+    size_t new_capacity = node_capacity ? node_capacity * 2 : EVENT_TABLE_MIN;
+    event_node_t *slots = calloc(new_capacity, sizeof(event_node_t));
+    if (!slots)
+        return false;
+
+    for (size_t i = 0; i < node_capacity; i++) {
+        if (!nodes[i].element)
+            continue;
+        size_t j = event_node_hash(nodes[i].element) & (new_capacity - 1);
+        while (slots[j].element)
+            j = (j + 1) & (new_capacity - 1);
+        slots[j] = nodes[i];
+    }
+
+    free(nodes);
+    nodes = slots;
+    node_capacity = new_capacity;
+    return true;
+}
+
+// Pointers into the table are only good until the next event_node_get()
+static event_node_t *event_node_get(lxb_dom_element_t *element) {
+    event_node_t *node = event_node_find(element);
+    if (node)
+        return node;
+
+    if (node_count == node_order_capacity) {
+        size_t capacity = node_order_capacity ? node_order_capacity * 2 : EVENT_TABLE_MIN;
+        lxb_dom_element_t **order = realloc(node_order, capacity * sizeof(*order));
+        if (!order)
+            return NULL;
+        node_order = order;
+        node_order_capacity = capacity;
+    }
+    if ((node_count + 1) * 4 > node_capacity * 3 && !event_node_grow())
+        return NULL;
+
+    size_t mask = node_capacity - 1;
+    size_t i = event_node_hash(element) & mask;
+    while (nodes[i].element)
+        i = (i + 1) & mask;
+
+    nodes[i].element = element;
+    node_order[node_count++] = element;
+    return &nodes[i];
+}
+
+// Backward-shift delete, so no probe chain is cut short by the hole
+static void event_node_delete(event_node_t *node) {
+    size_t mask = node_capacity - 1;
+    size_t hole = (size_t)(node - nodes);
+
+    for (size_t i = (hole + 1) & mask; nodes[i].element; i = (i + 1) & mask) {
+        size_t home = event_node_hash(nodes[i].element) & mask;
+        bool stays = (hole < i) ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!stays) {
+            nodes[hole] = nodes[i];
+            hole = i;
+        }
+    }
+    memset(&nodes[hole], 0, sizeof(nodes[hole]));
+    node_count--;
+}
+
+static void event_node_update_masks(event_node_t *node) {
+    node->bubble_mask = 0;
+    node->capture_mask = 0;
+    for (event_listener_t *l = node->head; l; l = l->next) {
+        if (l->removed)
+            continue;
+        if (l->capture)
+            node->capture_mask |= event_type_bit(l->type);
+        else
+            node->bubble_mask |= event_type_bit(l->type);
+    }
+}
+
+static void event_node_append(event_node_t *node, event_listener_t *l) {
+    if (node->tail)
+        node->tail->next = l;
+    else
+        node->head = l;
+    node->tail = l;
+
+    if (l->capture)
+        node->capture_mask |= event_type_bit(l->type);
+    else
+        node->bubble_mask |= event_type_bit(l->type);
+    handler_count++;
+}
+
+
+// ===== Listeners =====
+
+static void event_listener_free(event_listener_t *l) {
+    if (l->state == EVENT_LISTENER_READY && handler_ctx)
+        JS_FreeValue(handler_ctx, l->func);
+    free(l->type_name);
+    free(l->code);
+    free(l);
+}
+
+static event_listener_t *event_listener_new(const char *type, size_t type_len) {
+    event_listener_t *l = calloc(1, sizeof(event_listener_t));
+    if (!l)
+        return NULL;
+
+    l->type = event_type_index(type, type_len);
+    if (l->type == EVENT_TYPE_OTHER) {
+        l->type_name = malloc(type_len + 1);
+        if (!l->type_name) {
+            free(l);
+            return NULL;
+        }
+        memcpy(l->type_name, type, type_len);
+        l->type_name[type_len] = '\0';
+    }
+    l->func = JS_UNDEFINED;
+    return l;
+}
 
+// Drop a listener now, or mark it when a dispatch may be walking the list
+static void event_listener_remove(event_node_t *node, event_listener_t *l) {
+    if (l->removed)
+        return;
+    l->removed = true;
+    handler_count--;
+
+    if (dispatch_depth > 0) {
+        prune_pending = true;
+        event_node_update_masks(node);
+        return;
+    }
+
+    event_listener_t *prev = NULL;
+    for (event_listener_t *p = node->head; p; prev = p, p = p->next) {
+        if (p != l)
+            continue;
+        if (prev)
+            prev->next = l->next;
+        else
+            node->head = l->next;
+        if (node->tail == l)
+            node->tail = prev;
+        break;
+    }
+    event_listener_free(l);
+    event_node_update_masks(node);
+}
+
+// Unlink what was removed while handlers were running
+static void event_handler_prune(void) {
+    prune_pending = false;
+    while (orphans) {
+        event_listener_t *next = orphans->next;
+        event_listener_free(orphans);
+        orphans = next;
+    }
+    for (size_t i = 0; i < node_capacity; i++) {
+        event_node_t *node = &nodes[i];
+        if (!node->element)
+            continue;
+
+        event_listener_t **link = &node->head;
+        node->tail = NULL;
+        while (*link) {
+            event_listener_t *l = *link;
+            if (l->removed) {
+                *link = l->next;
+                event_listener_free(l);
+            } else {
+                node->tail = l;
+                link = &l->next;
+            }
+        }
+    }
+}
+
+
+// ===== Inline attributes =====
 
 void process_events_recursive(lxb_dom_node_t *node) {
     if (!node) return;
-    
+
     while (node) {
         if (node->type == LXB_DOM_NODE_TYPE_ELEMENT) {
             lxb_dom_element_t *elem = lxb_dom_interface_element(node);
-            process_element_events(elem);  // This is from your event_handler.c
+            process_element_events(elem);
         }
-        
+
         // Process children recursively
         lxb_dom_node_t *child = lxb_dom_node_first_child(node);
         if (child) {
             process_events_recursive(child);
         }
-        
+
         // Move to next sibling
         node = lxb_dom_node_next(node);
     }
 }
 
+void process_document_events(lxb_html_document_t *doc) {
+    if (!doc) return;
+    process_events_recursive(lxb_dom_interface_node(doc));
+}
 
 // Check if attribute name is an event attribute (starts with "on" and has valid event name)
-static int is_event_attribute(const char *attr_name) {
+static int is_event_attribute(const char *attr_name, size_t len) {
     // Must start with "on" and be at least 3 chars ("on" + at least 1 char)
-    if (!attr_name || strlen(attr_name) < 3 || 
-        attr_name[0] != 'o' || attr_name[1] != 'n') {
+    if (!attr_name || len < 3 || attr_name[0] != 'o' || attr_name[1] != 'n') {
         return 0;
     }
-    
-    // Common HTML event names (simplified list)
-    const char *event_names[] = {
-        "click", "dblclick", "mousedown", "mouseup", "mouseover", 
-        "mouseout", "mousemove", "keydown", "keyup", "keypress",
-        "submit", "change", "focus", "blur", "load", "unload",
-        "resize", "scroll", "contextmenu", "input", "select",
-        "abort", "error", "hashchange", "popstate", "pageshow",
-        "pagehide", "online", "offline", NULL
-    };
-    
-    // Skip "on" prefix
-    const char *event_part = attr_name + 2;
-    
-    // Check if it matches a known event
-    for (int i = 0; event_names[i] != NULL; i++) {
-        if (strcmp(event_part, event_names[i]) == 0) {
-            return 1;
+    return event_type_index(attr_name + 2, len - 2) != EVENT_TYPE_OTHER;
+}
+
+void event_handler_init(void) {
+    handler_count = 0;
+}
+
+void event_handler_release_js(JSContext *ctx) {
+    if (!ctx || ctx != handler_ctx)
+        return;
+
+    for (size_t i = 0; i < node_capacity; i++) {
+        event_node_t *node = &nodes[i];
+        if (!node->element)
+            continue;
+        for (event_listener_t *l = node->head; l; l = l->next) {
+            if (l->state == EVENT_LISTENER_READY) {
+                JS_FreeValue(ctx, l->func);
+                l->func = JS_UNDEFINED;
+            }
+            // Inline code can be compiled again in a new context
+            if (l->code) {
+                l->state = EVENT_LISTENER_SOURCE;
+            } else if (!l->removed) {
+                l->state = EVENT_LISTENER_SOURCE;
+                l->removed = true;
+                handler_count--;
+                prune_pending = true;
+            }
         }
     }
-    
-    return 0;
-}
 
-// Get event type from attribute name (remove "on" prefix)
-static char* get_event_type(const char *attr_name) {
-    if (!attr_name || strlen(attr_name) < 3) return NULL;
-    return strdup(attr_name + 2); // Skip "on"
+    for (event_listener_t *l = orphans; l; l = l->next) {
+        if (l->state == EVENT_LISTENER_READY) {
+            JS_FreeValue(ctx, l->func);
+            l->func = JS_UNDEFINED;
+            l->state = EVENT_LISTENER_SOURCE;
+        }
+    }
+
+    if (event_proto_ready) {
+        JS_FreeValue(ctx, event_proto);
+        event_proto_ready = false;
+    }
+    handler_ctx = NULL;
+
+    if (prune_pending && dispatch_depth == 0) {
+        event_handler_prune();
+        for (size_t i = 0; i < node_capacity; i++) {
+            if (nodes[i].element)
+                event_node_update_masks(&nodes[i]);
+        }
+    }
 }
 
-void event_handler_init(void) {
+void event_handler_cleanup(void) {
+    for (size_t i = 0; i < node_capacity; i++) {
+        event_listener_t *l = nodes[i].head;
+        while (l) {
+            event_listener_t *next = l->next;
+            event_listener_free(l);
+            l = next;
+        }
+    }
+    while (orphans) {
+        event_listener_t *next = orphans->next;
+        event_listener_free(orphans);
+        orphans = next;
+    }
+    free(nodes);
+    nodes = NULL;
+    node_capacity = 0;
+    node_count = 0;
+    free(node_order);
+    node_order = NULL;
+    node_order_capacity = 0;
     handler_count = 0;
+    prune_pending = false;
 }
 
-void event_handler_cleanup(void) {
-    for (int i = 0; i < handler_count; i++) {
-        if (event_handlers[i].event_type) {
-            free(event_handlers[i].event_type);
+void event_handler_forget_element(lxb_dom_element_t *elem) {
+    event_node_t *node = event_node_find(elem);
+    if (!node)
+        return;
+
+    for (event_listener_t *l = node->head; l; l = l->next) {
+        if (!l->removed) {
+            l->removed = true;
+            handler_count--;
         }
-        if (event_handlers[i].handler_code) {
-            free(event_handlers[i].handler_code);
+    }
+
+    // A running dispatch may still be walking the list: park it
+    if (node->head && dispatch_depth > 0) {
+        node->tail->next = orphans;
+        orphans = node->head;
+        prune_pending = true;
+    } else {
+        for (event_listener_t *l = node->head, *next; l; l = next) {
+            next = l->next;
+            event_listener_free(l);
         }
     }
-    handler_count = 0;
+
+    for (size_t i = 0; i < node_count; i++) {
+        if (node_order[i] == elem) {
+            memmove(&node_order[i], &node_order[i + 1], (node_count - i - 1) * sizeof(*node_order));
+            break;
+        }
+    }
+    event_node_delete(node);
 }
 
-// Get event count - ADD THIS FUNCTION
-int get_event_handler_count() {
+int get_event_handler_count(void) {
     return handler_count;
 }
 
+// Set (or replace) the inline handler for one on* attribute
+static void event_set_inline(lxb_dom_element_t *elem, const char *type, size_t type_len,
+    const lxb_char_t *value, size_t value_len) {
+    char *code = malloc(value_len + 1);
+    if (!code)
+        return;
+    memcpy(code, value, value_len);
+    code[value_len] = '\0';
+
+    event_node_t *node = event_node_get(elem);
+    if (!node) {
+        free(code);
+        return;
+    }
+
+    int index = event_type_index(type, type_len);
+    for (event_listener_t *l = node->head; l; l = l->next) {
+        if (l->code && !l->removed && l->type == index) {
+            // Same attribute seen again: new source, compile again on use
+            if (l->state == EVENT_LISTENER_READY && handler_ctx)
+                JS_FreeValue(handler_ctx, l->func);
+            free(l->code);
+            l->code = code;
+            l->func = JS_UNDEFINED;
+            l->state = EVENT_LISTENER_SOURCE;
+            return;
+        }
+    }
+
+    event_listener_t *l = event_listener_new(type, type_len);
+    if (!l) {
+        free(code);
+        return;
+    }
+    l->code = code;
+    event_node_append(node, l);
+
+    printf("Found event: %s -> %s\n", event_names[l->type], l->code);
+}
+
 void process_element_events(lxb_dom_element_t *elem) {
     if (!elem) return;
-    
-    // Get all attributes
-    lxb_dom_attr_t *attr = lxb_dom_element_first_attribute(elem);
-    
-    while (attr) {
+
+    for (lxb_dom_attr_t *attr = lxb_dom_element_first_attribute(elem); attr;
+         attr = lxb_dom_element_next_attribute(attr)) {
         size_t attr_name_len;
         const lxb_char_t *attr_name = lxb_dom_attr_qualified_name(attr, &attr_name_len);
-        
-        if (attr_name && attr_name_len > 0) {
-            // Convert to C string
-            char *attr_name_str = malloc(attr_name_len + 1);
-            if (attr_name_str) {
-                memcpy(attr_name_str, attr_name, attr_name_len);
-                attr_name_str[attr_name_len] = '\0';
-                
-                // Check if it's an event attribute
-                if (is_event_attribute(attr_name_str)) {
-                    // Get attribute value
-                    size_t value_len;
-                    const lxb_char_t *attr_value = lxb_dom_attr_value(attr, &value_len);
-                    
-                    if (attr_value && value_len > 0) {
-                        // Store handler
-                        if (handler_count < MAX_EVENT_HANDLERS) {
-                            event_handlers[handler_count].element = elem;
-                            event_handlers[handler_count].event_type = get_event_type(attr_name_str);
-                            
-                            // Copy handler code
-                            event_handlers[handler_count].handler_code = malloc(value_len + 1);
-                            if (event_handlers[handler_count].handler_code) {
-                                memcpy(event_handlers[handler_count].handler_code, 
-                                       attr_value, value_len);
-                                event_handlers[handler_count].handler_code[value_len] = '\0';
-                                
-                                printf("Found event: %s -> %s\n", 
-                                       event_handlers[handler_count].event_type,
-                                       event_handlers[handler_count].handler_code);
-                                
-                                handler_count++;
-                            }
-                        }
-                    }
-                }
-                
-                free(attr_name_str);
-            }
+        if (!attr_name || !is_event_attribute((const char *)attr_name, attr_name_len))
+            continue;
+
+        size_t value_len;
+        const lxb_char_t *attr_value = lxb_dom_attr_value(attr, &value_len);
+        if (attr_value && value_len > 0) {
+            event_set_inline(elem, (const char *)attr_name + 2, attr_name_len - 2,
+                attr_value, value_len);
         }
-        
-        attr = lxb_dom_element_next_attribute(attr);
     }
 }
 
-cJSON* get_event_handlers_json(void) {
-    cJSON *root = cJSON_CreateArray();
-    if (!root) return NULL;
-    
-    for (int i = 0; i < handler_count; i++) {
-        cJSON *handler = cJSON_CreateObject();
-        if (!handler) continue;
-        
-        // Add event type
-        if (event_handlers[i].event_type) {
-            cJSON_AddStringToObject(handler, "type", event_handlers[i].event_type);
+
+// ===== Script listeners =====
+
+static bool event_same_function(JSValueConst a, JSValueConst b) {
+    return JS_IsObject(a) && JS_IsObject(b) && JS_VALUE_GET_PTR(a) == JS_VALUE_GET_PTR(b);
+}
+
+bool event_handler_add_listener(JSContext *ctx, lxb_dom_element_t *elem,
+    const char *type, JSValueConst func, bool capture) {
+    if (!ctx || !elem || !type || !JS_IsFunction(ctx, func))
+        return false;
+    if (handler_ctx && handler_ctx != ctx)
+        return false;
+
+    size_t type_len = strlen(type);
+    int index = event_type_index(type, type_len);
+    event_node_t *node = event_node_get(elem);
+    if (!node)
+        return false;
+
+    // The same (type, function, capture) is only added once
+    for (event_listener_t *l = node->head; l; l = l->next) {
+        if (!l->removed && !l->code && l->capture == capture &&
+            event_listener_matches(l, index, type) && event_same_function(l->func, func))
+            return true;
+    }
+
+    event_listener_t *l = event_listener_new(type, type_len);
+    if (!l)
+        return false;
+    l->func = JS_DupValue(ctx, func);
+    l->state = EVENT_LISTENER_READY;
+    l->capture = capture;
+    handler_ctx = ctx;
+    event_node_append(node, l);
+    return true;
+}
+
+void event_handler_remove_listener(JSContext *ctx, lxb_dom_element_t *elem,
+    const char *type, JSValueConst func, bool capture) {
+    if (!ctx || !type || ctx != handler_ctx)
+        return;
+
+    event_node_t *node = event_node_find(elem);
+    if (!node)
+        return;
+
+    int index = event_type_index(type, strlen(type));
+    for (event_listener_t *l = node->head; l; l = l->next) {
+        if (!l->removed && !l->code && l->capture == capture &&
+            event_listener_matches(l, index, type) && event_same_function(l->func, func)) {
+            event_listener_remove(node, l);
+            return;
         }
-        
-        // Add handler code
-        if (event_handlers[i].handler_code) {
-            cJSON_AddStringToObject(handler, "code", event_handlers[i].handler_code);
+    }
+}
+
+bool event_handler_has(lxb_dom_element_t *elem, const char *type) {
+    event_node_t *node = event_node_find(elem);
+    if (!node || !type)
+        return false;
+
+    int index = event_type_index(type, strlen(type));
+    uint32_t bit = event_type_bit(index);
+    if (!((node->bubble_mask | node->capture_mask) & bit))
+        return false;
+    if (index != EVENT_TYPE_OTHER)
+        return true;
+
+    for (event_listener_t *l = node->head; l; l = l->next) {
+        if (!l->removed && event_listener_matches(l, index, type))
+            return true;
+    }
+    return false;
+}
+
+
+// ===== Dispatch =====
+
+static JSValue js_event_stop_propagation(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv) {
+    (void)argc; (void)argv;
+    JS_SetPropertyStr(ctx, this_val, "cancelBubble", JS_TRUE);
+    return JS_UNDEFINED;
+}
+
+static JSValue js_event_prevent_default(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv) {
+    (void)argc; (void)argv;
+    JS_SetPropertyStr(ctx, this_val, "defaultPrevented", JS_TRUE);
+    return JS_UNDEFINED;
+}
+
+static bool event_flag(JSContext *ctx, JSValueConst event, const char *name) {
+    JSValue v = JS_GetPropertyStr(ctx, event, name);
+    bool set = JS_ToBool(ctx, v) > 0;
+    JS_FreeValue(ctx, v);
+    return set;
+}
+
+static JSValue event_object_new(JSContext *ctx, lxb_dom_element_t *target, const char *type) {
+    if (!event_proto_ready) {
+        event_proto = JS_NewObject(ctx);
+        JS_SetPropertyStr(ctx, event_proto, "stopPropagation",
+            JS_NewCFunction(ctx, js_event_stop_propagation, "stopPropagation", 0));
+        JS_SetPropertyStr(ctx, event_proto, "preventDefault",
+            JS_NewCFunction(ctx, js_event_prevent_default, "preventDefault", 0));
+        event_proto_ready = true;
+    }
+
+    JSValue event = JS_NewObjectProto(ctx, event_proto);
+    JS_SetPropertyStr(ctx, event, "type", JS_NewString(ctx, type));
+    JS_SetPropertyStr(ctx, event, "target", js_element_wrap(ctx, target));
+    JS_SetPropertyStr(ctx, event, "bubbles", JS_TRUE);
+    JS_SetPropertyStr(ctx, event, "cancelBubble", JS_FALSE);
+    JS_SetPropertyStr(ctx, event, "defaultPrevented", JS_FALSE);
+    return event;
+}
+
+static bool event_listener_compile(JSContext *ctx, event_listener_t *l) {
+    if (l->state == EVENT_LISTENER_READY)
+        return true;
+    if (l->state == EVENT_LISTENER_FAILED || !l->code)
+        return false;
+
+    char filename[32];
+    snprintf(filename, sizeof(filename), "on%s", event_listener_type(l));
+    JSValue func = js_compile_handler(ctx, "event", l->code, filename);
+
+    if (JS_IsException(func)) {
+        JSValue exception = JS_GetException(ctx);
+        const char *error = JS_ToCString(ctx, exception);
+        printf("Event handler %s does not compile: %s\n", filename, error ? error : "(unknown)");
+        if (error)
+            JS_FreeCString(ctx, error);
+        JS_FreeValue(ctx, exception);
+        l->state = EVENT_LISTENER_FAILED;
+        return false;
+    }
+
+    l->func = func;
+    l->state = EVENT_LISTENER_READY;
+    handler_ctx = ctx;
+    return true;
+}
+
+// Run elem's listeners for one phase. Listeners added meanwhile wait for
+// the next event.
+static void event_run_node(JSContext *ctx, lxb_dom_element_t *elem, int type,
+    const char *name, JSValueConst event, int phase) {
+    event_node_t *node = event_node_find(elem);
+    if (!node)
+        return;
+
+    event_listener_t *first = node->head;
+    event_listener_t *last = node->tail;
+    JSValue this_obj = js_element_wrap(ctx, elem);
+    JS_SetPropertyStr(ctx, event, "currentTarget", JS_DupValue(ctx, this_obj));
+    JS_SetPropertyStr(ctx, event, "eventPhase", JS_NewInt32(ctx, phase));
+
+    for (event_listener_t *l = first; l; l = l->next) {
+        bool wanted = phase == EVENT_PHASE_AT_TARGET ||
+            l->capture == (phase == EVENT_PHASE_CAPTURING);
+        if (!l->removed && wanted && event_listener_matches(l, type, name) &&
+            event_listener_compile(ctx, l)) {
+            JSValueConst args[1] = { event };
+            JSValue result = js_call_function_value(ctx, l->func, this_obj, 1, args);
+            // onclick="return false" cancels the default action
+            if (l->code && JS_IsBool(result) && !JS_ToBool(ctx, result))
+                JS_SetPropertyStr(ctx, event, "defaultPrevented", JS_TRUE);
+            JS_FreeValue(ctx, result);
         }
-        
-        // Add element info with enhanced details
-        if (event_handlers[i].element) {
-            size_t len;
-            
-            // Get element tag
-            const lxb_char_t *tag = lxb_dom_element_qualified_name(
-                event_handlers[i].element, &len);
-            
-            if (tag && len > 0) {
-                char *tag_str = malloc(len + 1);
-                if (tag_str) {
-                    memcpy(tag_str, tag, len);
-                    tag_str[len] = '\0';
-                    cJSON_AddStringToObject(handler, "element", tag_str);
-                    cJSON_AddStringToObject(handler, "element_tag", tag_str);
-                    free(tag_str);
-                }
-            }
-            
-            // Get element ID
-            const lxb_char_t *id = lxb_dom_element_id(event_handlers[i].element, &len);
-            if (id && len > 0) {
-                char *id_str = malloc(len + 1);
-                if (id_str) {
-                    memcpy(id_str, id, len);
-                    id_str[len] = '\0';
-                    cJSON_AddStringToObject(handler, "id", id_str);
-                    cJSON_AddStringToObject(handler, "element_id", id_str);
-                    free(id_str);
-                }
+        if (l == last)
+            break;
+    }
+    JS_FreeValue(ctx, this_obj);
+}
+
+bool event_handler_dispatch(JSContext *ctx, lxb_dom_element_t *target, const char *type) {
+    if (!ctx || !target || !type || (handler_ctx && handler_ctx != ctx))
+        return true;
+
+    int index = event_type_index(type, strlen(type));
+    uint32_t bit = event_type_bit(index);
+
+    // Target first, then the ancestors that listen for this type at all
+    lxb_dom_element_t *stack_path[64];
+    lxb_dom_element_t **path = stack_path;
+    size_t path_capacity = sizeof(stack_path) / sizeof(stack_path[0]);
+    size_t path_len = 0;
+    bool any = false;
+
+    for (lxb_dom_node_t *n = lxb_dom_interface_node(target); n; n = lxb_dom_node_parent(n)) {
+        if (n->type != LXB_DOM_NODE_TYPE_ELEMENT)
+            continue;
+        lxb_dom_element_t *elem = lxb_dom_interface_element(n);
+        event_node_t *node = event_node_find(elem);
+        bool listens = node && ((node->bubble_mask | node->capture_mask) & bit);
+        if (!listens && elem != target)
+            continue;
+        any = any || listens;
+
+        if (path_len == path_capacity) {
+            size_t capacity = path_capacity * 2;
+            lxb_dom_element_t **grown = malloc(capacity * sizeof(*grown));
+            if (!grown)
+                break;
+            memcpy(grown, path, path_len * sizeof(*grown));
+            if (path != stack_path)
+                free(path);
+            path = grown;
+            path_capacity = capacity;
+        }
+        path[path_len++] = elem;
+    }
+
+    bool not_prevented = true;
+    if (any) {
+        dispatch_depth++;
+        JSValue event = event_object_new(ctx, target, type);
+        bool stopped = false;
+
+        for (size_t i = path_len; i-- > 1 && !stopped; ) {
+            event_node_t *node = event_node_find(path[i]);
+            if (node && (node->capture_mask & bit)) {
+                event_run_node(ctx, path[i], index, type, event, EVENT_PHASE_CAPTURING);
+                stopped = event_flag(ctx, event, "cancelBubble");
             }
-            
-            // Get element class
-            const lxb_char_t *cls = lxb_dom_element_class(event_handlers[i].element, &len);
-            if (cls && len > 0) {
-                char *cls_str = malloc(len + 1);
-                if (cls_str) {
-                    memcpy(cls_str, cls, len);
-                    cls_str[len] = '\0';
-                    cJSON_AddStringToObject(handler, "element_class", cls_str);
-                    free(cls_str);
-                }
+        }
+        if (!stopped) {
+            event_run_node(ctx, target, index, type, event, EVENT_PHASE_AT_TARGET);
+            stopped = event_flag(ctx, event, "cancelBubble");
+        }
+        for (size_t i = 1; i < path_len && !stopped; i++) {
+            event_node_t *node = event_node_find(path[i]);
+            if (node && (node->bubble_mask & bit)) {
+                event_run_node(ctx, path[i], index, type, event, EVENT_PHASE_BUBBLING);
+                stopped = event_flag(ctx, event, "cancelBubble");
             }
         }
-        
-        cJSON_AddItemToArray(root, handler);
+
+        not_prevented = !event_flag(ctx, event, "defaultPrevented");
+        JS_FreeValue(ctx, event);
+
+        if (--dispatch_depth == 0 && prune_pending)
+            event_handler_prune();
     }
-    
-    return root;
+
+    if (path != stack_path)
+        free(path);
+    return not_prevented;
 }
 
 
-// Get events for specific element with enhanced info
-cJSON* get_element_events_json(lxb_dom_element_t *elem) {
-    if (!elem) return NULL;
-    
-    cJSON *events_array = cJSON_CreateArray();
-    if (!events_array) return NULL;
-    
-    // Get element info once
-    char *element_tag = NULL;
-    char *element_id = NULL;
-    char *element_class = NULL;
-    
-    // Get element tag
+// ===== JSON output =====
+
+// Copy of a lexbor string, NULL when empty
+static char *event_copy_string(const lxb_char_t *str, size_t len) {
+    if (!str || len == 0)
+        return NULL;
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+static void add_element_info(cJSON *obj, lxb_dom_element_t *elem, bool with_id_alias) {
     size_t len;
-    const lxb_char_t *tag_name = lxb_dom_element_qualified_name(elem, &len);
-    if (tag_name && len > 0) {
-        element_tag = malloc(len + 1);
-        if (element_tag) {
-            memcpy(element_tag, tag_name, len);
-            element_tag[len] = '\0';
-        }
+    char *tag = event_copy_string(lxb_dom_element_qualified_name(elem, &len), len);
+    char *id = event_copy_string(lxb_dom_element_id(elem, &len), len);
+    char *cls = event_copy_string(lxb_dom_element_class(elem, &len), len);
+
+    if (tag) {
+        cJSON_AddStringToObject(obj, "element", tag);
+        cJSON_AddStringToObject(obj, "element_tag", tag);
     }
-    
-    // Get element id
-    const lxb_char_t *id = lxb_dom_element_id(elem, &len);
-    if (id && len > 0) {
-        element_id = malloc(len + 1);
-        if (element_id) {
-            memcpy(element_id, id, len);
-            element_id[len] = '\0';
-        }
+    if (id) {
+        if (with_id_alias)
+            cJSON_AddStringToObject(obj, "id", id);
+        cJSON_AddStringToObject(obj, "element_id", id);
     }
-    
-    // Get element class
-    const lxb_char_t *cls = lxb_dom_element_class(elem, &len);
-    if (cls && len > 0) {
-        element_class = malloc(len + 1);
-        if (element_class) {
-            memcpy(element_class, cls, len);
-            element_class[len] = '\0';
+    if (cls) {
+        cJSON_AddStringToObject(obj, "element_class", cls);
+    }
+
+    free(tag);
+    free(id);
+    free(cls);
+}
+
+cJSON* get_event_handlers_json(void) {
+    cJSON *root = cJSON_CreateArray();
+    if (!root) return NULL;
+
+    for (size_t i = 0; i < node_count; i++) {
+        event_node_t *node = event_node_find(node_order[i]);
+        if (!node)
+            continue;
+
+        for (event_listener_t *l = node->head; l; l = l->next) {
+            if (l->removed)
+                continue;
+            cJSON *handler = cJSON_CreateObject();
+            if (!handler) continue;
+
+            cJSON_AddStringToObject(handler, "type", event_listener_type(l));
+            if (l->code) {
+                cJSON_AddStringToObject(handler, "code", l->code);
+            }
+            add_element_info(handler, node->element, true);
+            cJSON_AddItemToArray(root, handler);
         }
     }
-    
-    // Search all registered handlers for this element
-    for (int i = 0; i < handler_count; i++) {
-        if (event_handlers[i].element == elem) {
-            cJSON *event_obj = cJSON_CreateObject();
-            if (event_obj) {
-                // Basic event info
-                if (event_handlers[i].event_type) {
-                    cJSON_AddStringToObject(event_obj, "type", event_handlers[i].event_type);
-                }
-                if (event_handlers[i].handler_code) {
-                    cJSON_AddStringToObject(event_obj, "handler", event_handlers[i].handler_code);
-                    
-                    // Optional: Add a preview for long handlers
-                    if (strlen(event_handlers[i].handler_code) > 50) {
-                        char preview[60];
-                        snprintf(preview, sizeof(preview), "%.50s...", 
-                                event_handlers[i].handler_code);
-                        cJSON_AddStringToObject(event_obj, "preview", preview);
-                    }
-                }
-                
-                // Enhanced: Add element info
-                if (element_tag) {
-                    cJSON_AddStringToObject(event_obj, "element", element_tag);
-                    cJSON_AddStringToObject(event_obj, "element_tag", element_tag);
-                }
-                
-                if (element_id) {
-                    cJSON_AddStringToObject(event_obj, "element_id", element_id);
-                }
-                
-                if (element_class) {
-                    cJSON_AddStringToObject(event_obj, "element_class", element_class);
-                }
-                
-                cJSON_AddItemToArray(events_array, event_obj);
+
+    return root;
+}
+
+// Get events for specific element with enhanced info
+cJSON* get_element_events_json(lxb_dom_element_t *elem) {
+    event_node_t *node = event_node_find(elem);
+    if (!node || !(node->bubble_mask | node->capture_mask))
+        return NULL;
+
+    cJSON *events_array = cJSON_CreateArray();
+    if (!events_array) return NULL;
+
+    for (event_listener_t *l = node->head; l; l = l->next) {
+        if (l->removed)
+            continue;
+        cJSON *event_obj = cJSON_CreateObject();
+        if (!event_obj)
+            continue;
+
+        cJSON_AddStringToObject(event_obj, "type", event_listener_type(l));
+        if (l->code) {
+            cJSON_AddStringToObject(event_obj, "handler", l->code);
+
+            // Preview for long handlers
+            if (strlen(l->code) > 50) {
+                char preview[60];
+                snprintf(preview, sizeof(preview), "%.50s...", l->code);
+                cJSON_AddStringToObject(event_obj, "preview", preview);
             }
         }
+        add_element_info(event_obj, elem, false);
+        cJSON_AddItemToArray(events_array, event_obj);
     }
-    
-    // Cleanup
-    if (element_tag) free(element_tag);
-    if (element_id) free(element_id);
-    if (element_class) free(element_class);
-    
+
     if (cJSON_GetArraySize(events_array) > 0) {
         return events_array;
     } else {
@@ -310,14 +874,6 @@ cJSON* get_element_events_json(lxb_dom_element_t *elem) {
     }
 }
 
-// event_handler.c - Add this function
 int is_event_attribute_name(const char *attr_name) {
-    // Must start with "on" and be at least 3 chars
-    if (!attr_name || strlen(attr_name) < 3 || 
-        attr_name[0] != 'o' || attr_name[1] != 'n') {
-        return 0;
-    }
-    
-    // Check if it's a known event type
-    return is_event_attribute(attr_name);  // Reuse your existing function
-}
\ No newline at end of file
+    return attr_name ? is_event_attribute(attr_name, strlen(attr_name)) : 0;
+}
@@ -1,30 +1,31 @@
-// event_handler.h - Simplified approach
+// event_handler.h - Inline and script event handlers, keyed by element
 #ifndef EVENT_HANDLER_H
 #define EVENT_HANDLER_H
 
+#include <stdbool.h>
 #include <lexbor/dom/dom.h>
 #include <lexbor/html/html.h>
 #include "cjson.h"
 #include "js_executor_quickjs.h"
 
-// Simple event handler structure
-typedef struct {
-    lxb_dom_element_t *element;
-    char *event_type;       // "click", "change", etc.
-    char *handler_code;     // JavaScript code from onclick="..."
-} EventHandler;
-
 // Initialize/cleanup
 void event_handler_init(void);
 void event_handler_cleanup(void);
 
+// Free every compiled handler and script listener held for ctx; call
+// before the context goes away (inline sources are kept)
+void event_handler_release_js(JSContext *ctx);
+
+// elem is about to be destroyed: drop its listeners and its table entry
+void event_handler_forget_element(lxb_dom_element_t *elem);
+
 // Process element for event attributes
 void process_element_events(lxb_dom_element_t *elem);
 
 // Get all event handlers as JSON
 cJSON* get_event_handlers_json(void);
 
-// Get event count - ADD THIS LINE
+// Number of registered handlers (inline and addEventListener)
 int get_event_handler_count(void);
 
 // Process entire document for events
@@ -33,9 +34,21 @@ void process_document_events(lxb_html_document_t *doc);
 // Get events for specific element as JSON
 cJSON* get_element_events_json(lxb_dom_element_t *elem);
 
-int get_event_handler_count(void) ;
 int is_event_attribute_name(const char *attr_name);
 void process_events_recursive(lxb_dom_node_t *node);
 
+// addEventListener / removeEventListener; func must be a function
+bool event_handler_add_listener(JSContext *ctx, lxb_dom_element_t *elem,
+    const char *type, JSValueConst func, bool capture);
+void event_handler_remove_listener(JSContext *ctx, lxb_dom_element_t *elem,
+    const char *type, JSValueConst func, bool capture);
+
+// Does elem itself have a handler for type
+bool event_handler_has(lxb_dom_element_t *elem, const char *type);
+
+// Fire type at target: capture down the ancestors, the target, then bubble
+// back up. Inline handlers are compiled on first use. Returns false when a
+// handler called preventDefault() (or an inline one returned false).
+bool event_handler_dispatch(JSContext *ctx, lxb_dom_element_t *target, const char *type);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,232 @@
+// file_source.c - Read-only views of local files
+//
+// The HTML file, the fonts, the intermediate JSON files and the Lua
+// scripts were each loaded the same way: fseek to the end, malloc the
+// size, fread it all. file_source_open() hands out a (data, len) view
+// instead. On the host, files of FILE_SOURCE_MAP_MIN and more are mapped
+// read-only: nothing is copied, pages come in as they are touched, and
+// the page cache is shared with every other reader. HelenOS has no file
+// mappings (its mmap only does anonymous memory), so there, and for small
+// files, the view is one buffered read.
+//
+// A mapped file that another process truncates would raise SIGBUS on the
+// next page read past its new end. Every mapping is registered with a
+// SIGBUS handler that puts zero pages over the rest of it and marks the
+// view; file_source_intact() then tells the reader its data is not the
+// file's.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PAUK_HOST
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "file_source.h"
+
+static errno_t file_source_read(file_source_t *src, const char *path, size_t max_len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return ENOENT;
+
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    if (size < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return EIO;
+    }
+    if (max_len && (size_t)size > max_len) {
+        fclose(f);
+        return ELIMIT;
+    }
+
+    char *buf = malloc((size_t)size + 1);
+    if (!buf) {
+        fclose(f);
+        return ENOMEM;
+    }
+    size_t got = fread(buf, 1, (size_t)size, f);
+    fclose(f);
+    if (got != (size_t)size) {
+        free(buf);
+        return EIO;
+    }
+    buf[got] = '\0';
+
+    src->buf = buf;
+    src->data = buf;
+    src->len = got;
+    return EOK;
+}
+
+#ifdef PAUK_HOST
+// Mappings the SIGBUS handler may repair. Published base last, withdrawn
+// base first; the handler reads them without a lock.
+typedef struct {
+    char *volatile base;
+    volatile size_t len;
+    volatile sig_atomic_t truncated;
+} file_source_guard_t;
+
+static file_source_guard_t guards[FILE_SOURCE_MAX_MAPS];
+static pthread_mutex_t guards_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool handler_installed = false;
+static struct sigaction previous_sigbus;
+static size_t page_size;
+
+static void file_source_sigbus(int sig, siginfo_t *info, void *context)
+{
+    char *addr = info->si_addr;
+    for (size_t i = 0; i < FILE_SOURCE_MAX_MAPS; i++) {
+        char *base = guards[i].base;
+        size_t len = guards[i].len;
+        if (!base || addr < base || addr >= base + len)
+            continue;
+
+        // The file ends before the mapping does: the rest reads as zeros
+        char *from = base + (size_t)(addr - base) / page_size * page_size;
+        if (mmap(from, (size_t)(base + len - from), PROT_READ,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+            break;
+        guards[i].truncated = 1;
+        return;
+    }
+
+    // Not a mapped view: whatever handled SIGBUS before
+    if ((previous_sigbus.sa_flags & SA_SIGINFO) && previous_sigbus.sa_sigaction) {
+        previous_sigbus.sa_sigaction(sig, info, context);
+    } else if (previous_sigbus.sa_handler != SIG_DFL && previous_sigbus.sa_handler != SIG_IGN) {
+        previous_sigbus.sa_handler(sig);
+    } else {
+        // The access faults again and the default action ends the process
+        signal(SIGBUS, SIG_DFL);
+    }
+}
+
+// Slot for a new mapping, -1 when none (the file is read instead)
+static int file_source_guard(void *map, size_t len)
+{
+    int slot = -1;
+    pthread_mutex_lock(&guards_lock);
+    if (!handler_installed) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = file_source_sigbus;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+        handler_installed = sigaction(SIGBUS, &sa, &previous_sigbus) == 0;
+    }
+    for (int i = 0; handler_installed && i < FILE_SOURCE_MAX_MAPS; i++) {
+        if (!guards[i].base) {
+            guards[i].truncated = 0;
+            guards[i].len = len;
+            guards[i].base = map;
+            slot = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&guards_lock);
+    return slot;
+}
+
+static void file_source_unguard(int slot)
+{
+    pthread_mutex_lock(&guards_lock);
+    guards[slot].base = NULL;
+    pthread_mutex_unlock(&guards_lock);
+}
+
+// EOK when mapped; ENOTSUP sends the caller to the buffered read
+static errno_t file_source_map(file_source_t *src, const char *path, size_t max_len,
+    unsigned flags)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return ENOENT;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return ENOTSUP;
+    }
+    size_t size = (size_t)st.st_size;
+    if (max_len && size > max_len) {
+        close(fd);
+        return ELIMIT;
+    }
+
+    if (size < FILE_SOURCE_MAP_MIN) {
+        close(fd);
+        return ENOTSUP;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return ENOTSUP;
+
+    int slot = file_source_guard(map, size);
+    if (slot < 0) {
+        munmap(map, size);
+        return ENOTSUP;
+    }
+
+    if (flags & FILE_SOURCE_SEQUENTIAL)
+        (void)madvise(map, size, MADV_SEQUENTIAL);
+
+    src->mapped = true;
+    src->guard = slot;
+    src->map = map;
+    src->map_len = size;
+    src->data = map;
+    src->len = size;
+    return EOK;
+}
+#endif
+
+errno_t file_source_open(file_source_t *src, const char *path, size_t max_len, unsigned flags)
+{
+    if (!src || !path)
+        return EINVAL;
+    memset(src, 0, sizeof(*src));
+
+#ifdef PAUK_HOST
+    errno_t rc = file_source_map(src, path, max_len, flags);
+    if (rc != ENOTSUP)
+        return rc;
+#endif
+    if (flags & FILE_SOURCE_MAP_ONLY)
+        return ENOTSUP;
+    return file_source_read(src, path, max_len);
+}
+
+bool file_source_intact(const file_source_t *src)
+{
+#ifdef PAUK_HOST
+    if (src && src->mapped)
+        return !guards[src->guard].truncated;
+#endif
+    return true;
+}
+
+void file_source_close(file_source_t *src)
+{
+    if (!src)
+        return;
+#ifdef PAUK_HOST
+    if (src->mapped) {
+        file_source_unguard(src->guard);
+        munmap(src->map, src->map_len);
+    }
+#endif
+    free(src->buf);
+    memset(src, 0, sizeof(*src));
+}
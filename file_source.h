@@ -0,0 +1,42 @@
+// file_source.h - Read-only views of local files
+#ifndef FILE_SOURCE_H
+#define FILE_SOURCE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Smaller files are read: mapping costs more than copying them
+#define FILE_SOURCE_MAP_MIN (16 * 1024)
+
+// Mapped views open at once; past that, files are read
+#define FILE_SOURCE_MAX_MAPS 128
+
+// Flags
+#define FILE_SOURCE_SEQUENTIAL 0x1  // read front to back once: read ahead
+#define FILE_SOURCE_MAP_ONLY 0x2    // ENOTSUP instead of a buffered read
+
+typedef struct {
+    const char *data;           // len bytes (no '\0' after them when mapped),
+                                // valid until file_source_close()
+    size_t len;
+    bool mapped;
+    int guard;                  // SIGBUS guard slot, when mapped
+    void *map;                  // mapping, when mapped
+    size_t map_len;
+    char *buf;                  // buffered copy otherwise
+} file_source_t;
+
+// Open path as a stable (data, len) view: mapped read-only where the
+// platform can map files, read into one buffer where it cannot. EOK, or
+// ENOENT / EIO / ENOMEM, or ELIMIT when the file is over max_len (0 = no
+// limit).
+errno_t file_source_open(file_source_t *src, const char *path, size_t max_len, unsigned flags);
+
+// False once the mapped file was found shorter than its view (truncated
+// while open): the missing part reads as zeros instead of faulting
+bool file_source_intact(const file_source_t *src);
+
+void file_source_close(file_source_t *src);
+
+#endif // FILE_SOURCE_H
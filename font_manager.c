@@ -1,5 +1,5 @@
 // font_manager.c
-#include "gui.h"
+#include "pauk_debug.h"
 #include "font_manager.h"
 #include <str.h>
 #include <mem.h>
@@ -166,48 +166,28 @@ errno_t font_manager_load_fonts(font_manager_t *manager, const char *font_direct
             continue;
         }
 
-        // Load font file
-        FILE *font_file = fopen(fullpath, "rb");
-        if (!font_file) {
-            printf("Cannot open font file: %s\n", fullpath);
-            continue;
-        }
-
-        // Get file size and read data
-        fseek(font_file, 0, SEEK_END);
-        size_t file_size = ftell(font_file);
-        fseek(font_file, 0, SEEK_SET);
-
-        // Check if font file is reasonable size (under 10MB)
-        if (file_size > 10 * 1024 * 1024) {
-            printf("Font file too large (%zu bytes), skipping: %s\n", file_size, ent->d_name);
-            fclose(font_file);
+        // Map the font file (read into memory where mapping is not available):
+        // stb_truetype only touches the tables it needs, so most of a mapped
+        // font is never paged in
+        file_source_t source;
+        errno_t src_rc = file_source_open(&source, fullpath, 10 * 1024 * 1024, 0);
+        if (src_rc == ELIMIT) {
+            printf("Font file too large (over 10MB), skipping: %s\n", ent->d_name);
             continue;
         }
-
-        unsigned char *font_data = malloc(file_size);
-        if (!font_data) {
-            fclose(font_file);
-            printf("Memory allocation failed for font: %s\n", ent->d_name);
-            continue;
-        }
-
-        size_t bytes_read = fread(font_data, 1, file_size, font_file);
-        fclose(font_file);
-        
-        if (bytes_read != file_size) {
-            free(font_data);
-            printf("Failed to read font file: %s (read %zu of %zu bytes)\n", 
-                   ent->d_name, bytes_read, file_size);
+        if (src_rc != EOK) {
+            printf("Cannot open font file: %s\n", fullpath);
             continue;
         }
+        const unsigned char *font_data = (const unsigned char *)source.data;
+        size_t file_size = source.len;
 
         // Initialize font
         html_font_t *font = &manager->fonts[manager->font_count];
         stbtt_fontinfo *info = &font->info;
         
         if (!stbtt_InitFont(info, font_data, 0)) {
-            free(font_data);
+            file_source_close(&source);
             printf("Failed to initialize TTF font: %s\n", ent->d_name);
             continue;
         }
@@ -217,7 +197,7 @@ errno_t font_manager_load_fonts(font_manager_t *manager, const char *font_direct
         stbtt_GetFontVMetrics(info, &ascent, &descent, &linegap);
         
         if (ascent <= 0 || descent >= 0) {
-            free(font_data);
+            file_source_close(&source);
             printf("Invalid font metrics for: %s (ascent=%d, descent=%d)\n", ent->d_name, ascent, descent);
             continue;
         }
@@ -226,6 +206,7 @@ errno_t font_manager_load_fonts(font_manager_t *manager, const char *font_direct
         str_cpy(font->name, MAX_FONT_NAME_LEN, ent->d_name);
         str_cpy(font->path, sizeof(font->path), fullpath);
         font->font_data = font_data;
+        font->font_source = source;
         font->font_size = file_size;
         font->is_loaded = true;
 
@@ -259,7 +240,7 @@ errno_t font_manager_load_fonts(font_manager_t *manager, const char *font_direct
 void font_manager_destroy(font_manager_t *manager) {
     for (int i = 0; i < manager->font_count; i++) {
         if (manager->fonts[i].font_data) {
-            free(manager->fonts[i].font_data);
+            file_source_close(&manager->fonts[i].font_source);
         }
     }
     memset(manager, 0, sizeof(font_manager_t));
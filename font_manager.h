@@ -10,6 +10,7 @@
 #include <dirent.h>
 
 #include "stb_truetype.h"
+#include "file_source.h"
 
 
 #define MAX_FONTS 50
@@ -26,8 +27,9 @@ typedef struct {
 typedef struct {
     char name[MAX_FONT_NAME_LEN];
     char path[256];
-    unsigned char *font_data;
+    const unsigned char *font_data;     // view of font_source
     size_t font_size;
+    file_source_t font_source;
     stbtt_fontinfo info;
     bool is_loaded;
     
@@ -1,6 +1,7 @@
 // forms_parser.c - COMPLETE VERSION
 #include "forms_parser.h"
 #include "main.h"
+#include "style_mutation.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -710,8 +711,8 @@ cJSON* extract_input_element(lxb_dom_element_t *input_elem, int element_index) {
     
     // Add default styles (your existing code)
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(input_elem, LXB_DOM_ATTR_STYLE);
-    if (style_attr) {
-        cJSON *styles = parse_inline_styles_simple(style_attr);
+    if (style_attr || style_mutation_has_element(input_elem)) {
+        cJSON *styles = element_inline_styles(input_elem);
         if (styles) {
             add_default_form_input_styles(styles, input_json);
             cJSON_AddItemToObject(input_json, "style", styles);
@@ -17,11 +17,16 @@
 #include <gfx/typeface.h>
 #include <gfx/coord.h>
 #include <gfximage/tga.h>
+#include <fibril_synch.h>
 
 #include "gui.h"
 #include "font_manager.h"
 #include "render_func.h"
 #include "change_size.h"
+#include "tile_raster.h"
+#include "js_event_loop.h"
+#include "pauk_sync.h"
+#include "page_paint.h"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
@@ -32,86 +37,17 @@ static const int page_step = 100;  // pixels per page up/down
 
 //definicije
 static void handle_keyboard_event(ui_window_t *window, void *arg, kbd_event_t *event);
+static void go_button_clicked(ui_pbutton_t *pbutton, void *arg);
+
+// Page shown in the address bar, and the one asked for with Go / Enter
+static char current_location[GUI_MAX_URL] = "";
+static char pending_location[GUI_MAX_URL] = "";
+static bool navigation_pending = false;
 
 static errno_t create_color(uint16_t r, uint16_t g, uint16_t b, gfx_color_t **color) {
     return gfx_color_new_rgb_i16(r, g, b, color);
 }
 
-/**
- * @brief Parses a hex color string (#RGB, #RRGGBB).
- * @param str Hex string starting after '#'.
- * @param len Length of the hex part (3 or 6).
- * @return 32-bit ARGB color.
- */
-uint32_t parse_hex_color(const char *str, size_t len) {
-    uint32_t color = 0xFF000000;  // Default: opaque black
-    
-    if (len == 3) {
-        // #RGB -> #RRGGBB (your implementation is perfect)
-        for (int i = 0; i < 3; i++) {
-            int d = hex_digit(str[i]);
-            if (d == -1) return 0xFF000000;
-            uint8_t byte = (d * 16) + d;
-            // Shift: R=16, G=8, B=0
-            color |= (uint32_t)byte << (16 - i * 8);
-        }
-    } else if (len == 6) {
-        // #RRGGBB (your implementation is perfect)
-        int d1 = hex_digit(str[0]);
-        int d2 = hex_digit(str[1]);
-        int d3 = hex_digit(str[2]);
-        int d4 = hex_digit(str[3]);
-        int d5 = hex_digit(str[4]);
-        int d6 = hex_digit(str[5]);
-        
-        if (d1 == -1 || d2 == -1 || d3 == -1 || d4 == -1 || d5 == -1 || d6 == -1)
-            return 0xFF000000;
-        
-        uint8_t r = (d1 * 16) + d2;
-        uint8_t g = (d3 * 16) + d4;
-        uint8_t b = (d5 * 16) + d6;
-        
-        color = 0xFF000000 | (r << 16) | (g << 8) | b;
-    } else if (len == 8) {
-        // #RRGGBBAA (ADDED: Support 8-digit hex with alpha)
-        int d1 = hex_digit(str[0]);
-        int d2 = hex_digit(str[1]);
-        int d3 = hex_digit(str[2]);
-        int d4 = hex_digit(str[3]);
-        int d5 = hex_digit(str[4]);
-        int d6 = hex_digit(str[5]);
-        int d7 = hex_digit(str[6]);
-        int d8 = hex_digit(str[7]);
-        
-        if (d1 == -1 || d2 == -1 || d3 == -1 || d4 == -1 || 
-            d5 == -1 || d6 == -1 || d7 == -1 || d8 == -1)
-            return 0xFF000000;
-        
-        uint8_t r = (d1 * 16) + d2;
-        uint8_t g = (d3 * 16) + d4;
-        uint8_t b = (d5 * 16) + d6;
-        uint8_t a = (d7 * 16) + d8;  // Alpha channel
-        
-        // ARGB format: a << 24 | r << 16 | g << 8 | b
-        color = (a << 24) | (r << 16) | (g << 8) | b;
-    }
-    // Note: len == 4 (#RGBA) could also be supported if needed
-    
-    return color;
-}
-
-/**
- * @brief Converts a hex character ('0'-'9', 'a'-'f', 'A'-'F') to its integer value.
- */
-int hex_digit(char c)
-{
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return -1;
-}
-
-
 /** Scrollbar up button pressed (line up) */
 static void scrollbar_up(ui_scrollbar_t *scrollbar, void *arg)
 {
@@ -131,7 +67,7 @@ static void scrollbar_up(ui_scrollbar_t *scrollbar, void *arg)
     printf("[SCROLL] Up: %d -> %d\n", pos, new_pos);
     
     // Force redraw
-    gfx_update(global_pauk_ui->gc);
+    html_renderer_repaint(pauk_ui);
 }
 
 /** Scrollbar down button pressed (line down) */
@@ -152,7 +88,7 @@ static void scrollbar_down(ui_scrollbar_t *scrollbar, void *arg)
     pauk_ui->scroll_y = new_pos;
     printf("[SCROLL] Down: %d -> %d (max: %d)\n", pos, new_pos, max_scroll);
     
-    gfx_update(global_pauk_ui->gc);
+    html_renderer_repaint(pauk_ui);
 }
 
 /** Page up */
@@ -168,7 +104,7 @@ static void scrollbar_page_up(ui_scrollbar_t *scrollbar, void *arg)
     pauk_ui->scroll_y = new_pos;
     printf("[SCROLL] Page up: %d -> %d\n", pos, new_pos);
     
-    gfx_update(global_pauk_ui->gc);
+    html_renderer_repaint(pauk_ui);
 }
 
 /** Page down */
@@ -188,7 +124,7 @@ static void scrollbar_page_down(ui_scrollbar_t *scrollbar, void *arg)
     pauk_ui->scroll_y = new_pos;
     printf("[SCROLL] Page down: %d -> %d\n", pos, new_pos);
     
-    gfx_update(global_pauk_ui->gc);
+    html_renderer_repaint(pauk_ui);
 }
 
 /** Scrollbar thumb moved (dragging) */
@@ -200,7 +136,7 @@ static void scrollbar_moved(ui_scrollbar_t *scrollbar, void *arg, gfx_coord_t po
     printf("[SCROLL] Moved to: %d\n", pos);
     
     // Force immediate redraw during drag
-    gfx_update(global_pauk_ui->gc);
+    html_renderer_repaint(pauk_ui);
 }
 
 //--------------------------------------------
@@ -236,7 +172,7 @@ static void handle_keyboard_event(ui_window_t *window, void *arg, kbd_event_t *e
                 } else {
                     // Enter key in address bar - trigger Go button
                     printf("Enter key pressed - triggering Go button\n");
-                //    go_button_clicked(pauk_ui->go_button, pauk_ui);
+                    go_button_clicked(pauk_ui->go_button, pauk_ui);
                 }
                 break;
                 
@@ -254,7 +190,7 @@ static void handle_keyboard_event(ui_window_t *window, void *arg, kbd_event_t *e
                 case KC_R:
                 if (event->mods & KM_CTRL) {
                     printf("Ctrl+R pressed - reloading page\n");
-             //       go_button_clicked(pauk_ui->go_button, pauk_ui);
+                    go_button_clicked(pauk_ui->go_button, pauk_ui);
                 } else if (event->mods & (KM_ALT | KM_SHIFT)) {
                     // Allow Alt+R or Shift+R to pass through
                     ui_window_def_kbd(window, event);
@@ -284,25 +220,130 @@ void wnd_close(ui_window_t *window, void *arg)
     ui_quit(pauk_ui->ui);
 }
 
-void start_gui(void)
+// Go: the page loop in main() loads the address once the window is closed
+static void go_button_clicked(ui_pbutton_t *pbutton, void *arg)
 {
-    printf("Start GUI\n");
+    pauk_ui_t *pauk_ui = (pauk_ui_t *)arg;
+    (void)pbutton;
 
-    pauk_ui_t pauk_ui;
+    const char *url = ui_entry_get_text(pauk_ui->address_entry);
+    if (!url || str_length(url) == 0 || str_cmp(url, "http://") == 0 ||
+        str_cmp(url, "https://") == 0)
+        return;
+
+    printf("Navigating to %s\n", url);
+    str_cpy(pending_location, sizeof(pending_location), url);
+    navigation_pending = true;
+    ui_quit(pauk_ui->ui);
+}
+
+void gui_set_location(const char *location)
+{
+    str_cpy(current_location, sizeof(current_location), location ? location : "");
+}
+
+bool gui_take_navigation(char *url, size_t size)
+{
+    if (!navigation_pending)
+        return false;
+    navigation_pending = false;
+    str_cpy(url, size, pending_location);
+    return true;
+}
 
-    errno_t rc = init_ui(&pauk_ui, UI_ANY_DEFAULT);
+static gui_first_paint_cb_t first_paint_cb = NULL;
+static void *first_paint_arg = NULL;
+
+void gui_set_first_paint_cb(gui_first_paint_cb_t cb, void *arg)
+{
+    first_paint_cb = cb;
+    first_paint_arg = arg;
+}
+
+static cJSON *page_positions = NULL;
+static gui_relayout_cb_t relayout_cb = NULL;
+static void *relayout_arg = NULL;
+
+void gui_set_page_positions(cJSON *positions)
+{
+    cJSON_Delete(page_positions);
+    page_positions = positions;
+}
+
+void gui_set_relayout_cb(gui_relayout_cb_t cb, void *arg)
+{
+    relayout_cb = cb;
+    relayout_arg = arg;
+}
+
+// The page's window, open from the start of the parse to the end of run_ui()
+static pauk_ui_t page_ui;
+static bool page_ui_open = false;
+static bool page_ui_streamed = false;
+
+errno_t gui_open(void)
+{
+    if (page_ui_open)
+        return EOK;
+
+    errno_t rc = init_ui(&page_ui, UI_ANY_DEFAULT);
     if (rc != EOK) {
         fprintf(stderr, "Failed to initialize UI: %s\n", str_error(rc));
-        return;
+        return rc;
     }
-    else{ printf("start gui pokrenut.\n");}
+    page_ui_open = true;
+    page_ui_streamed = false;
+    return EOK;
+}
 
-    
+errno_t gui_paint_blocks(cJSON *blocks, int y0, int y1)
+{
+    if (!page_ui_open || !page_ui.html_renderer || !blocks)
+        return EINVAL;
+
+    html_renderer_t *renderer = page_ui.html_renderer;
+    // The first blocks replace the start-up text, later ones only add rows
+    if (!page_ui_streamed) {
+        paint_list_clear(&renderer->display_list);
+        renderer->needs_redraw = true;
+        page_ui_streamed = true;
+    }
+
+    cJSON *block;
+    cJSON_ArrayForEach(block, blocks)
+        page_paint_node(&renderer->display_list, renderer->font_manager, block);
+    tile_cache_invalidate_rows(&renderer->tile_cache, y0, y1);
+    return html_renderer_repaint(&page_ui);
+}
+
+void start_gui(void)
+{
+    printf("Start GUI\n");
+
+    if (gui_open() != EOK)
+        return;
+    pauk_ui_t *pauk_ui = &page_ui;
+    printf("start gui pokrenut.\n");
+
+    // The page replaces the start-up text (or what was painted while it
+    // streamed in)
+    if (page_positions) {
+        gui_paint_positions(pauk_ui, page_positions);
+        gui_set_page_positions(NULL);
+    }
 
     gfx_update(global_pauk_ui->gc);
-    run_ui(&pauk_ui);
-    
-   
+
+    if (first_paint_cb)
+        first_paint_cb(first_paint_arg);
+
+    run_ui(pauk_ui);
+
+    // The next page opens its own window
+    ui_window_destroy(pauk_ui->window);
+    ui_destroy(pauk_ui->ui);
+    global_pauk_ui = NULL;
+    page_ui_open = false;
 }
 
 
@@ -558,7 +599,8 @@ pauk_ui->address_label_base_rect = rect;
     if (rc != EOK) return rc;
 
     // Address entry
-    rc = ui_entry_create(pauk_ui->window, "http://", &pauk_ui->address_entry);
+    rc = ui_entry_create(pauk_ui->window,
+        current_location[0] ? current_location : "http://", &pauk_ui->address_entry);
     if (rc != EOK) return rc;
 
     // Address entry - shift up 20px
@@ -576,7 +618,7 @@ if (ui_is_textmode(pauk_ui->ui)) {
     if (rc != EOK) return rc;
 
     // Go button
-    static ui_pbutton_cb_t pbutton_cb = { .clicked = NULL }; //go_button_clicked
+    static ui_pbutton_cb_t pbutton_cb = { .clicked = go_button_clicked };
     rc = ui_pbutton_create(ui_window_get_res(pauk_ui->window), "Go", &pauk_ui->go_button);
     if (rc != EOK) return rc;
 
@@ -1374,14 +1416,19 @@ pauk_ui->html_renderer = malloc(sizeof(html_renderer_t));
 if (pauk_ui->html_renderer) {
     html_renderer_init(pauk_ui->html_renderer, pauk_ui->gc, &pauk_ui->font_manager);
     
-    // Create the HTML renderer's bitmap
-    gfx_rect_t large_bitmap_rect = {
-        .p0 = {pauk_ui->tab_rect.p0.x, pauk_ui->tab_rect.p0.y},  // Start at tab position
-        .p1 = {pauk_ui->tab_rect.p0.x + 1400, pauk_ui->tab_rect.p0.y + 900}  // Extend from tab position
+    // Create the HTML renderer's bitmap - viewport sized plus overscan,
+    // content further away is kept in the tile cache
+    gfx_rect_t backing_rect = {
+        .p0 = {0, 0},
+        .p1 = {pauk_ui->list_rect.p1.x - pauk_ui->list_rect.p0.x,
+               pauk_ui->list_rect.p1.y - pauk_ui->list_rect.p0.y + CONTENT_OVERSCAN}
     };
     
  
-    html_renderer_create_bitmap(pauk_ui->html_renderer, large_bitmap_rect);
+    html_renderer_create_bitmap(pauk_ui->html_renderer, backing_rect);
+
+    // One raster worker per CPU for full-page repaints
+    tile_raster_init(0);
     
     
     // CRITICAL: Convert bitmap to UI image but use the normal display area
@@ -1389,11 +1436,13 @@ if (pauk_ui->html_renderer) {
 
        ui_resource_t *ui_res = ui_window_get_res(pauk_ui->window);
     
-        // Display the bitmap at the tab position (same as bitmap creation)
-        gfx_rect_t display_rect = pauk_ui->list_rect; // This should match the tab area
+        // Display the bitmap in the content area, overscan rows stay hidden
+        gfx_rect_t display_rect = pauk_ui->list_rect;
+        gfx_rect_t visible_rect = pauk_ui->html_renderer->bitmap_rect;
+        visible_rect.p1.y -= CONTENT_OVERSCAN;
        
       rc = ui_image_create(ui_res, pauk_ui->html_renderer->content_bitmap, 
-                            &display_rect, &pauk_ui->content_image);
+                            &visible_rect, &pauk_ui->content_image);
         if (rc == EOK) {
             ui_image_set_rect(pauk_ui->content_image, &display_rect);
             ui_image_set_flags(pauk_ui->content_image, ui_imgf_frame);
@@ -1482,6 +1531,115 @@ errno_t html_renderer_create_bitmap(html_renderer_t *renderer, gfx_rect_t rect)
 }
 
 
+/**
+ * @brief Rasterize the display list into the content bitmap and show it
+ * Tiles are painted in parallel by the tile_raster worker pool.
+ */
+errno_t html_renderer_repaint(pauk_ui_t *pauk_ui) {
+    if (!pauk_ui || !pauk_ui->html_renderer || !pauk_ui->html_renderer->content_bitmap)
+        return EINVAL;
+
+    html_renderer_t *renderer = pauk_ui->html_renderer;
+
+    gfx_bitmap_alloc_t alloc;
+    errno_t rc = gfx_bitmap_get_alloc(renderer->content_bitmap, &alloc);
+    if (rc != EOK) {
+        if (DEB_BITMAP) printf("[REPAINT] Failed to get bitmap allocation\n");
+        return rc;
+    }
+
+    raster_surface_t surface = {
+        .pixels = (uint32_t *)alloc.pixels,
+        .stride = alloc.pitch / 4,
+        .width = renderer->view_width,
+        .height = renderer->view_height
+    };
+
+    // Display list changed since the strips were rendered
+    if (renderer->needs_redraw)
+        tile_cache_invalidate(&renderer->tile_cache);
+
+    // Scrolling only re-rasterizes strips that are not cached yet
+    rc = tile_cache_compose(&renderer->tile_cache, &renderer->display_list, &surface,
+        pauk_ui->scroll_y, 0xFFFFFFFF);
+    if (rc != EOK)
+        return rc;
+
+    renderer->needs_redraw = false;
+
+    if (pauk_ui->content_image)
+        ui_image_paint(pauk_ui->content_image);
+    return gfx_update(pauk_ui->gc);
+}
+
+/**
+ * @brief Show a laid-out page: its positions tree becomes the display list
+ */
+errno_t gui_paint_positions(pauk_ui_t *pauk_ui, cJSON *positions) {
+    if (!pauk_ui || !pauk_ui->html_renderer || !positions)
+        return EINVAL;
+
+    html_renderer_t *renderer = pauk_ui->html_renderer;
+    paint_list_clear(&renderer->display_list);
+    page_paint_positions(&renderer->display_list, renderer->font_manager, positions);
+    renderer->needs_redraw = true;
+    return html_renderer_repaint(pauk_ui);
+}
+
+/**
+ * @brief Reallocate the backing bitmap after the content area changed size
+ */
+errno_t html_renderer_resize_viewport(pauk_ui_t *pauk_ui) {
+    if (!pauk_ui || !pauk_ui->html_renderer)
+        return EINVAL;
+
+    html_renderer_t *renderer = pauk_ui->html_renderer;
+    int width = pauk_ui->list_rect.p1.x - pauk_ui->list_rect.p0.x;
+    int height = pauk_ui->list_rect.p1.y - pauk_ui->list_rect.p0.y + CONTENT_OVERSCAN;
+
+    if (renderer->content_bitmap && width == renderer->view_width &&
+        height == renderer->view_height)
+        return EOK;
+
+    gfx_bitmap_t *old_bitmap = renderer->content_bitmap;
+    void *old_pixels = NULL;
+    if (old_bitmap) {
+        gfx_bitmap_alloc_t alloc;
+        if (gfx_bitmap_get_alloc(old_bitmap, &alloc) == EOK)
+            old_pixels = alloc.pixels;
+    }
+
+    gfx_rect_t backing_rect = {
+        .p0 = {0, 0},
+        .p1 = {width, height}
+    };
+
+    // A new bitmap does not make the cached strips stale
+    bool needs_redraw = renderer->needs_redraw;
+    renderer->content_bitmap = NULL;
+    errno_t rc = html_renderer_create_bitmap(renderer, backing_rect);
+    if (rc != EOK) {
+        renderer->content_bitmap = old_bitmap;
+        return rc;
+    }
+    renderer->needs_redraw = needs_redraw;
+
+    if (pauk_ui->content_image) {
+        gfx_rect_t visible_rect = renderer->bitmap_rect;
+        visible_rect.p1.y -= CONTENT_OVERSCAN;
+        ui_image_set_bmp(pauk_ui->content_image, renderer->content_bitmap, &visible_rect);
+    }
+
+    if (old_bitmap) {
+        gfx_bitmap_destroy(old_bitmap);
+        free(old_pixels);
+    }
+
+    // Strip width follows the viewport, tile_cache_compose drops stale strips
+    return html_renderer_repaint(pauk_ui);
+}
+
+
 // MENI KALBEK
 // Callback for menu items
 void file_exit(ui_menu_entry_t *mentry, void *arg)
@@ -1498,6 +1656,8 @@ memset(renderer, 0, sizeof(html_renderer_t));
 renderer->gc = gc;
 renderer->font_manager = font_manager;
 renderer->scroll_y = 0;
+paint_list_init(&renderer->display_list);
+tile_cache_init(&renderer->tile_cache, TILE_CACHE_MAX_BYTES, TILE_CACHE_STRIP_HEIGHT);
 
 // Initialize default styles with proper colors
 if (create_color(0, 0, 0, &renderer->default_style.color) != EOK) {
@@ -1562,10 +1722,89 @@ void help_about(ui_menu_entry_t *mentry, void *arg)
 
 
 
+// ===== JS event loop driver =====
+// A fibril timer wakes the loop when its next timer or frame is due; the
+// tick runs under ui_lock so it never races the UI callbacks.
+
+static fibril_timer_t *js_loop_timer = NULL;
+static uint64_t js_loop_armed = 0;          // wake time armed, 0 = none
+
+static void gui_js_loop_arm(pauk_ui_t *pauk_ui, uint64_t wake);
+
+static void gui_js_loop_fired(void *arg)
+{
+    pauk_ui_t *pauk_ui = (pauk_ui_t *)arg;
+
+    js_loop_armed = 0;
+    ui_lock(pauk_ui->ui);
+    uint64_t wake = js_event_loop_tick(pauk_time_usec());
+    ui_unlock(pauk_ui->ui);
+
+    gui_js_loop_arm(pauk_ui, wake);
+}
+
+static void gui_js_loop_arm(pauk_ui_t *pauk_ui, uint64_t wake)
+{
+    if (!js_loop_timer || wake == 0)
+        return;
+    // Already due earlier
+    if (js_loop_armed != 0 && js_loop_armed <= wake)
+        return;
+
+    // fibril_timer_set() wants a timer that is not set: take back the
+    // later wake first
+    if (js_loop_armed != 0)
+        fibril_timer_clear(js_loop_timer);
+
+    uint64_t now = pauk_time_usec();
+    js_loop_armed = wake;
+    fibril_timer_set(js_loop_timer, (usec_t)(wake > now ? wake - now : 0),
+        gui_js_loop_fired, pauk_ui);
+}
+
+// New timer / rAF / render request while the loop was idle
+static void gui_js_loop_wake(void *arg)
+{
+    gui_js_loop_arm((pauk_ui_t *)arg, pauk_time_usec());
+}
+
+// One frame's worth of JS changes: lay out again, then paint once
+static void gui_js_frame(void *arg)
+{
+    pauk_ui_t *pauk_ui = (pauk_ui_t *)arg;
+
+    cJSON *positions = relayout_cb ? relayout_cb(relayout_arg) : NULL;
+    if (positions) {
+        gui_paint_positions(pauk_ui, positions);
+        cJSON_Delete(positions);
+        return;
+    }
+
+    if (pauk_ui->html_renderer)
+        pauk_ui->html_renderer->needs_redraw = true;
+    html_renderer_repaint(pauk_ui);
+}
+
 void run_ui(pauk_ui_t *pauk_ui)
 {
+    js_loop_timer = fibril_timer_create(NULL);
+    if (js_loop_timer) {
+        js_event_loop_set_frame_cb(gui_js_frame, pauk_ui);
+        js_event_loop_set_wake_cb(gui_js_loop_wake, pauk_ui);
+        // Timers set while the page loaded
+        gui_js_loop_arm(pauk_ui, pauk_time_usec());
+    }
+
     ui_run(pauk_ui->ui);
 
+    if (js_loop_timer) {
+        js_event_loop_set_wake_cb(NULL, NULL);
+        js_event_loop_set_frame_cb(NULL, NULL);
+        fibril_timer_clear(js_loop_timer);
+        fibril_timer_destroy(js_loop_timer);
+        js_loop_timer = NULL;
+        js_loop_armed = 0;
+    }
 }
 
 
@@ -1578,10 +1817,14 @@ grafičkom korisničkom interfejsu (GUI).
 void test_simple_text(pauk_ui_t *pauk_ui) {
     printf("[TEST] Font-only test\n");
 
+    // New page - drop the previous display list
+    if (pauk_ui->html_renderer)
+        paint_list_clear(&pauk_ui->html_renderer->display_list);
+
     // Clear with white
     int width = pauk_ui->list_rect.p1.x - pauk_ui->list_rect.p0.x;
     int height = pauk_ui->list_rect.p1.y - pauk_ui->list_rect.p0.y;
-    clear_area_css(pauk_ui, 0, 0, width, height, "white");
+    clear_area_argb(pauk_ui, 0, 0, width, height, 0xFFFFFFFF);
 
     // Get font (should be Arial from your mappings)
     html_font_t *font = font_manager_get_by_name(&pauk_ui->font_manager, "Arial");
@@ -1592,22 +1835,24 @@ void test_simple_text(pauk_ui_t *pauk_ui) {
 
     // Test different fonts/styles
     int y = 50;
-    render_ttf_text_css(pauk_ui, "Arial 24pt", 50, y, font, 24.0f, "black");
+    render_ttf_text_argb(pauk_ui, "Arial 24pt", 50, y, font, 24.0f, 0xFF000000);
     y += 40;
     
-    render_ttf_text_css(pauk_ui, "Blue Text", 50, y, font, 20.0f, "blue");
+    render_ttf_text_argb(pauk_ui, "Blue Text", 50, y, font, 20.0f, 0xFF0000FF);
     y += 35;
     
-    render_ttf_text_css(pauk_ui, "Red Bold", 50, y, font, 18.0f, "red");
+    render_ttf_text_argb(pauk_ui, "Red Bold", 50, y, font, 18.0f, 0xFFFF0000);
     y += 30;
     
-    render_ttf_text_css(pauk_ui, "Green Medium", 50, y, font, 16.0f, "green");
+    render_ttf_text_argb(pauk_ui, "Green Medium", 50, y, font, 16.0f, 0xFF008000);
     y += 25;
     
-    render_ttf_text_css(pauk_ui, "Gray Small", 50, y, font, 14.0f, "#666666");
+    render_ttf_text_argb(pauk_ui, "Gray Small", 50, y, font, 14.0f, 0xFF666666);
     y += 20;
     
-    render_ttf_text_css(pauk_ui, "Purple Tiny", 50, y, font, 12.0f, "purple");
+    render_ttf_text_argb(pauk_ui, "Purple Tiny", 50, y, font, 12.0f, 0xFF800080);
+
+    html_renderer_repaint(pauk_ui);
     
     printf("[TEST] Font test done\n");
 } 
@@ -35,7 +35,12 @@
 #include <ui/scrollbar.h>
 #include <ui/window.h>
 
+#include "pauk_debug.h"
+#include "cjson.h"
 #include "font_manager.h"
+#include "paint_list.h"
+#include "css_color.h"
+#include "tile_cache.h"
 
 
 // Common definitions
@@ -44,23 +49,8 @@
 #define MAX_REDIRECTS 10
 #define RETRY_DELAY_MS 1000
 #define RECV_MAX_RETRIES 100
-// DEBUG STUFF////
-
-#define DEB_INFO 1
-#define DEB_INIT 0
-#define DEB_WARNING 0
-#define DEB_INIT_MENU 0
-#define DEB_INIT_SCROLLBAR 0
-#define DEB_BITMAP 0
-#define DEB_INIT_FONT 0
-#define DEB_FONT 1
-#define DEB_INIT_UI 0
-#define DEB_INIT_LEXBOR 0
-#define DEB_LEXBOR 0
-#define DEB_CSS 0
-#define DEB_GO 0
-#define DEB_FETCH 0
-#define DEB_INIT_CHILD 0
+#define GUI_MAX_URL 2048
+// DEBUG STUFF//// (flags live in pauk_debug.h so non-GUI code can use them)
 
 #define SYSTEM_MENU_HEIGHT 30
 #define CONTENT_MARGIN 10
@@ -69,6 +59,11 @@
 #define STATUS_HEIGHT 20
 #define ROW_SPACING 5  
 
+// Content backing store: viewport plus overscan rows, rest of the page lives in the tile cache
+#define CONTENT_OVERSCAN 256
+#define TILE_CACHE_STRIP_HEIGHT 256
+#define TILE_CACHE_MAX_BYTES (8 * 1024 * 1024)
+
 
 typedef struct {
     int font_index;
@@ -93,6 +88,12 @@ typedef struct {
         gfx_context_t *bitmap_gc;
         gfx_rect_t bitmap_rect;
         bool needs_redraw;
+
+        // Display list replayed by the tiled rasterizer on repaint
+        paint_list_t display_list;
+
+        // Pre-rendered strips of the document outside the backing bitmap
+        tile_cache_t tile_cache;
     
     // Default styles
     html_text_style_t default_style;  // ← CHANGED
@@ -282,51 +283,6 @@ typedef struct {
     size_t size;
 } email_t;
 
-// CSS structures and parsing
-typedef struct {
-    const char *name;
-    uint32_t value;
-} css_named_color_t;
-
-static const css_named_color_t css_named_colors[] = {
-    {"black", 0xFF000000},
-    {"white", 0xFFFFFFFF},
-    {"red", 0xFFFF0000},
-    {"green", 0xFF008000},
-    {"blue", 0xFF0000FF},
-    {"yellow", 0xFFFFFF00},
-    {"cyan", 0xFF00FFFF},
-    {"magenta", 0xFFFF00FF},
-    {"gray", 0xFF808080},
-    {"grey", 0xFF808080},
-    {"dimgray", 0xFF696969},
-    {"dimgrey", 0xFF696969},
-    {"darkgray", 0xFFA9A9A9},
-    {"darkgrey", 0xFFA9A9A9},
-    {"lightgray", 0xFFD3D3D3},
-    {"lightgrey", 0xFFD3D3D3},
-    {"darkred", 0xFF8B0000},
-    {"lightred", 0xFFFF6347},
-    {"darkgreen", 0xFF006400},
-    {"lightgreen", 0xFF90EE90},
-    {"darkblue", 0xFF00008B},
-    {"lightblue", 0xFFADD8E6},
-    {"maroon", 0xFF800000},
-    {"purple", 0xFF800080},
-    {"fuchsia", 0xFFFF00FF},
-    {"lime", 0xFF00FF00},
-    {"olive", 0xFF808000},
-    {"navy", 0xFF000080},
-    {"teal", 0xFF008080},
-    {"aqua", 0xFF00FFFF},
-    {"silver", 0xFFC0C0C0},
-    {"orange", 0xFFFFA500},
-    {"brown", 0xFFA52A2A},
-    {"pink", 0xFFFFC0CB},
-    {"gold", 0xFFFFD700},
-    {"violet", 0xFFEE82EE},
-    {NULL, 0}
-};
 
 // Simple busy wait delay function
 static inline void simple_delay(unsigned int ms)
@@ -336,14 +292,22 @@ static inline void simple_delay(unsigned int ms)
     }
 }
 
-uint32_t parse_hex_color(const char *str, size_t len);
-int hex_digit(char c);
 
 
 void start_gui(void);
 
+// Open the page's window before the document is parsed, so blocks can be
+// shown while the rest arrives; start_gui() then runs the same window
+errno_t gui_open(void);
+
+// Append laid-out top-level blocks (position_layout_block() output) to the
+// open window; only the document rows [y0, y1) are rasterized again
+errno_t gui_paint_blocks(cJSON *blocks, int y0, int y1);
+
 errno_t init_ui(pauk_ui_t *pauk_ui, const char *display_spec);
 errno_t html_renderer_create_bitmap(html_renderer_t *renderer, gfx_rect_t rect);
+errno_t html_renderer_repaint(pauk_ui_t *pauk_ui);
+errno_t html_renderer_resize_viewport(pauk_ui_t *pauk_ui);
 
 
 
@@ -361,6 +325,28 @@ errno_t html_renderer_init(html_renderer_t *renderer, gfx_context_t *gc,
 
  void run_ui(pauk_ui_t *pauk_ui);
 
+// Called once, after the window's first paint and before the UI loop
+typedef void (*gui_first_paint_cb_t)(void *arg);
+void gui_set_first_paint_cb(gui_first_paint_cb_t cb, void *arg);
+
+// Positions tree of the page (calculate_text_positions() output), painted
+// when the next window opens. The GUI takes ownership; NULL = none.
+void gui_set_page_positions(cJSON *positions);
+
+// Lays the page out again after scripts changed it and returns the new
+// positions tree (the GUI frees it), or NULL to keep what is painted
+typedef cJSON *(*gui_relayout_cb_t)(void *arg);
+void gui_set_relayout_cb(gui_relayout_cb_t cb, void *arg);
+
+// Replace the display list with a positions tree and repaint
+errno_t gui_paint_positions(pauk_ui_t *pauk_ui, cJSON *positions);
+
+// Shown in the address bar of the next window
+void gui_set_location(const char *location);
+// After start_gui() returns: true (and the address in url) if Go, Enter or
+// Ctrl+R asked for a page
+bool gui_take_navigation(char *url, size_t size);
+
  void test_simple_text(pauk_ui_t *pauk_ui);
 
  void render_ttf_text(pauk_ui_t *pauk_ui, const char *text, int x, int y,
@@ -0,0 +1,366 @@
+// headless.c - Off-screen render target over a plain ARGB buffer
+//
+// Used by the host build (PAUK_HOST) to exercise parsing, layout and
+// rasterization without HelenOS gfx/ui, and to dump PPM/PNG snapshots.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cjson.h"
+#include "pauk_debug.h"
+#include "css_color.h"
+#include "tile_raster.h"
+#include "headless.h"
+#include "file_source.h"
+#include "page_paint.h"
+
+#ifdef PAUK_HOST
+// gui.c carries the implementation on HelenOS, it is not built on the host
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb_truetype.h"
+#endif
+
+errno_t headless_target_init(headless_target_t *target, int width, int height,
+    font_manager_t *font_manager)
+{
+    if (!target || width <= 0)
+        return EINVAL;
+
+    memset(target, 0, sizeof(*target));
+    target->width = width;
+    target->height = height;   // <= 0: sized to the content on render
+    target->font_manager = font_manager;
+    paint_list_init(&target->display_list);
+    return EOK;
+}
+
+void headless_target_destroy(headless_target_t *target)
+{
+    if (!target)
+        return;
+    paint_list_free(&target->display_list);
+    free(target->pixels);
+    target->pixels = NULL;
+}
+
+void headless_fill_argb(headless_target_t *target, int x, int y, int width, int height,
+    uint32_t argb)
+{
+    if (!target) return;
+    paint_list_add_fill(&target->display_list, x, y, width, height, argb);
+}
+
+void headless_border_argb(headless_target_t *target, int x, int y, int width, int height,
+    uint32_t argb)
+{
+    if (!target) return;
+    paint_list_add_border(&target->display_list, x, y, width, height, argb);
+}
+
+void headless_text_argb(headless_target_t *target, const char *text, int x, int y,
+    html_font_t *font, float size, uint32_t argb)
+{
+    if (!target || !text || !font) return;
+
+    // Same alpha handling as render_ttf_text_argb: text is opaque over white
+    paint_list_add_text(&target->display_list, text, x, y, font, size,
+        css_color_over_white(argb));
+}
+
+void headless_fill_css(headless_target_t *target, int x, int y, int width, int height,
+    const char *css_color_str)
+{
+    if (!css_color_str) return;
+    headless_fill_argb(target, x, y, width, height, css_color_to_uint32(css_color_str));
+}
+
+void headless_border_css(headless_target_t *target, int x, int y, int width, int height,
+    const char *css_color_str)
+{
+    if (!css_color_str) return;
+    headless_border_argb(target, x, y, width, height, css_color_to_uint32(css_color_str));
+}
+
+void headless_text_css(headless_target_t *target, const char *text, int x, int y,
+    html_font_t *font, float size, const char *css_color_str)
+{
+    if (!css_color_str) return;
+    headless_text_argb(target, text, x, y, font, size, css_color_to_uint32(css_color_str));
+}
+
+errno_t headless_render(headless_target_t *target)
+{
+    if (!target)
+        return EINVAL;
+
+    if (!target->pixels) {
+        if (target->height <= 0) {
+            int h = target->display_list.extent_y;
+            if (h < HEADLESS_DEFAULT_HEIGHT) h = HEADLESS_DEFAULT_HEIGHT;
+            if (h > HEADLESS_MAX_HEIGHT) h = HEADLESS_MAX_HEIGHT;
+            target->height = h;
+        }
+        target->pixels = malloc((size_t)target->width * target->height * sizeof(uint32_t));
+        if (!target->pixels)
+            return ENOMEM;
+    }
+
+    raster_surface_t surface = {
+        .pixels = target->pixels,
+        .stride = target->width,
+        .width = target->width,
+        .height = target->height
+    };
+
+    return tile_raster_render(&target->display_list, &surface, target->scroll_y, 0xFFFFFFFF);
+}
+
+errno_t headless_render_rows(headless_target_t *target, int y0, int y1)
+{
+    if (!target)
+        return EINVAL;
+    if (!target->pixels)
+        return headless_render(target);
+
+    // Document rows -> rows of the pixel buffer
+    y0 -= target->scroll_y;
+    y1 -= target->scroll_y;
+    if (y0 < 0) y0 = 0;
+    if (y1 > target->height) y1 = target->height;
+    if (y0 >= y1)
+        return EOK;
+
+    raster_surface_t band = {
+        .pixels = target->pixels + (size_t)y0 * target->width,
+        .stride = target->width,
+        .width = target->width,
+        .height = y1 - y0
+    };
+    return tile_raster_render(&target->display_list, &band, target->scroll_y + y0, 0xFFFFFFFF);
+}
+
+errno_t headless_write_ppm(const headless_target_t *target, const char *path)
+{
+    if (!target || !target->pixels || !path)
+        return EINVAL;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return EIO;
+
+    fprintf(f, "P6\n%d %d\n255\n", target->width, target->height);
+
+    unsigned char *row = malloc((size_t)target->width * 3);
+    if (!row) {
+        fclose(f);
+        return ENOMEM;
+    }
+
+    for (int y = 0; y < target->height; y++) {
+        const uint32_t *src = target->pixels + (size_t)y * target->width;
+        for (int x = 0; x < target->width; x++) {
+            row[x * 3 + 0] = (src[x] >> 16) & 0xFF;
+            row[x * 3 + 1] = (src[x] >> 8) & 0xFF;
+            row[x * 3 + 2] = src[x] & 0xFF;
+        }
+        fwrite(row, 1, (size_t)target->width * 3, f);
+    }
+
+    free(row);
+    fclose(f);
+    return EOK;
+}
+
+// ===== PNG (stored deflate, no zlib dependency) =====
+
+static uint32_t png_crc_table[256];
+static int png_crc_ready = 0;
+
+static uint32_t png_crc(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    if (!png_crc_ready) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            png_crc_table[n] = c;
+        }
+        png_crc_ready = 1;
+    }
+    for (size_t i = 0; i < len; i++)
+        crc = png_crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_be32(unsigned char *p, uint32_t v)
+{
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+static void png_write_chunk(FILE *f, const char *type, const unsigned char *data, size_t len)
+{
+    unsigned char hdr[8];
+    put_be32(hdr, (uint32_t)len);
+    memcpy(hdr + 4, type, 4);
+    fwrite(hdr, 1, 8, f);
+    if (len)
+        fwrite(data, 1, len, f);
+
+    uint32_t crc = png_crc(0xFFFFFFFFu, (const unsigned char *)type, 4);
+    crc = png_crc(crc, data, len) ^ 0xFFFFFFFFu;
+    unsigned char tail[4];
+    put_be32(tail, crc);
+    fwrite(tail, 1, 4, f);
+}
+
+errno_t headless_write_png(const headless_target_t *target, const char *path)
+{
+    if (!target || !target->pixels || !path)
+        return EINVAL;
+
+    // Raw scanlines: filter byte 0 + RGB
+    size_t row_len = (size_t)target->width * 3 + 1;
+    size_t raw_len = row_len * target->height;
+
+    // zlib stream: 2 byte header, stored blocks of <= 65535 bytes (5 byte header each), adler32
+    size_t blocks = (raw_len + 65534) / 65535;
+    size_t z_len = 2 + raw_len + blocks * 5 + 4;
+
+    unsigned char *raw = malloc(raw_len);
+    unsigned char *z = malloc(z_len);
+    if (!raw || !z) {
+        free(raw);
+        free(z);
+        return ENOMEM;
+    }
+
+    for (int y = 0; y < target->height; y++) {
+        unsigned char *dst = raw + row_len * y;
+        const uint32_t *src = target->pixels + (size_t)y * target->width;
+        *dst++ = 0;
+        for (int x = 0; x < target->width; x++) {
+            *dst++ = (src[x] >> 16) & 0xFF;
+            *dst++ = (src[x] >> 8) & 0xFF;
+            *dst++ = src[x] & 0xFF;
+        }
+    }
+
+    size_t zp = 0;
+    z[zp++] = 0x78;
+    z[zp++] = 0x01;
+
+    uint32_t s1 = 1, s2 = 0;
+    size_t pos = 0;
+    while (pos < raw_len) {
+        size_t n = raw_len - pos;
+        if (n > 65535) n = 65535;
+        z[zp++] = (pos + n == raw_len) ? 1 : 0;
+        z[zp++] = n & 0xFF;
+        z[zp++] = (n >> 8) & 0xFF;
+        z[zp++] = ~n & 0xFF;
+        z[zp++] = (~n >> 8) & 0xFF;
+        memcpy(z + zp, raw + pos, n);
+        for (size_t i = 0; i < n; i++) {
+            s1 = (s1 + raw[pos + i]) % 65521;
+            s2 = (s2 + s1) % 65521;
+        }
+        zp += n;
+        pos += n;
+    }
+    put_be32(z + zp, (s2 << 16) | s1);
+    zp += 4;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        free(raw);
+        free(z);
+        return EIO;
+    }
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, 8, f);
+
+    unsigned char ihdr[13];
+    put_be32(ihdr, (uint32_t)target->width);
+    put_be32(ihdr + 4, (uint32_t)target->height);
+    ihdr[8] = 8;    // bit depth
+    ihdr[9] = 2;    // truecolor RGB
+    ihdr[10] = 0;   // deflate
+    ihdr[11] = 0;   // adaptive filtering
+    ihdr[12] = 0;   // no interlace
+    png_write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+    png_write_chunk(f, "IDAT", z, zp);
+    png_write_chunk(f, "IEND", NULL, 0);
+
+    fclose(f);
+    free(raw);
+    free(z);
+    return EOK;
+}
+
+// ===== Positions file -> snapshot =====
+
+static cJSON *headless_load_json(const char *path)
+{
+    file_source_t src;
+    if (file_source_open(&src, path, 0, 0) != EOK)
+        return NULL;
+
+    cJSON *json = src.len > 0 ? cJSON_ParseWithLength(src.data, src.len) : NULL;
+    file_source_close(&src);
+    return json;
+}
+
+errno_t headless_render_positions(const char *positions_path, const char *font_dir,
+    const char *out_base, int width)
+{
+    if (!positions_path || !out_base)
+        return EINVAL;
+
+    cJSON *root = headless_load_json(positions_path);
+    if (!root) {
+        printf("[HEADLESS] Cannot read %s\n", positions_path);
+        return EIO;
+    }
+
+    font_manager_t *fm = malloc(sizeof(font_manager_t));
+    if (!fm) {
+        cJSON_Delete(root);
+        return ENOMEM;
+    }
+    font_manager_init(fm);
+    font_manager_load_fonts(fm, font_dir ? font_dir : "/data/font/");
+    font_manager_init_substitutions(fm);
+
+    headless_target_t target;
+    errno_t rc = headless_target_init(&target, width > 0 ? width : HEADLESS_DEFAULT_WIDTH, 0, fm);
+    if (rc != EOK) {
+        free(fm);
+        cJSON_Delete(root);
+        return rc;
+    }
+
+    page_paint_positions(&target.display_list, fm, root);
+
+    rc = headless_render(&target);
+    if (rc == EOK) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s.ppm", out_base);
+        rc = headless_write_ppm(&target, path);
+        if (rc == EOK) {
+            snprintf(path, sizeof(path), "%s.png", out_base);
+            rc = headless_write_png(&target, path);
+        }
+        if (DEB_INFO) printf("[HEADLESS] %zu paint items -> %s.{ppm,png} (%dx%d)\n",
+            target.display_list.count, out_base, target.width, target.height);
+    }
+
+    headless_target_destroy(&target);
+    font_manager_destroy(fm);
+    free(fm);
+    cJSON_Delete(root);
+    return rc;
+}
@@ -0,0 +1,60 @@
+// headless.h - Off-screen render target over a plain ARGB buffer
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdint.h>
+#include <errno.h>
+
+#include "font_manager.h"
+#include "paint_list.h"
+
+#define HEADLESS_DEFAULT_WIDTH 1024
+#define HEADLESS_DEFAULT_HEIGHT 768
+#define HEADLESS_MAX_HEIGHT 16384
+
+// Same drawing surface as html_renderer_t (display list + ARGB pixels),
+// without any gfx/ui dependency.
+typedef struct {
+    uint32_t *pixels;      // width * height, stride == width
+    int width;
+    int height;
+    int scroll_y;
+    paint_list_t display_list;
+    font_manager_t *font_manager;
+} headless_target_t;
+
+errno_t headless_target_init(headless_target_t *target, int width, int height,
+    font_manager_t *font_manager);
+void headless_target_destroy(headless_target_t *target);
+
+// Drawing API, mirrors the *_argb / *_css calls from render_func.h
+void headless_fill_argb(headless_target_t *target, int x, int y, int width, int height,
+    uint32_t argb);
+void headless_border_argb(headless_target_t *target, int x, int y, int width, int height,
+    uint32_t argb);
+void headless_text_argb(headless_target_t *target, const char *text, int x, int y,
+    html_font_t *font, float size, uint32_t argb);
+void headless_fill_css(headless_target_t *target, int x, int y, int width, int height,
+    const char *css_color_str);
+void headless_border_css(headless_target_t *target, int x, int y, int width, int height,
+    const char *css_color_str);
+void headless_text_css(headless_target_t *target, const char *text, int x, int y,
+    html_font_t *font, float size, const char *css_color_str);
+
+// Rasterize the display list into pixels (tiled, multi-threaded)
+errno_t headless_render(headless_target_t *target);
+
+// Rasterize again only document rows [y0, y1), after items were added
+// there (the first call renders everything)
+errno_t headless_render_rows(headless_target_t *target, int y0, int y1);
+
+// Snapshots
+errno_t headless_write_ppm(const headless_target_t *target, const char *path);
+errno_t headless_write_png(const headless_target_t *target, const char *path);
+
+// Paint a positions file from calculate_text_positions() and write
+// <out_base>.ppm and <out_base>.png
+errno_t headless_render_positions(const char *positions_path, const char *font_dir,
+    const char *out_base, int width);
+
+#endif // HEADLESS_H
@@ -0,0 +1,269 @@
+// http_cache_test.c - freshness and storage rules of http_cache
+//
+// http_cache_fresh_until() against max-age and Age, Expires and Date, an
+// unparsable Expires, the Last-Modified heuristic and its cap, and
+// no-cache. Then a cache in a directory of its own: what is refused
+// (no-store, Vary on request headers pauk does not always send the same),
+// a 304 taking new validators and freshness, and a write that is dropped
+// half way leaving neither a partial entry nor a temporary file, with the
+// entry it was replacing still served.
+//
+//   meson test -C _host http_cache
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+
+#include "http_cache.h"
+#include "cache_store.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            failures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+#define NOW 1000000000          // 2001-09-09 01:46:40 GMT
+#define DATE "Sun, 06 Nov 1994 08:49:37 GMT"
+
+static int64_t fresh(const char *cc, const char *age, const char *date,
+    const char *expires, const char *last_modified)
+{
+    http_cache_headers_t h = {
+        .status = 200,
+        .cache_control = cc,
+        .age = age,
+        .date = date,
+        .expires = expires,
+        .last_modified = last_modified,
+    };
+    return http_cache_fresh_until(&h, NOW);
+}
+
+static void test_fresh_until(void)
+{
+    int64_t t;
+
+    // max-age less what the response spent in caches on the way
+    t = fresh("max-age=100", NULL, NULL, NULL, NULL);
+    CHECK(t == NOW + 100, "max-age: %lld", (long long)t);
+    t = fresh("public, max-age=100", "30", NULL, NULL, NULL);
+    CHECK(t == NOW + 70, "max-age with Age: %lld", (long long)t);
+    t = fresh("max-age=100", "150", NULL, NULL, NULL);
+    CHECK(t == 0, "Age past max-age: %lld", (long long)t);
+    t = fresh("max-age=100", NULL, DATE, "Sun, 06 Nov 1994 08:49:38 GMT", NULL);
+    CHECK(t == NOW + 100, "max-age over Expires: %lld", (long long)t);
+
+    // Expires counts from the server's Date, not from our clock
+    t = fresh(NULL, NULL, DATE, "Sun, 06 Nov 1994 09:49:37 GMT", NULL);
+    CHECK(t == NOW + 3600, "Expires - Date: %lld", (long long)t);
+    t = fresh(NULL, "600", DATE, "Sun, 06 Nov 1994 09:49:37 GMT", NULL);
+    CHECK(t == NOW + 3000, "Expires - Date with Age: %lld", (long long)t);
+    t = fresh(NULL, NULL, DATE, DATE, NULL);
+    CHECK(t == 0, "Expires == Date: %lld", (long long)t);
+
+    // Unparsable Expires is in the past, even with Last-Modified
+    t = fresh(NULL, NULL, DATE, "0", "Sun, 06 Nov 1994 07:49:37 GMT");
+    CHECK(t == 0, "Expires: 0 -> %lld", (long long)t);
+
+    // A tenth of the time since Last-Modified, at most a day
+    t = fresh(NULL, NULL, DATE, NULL, "Sat, 05 Nov 1994 22:49:37 GMT");
+    CHECK(t == NOW + 3600, "heuristic: %lld", (long long)t);
+    t = fresh(NULL, NULL, DATE, NULL, "Sun, 06 Nov 1984 08:49:37 GMT");
+    CHECK(t == NOW + HTTP_CACHE_HEURISTIC_MAX_SEC, "heuristic cap: %lld", (long long)t);
+    t = fresh(NULL, NULL, DATE, NULL, "Mon, 07 Nov 1994 08:49:37 GMT");
+    CHECK(t == 0, "Last-Modified after Date: %lld", (long long)t);
+    t = fresh(NULL, NULL, NULL, NULL, NULL);
+    CHECK(t == 0, "no freshness: %lld", (long long)t);
+
+    // no-cache: stored, but every use asks first
+    t = fresh("max-age=100, no-cache", NULL, NULL, NULL, NULL);
+    CHECK(t == 0, "no-cache: %lld", (long long)t);
+    t = fresh("No-Cache", NULL, DATE, "Sun, 06 Nov 1994 09:49:37 GMT", NULL);
+    CHECK(t == 0, "No-Cache with Expires: %lld", (long long)t);
+}
+
+// ===== A cache of its own =====
+
+static char cache_dir[CACHE_STORE_PATH_MAX];
+
+// Files in the cache directory, temporary ones included
+static int dir_files(void)
+{
+    int n = 0;
+    DIR *d = opendir(cache_dir);
+    if (!d)
+        return -1;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") != 0 && strcmp(de->d_name, "..") != 0)
+            n++;
+    }
+    closedir(d);
+    return n;
+}
+
+static bool store(const char *url, const http_cache_headers_t *h, const char *body)
+{
+    http_cache_writer_t *w = http_cache_store_begin(url, h);
+    if (!w)
+        return false;
+    http_cache_store_write(w, body, strlen(body));
+    http_cache_store_end(w, true);
+    return true;
+}
+
+typedef struct {
+    char data[256];
+    size_t len;
+} body_t;
+
+static errno_t body_append(const void *data, size_t len, void *arg)
+{
+    body_t *b = arg;
+    if (b->len + len >= sizeof(b->data))
+        return ENOMEM;
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return EOK;
+}
+
+static void test_refused(void)
+{
+    http_cache_headers_t h = { .status = 200, .cache_control = "max-age=60, no-store" };
+    CHECK(!store("http://t/no-store", &h, "x"), "no-store stored");
+
+    h.cache_control = "max-age=60";
+    h.vary = "Cookie";
+    CHECK(!store("http://t/vary-cookie", &h, "x"), "Vary: Cookie stored");
+    h.vary = "*";
+    CHECK(!store("http://t/vary-star", &h, "x"), "Vary: * stored");
+    h.vary = "Accept-Encoding, Accept-Language";
+    CHECK(!store("http://t/vary-lang", &h, "x"), "Vary: Accept-Language stored");
+
+    // Sent the same with every request: cannot change the answer
+    h.vary = "accept-encoding ,User-Agent";
+    CHECK(store("http://t/vary-ae", &h, "x"), "Vary: Accept-Encoding refused");
+    CHECK(http_cache_lookup("http://t/vary-ae", NULL) == HTTP_CACHE_FRESH,
+        "Vary: Accept-Encoding not fresh");
+
+    h.vary = NULL;
+    h.status = 206;
+    CHECK(!store("http://t/partial", &h, "x"), "206 stored");
+
+    // Neither fresh nor revalidatable
+    h.status = 200;
+    h.cache_control = "no-cache";
+    CHECK(!store("http://t/useless", &h, "x"), "no-cache without validator stored");
+
+    CHECK(http_cache_lookup("http://t/no-store", NULL) == HTTP_CACHE_MISS, "no-store found");
+    CHECK(http_cache_lookup("http://t/vary-cookie", NULL) == HTTP_CACHE_MISS, "Vary found");
+}
+
+static void test_revalidated(void)
+{
+    const char *url = "http://t/revalidate";
+    http_cache_headers_t h = {
+        .status = 200,
+        .cache_control = "no-cache",
+        .etag = "\"v1\"",
+        .last_modified = "Sun, 06 Nov 1994 08:49:37 GMT",
+    };
+    CHECK(store(url, &h, "body one"), "validated response refused");
+
+    http_cache_validators_t v;
+    CHECK(http_cache_lookup(url, &v) == HTTP_CACHE_STALE, "no-cache entry not stale");
+    CHECK(strcmp(v.etag, "\"v1\"") == 0, "etag %s", v.etag);
+
+    // A 304 with newer validators, still no-cache
+    http_cache_headers_t nm = {
+        .status = 304,
+        .cache_control = "no-cache",
+        .etag = "\"v2\"",
+        .last_modified = "Mon, 07 Nov 1994 08:49:37 GMT",
+    };
+    http_cache_revalidated(url, &nm);
+    memset(&v, 0, sizeof(v));
+    CHECK(http_cache_lookup(url, &v) == HTTP_CACHE_STALE, "not stale after 304");
+    CHECK(strcmp(v.etag, "\"v2\"") == 0, "etag after 304: %s", v.etag);
+    CHECK(strcmp(v.last_modified, "Mon, 07 Nov 1994 08:49:37 GMT") == 0,
+        "Last-Modified after 304: %s", v.last_modified);
+
+    // A 304 without validators keeps the stored ones, takes the freshness
+    http_cache_headers_t fresh_nm = { .status = 304, .cache_control = "max-age=600" };
+    http_cache_revalidated(url, &fresh_nm);
+    CHECK(http_cache_lookup(url, NULL) == HTTP_CACHE_FRESH, "not fresh after max-age 304");
+
+    body_t b = { .len = 0 };
+    CHECK(http_cache_deliver(url, body_append, &b) == EOK && strcmp(b.data, "body one") == 0,
+        "body after 304: %s", b.data);
+    CHECK(http_cache_stats().revalidated == 2, "revalidated %u",
+        http_cache_stats().revalidated);
+}
+
+static void test_aborted_write(void)
+{
+    const char *url = "http://t/atomic";
+    http_cache_headers_t h = { .status = 200, .cache_control = "max-age=600" };
+    CHECK(store(url, &h, "complete"), "first copy refused");
+    int files = dir_files();
+
+    // The replacement streams into a temporary file of its own
+    http_cache_writer_t *w = http_cache_store_begin(url, &h);
+    CHECK(w != NULL, "second copy refused");
+    http_cache_store_write(w, "partial", 7);
+    CHECK(dir_files() == files + 1, "%d files while writing, %d before", dir_files(), files);
+    body_t b = { .len = 0 };
+    CHECK(http_cache_deliver(url, body_append, &b) == EOK && strcmp(b.data, "complete") == 0,
+        "while writing: %s", b.data);
+
+    // Dropped half way: no trace, the old entry still answers
+    http_cache_store_end(w, false);
+    CHECK(dir_files() == files, "%d files after the abort, %d before", dir_files(), files);
+    b.len = 0;
+    CHECK(http_cache_deliver(url, body_append, &b) == EOK && strcmp(b.data, "complete") == 0,
+        "after the abort: %s", b.data);
+
+    // A new URL dropped half way is not an entry at all
+    w = http_cache_store_begin("http://t/never", &h);
+    CHECK(w != NULL, "new copy refused");
+    http_cache_store_write(w, "part", 4);
+    http_cache_store_end(w, false);
+    CHECK(http_cache_lookup("http://t/never", NULL) == HTTP_CACHE_MISS, "aborted entry found");
+    CHECK(dir_files() == files, "%d files after the second abort", dir_files());
+}
+
+int main(void)
+{
+    test_fresh_until();
+
+    // A cache directory nobody else uses
+    char base[] = "/tmp/pauk-cache-test-XXXXXX";
+    if (!mkdtemp(base) || setenv("XDG_CACHE_HOME", base, 1) != 0 ||
+        cache_store_dir(HTTP_CACHE_NAME, cache_dir, sizeof(cache_dir)) != EOK ||
+        http_cache_init(cache_dir) != EOK) {
+        printf("FAIL: no cache directory\n");
+        return 1;
+    }
+
+    test_refused();
+    test_revalidated();
+    test_aborted_write();
+
+    http_cache_shutdown();
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", base);
+    if (system(cmd) != 0)
+        printf("could not remove %s\n", base);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
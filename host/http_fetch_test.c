@@ -0,0 +1,348 @@
+// http_fetch_test.c - http_fetch against a loopback server
+//
+// A small HTTP/1.1 server on 127.0.0.1 answers the client from a thread
+// per connection. Checked: chunked bodies split at awkward places,
+// keep-alive reuse, the retry when a pooled connection was closed by the
+// server while idle, pipelined requests, and redirects (the final URL is
+// known before the first body byte).
+//
+//   meson test -C _host http_fetch
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "http_fetch.h"
+#include "pauk_sync.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            failures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+// ===== Server =====
+
+static int listen_fd = -1;
+static uint16_t port;
+
+static pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+static int connections = 0;         // accepted so far
+static int pipelined_seen = 0;      // requests waiting when /p/0 was answered
+
+static int server_connections(void)
+{
+    pthread_mutex_lock(&server_lock);
+    int n = connections;
+    pthread_mutex_unlock(&server_lock);
+    return n;
+}
+
+static void send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void send_str(int fd, const char *s)
+{
+    send_all(fd, s, strlen(s));
+}
+
+static void send_text(int fd, const char *body)
+{
+    char head[256];
+    snprintf(head, sizeof(head),
+        "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n\r\n",
+        strlen(body));
+    send_str(fd, head);
+    send_str(fd, body);
+}
+
+static int count_requests(const char *buf)
+{
+    int n = 0;
+    for (const char *p = buf; (p = strstr(p, "\r\n\r\n")) != NULL; p += 4)
+        n++;
+    return n;
+}
+
+// Answer one request for path; false closes the connection
+static bool serve(int fd, const char *path, char *buf, size_t *buf_len, size_t buf_size)
+{
+    if (strcmp(path, "/chunked") == 0) {
+        send_str(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+            "Transfer-Encoding: chunked\r\n\r\n");
+        // Split inside sizes, data and CRLFs
+        static const char *const pieces[] = {
+            "7", "\r\nhel", "lo, \r", "\n8\r\nchunked ", "\r\n5;ext=1\r\nworld\r\n0",
+            "\r\n\r", "\n", NULL
+        };
+        for (int i = 0; pieces[i]; i++) {
+            send_str(fd, pieces[i]);
+            usleep(2000);
+        }
+        return true;
+    }
+    if (strcmp(path, "/redirect") == 0) {
+        send_str(fd, "HTTP/1.1 302 Found\r\nLocation: /target\r\n"
+            "Content-Length: 5\r\n\r\nmoved");
+        return true;
+    }
+    if (strcmp(path, "/drop") == 0) {
+        // Kept alive as far as the client knows, then gone
+        send_text(fd, "dropped");
+        return false;
+    }
+    if (strcmp(path, "/p/0") == 0) {
+        // Let the rest of the pipeline arrive, then see how much did
+        usleep(50000);
+        ssize_t n = recv(fd, buf + *buf_len, buf_size - 1 - *buf_len, MSG_DONTWAIT);
+        if (n > 0) {
+            *buf_len += (size_t)n;
+            buf[*buf_len] = '\0';
+        }
+        pthread_mutex_lock(&server_lock);
+        pipelined_seen = 1 + count_requests(buf);
+        pthread_mutex_unlock(&server_lock);
+    }
+    send_text(fd, path);
+    return true;
+}
+
+static errno_t server_connection(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    char buf[8192];
+    size_t len = 0;
+
+    for (;;) {
+        char *end;
+        while ((end = strstr(buf, "\r\n\r\n")) == NULL || len == 0) {
+            ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+            if (n <= 0) {
+                close(fd);
+                return EOK;
+            }
+            len += (size_t)n;
+            buf[len] = '\0';
+        }
+
+        char path[256] = "";
+        sscanf(buf, "GET %255s", path);
+        size_t used = (size_t)(end + 4 - buf);
+        memmove(buf, buf + used, len - used + 1);
+        len -= used;
+
+        if (!serve(fd, path, buf, &len, sizeof(buf)))
+            break;
+    }
+    close(fd);
+    return EOK;
+}
+
+static errno_t server_accept(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            return EOK;
+        pthread_mutex_lock(&server_lock);
+        connections++;
+        pthread_mutex_unlock(&server_lock);
+        pauk_thread_start(server_connection, (void *)(intptr_t)fd);
+    }
+}
+
+static bool server_start(void)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        return false;
+
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 16) != 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0)
+        return false;
+
+    port = ntohs(addr.sin_port);
+    return pauk_thread_start(server_accept, NULL) == EOK;
+}
+
+// ===== Client =====
+
+static void url_for(char *url, size_t size, const char *path)
+{
+    snprintf(url, size, "http://127.0.0.1:%u%s", port, path);
+}
+
+static void test_chunked(void)
+{
+    char url[128];
+    url_for(url, sizeof(url), "/chunked");
+
+    char *body = NULL;
+    size_t len = 0;
+    int status = 0;
+    errno_t rc = http_fetch(url, &body, &len, &status);
+    CHECK(rc == EOK, "chunked: rc %d", rc);
+    CHECK(status == 200, "chunked: status %d", status);
+    CHECK(body && strcmp(body, "hello, chunked world") == 0, "chunked: body \"%s\"",
+        body ? body : "(none)");
+    free(body);
+}
+
+static void test_keep_alive(void)
+{
+    char url[128];
+    int before = server_connections();
+
+    for (int i = 0; i < 3; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/keep/%d", i);
+        url_for(url, sizeof(url), path);
+
+        char *body = NULL;
+        size_t len = 0;
+        int status = 0;
+        errno_t rc = http_fetch(url, &body, &len, &status);
+        CHECK(rc == EOK && status == 200 && body && strcmp(body, path) == 0,
+            "keep-alive %s: rc %d status %d", path, rc, status);
+        free(body);
+    }
+    CHECK(server_connections() - before <= 1, "keep-alive: %d connections for 3 requests",
+        server_connections() - before);
+}
+
+static void test_stale_retry(void)
+{
+    char url[128];
+    char *body = NULL;
+    size_t len = 0;
+    int status = 0;
+
+    url_for(url, sizeof(url), "/drop");
+    errno_t rc = http_fetch(url, &body, &len, &status);
+    CHECK(rc == EOK && body && strcmp(body, "dropped") == 0, "drop: rc %d", rc);
+    free(body);
+    body = NULL;
+
+    // The pooled connection is closed by now: one silent retry
+    usleep(20000);
+    int before = server_connections();
+    url_for(url, sizeof(url), "/after-drop");
+    rc = http_fetch(url, &body, &len, &status);
+    CHECK(rc == EOK && status == 200 && body && strcmp(body, "/after-drop") == 0,
+        "stale retry: rc %d status %d", rc, status);
+    CHECK(server_connections() - before == 1, "stale retry: %d new connections",
+        server_connections() - before);
+    free(body);
+}
+
+static void test_pipelined(void)
+{
+    char urls[4][128];
+    const char *list[4];
+    for (int i = 0; i < 4; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/p/%d", i);
+        url_for(urls[i], sizeof(urls[i]), path);
+        list[i] = urls[i];
+    }
+
+    http_response_t out[4];
+    errno_t rc = http_fetch_pipelined(list, 4, out);
+    CHECK(rc == EOK, "pipelined: rc %d", rc);
+    for (int i = 0; i < 4; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/p/%d", i);
+        CHECK(out[i].rc == EOK && out[i].status == 200 && out[i].body &&
+            strcmp(out[i].body, path) == 0, "pipelined %s: rc %d status %d body \"%s\"",
+            path, out[i].rc, out[i].status, out[i].body ? out[i].body : "(none)");
+        free(out[i].body);
+    }
+
+    pthread_mutex_lock(&server_lock);
+    int seen = pipelined_seen;
+    pthread_mutex_unlock(&server_lock);
+    CHECK(seen >= 2, "pipelined: only %d request(s) in flight", seen);
+}
+
+typedef struct {
+    const char *final_url;
+    bool known_early;
+    size_t len;
+    char body[64];
+} redirect_sink_t;
+
+static errno_t redirect_body(const void *data, size_t len, void *arg)
+{
+    redirect_sink_t *s = arg;
+    if (s->len == 0) {
+        const char *end = s->final_url + strlen(s->final_url);
+        s->known_early = end - s->final_url >= 7 && strcmp(end - 7, "/target") == 0;
+    }
+    if (s->len + len < sizeof(s->body)) {
+        memcpy(s->body + s->len, data, len);
+        s->len += len;
+        s->body[s->len] = '\0';
+    }
+    return EOK;
+}
+
+static void test_redirect(void)
+{
+    char url[128];
+    url_for(url, sizeof(url), "/redirect");
+
+    char final_url[256] = "";
+    redirect_sink_t sink = { .final_url = final_url };
+    int status = 0;
+    errno_t rc = http_fetch_stream(url, redirect_body, &sink, &status,
+        final_url, sizeof(final_url), NULL, 0);
+
+    char expected[128];
+    url_for(expected, sizeof(expected), "/target");
+    CHECK(rc == EOK && status == 200, "redirect: rc %d status %d", rc, status);
+    CHECK(strcmp(sink.body, "/target") == 0, "redirect: body \"%s\"", sink.body);
+    CHECK(strcmp(final_url, expected) == 0, "redirect: final URL %s", final_url);
+    CHECK(sink.known_early, "redirect: final URL not set before the body");
+}
+
+int main(void)
+{
+    http_fetch_init();
+    if (!server_start()) {
+        printf("FAIL: no loopback server\n");
+        return 1;
+    }
+
+    test_keep_alive();
+    test_chunked();
+    test_stale_retry();
+    test_pipelined();
+    test_redirect();
+
+    http_fetch_shutdown();
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
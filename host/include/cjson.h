@@ -0,0 +1,7 @@
+// cjson.h - Host build: HelenOS ships cJSON as cjson.h
+#ifndef PAUK_HOST_CJSON_H
+#define PAUK_HOST_CJSON_H
+
+#include <cjson/cJSON.h>
+
+#endif
@@ -0,0 +1,7 @@
+// cjson_utils.h - Host build: HelenOS ships cJSON_Utils as cjson_utils.h
+#ifndef PAUK_HOST_CJSON_UTILS_H
+#define PAUK_HOST_CJSON_UTILS_H
+
+#include <cjson/cJSON_Utils.h>
+
+#endif
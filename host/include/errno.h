@@ -0,0 +1,20 @@
+// errno.h - Adds HelenOS errno_t/EOK on top of the system errno.h
+#ifndef PAUK_HOST_ERRNO_H
+#define PAUK_HOST_ERRNO_H
+
+#include_next <errno.h>
+
+#ifndef EOK
+#define EOK 0
+typedef int errno_t;
+#endif
+
+#ifndef ELIMIT
+#define ELIMIT EOVERFLOW
+#endif
+
+#ifndef ETIMEOUT
+#define ETIMEOUT ETIMEDOUT
+#endif
+
+#endif
@@ -0,0 +1,7 @@
+// mem.h - HelenOS memory helpers for the host build
+#ifndef PAUK_HOST_MEM_H
+#define PAUK_HOST_MEM_H
+
+#include <string.h>
+
+#endif
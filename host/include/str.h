@@ -0,0 +1,54 @@
+// str.h - HelenOS string API on top of libc for the host build
+#ifndef PAUK_HOST_STR_H
+#define PAUK_HOST_STR_H
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+static inline size_t str_length(const char *s) { return strlen(s); }
+static inline size_t str_size(const char *s) { return strlen(s); }
+static inline int str_cmp(const char *a, const char *b) { return strcmp(a, b); }
+static inline int str_lcmp(const char *a, const char *b, size_t n) { return strncmp(a, b, n); }
+static inline int str_casecmp(const char *a, const char *b) { return strcasecmp(a, b); }
+static inline int str_ncasecmp(const char *a, const char *b, size_t n) { return strncasecmp(a, b, n); }
+static inline char *str_chr(const char *s, int c) { return strchr(s, c); }
+static inline char *str_rchr(const char *s, int c) { return strrchr(s, c); }
+static inline char *str_str(const char *h, const char *n) { return strstr(h, n); }
+static inline char *str_dup(const char *s) { return strdup(s); }
+static inline char *str_ndup(const char *s, size_t n) { return strndup(s, n); }
+
+static inline char *str_casestr(const char *h, const char *n) { return strcasestr(h, n); }
+
+// Always NUL-terminates, like the HelenOS version
+static inline void str_cpy(char *dest, size_t size, const char *src)
+{
+    if (size == 0)
+        return;
+    size_t n = strlen(src);
+    if (n >= size)
+        n = size - 1;
+    memcpy(dest, src, n);
+    dest[n] = '\0';
+}
+
+static inline void str_append(char *dest, size_t size, const char *src)
+{
+    size_t len = strlen(dest);
+    if (len < size)
+        str_cpy(dest + len, size - len, src);
+}
+
+// Trim leading and trailing whitespace in place
+static inline char *str_trim(char *s)
+{
+    while (isspace((unsigned char)*s))
+        s++;
+    size_t n = strlen(s);
+    while (n > 0 && isspace((unsigned char)s[n - 1]))
+        s[--n] = '\0';
+    return s;
+}
+
+#endif
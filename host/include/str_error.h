@@ -0,0 +1,11 @@
+// str_error.h - HelenOS error strings for the host build
+#ifndef PAUK_HOST_STR_ERROR_H
+#define PAUK_HOST_STR_ERROR_H
+
+#include <string.h>
+#include <errno.h>
+
+static inline const char *str_error(errno_t rc) { return strerror(rc); }
+static inline const char *str_error_name(errno_t rc) { return strerror(rc); }
+
+#endif
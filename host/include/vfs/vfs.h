@@ -0,0 +1,9 @@
+// vfs/vfs.h - Host build: the engine only needs POSIX file access
+#ifndef PAUK_HOST_VFS_H
+#define PAUK_HOST_VFS_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
@@ -0,0 +1,582 @@
+// inflate_charset_test.c - the body decoders: content_inflate, charset_decoder
+//
+// content_inflate against streams zlib made (python zlib, level 9 gzip
+// with a file name, zlib with dynamic and stored blocks, raw deflate with
+// the fixed code, two gzip members one after the other), each fed whole,
+// a byte at a time and split at every offset. The big one is longer than
+// the window. Then damaged trailers (CRC-32, ISIZE, Adler-32), a stream
+// cut short and junk after a gzip member, all EIO.
+//
+// charset_decoder picks the charset in the order browsers do: byte order
+// mark, then Content-Type, then <meta> in the first CHARSET_PRESCAN_BYTES,
+// then UTF-8. Each document is also fed split at every offset.
+//
+//   meson test -C _host inflate_charset
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "content_inflate.h"
+#include "charset_decoder.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            failures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+// ===== Output =====
+
+typedef struct {
+    uint8_t data[40000];
+    size_t len;
+} output_t;
+
+static errno_t output_append(const void *data, size_t len, void *arg)
+{
+    output_t *out = arg;
+    if (out->len + len > sizeof(out->data))
+        return ENOMEM;
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    return EOK;
+}
+
+// ===== Inflate =====
+
+// What the vectors below were made from: python's version of this with
+// the same seed, cut to the length of each vector
+static const char *const words[4] = { "pauk", "window", "deflate", "the" };
+
+static uint8_t text[34000];
+
+static void make_text(void)
+{
+    uint32_t x = 1;
+    size_t len = 0;
+    while (len < sizeof(text)) {
+        x = (x * 1103515245u + 12345u) & 0x7fffffff;
+        for (const char *w = words[(x >> 16) & 3]; *w && len < sizeof(text); w++)
+            text[len++] = (uint8_t)*w;
+        if (len < sizeof(text))
+            text[len++] = ((x >> 8) & 7) == 0 ? '\n' : ' ';
+    }
+}
+
+static const uint8_t gzip_big[3287] = {
+    0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x62, 0x69, 0x67, 0x2e, 0x74, 0x78,
+    0x74, 0x00, 0xa5, 0x5d, 0x49, 0x92, 0x5d, 0x45, 0x0c, 0xdc, 0xe7, 0x29, 0xfa, 0x6a, 0x44, 0xd8,
+    0x04, 0x04, 0x04, 0xb0, 0x80, 0xf0, 0xf5, 0x01, 0x63, 0xff, 0x7e, 0x25, 0xe5, 0x54, 0xcd, 0xc2,
+    0x53, 0xb7, 0xfb, 0x0d, 0x55, 0x2a, 0x29, 0x95, 0x4a, 0xe9, 0x7f, 0xfa, 0xfc, 0xe3, 0xaf, 0x3f,
+    0xfc, 0xf9, 0xf9, 0xed, 0xd3, 0x7f, 0x7f, 0xe2, 0xcb, 0xcf, 0xbf, 0x7d, 0xfa, 0xfd, 0xcb, 0xdb,
+    0x9f, 0x3f, 0x7d, 0x7e, 0xfd, 0xfa, 0xf6, 0xad, 0xaf, 0x7f, 0xff, 0xe3, 0x87, 0xbf, 0x7e, 0x79,
+    0x7d, 0xe1, 0xf1, 0x7f, 0xbf, 0x7e, 0xfd, 0xdf, 0xdf, 0x9e, 0x17, 0xd8, 0x7f, 0xfd, 0x34, 0xee,
+    0xf6, 0xbc, 0x34, 0xbb, 0xdd, 0xf8, 0xb1, 0xd7, 0x5d, 0xc6, 0x37, 0xd6, 0x75, 0xce, 0x27, 0xfc,
+    0xfe, 0x4c, 0xef, 0x3f, 0xfe, 0xbc, 0xc6, 0xf8, 0x99, 0xe7, 0x0b, 0x8c, 0xc7, 0x7d, 0x9b, 0xd7,
+    0xc1, 0x3f, 0xff, 0x09, 0xf3, 0x3f, 0x91, 0xe7, 0x37, 0x8b, 0xba, 0x16, 0xf7, 0xfc, 0x11, 0x75,
+    0xf1, 0x63, 0x45, 0xe8, 0x17, 0xcf, 0x57, 0x7f, 0xdc, 0x06, 0xea, 0x6d, 0x5e, 0xcf, 0xf6, 0xfc,
+    0xc6, 0xb7, 0xcb, 0xec, 0x47, 0xc3, 0xeb, 0x47, 0xbe, 0xfd, 0x5b, 0xbd, 0x89, 0xb9, 0xf5, 0xf3,
+    0x47, 0xc4, 0xb7, 0xbe, 0xef, 0x8a, 0xba, 0xea, 0x30, 0x84, 0xe7, 0x7a, 0x1c, 0x0f, 0x4d, 0x17,
+    0x8a, 0xaf, 0xb5, 0x37, 0x22, 0xba, 0xd8, 0xeb, 0x4e, 0xaf, 0xc5, 0x79, 0x9c, 0x89, 0xaf, 0xd6,
+    0xa2, 0x6f, 0x39, 0x6d, 0xf2, 0xfd, 0xaf, 0x18, 0x1b, 0xf3, 0xb8, 0xd1, 0xb8, 0x1e, 0xb7, 0x37,
+    0xf1, 0xe4, 0xc4, 0x0c, 0xf1, 0xfe, 0xf0, 0xf3, 0x68, 0x9d, 0x8f, 0x03, 0x69, 0x3c, 0x72, 0x5d,
+    0x98, 0x75, 0x8d, 0xf3, 0x8e, 0x6d, 0x79, 0xcf, 0xfb, 0xf2, 0xad, 0x5f, 0x17, 0x12, 0xee, 0x09,
+    0xe5, 0x11, 0xa3, 0x2f, 0xf1, 0xb4, 0xee, 0xaf, 0xef, 0xcf, 0x1c, 0xe1, 0xfe, 0xa9, 0xd7, 0x2d,
+    0xd9, 0xcb, 0xab, 0x1b, 0x82, 0x79, 0xb8, 0xe1, 0x4f, 0x0f, 0x9f, 0x7b, 0xde, 0x82, 0x5a, 0xfa,
+    0xf1, 0x20, 0x9d, 0x8b, 0x31, 0x36, 0xe9, 0xfc, 0x22, 0x75, 0x7b, 0xd3, 0x49, 0x42, 0xf9, 0x0c,
+    0x73, 0xc4, 0xc7, 0x0a, 0xa8, 0x48, 0xc4, 0x2c, 0x81, 0xec, 0x7a, 0x77, 0xe6, 0xc9, 0xea, 0x6f,
+    0xfb, 0x9e, 0x8b, 0xb4, 0xfc, 0xe6, 0xb1, 0x33, 0xdf, 0xfe, 0x01, 0xe5, 0x01, 0xb8, 0xd7, 0x51,
+    0x81, 0x6c, 0x5c, 0x8d, 0x1f, 0x9c, 0x77, 0x5b, 0xe4, 0xde, 0x7d, 0x5c, 0xcf, 0x38, 0xe9, 0xb1,
+    0x07, 0xc6, 0x74, 0xb0, 0x8f, 0x0e, 0x5b, 0x40, 0xe7, 0x54, 0xb9, 0x19, 0x90, 0xdb, 0x5f, 0xec,
+    0xfe, 0xb1, 0xc4, 0xd3, 0x5e, 0xcf, 0x65, 0x28, 0x23, 0xb0, 0x0c, 0x36, 0xdc, 0xd0, 0xd8, 0x22,
+    0x7c, 0x77, 0xf1, 0xaf, 0x6d, 0x22, 0x78, 0xa1, 0x70, 0x5c, 0xcf, 0x78, 0x70, 0x3c, 0x15, 0xc7,
+    0x62, 0x6c, 0x6f, 0xe2, 0x1a, 0x9f, 0xe6, 0xf8, 0x7c, 0xc0, 0x11, 0xae, 0xe2, 0x85, 0xb9, 0x95,
+    0x1e, 0xe7, 0x86, 0x82, 0x9c, 0x75, 0x50, 0xf6, 0x5e, 0xc1, 0xc7, 0xf7, 0x61, 0xd0, 0xaf, 0x35,
+    0x3a, 0xc1, 0xc3, 0xe3, 0x7d, 0xcc, 0xa9, 0x92, 0xd0, 0xd0, 0xf8, 0x1e, 0x24, 0x68, 0xe9, 0x0c,
+    0xf8, 0x65, 0x27, 0xc2, 0xff, 0x71, 0x40, 0x70, 0xc0, 0x91, 0xe3, 0xa5, 0xb7, 0x0b, 0x93, 0x5b,
+    0x95, 0x01, 0xee, 0x71, 0x80, 0xc0, 0x80, 0x9f, 0xf7, 0x2d, 0xf0, 0xb1, 0x8b, 0xbb, 0xa9, 0xb1,
+    0x61, 0xf4, 0x5c, 0x26, 0x20, 0x6f, 0x62, 0x8d, 0xda, 0x04, 0xb6, 0x61, 0x31, 0x70, 0x09, 0x97,
+    0x3a, 0x40, 0xa2, 0x38, 0x1f, 0xd6, 0x1f, 0x9a, 0x84, 0x88, 0x84, 0x61, 0xb2, 0x6d, 0xb5, 0xd7,
+    0x54, 0x5b, 0xce, 0xb2, 0x41, 0x0a, 0x4a, 0x66, 0xf0, 0x57, 0x9e, 0xf3, 0x70, 0x50, 0x36, 0xf1,
+    0xd1, 0x6e, 0x2b, 0xad, 0xe6, 0x58, 0x6e, 0x50, 0x14, 0xbb, 0x2f, 0xe0, 0xfe, 0x58, 0x06, 0x4a,
+    0x97, 0xb7, 0x89, 0x82, 0xec, 0xe0, 0x08, 0x4c, 0x5f, 0x85, 0x2e, 0xbe, 0x18, 0xeb, 0x55, 0x25,
+    0x38, 0x65, 0x08, 0x8c, 0x01, 0x4b, 0x46, 0x1a, 0x80, 0x66, 0x01, 0xa0, 0x1e, 0xc8, 0xc4, 0x3c,
+    0x0a, 0x72, 0x13, 0x94, 0x7a, 0x66, 0xf7, 0xfb, 0xc8, 0x8b, 0x37, 0x80, 0x82, 0xea, 0xe4, 0x25,
+    0x9f, 0x2f, 0x78, 0x58, 0xfa, 0x5a, 0x6d, 0x97, 0x8f, 0xcf, 0xab, 0x60, 0x05, 0xf1, 0xe1, 0xea,
+    0xd2, 0x99, 0xa1, 0xd0, 0x26, 0x06, 0x66, 0x8a, 0x8a, 0x36, 0x22, 0xc1, 0x13, 0xb5, 0xd8, 0x33,
+    0xb3, 0x83, 0x8f, 0x76, 0x90, 0xd3, 0x16, 0xa0, 0x83, 0x8d, 0xf2, 0x43, 0x3a, 0x96, 0xb1, 0x97,
+    0xa4, 0x0f, 0xce, 0xac, 0x12, 0xfe, 0x9c, 0xf0, 0x60, 0xb5, 0x2f, 0x16, 0xce, 0xa4, 0x02, 0xe1,
+    0x67, 0x64, 0x7d, 0x01, 0x45, 0xe7, 0x0d, 0xdb, 0x30, 0x6d, 0xc3, 0x8a, 0x44, 0xf1, 0xc4, 0x38,
+    0x44, 0x66, 0xc4, 0xbd, 0xce, 0xe6, 0x30, 0xb0, 0x8f, 0xa8, 0xcf, 0x73, 0xde, 0x61, 0xd0, 0xda,
+    0x0d, 0x63, 0xe9, 0x82, 0x38, 0x62, 0xfb, 0xb0, 0x2e, 0x09, 0x96, 0xc9, 0xbd, 0x71, 0x97, 0xc2,
+    0x16, 0x65, 0x7f, 0x1f, 0x06, 0xbc, 0x8f, 0x98, 0x04, 0x7e, 0xd0, 0x74, 0xf0, 0x96, 0xdf, 0xc1,
+    0xff, 0x4b, 0xb7, 0x6c, 0x3c, 0xf3, 0x64, 0x99, 0xa1, 0x68, 0xf4, 0xa9, 0x76, 0xa1, 0x5f, 0x32,
+    0xbf, 0xea, 0xef, 0x1a, 0x4f, 0x09, 0x50, 0x87, 0xea, 0x19, 0xc7, 0x6f, 0x26, 0x37, 0x51, 0xdf,
+    0x37, 0x09, 0x5e, 0x48, 0xb5, 0x1d, 0xb7, 0xe9, 0x4f, 0x77, 0x40, 0xe5, 0x45, 0xac, 0xc7, 0xe9,
+    0x4b, 0x56, 0x50, 0x5c, 0x5f, 0x58, 0x5e, 0x94, 0x61, 0x61, 0x99, 0x64, 0x4b, 0xf4, 0x02, 0xe5,
+    0x6f, 0x60, 0x39, 0x5f, 0x90, 0x4d, 0x26, 0xb4, 0xaa, 0x44, 0xaa, 0x0e, 0xba, 0xe6, 0xa4, 0x83,
+    0xad, 0x6f, 0x83, 0x73, 0x63, 0xc2, 0x7a, 0x77, 0x9e, 0xd2, 0xf3, 0x73, 0xdb, 0x86, 0x62, 0x27,
+    0x32, 0x19, 0x99, 0x2a, 0x05, 0x04, 0x23, 0x49, 0x6f, 0x84, 0x11, 0xc7, 0x20, 0x32, 0x70, 0x93,
+    0x8e, 0x8b, 0x94, 0x1e, 0x87, 0xc7, 0x7f, 0x59, 0x06, 0x27, 0x9d, 0xb0, 0x20, 0xa0, 0xe4, 0x95,
+    0x56, 0x0c, 0x21, 0xef, 0x59, 0xa6, 0x7b, 0xa0, 0x08, 0xcb, 0xe4, 0xe9, 0x1b, 0x8f, 0xca, 0xf3,
+    0x58, 0x45, 0xcf, 0x61, 0xc6, 0x20, 0x95, 0x09, 0xb3, 0xc1, 0xef, 0x01, 0x7c, 0xc1, 0xd6, 0x00,
+    0x6e, 0x10, 0x1d, 0x25, 0x54, 0xa9, 0x91, 0x6d, 0x62, 0x20, 0xdc, 0x4d, 0x01, 0x83, 0x83, 0x42,
+    0xcd, 0x56, 0xe0, 0xa6, 0xae, 0xa7, 0xcb, 0x3e, 0x1c, 0xb6, 0x6a, 0xc4, 0x27, 0xb8, 0x12, 0x76,
+    0x62, 0xc3, 0x83, 0x72, 0x27, 0x9e, 0x00, 0x4f, 0x51, 0xfe, 0x95, 0x48, 0x92, 0x17, 0x14, 0x58,
+    0xce, 0x49, 0xb1, 0x8d, 0x29, 0x3b, 0x8a, 0xf4, 0x83, 0xc6, 0x3b, 0x50, 0xc3, 0x0b, 0x25, 0x95,
+    0x1e, 0x78, 0x2c, 0xa7, 0xe0, 0x23, 0xf4, 0xe3, 0xa5, 0x50, 0x70, 0xd5, 0x22, 0x2f, 0x5f, 0x24,
+    0xb4, 0x77, 0x0d, 0xf0, 0x5c, 0x0f, 0x22, 0x66, 0x1b, 0xa8, 0x5d, 0x22, 0xcd, 0x93, 0x15, 0x80,
+    0x37, 0xed, 0xe0, 0xb8, 0x20, 0xcb, 0x6f, 0x05, 0xba, 0xf7, 0x21, 0x31, 0x94, 0x1d, 0xc8, 0x56,
+    0x85, 0xfd, 0x88, 0x15, 0x11, 0x1d, 0x16, 0xbc, 0xe8, 0x20, 0xf3, 0xe0, 0x8a, 0xec, 0x98, 0xbf,
+    0x28, 0x02, 0xe8, 0xd3, 0xf9, 0x0e, 0x7e, 0x0f, 0x17, 0xa4, 0x89, 0x29, 0xe2, 0x75, 0x03, 0xa4,
+    0x0d, 0xc0, 0x40, 0xd7, 0x7d, 0x95, 0x67, 0xda, 0x85, 0x5b, 0x69, 0x41, 0xaa, 0xaa, 0x53, 0x64,
+    0x61, 0x45, 0xca, 0xe5, 0x6a, 0x7f, 0x9e, 0xd2, 0x33, 0xc2, 0x03, 0x11, 0xe6, 0x55, 0x31, 0xfa,
+    0xa1, 0x73, 0xb8, 0x2f, 0x81, 0x35, 0x71, 0x5f, 0x66, 0x0c, 0xd8, 0x3b, 0xb7, 0x8d, 0x83, 0x24,
+    0x2b, 0x92, 0xba, 0x10, 0x30, 0xc2, 0xd0, 0x17, 0x4f, 0x6e, 0x8c, 0x25, 0x22, 0x07, 0x71, 0x43,
+    0x4d, 0x07, 0x77, 0xda, 0x1f, 0xab, 0xb4, 0x12, 0xe5, 0x2b, 0x71, 0x6a, 0xa2, 0x1d, 0x72, 0x9c,
+    0xc3, 0xcf, 0xab, 0xa5, 0xa6, 0xd5, 0xcd, 0x3d, 0x85, 0x2f, 0xdf, 0xcf, 0x21, 0x10, 0xe1, 0x9e,
+    0x38, 0xc9, 0xa2, 0x99, 0x93, 0x91, 0x29, 0x46, 0x7d, 0x8b, 0x78, 0xf6, 0xa7, 0xa9, 0x18, 0xed,
+    0x02, 0x8a, 0x5a, 0x80, 0xf1, 0x69, 0x50, 0x95, 0x40, 0x08, 0xa2, 0x4b, 0xac, 0xb2, 0x3c, 0x87,
+    0x25, 0xdd, 0x24, 0x7c, 0xdf, 0xf0, 0x12, 0xc2, 0x83, 0xae, 0x22, 0xa5, 0x10, 0x15, 0xd6, 0x0f,
+    0x08, 0x67, 0x67, 0xae, 0x7a, 0xe1, 0xdc, 0x2f, 0xe5, 0xc1, 0x3b, 0x4c, 0xe0, 0x72, 0x93, 0x98,
+    0xc3, 0x7d, 0x4c, 0x6a, 0xf9, 0x66, 0x15, 0x37, 0xa7, 0xc3, 0x5c, 0x11, 0x4a, 0x4a, 0x73, 0xbc,
+    0x01, 0x14, 0x8a, 0x4e, 0x93, 0x31, 0xa3, 0xa8, 0xb0, 0x7a, 0xa2, 0xa3, 0xc2, 0x54, 0xbe, 0x5e,
+    0x93, 0x6a, 0x4c, 0x9b, 0x75, 0xb0, 0xc7, 0x20, 0x48, 0x6b, 0x1a, 0x78, 0x69, 0xf3, 0x24, 0xa7,
+    0xef, 0x31, 0xb0, 0x01, 0x53, 0x79, 0x32, 0x55, 0x97, 0xe0, 0x4b, 0xe5, 0x16, 0xb7, 0x50, 0x1b,
+    0x5e, 0xc3, 0x9a, 0xe4, 0xa4, 0x2f, 0xa2, 0x76, 0x52, 0xc2, 0x08, 0x26, 0x30, 0x2b, 0xc9, 0xbc,
+    0xb2, 0x13, 0x81, 0x8c, 0x92, 0xf5, 0xa1, 0x4e, 0x87, 0xa1, 0xc1, 0xb1, 0x43, 0x9b, 0xbe, 0xc2,
+    0x40, 0x4a, 0x70, 0x88, 0x25, 0x6d, 0x94, 0x65, 0x24, 0x53, 0x5a, 0x06, 0x25, 0x15, 0xe5, 0xcf,
+    0x81, 0x91, 0x40, 0x46, 0xce, 0x46, 0x4c, 0x2a, 0xb3, 0x6f, 0x41, 0x75, 0x30, 0xcf, 0xad, 0x4b,
+    0xb6, 0x79, 0xc9, 0x9e, 0xc8, 0xad, 0x0b, 0x9d, 0xd3, 0xf4, 0x39, 0x5b, 0x77, 0xfa, 0x94, 0x97,
+    0x4d, 0xc0, 0xca, 0x33, 0x78, 0x8a, 0x82, 0xb5, 0xe4, 0x98, 0xd3, 0xe1, 0x34, 0x89, 0xe6, 0xb7,
+    0x22, 0x01, 0x03, 0x46, 0x0f, 0xd0, 0x85, 0x24, 0x25, 0x83, 0xb3, 0x10, 0x9f, 0xe6, 0xaf, 0x0c,
+    0x64, 0xa9, 0x5d, 0x9a, 0x75, 0x6e, 0xb4, 0x2e, 0xad, 0x90, 0xe7, 0x70, 0x0d, 0x54, 0xa1, 0x12,
+    0xd4, 0xd4, 0xaf, 0x58, 0xf1, 0xba, 0xac, 0x89, 0x74, 0xc8, 0x4d, 0xfd, 0x78, 0x33, 0x3d, 0x22,
+    0x84, 0xa9, 0xd3, 0xed, 0x4f, 0x1b, 0xa6, 0x97, 0xb3, 0x9a, 0x17, 0x0f, 0xbf, 0xd8, 0xe6, 0x6b,
+    0xdc, 0x63, 0xb3, 0x0c, 0x10, 0xa0, 0xdf, 0x55, 0x4a, 0x56, 0xf4, 0xdd, 0x2c, 0x96, 0x86, 0x71,
+    0xfc, 0xc9, 0x95, 0x3e, 0x7e, 0x55, 0x2a, 0xa1, 0xf8, 0xd5, 0x86, 0xcf, 0x8a, 0x95, 0xdc, 0x7d,
+    0x6b, 0x17, 0xe0, 0x8b, 0xb0, 0x98, 0x45, 0xf9, 0x5e, 0xa8, 0x40, 0x09, 0x48, 0x6c, 0x5b, 0x62,
+    0x55, 0xd1, 0x5c, 0xd3, 0x55, 0xec, 0x07, 0x4c, 0xff, 0x4b, 0x55, 0x34, 0xe0, 0xf8, 0xb3, 0xc8,
+    0xb1, 0xdd, 0xf1, 0xd0, 0x01, 0xac, 0x93, 0xb1, 0x9f, 0x0b, 0x2f, 0x40, 0x33, 0xe7, 0x2e, 0x15,
+    0x20, 0xd2, 0x47, 0xcf, 0x21, 0x4f, 0xd5, 0x90, 0xf1, 0x3c, 0x98, 0x3e, 0x59, 0x73, 0xca, 0xf3,
+    0x29, 0x6a, 0xf3, 0xd0, 0x18, 0xae, 0x8d, 0x61, 0x20, 0xb3, 0x02, 0x5d, 0xa3, 0x11, 0xf1, 0xa2,
+    0x68, 0x3c, 0x8a, 0x79, 0x9c, 0x4e, 0x94, 0xa9, 0xac, 0x7d, 0x9e, 0x59, 0xb3, 0xd9, 0xc5, 0x59,
+    0x51, 0x39, 0xd2, 0x3d, 0x3b, 0xaa, 0x72, 0xd0, 0xd0, 0xd1, 0xf5, 0xc8, 0xfb, 0x2f, 0x1a, 0xd8,
+    0x14, 0xb6, 0x99, 0x26, 0x13, 0xdc, 0x2a, 0x4f, 0x64, 0x60, 0x25, 0x31, 0x4e, 0x18, 0x6d, 0x84,
+    0x61, 0x89, 0xac, 0x30, 0xd5, 0xfa, 0x22, 0xd6, 0x6b, 0x00, 0x27, 0xc8, 0xdb, 0xa6, 0x85, 0x00,
+    0x2e, 0xd9, 0x24, 0x2c, 0x35, 0x3f, 0x14, 0x38, 0xac, 0x57, 0x42, 0x75, 0x75, 0x0f, 0xd9, 0xb7,
+    0xc6, 0xea, 0x29, 0xbe, 0x1d, 0xd0, 0x75, 0xf7, 0x81, 0x23, 0x42, 0x5d, 0x46, 0x69, 0x55, 0x18,
+    0x85, 0xf6, 0x43, 0x58, 0x29, 0x16, 0x1b, 0xef, 0x85, 0xf2, 0x08, 0x7a, 0x23, 0xdf, 0x6b, 0x81,
+    0x99, 0xc1, 0x53, 0x54, 0x7c, 0x53, 0x48, 0xc9, 0xb9, 0xa9, 0x15, 0xfd, 0xf8, 0x8e, 0x50, 0xfa,
+    0xea, 0x30, 0x74, 0xa4, 0x44, 0x0a, 0xb4, 0x66, 0x49, 0xf0, 0x91, 0xe7, 0xbd, 0xb5, 0x4c, 0x47,
+    0xbd, 0x9f, 0x3c, 0x09, 0x2a, 0xbe, 0x15, 0x09, 0x96, 0xc8, 0xdf, 0x73, 0x6a, 0x9d, 0xb5, 0xcc,
+    0x6b, 0x99, 0x76, 0xef, 0x4b, 0x13, 0x67, 0x08, 0x31, 0x9e, 0x1a, 0xa7, 0xfd, 0xc1, 0xb6, 0xc7,
+    0x57, 0xdd, 0xfa, 0xa2, 0xf7, 0xc3, 0x2f, 0x55, 0x3a, 0x99, 0x75, 0x12, 0x5c, 0xd1, 0x3f, 0xe4,
+    0xbd, 0x9b, 0x35, 0xe7, 0xeb, 0x1d, 0x88, 0x95, 0x9b, 0xde, 0x62, 0x9b, 0x74, 0x0d, 0x24, 0xae,
+    0xee, 0x67, 0x7b, 0x97, 0xc6, 0x26, 0xdb, 0x42, 0xd9, 0x8e, 0x47, 0x24, 0x96, 0x42, 0x74, 0xd1,
+    0xb0, 0x42, 0x98, 0x14, 0xc7, 0x54, 0xa4, 0x6c, 0x63, 0xf0, 0xa7, 0x13, 0xd3, 0xc0, 0xd3, 0x11,
+    0xcf, 0x8e, 0xee, 0xf7, 0x3a, 0x20, 0x58, 0x97, 0x78, 0x23, 0x82, 0xb3, 0xfe, 0xbc, 0x11, 0x7e,
+    0x28, 0x17, 0xd7, 0xfe, 0xc9, 0x0f, 0x7e, 0x68, 0x33, 0x8b, 0x91, 0x5c, 0x13, 0x10, 0x93, 0xe8,
+    0x37, 0xbd, 0xd5, 0xbc, 0x6e, 0x8b, 0x7c, 0x50, 0xc3, 0xf6, 0x14, 0x94, 0xaa, 0xce, 0x61, 0xc9,
+    0x28, 0x05, 0xd9, 0x88, 0x0d, 0x4e, 0x2e, 0x51, 0x98, 0xa0, 0x71, 0x29, 0x3a, 0x01, 0x8d, 0x22,
+    0xd0, 0x64, 0x50, 0xb5, 0xb1, 0x5e, 0x4a, 0x1b, 0x60, 0x45, 0xf0, 0xdc, 0xeb, 0x58, 0xa4, 0xed,
+    0x87, 0xb9, 0x74, 0xdc, 0x79, 0x3f, 0x56, 0x83, 0xb1, 0x02, 0xb6, 0x8a, 0xd9, 0xd4, 0x00, 0x24,
+    0x0b, 0xae, 0x87, 0x53, 0x5c, 0x4e, 0x61, 0x21, 0xd5, 0xeb, 0x82, 0x1c, 0x30, 0xe5, 0xcf, 0x99,
+    0x0c, 0x7a, 0x76, 0xd7, 0x69, 0xc0, 0xfb, 0x3a, 0x9b, 0x16, 0x30, 0x76, 0x65, 0x8f, 0xae, 0x3c,
+    0x0e, 0x07, 0x07, 0x98, 0xf4, 0x86, 0x36, 0x02, 0x5e, 0x50, 0x30, 0xac, 0x69, 0x7e, 0xda, 0x95,
+    0x31, 0x3b, 0xa3, 0x1a, 0x84, 0xce, 0x18, 0xcd, 0xb4, 0x13, 0x79, 0xf8, 0x0a, 0x84, 0xd3, 0x16,
+    0x07, 0x55, 0x3c, 0xde, 0x1c, 0x27, 0x0c, 0xd9, 0x92, 0x66, 0x92, 0x84, 0xb4, 0xc6, 0x3b, 0xd4,
+    0xa8, 0xf7, 0x93, 0x35, 0x8c, 0xc5, 0x21, 0xd1, 0xc3, 0x81, 0x13, 0xa5, 0x09, 0x5d, 0x43, 0x2e,
+    0x7e, 0xf0, 0xb6, 0x10, 0xd9, 0x48, 0xaf, 0x4b, 0x09, 0x27, 0x24, 0x72, 0xc0, 0xb4, 0xee, 0x93,
+    0x50, 0xaf, 0xc6, 0x52, 0x38, 0x4b, 0x7d, 0xe8, 0xbd, 0x67, 0x64, 0x56, 0x95, 0x3f, 0xd4, 0x59,
+    0x3d, 0xba, 0x0e, 0x54, 0x4d, 0xc7, 0x78, 0xf8, 0x0f, 0x09, 0x5b, 0xc0, 0xb4, 0xaa, 0xee, 0x45,
+    0xc1, 0x36, 0xa6, 0x52, 0x97, 0x0a, 0xa7, 0x90, 0xc4, 0x2c, 0x86, 0x0c, 0x2b, 0x34, 0x7b, 0x65,
+    0x40, 0x00, 0x67, 0x32, 0x75, 0x73, 0x8d, 0x96, 0x7b, 0xd3, 0xe4, 0xdf, 0x55, 0x69, 0x6a, 0xee,
+    0x95, 0x01, 0x23, 0xb8, 0x59, 0x2d, 0x30, 0x9d, 0x40, 0xd7, 0xca, 0x19, 0xe6, 0xfb, 0xed, 0x94,
+    0x9c, 0xba, 0x14, 0x20, 0xbe, 0x1a, 0x58, 0xe6, 0x67, 0x31, 0xe2, 0x43, 0x63, 0x7a, 0x4c, 0x91,
+    0xd6, 0xd4, 0x93, 0x10, 0x17, 0x8a, 0xb6, 0xe9, 0x88, 0x73, 0xd9, 0x91, 0x6b, 0xc8, 0x3a, 0xd2,
+    0x34, 0xec, 0xe9, 0x48, 0x7a, 0xdd, 0xf1, 0x11, 0x4d, 0x30, 0x57, 0x48, 0xaa, 0x10, 0x9b, 0xb1,
+    0xe4, 0xbd, 0xce, 0x0a, 0x2a, 0x1f, 0x6c, 0x08, 0xe8, 0x4a, 0x7d, 0x56, 0x91, 0x96, 0xba, 0x49,
+    0x05, 0xa9, 0x57, 0x2c, 0x27, 0x3e, 0x79, 0x32, 0x64, 0x57, 0xfa, 0x4b, 0xb8, 0x68, 0xb9, 0xf2,
+    0x2e, 0x91, 0x99, 0xe6, 0x64, 0x07, 0x68, 0x20, 0xb3, 0xb6, 0x3a, 0xe1, 0x4b, 0xdb, 0x63, 0xdd,
+    0x48, 0xa3, 0x20, 0x48, 0x0c, 0x8c, 0xc5, 0x4d, 0xbb, 0xfb, 0xb1, 0xe1, 0x21, 0x87, 0xc4, 0x48,
+    0x7a, 0xcf, 0x56, 0x15, 0x73, 0xfd, 0x9a, 0x3a, 0x44, 0x64, 0x91, 0x10, 0xeb, 0x1e, 0x72, 0xd5,
+    0x74, 0x04, 0xc2, 0x45, 0x0c, 0xdc, 0x44, 0xee, 0xd9, 0x4e, 0x63, 0x06, 0x11, 0x64, 0x30, 0x85,
+    0x7c, 0x56, 0xce, 0x35, 0x15, 0x69, 0x61, 0xd2, 0x5e, 0xa7, 0x36, 0x40, 0xd2, 0x92, 0x91, 0x26,
+    0x8e, 0x44, 0xa6, 0xd6, 0xc6, 0xc6, 0x50, 0xc6, 0xa2, 0xe8, 0x5b, 0xb6, 0x03, 0xf2, 0x8a, 0x1e,
+    0x6b, 0x88, 0x47, 0x68, 0xfb, 0xf1, 0xfd, 0x8d, 0x10, 0x29, 0x4a, 0xa4, 0xe1, 0xcc, 0x09, 0x55,
+    0x4d, 0xf9, 0x10, 0x36, 0x15, 0x72, 0xc2, 0xae, 0x69, 0xa4, 0x82, 0xa9, 0x46, 0xba, 0x26, 0x5b,
+    0x05, 0x45, 0xa5, 0x1b, 0x8c, 0xfb, 0xd3, 0x65, 0xd2, 0x4d, 0x99, 0x5f, 0xda, 0x5c, 0x05, 0x0e,
+    0x06, 0x37, 0xda, 0x17, 0xbb, 0xe8, 0xc9, 0x91, 0x39, 0x0a, 0x87, 0xa2, 0xa9, 0xc2, 0x6a, 0x07,
+    0x37, 0x4a, 0x96, 0xaa, 0xad, 0x21, 0xa5, 0xe9, 0x09, 0x74, 0x9a, 0x4a, 0x33, 0x9b, 0x44, 0xf4,
+    0xea, 0x85, 0x79, 0x89, 0x4e, 0x4a, 0x20, 0xea, 0xf2, 0x49, 0x7e, 0xe3, 0x2b, 0xc5, 0xd8, 0xcb,
+    0x99, 0x8b, 0x2c, 0x71, 0xc8, 0x51, 0xa0, 0x15, 0xe2, 0x82, 0x36, 0xea, 0x75, 0x3e, 0x07, 0x41,
+    0xb4, 0x4a, 0xc0, 0x8e, 0xd6, 0xb8, 0x82, 0xb4, 0xcd, 0x24, 0xb1, 0x3e, 0x93, 0x9c, 0xda, 0x33,
+    0x97, 0x77, 0xcb, 0x49, 0x4f, 0xa7, 0xc7, 0xd5, 0xe7, 0x29, 0x77, 0x4d, 0x4d, 0x56, 0xf2, 0x86,
+    0x92, 0x4f, 0x3c, 0x4c, 0xe0, 0x9a, 0xcd, 0x9b, 0x23, 0x8b, 0x74, 0xe5, 0x78, 0xb3, 0xf0, 0x44,
+    0x48, 0x8a, 0xeb, 0xa6, 0xb8, 0x35, 0xb9, 0xad, 0x66, 0xaa, 0x08, 0xe8, 0xb4, 0xb1, 0x88, 0xd3,
+    0xd1, 0xd9, 0xd2, 0x9b, 0xa7, 0xd0, 0xcd, 0xd4, 0x06, 0xd9, 0x0f, 0x50, 0x0c, 0xb0, 0x90, 0xac,
+    0xd5, 0xa2, 0x87, 0x44, 0x45, 0x65, 0xf8, 0xb2, 0xd0, 0x8b, 0x68, 0x86, 0x94, 0xc2, 0x95, 0xfa,
+    0xbc, 0x6b, 0x2d, 0x84, 0xe1, 0x39, 0x57, 0x81, 0xd3, 0x67, 0xe8, 0x8d, 0x30, 0x8d, 0x05, 0x3a,
+    0xfc, 0x25, 0x45, 0x07, 0xda, 0x49, 0x56, 0x72, 0x84, 0x84, 0x7f, 0x60, 0x8f, 0x68, 0xab, 0x02,
+    0x9f, 0xb1, 0x43, 0xe5, 0xef, 0x50, 0xcc, 0xf8, 0x24, 0xab, 0xba, 0x38, 0x82, 0x15, 0x30, 0xaa,
+    0x56, 0x5c, 0x3b, 0x5e, 0xcb, 0x8a, 0xd4, 0xed, 0x48, 0xd4, 0x13, 0x27, 0x30, 0xdf, 0xda, 0x51,
+    0xe7, 0xa1, 0xb8, 0x14, 0xc4, 0x49, 0x4f, 0x6e, 0x8f, 0xb9, 0x36, 0xe9, 0x16, 0x98, 0x6b, 0x10,
+    0x53, 0x74, 0xaf, 0x66, 0xf6, 0x36, 0xf0, 0x00, 0x42, 0xab, 0x71, 0x0c, 0x3f, 0xb2, 0x4f, 0xde,
+    0x91, 0x94, 0x4e, 0x87, 0x0e, 0x2b, 0xaf, 0x83, 0xaf, 0x67, 0x8a, 0x12, 0x7f, 0x46, 0xfd, 0xbc,
+    0x0d, 0x76, 0x0f, 0x2d, 0x82, 0x6b, 0xff, 0x52, 0xbe, 0x32, 0x7d, 0x1e, 0x08, 0x4b, 0x73, 0x16,
+    0xd9, 0xed, 0x2a, 0x0a, 0x45, 0x6b, 0xda, 0x87, 0xf2, 0xb7, 0xd8, 0x0c, 0x99, 0x7d, 0xb9, 0x9c,
+    0x88, 0x0d, 0xb1, 0xd9, 0xde, 0xf1, 0x35, 0xed, 0x11, 0x97, 0x3c, 0x53, 0x6c, 0x1a, 0x7e, 0xef,
+    0x9c, 0x0d, 0x62, 0xa3, 0x60, 0x17, 0x8c, 0x70, 0xf0, 0x02, 0x89, 0xa8, 0x07, 0x6e, 0x26, 0xb3,
+    0xeb, 0x65, 0x81, 0xa2, 0x91, 0x2e, 0x46, 0x3c, 0xd9, 0xc9, 0x78, 0x66, 0xdc, 0xae, 0xa3, 0x5e,
+    0x8b, 0xdd, 0x12, 0x40, 0xe3, 0x4e, 0xa9, 0x52, 0x22, 0xaf, 0x4a, 0xc3, 0x18, 0xdb, 0x10, 0x70,
+    0xd3, 0x30, 0xad, 0xeb, 0xd9, 0x66, 0x86, 0xb5, 0x0b, 0x52, 0xc2, 0x1c, 0xc9, 0x87, 0xce, 0x90,
+    0x1e, 0x25, 0x37, 0x12, 0x9d, 0x74, 0x05, 0xb8, 0x21, 0x34, 0xc8, 0xf9, 0xae, 0x06, 0x4a, 0x46,
+    0x11, 0x59, 0xf0, 0x2c, 0x8c, 0x55, 0xd1, 0x1f, 0xc3, 0xa3, 0x6a, 0x69, 0x94, 0x73, 0x6a, 0xa7,
+    0x15, 0x84, 0xba, 0x42, 0xf8, 0xcc, 0x20, 0x1e, 0x6b, 0xe1, 0x3a, 0x52, 0xfd, 0xd0, 0x1d, 0x34,
+    0x75, 0x9d, 0xfb, 0x53, 0xe6, 0xb4, 0xe3, 0x50, 0x33, 0x9f, 0x83, 0xbd, 0x34, 0xa0, 0x43, 0x27,
+    0xb3, 0xcc, 0x9e, 0x5b, 0x79, 0xe2, 0xdd, 0x44, 0x87, 0x44, 0xbc, 0x35, 0x73, 0x53, 0x8e, 0x00,
+    0x19, 0x54, 0x8c, 0x31, 0xf2, 0x16, 0xfa, 0xa7, 0x34, 0xab, 0xee, 0x62, 0x40, 0x7a, 0x28, 0x3c,
+    0xf1, 0x99, 0x45, 0xe8, 0x1a, 0x18, 0x7c, 0x71, 0x95, 0xd7, 0x1f, 0xaa, 0xf9, 0x21, 0xc8, 0xbd,
+    0x34, 0xe6, 0x63, 0x29, 0xf2, 0xa4, 0x88, 0x68, 0x03, 0x56, 0x9f, 0xa9, 0x0e, 0x81, 0x92, 0x3a,
+    0xca, 0xa9, 0xec, 0xa1, 0x74, 0xe4, 0x67, 0x8b, 0x7e, 0x00, 0x73, 0xe9, 0x99, 0x00, 0xb2, 0x1b,
+    0xac, 0x68, 0x10, 0x2a, 0x98, 0xd9, 0xa0, 0x75, 0x24, 0x66, 0x0d, 0x57, 0xa4, 0x88, 0x9f, 0xbd,
+    0x62, 0xf4, 0xc5, 0x2b, 0x6b, 0x60, 0x02, 0x06, 0xa7, 0x71, 0x39, 0x7a, 0xd4, 0xe8, 0xcc, 0xcb,
+    0x3c, 0x53, 0xb7, 0x19, 0xdc, 0x19, 0xc6, 0xf7, 0xf4, 0x6d, 0x46, 0x20, 0x8d, 0x70, 0x41, 0x5d,
+    0x2a, 0xb0, 0x49, 0x31, 0xe0, 0x17, 0xa9, 0x07, 0xbc, 0x1b, 0x0d, 0x74, 0xf7, 0x09, 0x50, 0xfd,
+    0x3c, 0x18, 0xd9, 0xff, 0x7b, 0xc3, 0xf0, 0xb6, 0x65, 0xf0, 0x32, 0x32, 0xd1, 0xfd, 0x6a, 0x3a,
+    0x9c, 0x5c, 0x75, 0xa7, 0x4c, 0x24, 0x50, 0xf5, 0x4d, 0xd9, 0x8f, 0x3a, 0x61, 0x5f, 0xc4, 0x4e,
+    0xd0, 0x52, 0x68, 0x8d, 0x9f, 0x39, 0xa8, 0x2e, 0xa0, 0x79, 0x0e, 0x54, 0x1f, 0x9e, 0xe3, 0xa4,
+    0x89, 0x8d, 0xd8, 0x48, 0x94, 0x05, 0x65, 0x52, 0x08, 0x3d, 0x75, 0xcd, 0xd6, 0x5e, 0x82, 0x3b,
+    0x69, 0xfb, 0xf6, 0xed, 0x28, 0x63, 0xf2, 0x48, 0x5a, 0xc9, 0x5f, 0x35, 0xfb, 0x3b, 0xc1, 0xb7,
+    0xeb, 0x06, 0x4a, 0x55, 0x19, 0x1e, 0xc1, 0x12, 0x7c, 0x2d, 0xa4, 0x11, 0x02, 0x6e, 0x98, 0x79,
+    0xcd, 0xd6, 0x8b, 0xc6, 0xb2, 0x19, 0x8a, 0x12, 0x69, 0xf8, 0xa8, 0x4f, 0x3f, 0x69, 0x9a, 0xc1,
+    0xfb, 0x99, 0xf1, 0x13, 0xe1, 0xa9, 0x1f, 0x40, 0xa1, 0x3e, 0x44, 0x87, 0x97, 0x7e, 0x5c, 0x1b,
+    0x3c, 0x9b, 0x60, 0x2a, 0x7d, 0x81, 0x85, 0x7a, 0x29, 0xff, 0xeb, 0x09, 0xd1, 0xa4, 0x6d, 0xd3,
+    0x4e, 0x1c, 0xda, 0xa7, 0x55, 0xa5, 0xb7, 0x0f, 0xc9, 0x76, 0x07, 0x2f, 0x56, 0x0c, 0x2d, 0x6d,
+    0x51, 0x69, 0x53, 0xea, 0x80, 0xc6, 0x02, 0xb3, 0x8f, 0x0a, 0xdd, 0x07, 0x74, 0x91, 0x81, 0x5c,
+    0x6e, 0x2c, 0xa8, 0xd6, 0x86, 0xcd, 0x98, 0x28, 0x1f, 0xc3, 0x08, 0x6b, 0x8d, 0xb6, 0xd5, 0x57,
+    0x10, 0xa8, 0x9a, 0x4f, 0x0f, 0xbc, 0x70, 0xe3, 0xc8, 0x64, 0xeb, 0x81, 0xd1, 0x3c, 0x0f, 0xb2,
+    0x3c, 0x77, 0xbd, 0x20, 0x7e, 0xac, 0x47, 0x31, 0x6d, 0xce, 0xeb, 0x11, 0x04, 0xe5, 0xcc, 0x99,
+    0x10, 0x35, 0xd8, 0x33, 0x7e, 0x36, 0xba, 0xd5, 0x81, 0x96, 0x83, 0x7e, 0x13, 0xe1, 0xe3, 0x5a,
+    0xf7, 0x8a, 0xc1, 0x81, 0x0e, 0x4d, 0xf3, 0xa1, 0x8f, 0x72, 0x5a, 0x49, 0xae, 0xc2, 0x4d, 0xab,
+    0x2d, 0x3f, 0xbf, 0x8f, 0x17, 0x7b, 0x94, 0x92, 0x28, 0x75, 0x6c, 0x99, 0xb4, 0x9d, 0x6c, 0x32,
+    0x56, 0x0a, 0x78, 0x39, 0x68, 0xa9, 0xf9, 0xc0, 0xe7, 0xa0, 0x75, 0x9f, 0xc6, 0x08, 0xd9, 0x57,
+    0xe5, 0x1b, 0x43, 0x12, 0xff, 0x43, 0xea, 0xb5, 0x5e, 0x86, 0x3c, 0x09, 0x92, 0x04, 0x9b, 0x60,
+    0xbc, 0x19, 0xac, 0x84, 0xc3, 0xb2, 0x1a, 0x84, 0xf6, 0x8e, 0x03, 0xcf, 0x71, 0x37, 0xdf, 0xd1,
+    0xf4, 0x39, 0xa8, 0xc0, 0x0f, 0xda, 0x3e, 0xd3, 0x09, 0x1d, 0xba, 0x82, 0x86, 0xc9, 0x3d, 0x32,
+    0xc5, 0x5f, 0x69, 0x82, 0x75, 0x40, 0xbd, 0x98, 0x13, 0xdc, 0x4c, 0x6e, 0x84, 0x3f, 0x55, 0xdd,
+    0xc7, 0xee, 0xf9, 0x96, 0xf3, 0x38, 0x11, 0x31, 0x54, 0xcd, 0x6b, 0xaa, 0x27, 0x4d, 0xd4, 0x88,
+    0xae, 0xbc, 0x1a, 0xc4, 0x52, 0x8c, 0x95, 0x8b, 0x7d, 0xa9, 0xde, 0xbc, 0xb6, 0x9f, 0x70, 0xb4,
+    0x5c, 0x6e, 0x98, 0x51, 0x2c, 0x55, 0x45, 0x3e, 0x16, 0x61, 0xf1, 0xfd, 0x5b, 0x7f, 0x03, 0xc9,
+    0x92, 0xef, 0x52, 0xd0, 0x84, 0x00, 0x00,
+};
+
+static const uint8_t zlib_text[406] = {
+    0x78, 0x9c, 0x9d, 0x56, 0xcb, 0x4e, 0xc3, 0x40, 0x0c, 0xbc, 0xfb, 0x2b, 0xf2, 0x6b, 0x95, 0x12,
+    0x04, 0x02, 0x01, 0x87, 0xa2, 0xfe, 0x7e, 0x69, 0x48, 0xbc, 0xe3, 0xf1, 0xd8, 0x5d, 0x71, 0x48,
+    0x9b, 0x64, 0xe3, 0xd7, 0x78, 0x3c, 0xbb, 0xeb, 0xf6, 0xf2, 0x71, 0xb9, 0x6e, 0xcb, 0xfa, 0xf7,
+    0x6f, 0xb7, 0xb7, 0xcf, 0xf5, 0xeb, 0xb6, 0x5c, 0x5f, 0x37, 0xbf, 0x8e, 0xa5, 0xfd, 0xfe, 0xfb,
+    0xf2, 0xf3, 0xee, 0x2f, 0xe0, 0xdb, 0xfd, 0xfd, 0xe3, 0x07, 0x1d, 0xe4, 0xdb, 0x95, 0xa2, 0xa1,
+    0x6b, 0x15, 0x8e, 0xcc, 0x3c, 0x0a, 0x2d, 0x24, 0x3f, 0x31, 0xc3, 0x33, 0xa7, 0x61, 0x8e, 0x3e,
+    0xc8, 0x06, 0x0b, 0xa0, 0x74, 0x17, 0xf6, 0x63, 0xbf, 0x1f, 0x19, 0x7f, 0x24, 0xf2, 0x6f, 0x40,
+    0x4d, 0xe0, 0x46, 0x93, 0xca, 0x79, 0x40, 0x44, 0xbe, 0x8c, 0xa5, 0x43, 0x18, 0xab, 0xaa, 0xf1,
+    0xdc, 0x70, 0xe1, 0x70, 0x93, 0x53, 0x33, 0x37, 0x39, 0x9e, 0xab, 0x4a, 0x9a, 0xd0, 0x68, 0x52,
+    0x2c, 0x9d, 0x5d, 0xa9, 0xbc, 0x12, 0x11, 0x10, 0x8f, 0x90, 0xb4, 0x04, 0x4a, 0x63, 0xdd, 0x93,
+    0x48, 0x82, 0x9d, 0x22, 0x39, 0x38, 0x30, 0x13, 0x3b, 0x5b, 0xea, 0x90, 0xcc, 0xc9, 0x71, 0x6b,
+    0xd4, 0x18, 0x08, 0x44, 0xfe, 0x34, 0xdf, 0x8a, 0xcc, 0x05, 0x0d, 0x6d, 0x24, 0xcf, 0xa3, 0x15,
+    0xd3, 0xc9, 0x23, 0xc5, 0xa8, 0x95, 0x73, 0x86, 0x96, 0x34, 0xef, 0x96, 0x99, 0x87, 0x71, 0x75,
+    0xeb, 0x93, 0xa3, 0x42, 0x9e, 0x12, 0x85, 0x26, 0x60, 0x19, 0x93, 0x8e, 0x59, 0x3e, 0x2e, 0x25,
+    0x84, 0xd9, 0xca, 0x43, 0xaa, 0xe2, 0xab, 0x80, 0x26, 0x78, 0x6e, 0xa4, 0xa7, 0x41, 0x73, 0x63,
+    0x08, 0xc9, 0xf4, 0x90, 0xc8, 0x9c, 0xc4, 0x34, 0x9c, 0xec, 0x74, 0x51, 0xca, 0x1e, 0x8b, 0xe4,
+    0x39, 0x11, 0x29, 0x56, 0x33, 0xe2, 0x84, 0x40, 0xb5, 0x13, 0x29, 0x26, 0x88, 0xae, 0xcf, 0xcd,
+    0xbc, 0x40, 0x3f, 0xf3, 0x9b, 0x41, 0x4a, 0xba, 0x19, 0x3a, 0x73, 0x3c, 0x08, 0x61, 0x56, 0x25,
+    0xc5, 0xf9, 0x2e, 0xa7, 0xae, 0x1f, 0x9c, 0xc1, 0x45, 0xad, 0xee, 0xe4, 0xaf, 0x11, 0x69, 0xea,
+    0x41, 0x43, 0x9d, 0xa1, 0x24, 0x95, 0xe8, 0xab, 0x56, 0x77, 0x6b, 0xb9, 0xac, 0x7f, 0x74, 0x3f,
+    0x40, 0xcc, 0x7c, 0x8d, 0x30, 0x4c, 0xee, 0xc0, 0xe5, 0x66, 0xa3, 0x89, 0xa6, 0x40, 0x38, 0x25,
+    0xde, 0xdb, 0x24, 0xce, 0x0b, 0x13, 0xc2, 0x85, 0xfb, 0x41, 0xc8, 0x4a, 0x9f, 0xc5, 0x54, 0x6f,
+    0x9e, 0x62, 0x1c, 0xe9, 0x88, 0x09, 0xd2, 0x76, 0xf5, 0xd4, 0xb1, 0x66, 0x69, 0x98, 0x1b, 0x79,
+    0xc8, 0x49, 0x83, 0x92, 0x7b, 0x55, 0x54, 0xa5, 0x04, 0xce, 0x99, 0xca, 0x9a, 0x0e, 0xc7, 0x40,
+    0x71, 0xf8, 0x29, 0x15, 0x28, 0xed, 0x9f, 0xa2, 0x71, 0xa6, 0x48, 0xda, 0x1d, 0x53, 0x94, 0xc0,
+    0xdc, 0x01, 0xe0, 0x63, 0x51, 0xf3,
+};
+
+static const uint8_t zlib_stored[311] = {
+    0x78, 0x01, 0x01, 0x2c, 0x01, 0xd3, 0xfe, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74, 0x65, 0x20, 0x64,
+    0x65, 0x66, 0x6c, 0x61, 0x74, 0x65, 0x0a, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x20, 0x74, 0x68,
+    0x65, 0x20, 0x74, 0x68, 0x65, 0x20, 0x74, 0x68, 0x65, 0x20, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74,
+    0x65, 0x20, 0x74, 0x68, 0x65, 0x20, 0x70, 0x61, 0x75, 0x6b, 0x20, 0x64, 0x65, 0x66, 0x6c, 0x61,
+    0x74, 0x65, 0x20, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x20, 0x74, 0x68, 0x65, 0x20, 0x70, 0x61,
+    0x75, 0x6b, 0x20, 0x70, 0x61, 0x75, 0x6b, 0x0a, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x20, 0x74,
+    0x68, 0x65, 0x20, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x20, 0x74, 0x68, 0x65, 0x20, 0x77, 0x69,
+    0x6e, 0x64, 0x6f, 0x77, 0x20, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74, 0x65, 0x20, 0x64, 0x65, 0x66,
+    0x6c, 0x61, 0x74, 0x65, 0x0a, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74, 0x65, 0x20, 0x74, 0x68, 0x65,
+    0x20, 0x74, 0x68, 0x65, 0x20, 0x74, 0x68, 0x65, 0x20, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74, 0x65,
+    0x20, 0x74, 0x68, 0x65, 0x20, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x20, 0x64, 0x65, 0x66, 0x6c,
+    0x61, 0x74, 0x65, 0x20, 0x70, 0x61, 0x75, 0x6b, 0x20, 0x70, 0x61, 0x75, 0x6b, 0x20, 0x77, 0x69,
+    0x6e, 0x64, 0x6f, 0x77, 0x20, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74, 0x65, 0x0a, 0x64, 0x65, 0x66,
+    0x6c, 0x61, 0x74, 0x65, 0x20, 0x74, 0x68, 0x65, 0x20, 0x74, 0x68, 0x65, 0x20, 0x64, 0x65, 0x66,
+    0x6c, 0x61, 0x74, 0x65, 0x20, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x0a, 0x77, 0x69, 0x6e, 0x64,
+    0x6f, 0x77, 0x20, 0x70, 0x61, 0x75, 0x6b, 0x20, 0x70, 0x61, 0x75, 0x6b, 0x20, 0x70, 0x61, 0x75,
+    0x6b, 0x20, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x20, 0x74, 0x68, 0x65, 0x20, 0x74, 0x68, 0x65,
+    0x20, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74, 0x65, 0x0a, 0x77, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x20,
+    0x74, 0x68, 0x65, 0x20, 0x64, 0x65, 0x66, 0x6c, 0x61, 0x74, 0x65, 0x20, 0x64, 0x65, 0x66, 0x6c,
+    0x61, 0x74, 0x65, 0xb7, 0xba, 0x6e, 0x38,
+};
+
+static const uint8_t raw_fixed[76] = {
+    0x4b, 0x49, 0x4d, 0xcb, 0x49, 0x2c, 0x49, 0x55, 0x48, 0x81, 0xd0, 0x5c, 0xe5, 0x99, 0x79, 0x29,
+    0xf9, 0xe5, 0x0a, 0x25, 0x19, 0xa9, 0x70, 0x0c, 0x95, 0x02, 0xb3, 0x0b, 0x12, 0x4b, 0xb3, 0xe1,
+    0x02, 0x48, 0x6a, 0xc1, 0xe2, 0x20, 0x02, 0xd9, 0x00, 0x4c, 0x66, 0x0a, 0x9a, 0x6d, 0xc8, 0x46,
+    0x63, 0xb3, 0x0e, 0x4d, 0x1b, 0xdc, 0x16, 0x34, 0x09, 0x0c, 0x73, 0x50, 0x5d, 0x08, 0x73, 0x13,
+    0x42, 0x3b, 0xb2, 0x19, 0x68, 0x7a, 0x90, 0x3d, 0x80, 0xe6, 0x5c, 0x00,
+};
+
+static const uint8_t gzip_two[139] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x4b, 0x49, 0x4d, 0xcb, 0x49, 0x2c,
+    0x49, 0x55, 0x48, 0x81, 0xd0, 0x5c, 0xe5, 0x99, 0x79, 0x29, 0xf9, 0xe5, 0x0a, 0x25, 0x19, 0xa9,
+    0x70, 0x0c, 0x95, 0x02, 0xb3, 0x0b, 0x12, 0x4b, 0xb3, 0xe1, 0x02, 0x48, 0x6a, 0xc1, 0xe2, 0x20,
+    0x02, 0xd9, 0x00, 0x18, 0x13, 0x00, 0x56, 0x77, 0x82, 0xe4, 0x64, 0x00, 0x00, 0x00, 0x1f, 0x8b,
+    0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0xcb, 0x48, 0x55, 0x28, 0xcf, 0xcc, 0x4b, 0xc9,
+    0x2f, 0x57, 0x48, 0x49, 0x4d, 0xcb, 0x49, 0x2c, 0x49, 0x85, 0xd1, 0x5c, 0x30, 0x7e, 0x49, 0x06,
+    0x02, 0x23, 0x8b, 0xa1, 0x69, 0x2b, 0x48, 0x2c, 0xcd, 0x86, 0x10, 0xa8, 0x12, 0x18, 0xe6, 0xc0,
+    0xf8, 0x10, 0x65, 0x5c, 0x50, 0xd5, 0x08, 0xed, 0xc8, 0x66, 0xa0, 0xe9, 0xe1, 0x42, 0x12, 0x46,
+    0x73, 0x2e, 0x00, 0x59, 0x53, 0x5c, 0x54, 0xc8, 0x00, 0x00, 0x00,
+};
+typedef struct {
+    const char *name;
+    content_encoding_t encoding;
+    const uint8_t *data;
+    size_t len;
+    size_t text_len;            // decodes to text[0, text_len)
+} vector_t;
+
+static const vector_t vectors[] = {
+    { "gzip", CONTENT_ENCODING_GZIP, gzip_big, sizeof(gzip_big), 34000 },
+    { "zlib", CONTENT_ENCODING_DEFLATE, zlib_text, sizeof(zlib_text), 3000 },
+    { "zlib stored", CONTENT_ENCODING_DEFLATE, zlib_stored, sizeof(zlib_stored), 300 },
+    { "raw fixed", CONTENT_ENCODING_DEFLATE, raw_fixed, sizeof(raw_fixed), 300 },
+    { "gzip members", CONTENT_ENCODING_GZIP, gzip_two, sizeof(gzip_two), 300 },
+};
+
+static output_t out;
+
+// Feed data in pieces of step bytes (0: two pieces split at step_or_split)
+static errno_t inflate_pieces(content_encoding_t encoding, const uint8_t *data, size_t len,
+    size_t step, size_t split)
+{
+    content_inflate_t *inf = malloc(sizeof(content_inflate_t));
+    if (!inf)
+        return ENOMEM;
+    content_inflate_init(inf, encoding, output_append, &out);
+    out.len = 0;
+
+    errno_t rc = EOK;
+    if (step > 0) {
+        for (size_t off = 0; off < len && rc == EOK; off += step)
+            rc = content_inflate_feed(inf, data + off, len - off < step ? len - off : step);
+    } else {
+        rc = content_inflate_feed(inf, data, split);
+        if (rc == EOK)
+            rc = content_inflate_feed(inf, data + split, len - split);
+    }
+    if (rc == EOK)
+        rc = content_inflate_finish(inf);
+    free(inf);
+    return rc;
+}
+
+static bool inflated(const vector_t *v)
+{
+    return out.len == v->text_len && memcmp(out.data, text, v->text_len) == 0;
+}
+
+static void test_vectors(void)
+{
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const vector_t *v = &vectors[i];
+        errno_t rc = inflate_pieces(v->encoding, v->data, v->len, v->len, 0);
+        CHECK(rc == EOK && inflated(v), "%s whole: rc %d, %zu bytes", v->name, rc, out.len);
+        rc = inflate_pieces(v->encoding, v->data, v->len, 1, 0);
+        CHECK(rc == EOK && inflated(v), "%s byte at a time: rc %d, %zu bytes",
+            v->name, rc, out.len);
+        for (size_t at = 1; at < v->len; at++) {
+            rc = inflate_pieces(v->encoding, v->data, v->len, 0, at);
+            if (rc != EOK || !inflated(v)) {
+                CHECK(false, "%s split at %zu: rc %d, %zu bytes", v->name, at, rc, out.len);
+                break;
+            }
+        }
+    }
+}
+
+// A copy of data with one byte changed (at < 0: from the end)
+static uint8_t *damaged(const uint8_t *data, size_t len, long at)
+{
+    uint8_t *copy = malloc(len);
+    if (copy) {
+        memcpy(copy, data, len);
+        copy[at < 0 ? len + at : (size_t)at] ^= 0x01;
+    }
+    return copy;
+}
+
+static void test_damaged(void)
+{
+    static const struct {
+        const char *what;
+        content_encoding_t encoding;
+        const uint8_t *data;
+        size_t len;
+        long at;
+    } cases[] = {
+        { "gzip CRC-32", CONTENT_ENCODING_GZIP, gzip_big, sizeof(gzip_big), -8 },
+        { "gzip ISIZE", CONTENT_ENCODING_GZIP, gzip_big, sizeof(gzip_big), -1 },
+        { "second member CRC-32", CONTENT_ENCODING_GZIP, gzip_two, sizeof(gzip_two), -5 },
+        { "zlib Adler-32", CONTENT_ENCODING_DEFLATE, zlib_text, sizeof(zlib_text), -1 },
+        { "stored length", CONTENT_ENCODING_DEFLATE, zlib_stored, sizeof(zlib_stored), 3 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint8_t *bad = damaged(cases[i].data, cases[i].len, cases[i].at);
+        if (!bad)
+            continue;
+        errno_t rc = inflate_pieces(cases[i].encoding, bad, cases[i].len, cases[i].len, 0);
+        CHECK(rc == EIO, "%s: rc %d", cases[i].what, rc);
+        rc = inflate_pieces(cases[i].encoding, bad, cases[i].len, 1, 0);
+        CHECK(rc == EIO, "%s byte at a time: rc %d", cases[i].what, rc);
+        free(bad);
+    }
+
+    // Cut short anywhere, the last byte of the trailer included
+    errno_t rc = inflate_pieces(CONTENT_ENCODING_GZIP, gzip_big, sizeof(gzip_big) - 1,
+        sizeof(gzip_big), 0);
+    CHECK(rc == EIO, "gzip without its last byte: rc %d", rc);
+    rc = inflate_pieces(CONTENT_ENCODING_DEFLATE, zlib_text, sizeof(zlib_text) / 2,
+        sizeof(zlib_text), 0);
+    CHECK(rc == EIO, "half a zlib stream: rc %d", rc);
+    // A member cut short is not followed by the next one
+    rc = inflate_pieces(CONTENT_ENCODING_GZIP, gzip_two, 20, 1, 0);
+    CHECK(rc == EIO, "first member cut short: rc %d", rc);
+
+    // After a member comes another member or nothing
+    uint8_t junk[sizeof(gzip_two) + 4];
+    memcpy(junk, gzip_two, sizeof(gzip_two));
+    memcpy(junk + sizeof(gzip_two), "junk", 4);
+    rc = inflate_pieces(CONTENT_ENCODING_GZIP, junk, sizeof(junk), sizeof(junk), 0);
+    CHECK(rc == EIO, "junk after the last member: rc %d", rc);
+    rc = inflate_pieces(CONTENT_ENCODING_GZIP, junk, sizeof(gzip_two) + 2, 1, 0);
+    CHECK(rc == EIO, "half a header after the last member: rc %d", rc);
+}
+
+// ===== Charsets =====
+
+#define DOC(s) s, sizeof(s) - 1
+
+typedef struct {
+    const char *what;
+    const char *content_type;
+    const char *doc;
+    size_t doc_len;
+    const char *want;
+} charset_case_t;
+
+static const charset_case_t charset_cases[] = {
+    { "UTF-8 BOM over header and meta", "text/html; charset=windows-1251",
+        DOC("\xef\xbb\xbf<meta charset=koi8-r><p>\xc3\xa9"),
+        "<meta charset=koi8-r><p>\xc3\xa9" },
+    { "UTF-16LE BOM over header", "text/html; charset=windows-1251",
+        DOC("\xff\xfe<\0p\0>\0\x30\x04"), "<p>\xd0\xb0" },
+    { "UTF-16BE BOM", NULL,
+        DOC("\xfe\xff\0<\0p\0>\x04\x30"), "<p>\xd0\xb0" },
+    { "header over meta", "text/html; charset=windows-1251",
+        DOC("<meta charset=\"koi8-r\"><p>\xe0"), "<meta charset=\"koi8-r\"><p>\xd0\xb0" },
+    { "meta charset", NULL,
+        DOC("<html><head><meta charset=\"windows-1250\"></head>\x8a"),
+        "<html><head><meta charset=\"windows-1250\"></head>\xc5\xa0" },
+    { "meta http-equiv", "text/html",
+        DOC("<meta http-equiv=\"Content-Type\" content=\"text/html; charset=iso-8859-2\">\xa9"),
+        "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=iso-8859-2\">\xc5\xa0" },
+    { "unknown header label, meta", "text/html; charset=x-unheard-of",
+        DOC("<meta charset=koi8-r>\xe0"), "<meta charset=koi8-r>\xd0\xae" },
+    { "UTF-8 fallback", NULL,
+        DOC("<p>caf\xc3\xa9</p>"), "<p>caf\xc3\xa9</p>" },
+};
+
+// Decode doc in two pieces split at split (doc_len: whole), or a byte at
+// a time when bytes is set
+static errno_t charset_pieces(const char *content_type, const char *doc, size_t doc_len,
+    size_t split, bool bytes)
+{
+    charset_decoder_t *dec = malloc(sizeof(charset_decoder_t));
+    if (!dec)
+        return ENOMEM;
+    charset_decoder_init(dec, output_append, &out);
+    charset_decoder_set_content_type(dec, content_type);
+    out.len = 0;
+
+    errno_t rc = EOK;
+    if (bytes) {
+        for (size_t i = 0; i < doc_len && rc == EOK; i++)
+            rc = charset_decoder_feed(dec, doc + i, 1);
+    } else {
+        rc = charset_decoder_feed(dec, doc, split);
+        if (rc == EOK)
+            rc = charset_decoder_feed(dec, doc + split, doc_len - split);
+    }
+    if (rc == EOK)
+        rc = charset_decoder_finish(dec);
+    free(dec);
+    return rc;
+}
+
+static bool decoded(const char *want)
+{
+    return out.len == strlen(want) && memcmp(out.data, want, out.len) == 0;
+}
+
+static void test_charset_case(const char *what, const char *content_type, const char *doc,
+    size_t doc_len, const char *want)
+{
+    errno_t rc = charset_pieces(content_type, doc, doc_len, doc_len, false);
+    CHECK(rc == EOK && decoded(want), "%s: rc %d, %.*s", what, rc, (int)out.len, out.data);
+    rc = charset_pieces(content_type, doc, doc_len, 0, true);
+    CHECK(rc == EOK && decoded(want), "%s byte at a time: rc %d", what, rc);
+    for (size_t at = 0; at < doc_len; at++) {
+        rc = charset_pieces(content_type, doc, doc_len, at, false);
+        if (rc != EOK || !decoded(want)) {
+            CHECK(false, "%s split at %zu: rc %d", what, at, rc);
+            break;
+        }
+    }
+}
+
+static void test_charsets(void)
+{
+    for (size_t i = 0; i < sizeof(charset_cases) / sizeof(charset_cases[0]); i++) {
+        const charset_case_t *c = &charset_cases[i];
+        test_charset_case(c->what, c->content_type, c->doc, c->doc_len, c->want);
+    }
+
+    // A <meta> past the prescan is not looked for: UTF-8
+    static char late[CHARSET_PRESCAN_BYTES + 64];
+    memset(late, ' ', CHARSET_PRESCAN_BYTES);
+    strcpy(late + CHARSET_PRESCAN_BYTES, "<meta charset=windows-1250>caf\xc3\xa9");
+    test_charset_case("meta past the prescan", NULL, late, strlen(late), late);
+}
+
+int main(void)
+{
+    make_text();
+    test_vectors();
+    test_damaged();
+    test_charsets();
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
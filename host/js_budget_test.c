@@ -0,0 +1,153 @@
+// js_budget_test.c - the script time budget with nested callbacks
+//
+// el.click() runs the click listeners from inside the script that called
+// it. The listener is timed and interrupted under the outer script's
+// deadline: when it returns, the outer script must still be interrupted,
+// and its time must be counted once. Checked: a script spinning after
+// click(), a listener that spins itself, and the wall time of a script
+// whose listener is busy for a while.
+//
+//   meson test -C _host js_budget
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "js_executor_quickjs.h"
+#include "pauk_sync.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            failures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+// layout_engine.c takes this from main.c, which is not linked here
+char *get_element_text(lxb_dom_element_t *elem)
+{
+    (void)elem;
+    return NULL;
+}
+
+#define SCRIPT_MS 200
+
+static const char page_html[] = "<html><body><button id=\"b\">b</button></body></html>";
+
+static lxb_html_document_t *doc = NULL;
+
+// A fresh page context with the per-script budget only
+static JSContext *page_start(void)
+{
+    JSContext *ctx = js_engine_init();
+    if (!ctx)
+        return NULL;
+
+    SecurityPolicy policy = js_default_security_policy();
+    policy.max_execution_time_ms = SCRIPT_MS;
+    policy.max_page_execution_time_ms = 0;
+    policy.yield_after_ms = 0;
+    js_set_security_policy(ctx, policy);
+    js_set_document(ctx, doc);
+    return ctx;
+}
+
+// Run script as a page script; *elapsed_usec gets its wall time
+static JSExecStats run_script(const char *script, uint64_t *elapsed_usec)
+{
+    JSExecStats none = { 0 };
+    JSContext *ctx = page_start();
+    CHECK(ctx != NULL, "no JS context");
+    if (!ctx)
+        return none;
+
+    // The stats are per page (js_execute_script_elements): take the
+    // difference this script made
+    JSExecStats before = js_get_exec_stats();
+    uint64_t start = pauk_time_usec();
+    js_execute_code(ctx, script);
+    *elapsed_usec = pauk_time_usec() - start;
+    JSExecStats stats = js_get_exec_stats();
+    js_engine_cleanup(ctx);
+
+    stats.scripts_run -= before.scripts_run;
+    stats.scripts_interrupted -= before.scripts_interrupted;
+    stats.callbacks_run -= before.callbacks_run;
+    stats.wall_usec -= before.wall_usec;
+    stats.cpu_usec -= before.cpu_usec;
+    return stats;
+}
+
+static void test_spin_after_click(void)
+{
+    uint64_t elapsed;
+    JSExecStats stats = run_script(
+        "var b = document.getElementById('b');\n"
+        "b.addEventListener('click', function () { clicked = 1; });\n"
+        "b.click();\n"
+        "for (;;) {}\n", &elapsed);
+
+    CHECK(stats.scripts_interrupted == 1, "interrupted %d scripts",
+        stats.scripts_interrupted);
+    CHECK(elapsed < 4 * SCRIPT_MS * 1000, "ran %llu ms",
+        (unsigned long long)(elapsed / 1000));
+    CHECK(stats.callbacks_run == 1, "ran %d callbacks", stats.callbacks_run);
+}
+
+static void test_spinning_listener(void)
+{
+    uint64_t elapsed;
+    JSExecStats stats = run_script(
+        "var b = document.getElementById('b');\n"
+        "b.addEventListener('click', function () { for (;;) {} });\n"
+        "b.click();\n"
+        "for (;;) {}\n", &elapsed);
+
+    // The listener and then the script are stopped, counted once
+    CHECK(stats.scripts_interrupted == 1, "interrupted %d scripts",
+        stats.scripts_interrupted);
+    CHECK(elapsed < 4 * SCRIPT_MS * 1000, "ran %llu ms",
+        (unsigned long long)(elapsed / 1000));
+}
+
+static void test_wall_counted_once(void)
+{
+    uint64_t elapsed;
+    JSExecStats stats = run_script(
+        "var b = document.getElementById('b');\n"
+        "b.addEventListener('click', function () {\n"
+        "    var end = Date.now() + 60;\n"
+        "    while (Date.now() < end) {}\n"
+        "});\n"
+        "b.click();\n", &elapsed);
+
+    CHECK(stats.scripts_interrupted == 0, "interrupted %d scripts",
+        stats.scripts_interrupted);
+    CHECK(stats.wall_usec >= 50000, "wall %llu us",
+        (unsigned long long)stats.wall_usec);
+    CHECK(stats.wall_usec <= elapsed, "wall %llu us for %llu us of script",
+        (unsigned long long)stats.wall_usec, (unsigned long long)elapsed);
+}
+
+int main(void)
+{
+    doc = lxb_html_document_create();
+    if (!doc || lxb_html_document_parse(doc, (const lxb_char_t *)page_html,
+            sizeof(page_html) - 1) != LXB_STATUS_OK) {
+        printf("FAIL: no document\n");
+        return 1;
+    }
+
+    test_spin_after_click();
+    test_spinning_listener();
+    test_wall_counted_once();
+
+    js_engine_shutdown();
+    lxb_html_document_destroy(doc);
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+// preload_scanner_test.c - subresources the preload scanner finds
+//
+// One document is fed whole, a byte at a time, and in two pieces split at
+// every offset. Each time the same URLs must come out: scripts,
+// stylesheets, images (srcset) and frames, resolved against the page and,
+// after it, the first <base href>. Nothing inside comments, raw-text
+// elements (<script> bodies, <style>, ...) or <template> is fetched, and
+// a <base> there does not move the base. The script loader is real, with
+// recording fetchers in place of http and https.
+//
+//   meson test -C _host preload_scanner
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "preload_scanner.h"
+#include "script_loader.h"
+#include "pauk_sync.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            failures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+static const char page[] =
+    "<!DOCTYPE html><html><head>\n"
+    "<script src=\"js/app.js\"></script>\n"
+    "<!-- <script src=\"commented.js\"></script> <base href=\"/nope/\"> -->\n"
+    "<template><base href=\"/inert/\"><img src=\"inert.png\">"
+    "<template><script src=\"inert2.js\"></script></template>"
+    "<link rel=\"stylesheet\" href=\"inert.css\"></template>\n"
+    "<base href=\"/static/\">\n"
+    "<base href=\"/second/\">\n"
+    "<link rel=\"preload stylesheet\" href=\"  site.css  \">\n"
+    "<link rel=\"icon\" href=\"favicon.ico\">\n"
+    "<style>body { background: url(\"<img src=in-style.png>\") }</style>\n"
+    "<script>var s = '<script src=\"in-script.js\"></' + 'script>';"
+    " document.write('<img src=\"written.png\">');</script>\n"
+    "<title><img src=\"in-title.png\"></title>\n"
+    "</head><body>\n"
+    "<p>1 < 2 and <b>bold</b></p>\n"
+    "<img srcset=\"small.png 1x, big.png 2x\" src=\"fallback.png\">\n"
+    "<img src='//cdn.example.test/logo.png' alt=\"a > b\">\n"
+    "<iframe src=\"frame.html\"></iframe>\n"
+    "<a href=\"page2.html\">not fetched</a>\n"
+    "<img src=\"data:image/png;base64,AAAA\"><img src=\"#\">\n"
+    "<SCRIPT SRC=\"/abs/upper.js\"></SCRIPT>\n"
+    "<textarea><script src=\"in-textarea.js\"></script></textarea>\n"
+    "</body></html>\n";
+
+// Sorted, as the workers fetch in any order
+static const char *const expected[] = {
+    "http://cdn.example.test/logo.png",
+    "http://example.test/abs/upper.js",
+    "http://example.test/dir/js/app.js",
+    "http://example.test/static/frame.html",
+    "http://example.test/static/site.css",
+    "http://example.test/static/small.png",
+    NULL
+};
+
+// ===== Recording fetchers =====
+
+#define MAX_SEEN 32
+
+static pauk_mutex_t seen_lock;
+static char *seen[MAX_SEEN];
+static size_t seen_count = 0;
+
+static errno_t record_fetch(const char *url, void *arg, char **data, size_t *len)
+{
+    (void)arg;
+    pauk_mutex_lock(&seen_lock);
+    if (seen_count < MAX_SEEN)
+        seen[seen_count++] = strdup(url);
+    pauk_mutex_unlock(&seen_lock);
+
+    *data = calloc(1, 1);
+    *len = 0;
+    return *data ? EOK : ENOMEM;
+}
+
+static size_t seen_now(void)
+{
+    pauk_mutex_lock(&seen_lock);
+    size_t n = seen_count;
+    pauk_mutex_unlock(&seen_lock);
+    return n;
+}
+
+static int url_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// ===== Runs =====
+
+// Feed page in pieces of the given lengths (the last one takes the rest)
+// and check what was fetched
+static void scan(const char *what, const size_t *pieces, size_t piece_count)
+{
+    script_loader_init();
+    script_loader_register("http", record_fetch, NULL);
+    script_loader_register("https", record_fetch, NULL);
+    script_loader_set_base("http://example.test/dir/index.html");
+
+    preload_scanner_t scanner;
+    preload_scanner_init(&scanner);
+    size_t len = sizeof(page) - 1;
+    size_t off = 0;
+    for (size_t i = 0; off < len; i++) {
+        size_t n = (i < piece_count && pieces[i] < len - off) ? pieces[i] : len - off;
+        preload_scanner_feed(&scanner, page + off, n);
+        off += n;
+    }
+
+    // Everything queued reaches a fetcher before the loader is torn down
+    uint64_t until = pauk_time_usec() + 5000000;
+    while (seen_now() < scanner.issued && pauk_time_usec() < until)
+        pauk_sleep_usec(1000);
+    script_loader_cleanup();
+
+    qsort(seen, seen_count, sizeof(seen[0]), url_cmp);
+    size_t want = 0;
+    while (expected[want])
+        want++;
+    bool same = seen_count == want && scanner.issued == want;
+    for (size_t i = 0; same && i < want; i++)
+        same = strcmp(seen[i], expected[i]) == 0;
+    CHECK(same, "%s: %u issued, %zu fetched", what, scanner.issued, seen_count);
+    if (!same) {
+        for (size_t i = 0; i < seen_count; i++)
+            printf("  fetched %s\n", seen[i]);
+    }
+
+    for (size_t i = 0; i < seen_count; i++)
+        free(seen[i]);
+    seen_count = 0;
+}
+
+int main(void)
+{
+    pauk_mutex_init(&seen_lock);
+    size_t len = sizeof(page) - 1;
+
+    scan("whole", NULL, 0);
+
+    size_t *bytes = malloc(len * sizeof(size_t));
+    if (!bytes)
+        return 1;
+    for (size_t i = 0; i < len; i++)
+        bytes[i] = 1;
+    scan("byte at a time", bytes, len);
+    free(bytes);
+
+    int split_failures = failures;
+    for (size_t at = 1; at < len && failures == split_failures; at++) {
+        char what[48];
+        snprintf(what, sizeof(what), "split at %zu", at);
+        scan(what, &at, 1);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,292 @@
+// html_stream.c - Chunked HTML parsing with progressive paints
+//
+// main() used to fseek/ftell the whole file into one buffer, parse it with
+// lxb_html_document_parse() and only then start the pipeline, so nothing
+// reached the screen before the last byte was read and every extractor and
+// both layout passes were done. The document is now fed to lexbor's chunk
+// parser a piece at a time. After each piece, the direct children of <body>
+// the tree builder has closed are handed out as finished blocks, and the
+// caller is asked to paint what it has once a deadline passes or enough
+// blocks are in, and again every so often after that. Time to first pixels
+// depends on the first screenful, not on the page size. Pieces pass
+// through a charset_decoder on the way in, so the parser sees UTF-8
+// whatever the document was written in.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lexbor/html/parser.h>
+#include <lexbor/html/tree/open_elements.h>
+
+#include "html_stream.h"
+#include "pauk_sync.h"
+#include "file_source.h"
+#include "http_fetch.h"
+#include "http_cache.h"
+#include "script_loader.h"
+
+static lxb_dom_node_t *stream_body(html_stream_t *stream)
+{
+    lxb_html_body_element_t *body = lxb_html_document_body_element(stream->doc);
+    return body ? lxb_dom_interface_node(body) : NULL;
+}
+
+// A body child is complete once the tree builder has closed it: an element
+// off its stack of open elements, or a text node with something after it
+// (more characters would still be appended to it). A next sibling alone
+// says little: foster-parented content goes in before an open <table>.
+static bool stream_block_done(html_stream_t *stream, lxb_dom_node_t *node)
+{
+    if (node->type != LXB_DOM_NODE_TYPE_ELEMENT)
+        return lxb_dom_node_next(node) != NULL;
+
+    lxb_html_parser_t *parser = stream->doc->dom_document.parser;
+    if (!parser || !parser->tree)
+        return false;
+    size_t pos;
+    return !lxb_html_tree_open_elements_find_by_node(parser->tree, node, &pos);
+}
+
+// Hand out the body children that are complete, or all of them at the end
+static void stream_collect_blocks(html_stream_t *stream, bool final)
+{
+    lxb_dom_node_t *body = stream_body(stream);
+    if (!body)
+        return;
+
+    lxb_dom_node_t *node;
+    if (stream->last_block) {
+        // The tree builder may move a node (misnested markup): stop
+        // reporting rather than walk another parent's children
+        if (stream->last_block->parent != body)
+            return;
+        node = lxb_dom_node_next(stream->last_block);
+    } else {
+        node = lxb_dom_node_first_child(body);
+    }
+
+    while (node && (final || stream_block_done(stream, node))) {
+        if (stream->on_block)
+            stream->on_block(node, stream->arg);
+        stream->last_block = node;
+        stream->blocks++;
+        node = lxb_dom_node_next(node);
+    }
+}
+
+static void stream_maybe_paint(html_stream_t *stream)
+{
+    if (!stream->on_paint || stream->blocks == stream->blocks_painted)
+        return;
+
+    uint64_t now = pauk_time_usec();
+    bool due;
+    if (stream->paints == 0) {
+        due = now - stream->start_usec >= stream->first_paint_usec ||
+            stream->blocks >= stream->first_paint_blocks;
+    } else {
+        due = now - stream->last_paint_usec >= stream->paint_interval_usec;
+    }
+    if (!due)
+        return;
+
+    stream->on_paint(stream->arg);
+    stream->paints++;
+    stream->blocks_painted = stream->blocks;
+    stream->last_paint_usec = pauk_time_usec();
+}
+
+// A decoded (UTF-8) piece to the preload scanner and the tree builder
+static errno_t stream_parse(const void *data, size_t len, void *arg)
+{
+    html_stream_t *stream = arg;
+
+    // Subresource fetches start before the tree builder gets here
+    if (stream->preload)
+        preload_scanner_feed(stream->preload, data, len);
+
+    if (lxb_html_document_parse_chunk(stream->doc, (const lxb_char_t *)data, len) != LXB_STATUS_OK)
+        return EIO;
+    stream->bytes += len;
+
+    if (stream->on_block || stream->on_paint) {
+        stream_collect_blocks(stream, false);
+        stream_maybe_paint(stream);
+    }
+    return EOK;
+}
+
+errno_t html_stream_begin(html_stream_t *stream, lxb_html_document_t *doc,
+    html_stream_block_cb_t on_block, html_stream_paint_cb_t on_paint, void *arg)
+{
+    if (!stream || !doc)
+        return EINVAL;
+
+    memset(stream, 0, sizeof(*stream));
+    stream->doc = doc;
+    stream->on_block = on_block;
+    stream->on_paint = on_paint;
+    stream->arg = arg;
+    stream->first_paint_usec = HTML_STREAM_FIRST_PAINT_USEC;
+    stream->first_paint_blocks = HTML_STREAM_FIRST_PAINT_BLOCKS;
+    stream->paint_interval_usec = HTML_STREAM_PAINT_INTERVAL_USEC;
+    charset_decoder_init(&stream->charset, stream_parse, stream);
+
+    if (lxb_html_document_parse_chunk_begin(doc) != LXB_STATUS_OK)
+        return EIO;
+    stream->started = true;
+    return EOK;
+}
+
+void html_stream_set_content_type(html_stream_t *stream, const char *content_type)
+{
+    charset_decoder_set_content_type(&stream->charset, content_type);
+}
+
+errno_t html_stream_feed(html_stream_t *stream, const void *data, size_t len)
+{
+    if (!stream || !stream->started)
+        return EINVAL;
+    if (len == 0)
+        return EOK;
+
+    if (stream->start_usec == 0)
+        stream->start_usec = pauk_time_usec();
+
+    return charset_decoder_feed(&stream->charset, data, len);
+}
+
+errno_t html_stream_end(html_stream_t *stream)
+{
+    if (!stream || !stream->started)
+        return EINVAL;
+
+    // What the charset prescan still holds back
+    errno_t rc = charset_decoder_finish(&stream->charset);
+    stream->started = false;
+    if (rc != EOK) {
+        lxb_html_document_parse_chunk_end(stream->doc);
+        return rc;
+    }
+
+    if (lxb_html_document_parse_chunk_end(stream->doc) != LXB_STATUS_OK)
+        return EIO;
+
+    if (stream->on_block)
+        stream_collect_blocks(stream, true);
+    return EOK;
+}
+
+// Where the file cannot be mapped it is read a chunk at a time, so the
+// first chunks are parsed before the last ones are read
+static errno_t stream_feed_file(html_stream_t *stream, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return ENOENT;
+
+    char *chunk = malloc(HTML_STREAM_CHUNK_SIZE);
+    if (!chunk) {
+        fclose(f);
+        return ENOMEM;
+    }
+
+    errno_t rc = EOK;
+    while (rc == EOK) {
+        size_t n = fread(chunk, 1, HTML_STREAM_CHUNK_SIZE, f);
+        if (n > 0)
+            rc = html_stream_feed(stream, chunk, n);
+        if (n < HTML_STREAM_CHUNK_SIZE) {
+            if (ferror(f))
+                rc = EIO;
+            break;
+        }
+    }
+
+    free(chunk);
+    fclose(f);
+    return rc;
+}
+
+errno_t html_stream_parse_file(lxb_html_document_t *doc, const char *path,
+    html_stream_block_cb_t on_block, html_stream_paint_cb_t on_paint, void *arg,
+    preload_scanner_t *preload)
+{
+    // Mapped: the chunks are slices of the mapping, paged in just ahead of
+    // the parser, nothing is copied
+    file_source_t src;
+    errno_t map_rc = file_source_open(&src, path, 0,
+        FILE_SOURCE_SEQUENTIAL | FILE_SOURCE_MAP_ONLY);
+    if (map_rc != EOK && map_rc != ENOTSUP)
+        return map_rc;
+
+    html_stream_t stream;
+    errno_t rc = html_stream_begin(&stream, doc, on_block, on_paint, arg);
+    stream.preload = preload;
+    if (rc == EOK && map_rc == EOK) {
+        for (size_t off = 0; rc == EOK && off < src.len; off += HTML_STREAM_CHUNK_SIZE) {
+            size_t n = src.len - off;
+            if (n > HTML_STREAM_CHUNK_SIZE)
+                n = HTML_STREAM_CHUNK_SIZE;
+            rc = html_stream_feed(&stream, src.data + off, n);
+        }
+        // Cut short while it was read: zeros came in for the rest
+        if (rc == EOK && !file_source_intact(&src))
+            rc = EIO;
+    } else if (rc == EOK) {
+        rc = stream_feed_file(&stream, path);
+    }
+
+    if (stream.started) {
+        errno_t end_rc = html_stream_end(&stream);
+        if (rc == EOK)
+            rc = end_rc;
+    }
+
+    if (map_rc == EOK)
+        file_source_close(&src);
+    return rc;
+}
+
+typedef struct {
+    html_stream_t *stream;
+    char content_type[HTTP_CACHE_MAX_CONTENT_TYPE];
+    char *final_url;
+    bool typed;
+} stream_url_t;
+
+static errno_t stream_feed_body(const void *data, size_t len, void *arg)
+{
+    stream_url_t *s = arg;
+    // http_fetch_stream() has filled in the Content-Type and the URL that
+    // answered by now; scripts and preloads resolve against that URL
+    if (!s->typed) {
+        s->typed = true;
+        html_stream_set_content_type(s->stream, s->content_type);
+        script_loader_set_base(s->final_url);
+    }
+    return html_stream_feed(s->stream, data, len);
+}
+
+errno_t html_stream_parse_url(lxb_html_document_t *doc, const char *url,
+    html_stream_block_cb_t on_block, html_stream_paint_cb_t on_paint, void *arg,
+    preload_scanner_t *preload, int *status, char *final_url, size_t final_url_size)
+{
+    if (!final_url || final_url_size == 0)
+        return EINVAL;
+    snprintf(final_url, final_url_size, "%s", url);
+
+    html_stream_t stream;
+    errno_t rc = html_stream_begin(&stream, doc, on_block, on_paint, arg);
+    if (rc != EOK)
+        return rc;
+    stream.preload = preload;
+
+    // Each piece is parsed as it comes off the socket
+    stream_url_t s = { .stream = &stream, .final_url = final_url };
+    rc = http_fetch_stream(url, stream_feed_body, &s, status, final_url, final_url_size,
+        s.content_type, sizeof(s.content_type));
+
+    errno_t end_rc = html_stream_end(&stream);
+    return (rc == EOK) ? end_rc : rc;
+}
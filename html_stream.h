@@ -0,0 +1,91 @@
+// html_stream.h - Chunked HTML parsing with progressive paints
+#ifndef HTML_STREAM_H
+#define HTML_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <lexbor/html/html.h>
+
+#include "preload_scanner.h"
+#include "charset_decoder.h"
+
+// Bytes handed to the parser at a time when reading a file
+#define HTML_STREAM_CHUNK_SIZE (16 * 1024)
+
+// First paint: once this much time has passed since the first byte, or
+// once this many top-level blocks are complete, whichever comes first
+#define HTML_STREAM_FIRST_PAINT_USEC 50000
+#define HTML_STREAM_FIRST_PAINT_BLOCKS 12
+
+// Later paints while the rest arrives: at most one per interval
+#define HTML_STREAM_PAINT_INTERVAL_USEC 250000
+
+// A direct child of <body> the tree builder has closed: its subtree will not
+// change any more (in order, each block once)
+typedef void (*html_stream_block_cb_t)(lxb_dom_node_t *block, void *arg);
+
+// Time to show what has arrived so far
+typedef void (*html_stream_paint_cb_t)(void *arg);
+
+typedef struct {
+    lxb_html_document_t *doc;
+
+    html_stream_block_cb_t on_block;
+    html_stream_paint_cb_t on_paint;
+    void *arg;
+
+    // Sees every piece before the tree builder does (NULL = none)
+    preload_scanner_t *preload;
+
+    // Input bytes in, UTF-8 out to the scanner and the tree builder
+    charset_decoder_t charset;
+
+    uint64_t first_paint_usec;
+    size_t first_paint_blocks;
+    uint64_t paint_interval_usec;
+
+    // Progress
+    uint64_t start_usec;
+    uint64_t last_paint_usec;
+    size_t bytes;
+    size_t blocks;
+    size_t blocks_painted;
+    int paints;
+    lxb_dom_node_t *last_block;
+    bool started;
+} html_stream_t;
+
+// Start parsing into doc (an empty document). on_block and on_paint may
+// be NULL; the timing fields get the defaults above and can be changed
+// before the first feed.
+errno_t html_stream_begin(html_stream_t *stream, lxb_html_document_t *doc,
+    html_stream_block_cb_t on_block, html_stream_paint_cb_t on_paint, void *arg);
+
+// Content-Type the document came with (its charset), before the first feed
+void html_stream_set_content_type(html_stream_t *stream, const char *content_type);
+
+// Parse the next piece of the document (any size, from a file or socket, in
+// its own charset)
+errno_t html_stream_feed(html_stream_t *stream, const void *data, size_t len);
+
+// End of input: finishes the tree and reports the remaining blocks. No
+// paint is requested here; the caller's full pipeline takes over.
+errno_t html_stream_end(html_stream_t *stream);
+
+// begin / feed HTML_STREAM_CHUNK_SIZE pieces of path / end. preload may
+// be NULL.
+errno_t html_stream_parse_file(lxb_html_document_t *doc, const char *path,
+    html_stream_block_cb_t on_block, html_stream_paint_cb_t on_paint, void *arg,
+    preload_scanner_t *preload);
+
+// begin / feed the body of an http[s]:// URL as it arrives / end. *status
+// gets the HTTP status; an error page is parsed like any other. final_url
+// gets the URL that answered (after redirects); the script loader is
+// rebased on it before the first byte is parsed.
+errno_t html_stream_parse_url(lxb_html_document_t *doc, const char *url,
+    html_stream_block_cb_t on_block, html_stream_paint_cb_t on_paint, void *arg,
+    preload_scanner_t *preload, int *status, char *final_url, size_t final_url_size);
+
+#endif // HTML_STREAM_H
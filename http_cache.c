@@ -0,0 +1,686 @@
+// http_cache.c - On-disk HTTP response cache with revalidation
+//
+// With pages and scripts coming over the network, every visit fetched
+// every byte again. Responses that say they may be kept (Cache-Control
+// max-age, Expires, or a validator) are now written to disk as they stream
+// past. A fresh entry is answered from disk without any request. A stale
+// one goes out as a conditional request (If-None-Match / If-Modified-Since),
+// and a 304 answer means the stored body is used again.
+//
+// Bodies and the index are cache_store entries in the cache's private
+// directory. A body is named after the SHA-256 of its URL, so one URL can
+// never be answered with what another one served, and its SHA-256 is
+// checked before the first byte is handed out. The URL -> body index is
+// kept in memory (hash table plus LRU list) and is written back as one
+// entry on shutdown. Over HTTP_CACHE_MAX_BYTES or HTTP_CACHE_MAX_ENTRIES,
+// the least recently used entries go first. Bodies are read back through
+// cache_store_open(), so on the host the parser is fed slices of the
+// mapped file.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "http_cache.h"
+#include "cache_store.h"
+#include "pauk_sync.h"
+
+#define HTTP_CACHE_BUCKETS 256                      // power of two
+#define HTTP_CACHE_BODY_MAGIC 0x42485450u           // "PTHB"
+#define HTTP_CACHE_INDEX_MAGIC 0x49485450u          // "PTHI"
+#define HTTP_CACHE_INDEX_NAME "pauk http cache index 2"
+#define HTTP_CACHE_INDEX_MAX_BYTES (8 * 1024 * 1024)
+
+typedef struct http_cache_entry {
+    char *url;
+    uint8_t key[SHA256_DIGEST_LEN];                 // SHA-256 of the URL, names the body
+    size_t body_len;
+    int64_t fresh_until;        // seconds since the epoch; 0 = revalidate
+    char etag[HTTP_CACHE_MAX_VALIDATOR];
+    char last_modified[HTTP_CACHE_MAX_VALIDATOR];
+    char content_type[HTTP_CACHE_MAX_CONTENT_TYPE];
+
+    struct http_cache_entry *hash_next;
+    struct http_cache_entry *lru_prev;              // towards most recent
+    struct http_cache_entry *lru_next;
+} http_cache_entry_t;
+
+struct http_cache_writer {
+    char *url;
+    cache_store_writer_t store;
+    size_t len;
+    bool failed;
+    int64_t fresh_until;
+    char etag[HTTP_CACHE_MAX_VALIDATOR];
+    char last_modified[HTTP_CACHE_MAX_VALIDATOR];
+    char content_type[HTTP_CACHE_MAX_CONTENT_TYPE];
+};
+
+static bool lock_ready = false;
+static pauk_mutex_t lock;
+static char *cache_dir = NULL;
+static http_cache_entry_t *buckets[HTTP_CACHE_BUCKETS];
+static http_cache_entry_t *lru_head = NULL;         // most recently used
+static http_cache_entry_t *lru_tail = NULL;
+static http_cache_stats_t stats;
+
+// ===== Helpers =====
+
+static void http_cache_key(const char *url, uint8_t key[SHA256_DIGEST_LEN])
+{
+    sha256(url, strlen(url), key);
+}
+
+static void http_cache_copy_value(char *out, size_t size, const char *value)
+{
+    out[0] = '\0';
+    if (!value)
+        return;
+    size_t len = strlen(value);
+    // Too long, or would break an index line: no validator then
+    if (len >= size || strpbrk(value, "\t\r\n"))
+        return;
+    memcpy(out, value, len + 1);
+}
+
+// "Sun, 06 Nov 1994 08:49:37 GMT" (RFC 1123; the obsolete forms are not
+// worth the code) to seconds since the epoch
+static bool http_cache_parse_date(const char *s, int64_t *out)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    if (!s)
+        return false;
+    const char *p = strchr(s, ',');
+    p = p ? p + 1 : s;
+
+    int day, year, hour, min, sec;
+    char mon[4];
+    if (sscanf(p, " %d %3s %d %d:%d:%d", &day, mon, &year, &hour, &min, &sec) != 6)
+        return false;
+    const char *m = strstr(months, mon);
+    if (strlen(mon) != 3 || !m || (m - months) % 3 != 0)
+        return false;
+    int month = (int)(m - months) / 3 + 1;
+
+    // Days from 1970-01-01 to the civil date
+    int64_t y = year - (month <= 2);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = era * 146097 + doe - 719468;
+
+    *out = days * 86400 + hour * 3600 + min * 60 + sec;
+    return true;
+}
+
+// Value of directive name in a Cache-Control header; "" for a bare flag,
+// NULL when absent
+static const char *http_cache_directive(const char *cc, const char *name, size_t *len)
+{
+    size_t name_len = strlen(name);
+    const char *p = cc;
+    while (p && *p) {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        size_t tok = strcspn(p, ",=");
+        size_t trimmed = tok;
+        while (trimmed > 0 && (p[trimmed - 1] == ' ' || p[trimmed - 1] == '\t'))
+            trimmed--;
+        bool match = trimmed == name_len;
+        for (size_t i = 0; match && i < name_len; i++)
+            match = tolower((unsigned char)p[i]) == name[i];
+
+        const char *value = p + tok;
+        size_t value_len = 0;
+        if (*value == '=') {
+            value++;
+            value_len = strcspn(value, ",");
+        }
+        if (match) {
+            *len = value_len;
+            return value;
+        }
+        p = value + value_len;
+    }
+    return NULL;
+}
+
+int64_t http_cache_fresh_until(const http_cache_headers_t *h, int64_t now)
+{
+    size_t len;
+    const char *cc = h->cache_control;
+    if (cc && http_cache_directive(cc, "no-cache", &len))
+        return 0;
+
+    int64_t age = h->age ? strtoll(h->age, NULL, 10) : 0;
+    if (age < 0)
+        age = 0;
+
+    const char *max_age = cc ? http_cache_directive(cc, "max-age", &len) : NULL;
+    if (max_age && len > 0) {
+        int64_t lifetime = strtoll(max_age, NULL, 10);
+        return lifetime > age ? now + lifetime - age : 0;
+    }
+
+    int64_t date;
+    if (!http_cache_parse_date(h->date, &date))
+        date = now;
+
+    int64_t expires;
+    if (h->expires) {
+        // An unparsable Expires means already expired
+        if (!http_cache_parse_date(h->expires, &expires) || expires <= date)
+            return 0;
+        return now + (expires - date) - age;
+    }
+
+    int64_t modified;
+    if (http_cache_parse_date(h->last_modified, &modified) && modified < date) {
+        int64_t lifetime = (date - modified) / 10;
+        if (lifetime > HTTP_CACHE_HEURISTIC_MAX_SEC)
+            lifetime = HTTP_CACHE_HEURISTIC_MAX_SEC;
+        return now + lifetime;
+    }
+    return 0;
+}
+
+// Entries are keyed on the URL alone. Every request carries the same
+// User-Agent, Accept and Accept-Encoding, so a Vary on those cannot change
+// the answer; one on anything else (or "*") could, and is not stored.
+static bool http_cache_vary_ok(const char *vary)
+{
+    static const char *const fixed[] = { "user-agent", "accept", "accept-encoding", NULL };
+    const char *p = vary;
+    while (p && *p) {
+        p += strspn(p, " \t,");
+        size_t tok = strcspn(p, ",");
+        size_t trimmed = tok;
+        while (trimmed > 0 && (p[trimmed - 1] == ' ' || p[trimmed - 1] == '\t'))
+            trimmed--;
+        if (trimmed > 0) {
+            bool same = false;
+            for (size_t i = 0; !same && fixed[i]; i++)
+                same = strlen(fixed[i]) == trimmed && strncasecmp(p, fixed[i], trimmed) == 0;
+            if (!same)
+                return false;
+        }
+        p += tok;
+    }
+    return true;
+}
+
+// ===== Index (called with lock held) =====
+
+static http_cache_entry_t **http_cache_bucket(const uint8_t key[SHA256_DIGEST_LEN])
+{
+    return &buckets[(key[0] | key[1] << 8) & (HTTP_CACHE_BUCKETS - 1)];
+}
+
+static http_cache_entry_t *http_cache_find(const char *url)
+{
+    uint8_t key[SHA256_DIGEST_LEN];
+    http_cache_key(url, key);
+    for (http_cache_entry_t *e = *http_cache_bucket(key); e; e = e->hash_next) {
+        if (memcmp(e->key, key, sizeof(key)) == 0 && strcmp(e->url, url) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+static void http_cache_lru_unlink(http_cache_entry_t *e)
+{
+    if (e->lru_prev)
+        e->lru_prev->lru_next = e->lru_next;
+    else
+        lru_head = e->lru_next;
+    if (e->lru_next)
+        e->lru_next->lru_prev = e->lru_prev;
+    else
+        lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void http_cache_lru_push_front(http_cache_entry_t *e)
+{
+    e->lru_prev = NULL;
+    e->lru_next = lru_head;
+    if (lru_head)
+        lru_head->lru_prev = e;
+    lru_head = e;
+    if (!lru_tail)
+        lru_tail = e;
+}
+
+static void http_cache_touch(http_cache_entry_t *e)
+{
+    if (lru_head == e)
+        return;
+    http_cache_lru_unlink(e);
+    http_cache_lru_push_front(e);
+}
+
+// Unlinks and frees e, and removes its body file
+static void http_cache_remove(http_cache_entry_t *e)
+{
+    http_cache_entry_t **p = http_cache_bucket(e->key);
+    while (*p && *p != e)
+        p = &(*p)->hash_next;
+    if (*p)
+        *p = e->hash_next;
+    http_cache_lru_unlink(e);
+
+    stats.entries--;
+    stats.bytes -= e->body_len;
+    cache_store_remove(cache_dir, e->key);
+    free(e->url);
+    free(e);
+}
+
+static void http_cache_evict(void)
+{
+    while (lru_tail && (stats.bytes > HTTP_CACHE_MAX_BYTES ||
+        stats.entries > HTTP_CACHE_MAX_ENTRIES)) {
+        http_cache_remove(lru_tail);
+        stats.evicted++;
+    }
+}
+
+// The entry for url, added if new (most recently used either way). An
+// existing entry keeps its body file, which a new body replaces in place.
+static http_cache_entry_t *http_cache_insert(const char *url, size_t len)
+{
+    http_cache_entry_t *old = http_cache_find(url);
+    if (old) {
+        stats.bytes = stats.bytes - old->body_len + len;
+        old->body_len = len;
+        http_cache_touch(old);
+        return old;
+    }
+
+    http_cache_entry_t *e = calloc(1, sizeof(http_cache_entry_t));
+    if (!e)
+        return NULL;
+    size_t url_len = strlen(url);
+    e->url = malloc(url_len + 1);
+    if (!e->url) {
+        free(e);
+        return NULL;
+    }
+    memcpy(e->url, url, url_len + 1);
+    http_cache_key(url, e->key);
+    e->body_len = len;
+
+    http_cache_entry_t **b = http_cache_bucket(e->key);
+    e->hash_next = *b;
+    *b = e;
+    http_cache_lru_push_front(e);
+    stats.entries++;
+    stats.bytes += len;
+    return e;
+}
+
+// ===== Index file =====
+
+static void http_cache_index_key(uint8_t key[SHA256_DIGEST_LEN])
+{
+    sha256(HTTP_CACHE_INDEX_NAME, strlen(HTTP_CACHE_INDEX_NAME), key);
+}
+
+// Lines: "len fresh_until\turl\tetag\tlast_modified\tcontent_type", most
+// recent first
+static void http_cache_load_index(void)
+{
+    uint8_t key[SHA256_DIGEST_LEN];
+    http_cache_index_key(key);
+    uint8_t *data;
+    size_t data_len;
+    if (cache_store_get(cache_dir, HTTP_CACHE_INDEX_MAGIC, key, HTTP_CACHE_INDEX_MAX_BYTES,
+        &data, &data_len) != EOK)
+        return;
+
+    char *next = (char *)data;
+    while (*next) {
+        char *line = next;
+        next = line + strcspn(line, "\n");
+        if (*next)
+            *next++ = '\0';
+
+        char *fields[5] = { NULL };
+        int n = 0;
+        for (char *p = line; n < 5 && p; n++) {
+            fields[n] = p;
+            p = strchr(p, '\t');
+            if (p)
+                *p++ = '\0';
+        }
+        unsigned long long len;
+        long long fresh_until;
+        if (n < 5 || sscanf(fields[0], "%llu %lld", &len, &fresh_until) != 2 ||
+            len > HTTP_CACHE_MAX_ENTRY_BYTES || fields[1][0] == '\0')
+            continue;
+
+        // A body file gone behind our back is found missing on delivery
+        if (http_cache_find(fields[1]))
+            continue;
+        http_cache_entry_t *e = http_cache_insert(fields[1], (size_t)len);
+        if (!e)
+            break;
+        // Read most recent first: keep that order
+        http_cache_lru_unlink(e);
+        e->lru_prev = lru_tail;
+        if (lru_tail)
+            lru_tail->lru_next = e;
+        else
+            lru_head = e;
+        lru_tail = e;
+
+        e->fresh_until = fresh_until;
+        http_cache_copy_value(e->etag, sizeof(e->etag), fields[2]);
+        http_cache_copy_value(e->last_modified, sizeof(e->last_modified), fields[3]);
+        http_cache_copy_value(e->content_type, sizeof(e->content_type), fields[4]);
+    }
+    free(data);
+    http_cache_evict();
+}
+
+static void http_cache_save_index(void)
+{
+    size_t size = 1;
+    for (http_cache_entry_t *e = lru_head; e; e = e->lru_next) {
+        size += strlen(e->url) + strlen(e->etag) + strlen(e->last_modified) +
+            strlen(e->content_type) + 64;
+    }
+    char *buf = malloc(size);
+    if (!buf)
+        return;
+
+    size_t len = 0;
+    for (http_cache_entry_t *e = lru_head; e; e = e->lru_next) {
+        if (strpbrk(e->url, "\t\r\n"))
+            continue;
+        len += (size_t)snprintf(buf + len, size - len, "%zu %lld\t%s\t%s\t%s\t%s\n",
+            e->body_len, (long long)e->fresh_until, e->url, e->etag, e->last_modified,
+            e->content_type);
+    }
+
+    // Replaces the old index only once complete
+    uint8_t key[SHA256_DIGEST_LEN];
+    http_cache_index_key(key);
+    cache_store_put(cache_dir, HTTP_CACHE_INDEX_MAGIC, key, buf, len);
+    free(buf);
+}
+
+// ===== API =====
+
+errno_t http_cache_init(const char *dir)
+{
+    if (!lock_ready) {
+        pauk_mutex_init(&lock);
+        lock_ready = true;
+    }
+    http_cache_shutdown();
+    if (!dir)
+        return EOK;
+
+    size_t len = strlen(dir);
+    if (len + 2 > CACHE_STORE_PATH_MAX)
+        return EINVAL;
+    char *copy = malloc(len + 2);
+    if (!copy)
+        return ENOMEM;
+    memcpy(copy, dir, len);
+    // Always end with a separator
+    if (len == 0 || dir[len - 1] != '/')
+        copy[len++] = '/';
+    copy[len] = '\0';
+
+    pauk_mutex_lock(&lock);
+    cache_dir = copy;
+    http_cache_load_index();
+    pauk_mutex_unlock(&lock);
+    return EOK;
+}
+
+void http_cache_shutdown(void)
+{
+    if (!lock_ready)
+        return;
+
+    pauk_mutex_lock(&lock);
+    if (cache_dir)
+        http_cache_save_index();
+    while (lru_head) {
+        http_cache_entry_t *e = lru_head;
+        lru_head = e->lru_next;
+        free(e->url);
+        free(e);
+    }
+    lru_tail = NULL;
+    memset(buckets, 0, sizeof(buckets));
+    memset(&stats, 0, sizeof(stats));
+    free(cache_dir);
+    cache_dir = NULL;
+    pauk_mutex_unlock(&lock);
+}
+
+bool http_cache_enabled(void)
+{
+    if (!lock_ready)
+        return false;
+    pauk_mutex_lock(&lock);
+    bool on = cache_dir != NULL;
+    pauk_mutex_unlock(&lock);
+    return on;
+}
+
+http_cache_state_t http_cache_lookup(const char *url, http_cache_validators_t *v)
+{
+    if (!lock_ready || !url)
+        return HTTP_CACHE_MISS;
+
+    pauk_mutex_lock(&lock);
+    http_cache_entry_t *e = cache_dir ? http_cache_find(url) : NULL;
+    http_cache_state_t state = HTTP_CACHE_MISS;
+    if (e) {
+        http_cache_touch(e);
+        if (e->fresh_until > (int64_t)time(NULL)) {
+            state = HTTP_CACHE_FRESH;
+            stats.fresh_hits++;
+        } else if (e->etag[0] || e->last_modified[0]) {
+            state = HTTP_CACHE_STALE;
+            if (v) {
+                memcpy(v->etag, e->etag, sizeof(v->etag));
+                memcpy(v->last_modified, e->last_modified, sizeof(v->last_modified));
+            }
+        }
+    }
+    if (state == HTTP_CACHE_MISS)
+        stats.misses++;
+    pauk_mutex_unlock(&lock);
+    return state;
+}
+
+errno_t http_cache_deliver(const char *url,
+    errno_t (*on_body)(const void *data, size_t len, void *arg), void *arg)
+{
+    if (!lock_ready || !url)
+        return ENOENT;
+
+    char dir[CACHE_STORE_PATH_MAX];
+    uint8_t key[SHA256_DIGEST_LEN];
+    pauk_mutex_lock(&lock);
+    http_cache_entry_t *e = cache_dir ? http_cache_find(url) : NULL;
+    if (e) {
+        snprintf(dir, sizeof(dir), "%s", cache_dir);
+        memcpy(key, e->key, sizeof(key));
+    }
+    pauk_mutex_unlock(&lock);
+    if (!e)
+        return ENOENT;
+
+    // Checked against its SHA-256 before anything is passed on
+    cache_store_view_t view;
+    errno_t rc = cache_store_open(dir, HTTP_CACHE_BODY_MAGIC, key,
+        HTTP_CACHE_MAX_ENTRY_BYTES, &view);
+    if (rc != EOK) {
+        // Gone or damaged: forget it, the caller fetches again
+        pauk_mutex_lock(&lock);
+        e = cache_dir ? http_cache_find(url) : NULL;
+        if (e)
+            http_cache_remove(e);
+        pauk_mutex_unlock(&lock);
+        return ENOENT;
+    }
+
+    for (size_t off = 0; rc == EOK && off < view.len; off += HTTP_CACHE_DELIVER_CHUNK) {
+        size_t n = view.len - off;
+        if (n > HTTP_CACHE_DELIVER_CHUNK)
+            n = HTTP_CACHE_DELIVER_CHUNK;
+        if (on_body)
+            rc = on_body(view.data + off, n, arg);
+    }
+    // Truncated while it was passed on: the tail went out as zeros
+    if (rc == EOK && !file_source_intact(&view.src))
+        rc = EIO;
+    cache_store_close(&view);
+
+    return rc;
+}
+
+bool http_cache_content_type(const char *url, char *out, size_t size)
+{
+    if (size > 0)
+        out[0] = '\0';
+    if (!lock_ready || !url)
+        return false;
+
+    pauk_mutex_lock(&lock);
+    http_cache_entry_t *e = cache_dir ? http_cache_find(url) : NULL;
+    if (e && size > 0)
+        snprintf(out, size, "%s", e->content_type);
+    pauk_mutex_unlock(&lock);
+    return e != NULL;
+}
+
+void http_cache_revalidated(const char *url, const http_cache_headers_t *h)
+{
+    if (!lock_ready || !url || !h)
+        return;
+
+    int64_t fresh_until = http_cache_fresh_until(h, (int64_t)time(NULL));
+
+    pauk_mutex_lock(&lock);
+    http_cache_entry_t *e = cache_dir ? http_cache_find(url) : NULL;
+    if (e) {
+        e->fresh_until = fresh_until;
+        // A 304 may carry newer validators
+        if (h->etag)
+            http_cache_copy_value(e->etag, sizeof(e->etag), h->etag);
+        if (h->last_modified)
+            http_cache_copy_value(e->last_modified, sizeof(e->last_modified), h->last_modified);
+        http_cache_touch(e);
+        stats.revalidated++;
+    }
+    pauk_mutex_unlock(&lock);
+}
+
+http_cache_writer_t *http_cache_store_begin(const char *url, const http_cache_headers_t *h)
+{
+    if (!lock_ready || !url || !h || h->status != 200)
+        return NULL;
+
+    size_t len;
+    if (h->cache_control && http_cache_directive(h->cache_control, "no-store", &len))
+        return NULL;
+    if (!http_cache_vary_ok(h->vary))
+        return NULL;
+
+    int64_t fresh_until = http_cache_fresh_until(h, (int64_t)time(NULL));
+    http_cache_writer_t *w = calloc(1, sizeof(http_cache_writer_t));
+    if (!w)
+        return NULL;
+    w->fresh_until = fresh_until;
+    http_cache_copy_value(w->etag, sizeof(w->etag), h->etag);
+    http_cache_copy_value(w->last_modified, sizeof(w->last_modified), h->last_modified);
+    http_cache_copy_value(w->content_type, sizeof(w->content_type), h->content_type);
+    // Neither fresh for a while nor revalidatable: nothing to gain
+    if (fresh_until == 0 && !w->etag[0] && !w->last_modified[0]) {
+        free(w);
+        return NULL;
+    }
+
+    char dir[CACHE_STORE_PATH_MAX];
+    pauk_mutex_lock(&lock);
+    bool on = cache_dir != NULL;
+    if (on)
+        snprintf(dir, sizeof(dir), "%s", cache_dir);
+    pauk_mutex_unlock(&lock);
+
+    // Written to a temporary file of its own, renamed onto the URL's key
+    // once complete
+    uint8_t key[SHA256_DIGEST_LEN];
+    http_cache_key(url, key);
+    size_t url_len = strlen(url);
+    w->url = on ? malloc(url_len + 1) : NULL;
+    if (!w->url || cache_store_begin(&w->store, dir, HTTP_CACHE_BODY_MAGIC, key) != EOK) {
+        free(w->url);
+        free(w);
+        return NULL;
+    }
+    memcpy(w->url, url, url_len + 1);
+    return w;
+}
+
+errno_t http_cache_store_write(http_cache_writer_t *w, const void *data, size_t len)
+{
+    // A failed copy never fails the fetch itself
+    if (!w || w->failed)
+        return EOK;
+    if (w->len + len > HTTP_CACHE_MAX_ENTRY_BYTES ||
+        cache_store_write(&w->store, data, len) != EOK) {
+        w->failed = true;
+        return EOK;
+    }
+    w->len += len;
+    return EOK;
+}
+
+void http_cache_store_end(http_cache_writer_t *w, bool complete)
+{
+    if (!w)
+        return;
+
+    pauk_mutex_lock(&lock);
+    if (complete && !w->failed && cache_dir && cache_store_commit(&w->store) == EOK) {
+        http_cache_entry_t *e = http_cache_insert(w->url, w->len);
+        if (e) {
+            e->fresh_until = w->fresh_until;
+            memcpy(e->etag, w->etag, sizeof(e->etag));
+            memcpy(e->last_modified, w->last_modified, sizeof(e->last_modified));
+            memcpy(e->content_type, w->content_type, sizeof(e->content_type));
+            stats.stored++;
+        } else {
+            // Not in the index: nobody would ever remove the file
+            cache_store_remove(w->store.dir, w->store.header.key);
+        }
+        http_cache_evict();
+    }
+    pauk_mutex_unlock(&lock);
+
+    cache_store_abort(&w->store);
+    free(w->url);
+    free(w);
+}
+
+http_cache_stats_t http_cache_stats(void)
+{
+    http_cache_stats_t s = { 0 };
+    if (!lock_ready)
+        return s;
+    pauk_mutex_lock(&lock);
+    s = stats;
+    pauk_mutex_unlock(&lock);
+    return s;
+}
@@ -0,0 +1,105 @@
+// http_cache.h - On-disk HTTP response cache with revalidation
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Name of the on-disk cache, see cache_store_dir()
+#define HTTP_CACHE_NAME "http"
+
+// LRU eviction keeps the bodies under this many bytes and entries
+#define HTTP_CACHE_MAX_BYTES (64 * 1024 * 1024)
+#define HTTP_CACHE_MAX_ENTRIES 1024
+
+// Larger responses are passed through without being stored
+#define HTTP_CACHE_MAX_ENTRY_BYTES (8 * 1024 * 1024)
+
+// Without max-age or Expires, a Last-Modified response stays fresh for a
+// tenth of its age, at most this long (seconds)
+#define HTTP_CACHE_HEURISTIC_MAX_SEC (24 * 60 * 60)
+
+// Cached bodies are handed out in pieces of this size
+#define HTTP_CACHE_DELIVER_CHUNK (16 * 1024)
+
+#define HTTP_CACHE_MAX_VALIDATOR 128
+#define HTTP_CACHE_MAX_CONTENT_TYPE 128
+
+typedef enum {
+    HTTP_CACHE_MISS,
+    HTTP_CACHE_FRESH,           // answer from disk, no request
+    HTTP_CACHE_STALE            // send the validators, 304 = still good
+} http_cache_state_t;
+
+typedef struct {
+    char etag[HTTP_CACHE_MAX_VALIDATOR];            // "" = none
+    char last_modified[HTTP_CACHE_MAX_VALIDATOR];
+} http_cache_validators_t;
+
+// The response headers caching depends on; NULL when absent
+typedef struct {
+    int status;
+    const char *cache_control;
+    const char *etag;
+    const char *last_modified;
+    const char *expires;
+    const char *date;
+    const char *age;
+    const char *content_type;   // kept with the body (its charset)
+    const char *vary;
+} http_cache_headers_t;
+
+typedef struct {
+    unsigned fresh_hits;
+    unsigned revalidated;       // 304s
+    unsigned misses;
+    unsigned stored;
+    unsigned evicted;
+    size_t bytes;
+    size_t entries;
+} http_cache_stats_t;
+
+typedef struct http_cache_writer http_cache_writer_t;
+
+// dir: private directory for bodies and the index (cache_store_dir()),
+// whose index is loaded; NULL = off
+errno_t http_cache_init(const char *dir);
+// Writes the index back and drops the in-memory copy
+void http_cache_shutdown(void);
+
+// Whether there is a cache directory to store into
+bool http_cache_enabled(void);
+
+// What the cache knows about url. v (may be NULL) gets the validators of
+// a stale entry.
+http_cache_state_t http_cache_lookup(const char *url, http_cache_validators_t *v);
+
+// Pass the stored body of url to on_body in HTTP_CACHE_DELIVER_CHUNK
+// slices of the (mapped where possible) body file, once its SHA-256 has
+// been checked. ENOENT, before any byte, if it is gone or damaged.
+errno_t http_cache_deliver(const char *url,
+    errno_t (*on_body)(const void *data, size_t len, void *arg), void *arg);
+
+// Content-Type stored with url ("" if none); false when url is not cached
+bool http_cache_content_type(const char *url, char *out, size_t size);
+
+// A 304 for url: the stored body is good, take the new freshness
+void http_cache_revalidated(const char *url, const http_cache_headers_t *h);
+
+// When a response with h, received at now, stops being fresh (seconds
+// since the epoch); 0 = every use revalidates
+int64_t http_cache_fresh_until(const http_cache_headers_t *h, int64_t now);
+
+// Store a response while it streams by. NULL when it is not cacheable
+// (status, no-store, Vary on what pauk does not always send the same, no
+// freshness or validator) or the cache is off.
+http_cache_writer_t *http_cache_store_begin(const char *url, const http_cache_headers_t *h);
+errno_t http_cache_store_write(http_cache_writer_t *w, const void *data, size_t len);
+// complete: the whole body went through; otherwise the copy is dropped
+void http_cache_store_end(http_cache_writer_t *w, bool complete);
+
+http_cache_stats_t http_cache_stats(void);
+
+#endif // HTTP_CACHE_H
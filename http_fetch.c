@@ -0,0 +1,1194 @@
+// http_fetch.c - HTTP/1.1 GET client with keep-alive connection pooling
+//
+// Every fetch used to open its own connection, speak HTTP/1.0 and read
+// until the server hung up, so a page with a dozen scripts paid a dozen
+// connects and the whole body was buffered before anything looked at it.
+// Requests are now HTTP/1.1: bodies are Content-Length, chunked or
+// close-delimited, and are handed to the caller piece by piece as they are
+// read. A connection that ends its response cleanly goes back to a small
+// per-origin pool and the next request to that origin reuses it; a reused
+// connection the server has meanwhile closed is retried once on a fresh
+// one. Runs of same-origin requests can be written back to back on one
+// connection (pipelining) and their responses read in order. Fetches go
+// through http_cache first: fresh entries never touch the network and
+// stale ones are revalidated. Bodies may come gzip or deflate encoded:
+// they are inflated as they are read, so the cache and the caller only
+// see decoded bytes. https:// URLs run the same protocol over a
+// tls_session connection; pooled https connections keep their TLS state,
+// and new ones resume the last session with the server.
+//
+// Reads block the calling worker only: a fibril on HelenOS (libinet waits
+// per fibril), a thread with a receive timeout on the host. The pool is
+// the only shared state.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#include "http_fetch.h"
+#include "http_cache.h"
+#include "tls_session.h"
+#include "content_inflate.h"
+#include "pauk_sync.h"
+
+#ifdef PAUK_HOST
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#else
+#include <inet/addr.h>
+#include <inet/endpoint.h>
+#include <inet/host.h>
+#include <inet/tcp.h>
+#endif
+
+#define HTTP_FETCH_RECV_CHUNK 4096
+
+// ===== URL =====
+
+errno_t http_url_parse(const char *url, http_url_t *out)
+{
+    if (!url || !out)
+        return EINVAL;
+    const char *host;
+    if (strncmp(url, "http://", 7) == 0) {
+        out->tls = false;
+        host = url + 7;
+    } else if (strncmp(url, "https://", 8) == 0) {
+        out->tls = true;
+        host = url + 8;
+    } else {
+        return EINVAL;
+    }
+
+    size_t host_len = strcspn(host, ":/?#");
+    if (host_len == 0 || host_len >= sizeof(out->host))
+        return EINVAL;
+    memcpy(out->host, host, host_len);
+    out->host[host_len] = '\0';
+
+    const char *p = host + host_len;
+    out->port = out->tls ? 443 : 80;
+    if (*p == ':') {
+        char *end;
+        unsigned long port = strtoul(p + 1, &end, 10);
+        if (end == p + 1 || port == 0 || port > 65535)
+            return EINVAL;
+        out->port = (uint16_t)port;
+        p = end;
+    }
+
+    // Fragment never goes on the wire
+    size_t path_len = strcspn(p, "#");
+    if (path_len + 2 > sizeof(out->path))
+        return EINVAL;
+    size_t n = 0;
+    if (*p != '/')
+        out->path[n++] = '/';
+    memcpy(out->path + n, p, path_len);
+    out->path[n + path_len] = '\0';
+    return EOK;
+}
+
+static bool http_same_origin(const http_url_t *a, const http_url_t *b)
+{
+    return a->tls == b->tls && a->port == b->port && strcmp(a->host, b->host) == 0;
+}
+
+// Location header against the URL that sent it
+static errno_t http_resolve_location(const http_url_t *base, const char *loc,
+    char *out, size_t size)
+{
+    const char *scheme = base->tls ? "https" : "http";
+    int n;
+    if (strncmp(loc, "http://", 7) == 0 || strncmp(loc, "https://", 8) == 0) {
+        n = snprintf(out, size, "%s", loc);
+    } else if (loc[0] == '/' && loc[1] == '/') {
+        n = snprintf(out, size, "%s:%s", scheme, loc);
+    } else if (loc[0] == '/') {
+        n = snprintf(out, size, "%s://%s:%u%s", scheme, base->host, base->port, loc);
+    } else {
+        // Relative to the directory of the base path
+        size_t dir_len = strcspn(base->path, "?");
+        while (dir_len > 0 && base->path[dir_len - 1] != '/')
+            dir_len--;
+        n = snprintf(out, size, "%s://%s:%u%.*s%s", scheme, base->host, base->port,
+            (int)dir_len, base->path, loc);
+    }
+    return (n < 0 || (size_t)n >= size) ? ELIMIT : EOK;
+}
+
+// ===== Transport =====
+
+typedef struct http_conn {
+#ifdef PAUK_HOST
+    int fd;
+#else
+    tcp_t *tcp;
+    tcp_conn_t *conn;
+#endif
+    tls_conn_t *tls;            // NULL: plain http
+    char host[HTTP_URL_MAX_HOST];
+    uint16_t port;
+
+    // Received, not yet consumed: [rpos, rlen)
+    char rbuf[HTTP_FETCH_RECV_CHUNK];
+    size_t rpos;
+    size_t rlen;
+    bool eof;
+    size_t received;            // bytes read since the last request went out
+
+    bool reused;                // came out of the pool
+    uint64_t idle_since;
+    struct http_conn *next;
+} http_conn_t;
+
+#ifdef PAUK_HOST
+
+static errno_t http_tcp_open(http_conn_t *c, const char *host, uint16_t port)
+{
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    struct addrinfo hints = { 0 };
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, service, &hints, &res) != 0)
+        return ENOENT;
+
+    c->fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            c->fd = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(res);
+    if (c->fd < 0)
+        return EIO;
+
+    struct timeval tv = { .tv_sec = HTTP_FETCH_TIMEOUT_SEC };
+    setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(c->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    // Requests are small and often written back to back
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return EOK;
+}
+
+static errno_t http_tcp_send(http_conn_t *c, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(c->fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return EIO;
+        p += n;
+        len -= (size_t)n;
+    }
+    return EOK;
+}
+
+static errno_t http_tcp_recv(http_conn_t *c, void *buf, size_t size, size_t *nrecv)
+{
+    ssize_t n = recv(c->fd, buf, size, 0);
+    if (n < 0)
+        return EIO;
+    *nrecv = (size_t)n;
+    return EOK;
+}
+
+static void http_tcp_close(http_conn_t *c)
+{
+    if (c->fd >= 0)
+        close(c->fd);
+    c->fd = -1;
+}
+
+#else
+
+static errno_t http_tcp_open(http_conn_t *c, const char *host, uint16_t port)
+{
+    inet_addr_t addr;
+    errno_t rc = inet_host_plookup_one(host, ip_any, &addr, NULL, NULL);
+    if (rc != EOK)
+        return rc;
+
+    inet_ep2_t epp;
+    inet_ep2_init(&epp);
+    epp.remote.addr = addr;
+    epp.remote.port = port;
+
+    c->tcp = NULL;
+    c->conn = NULL;
+    rc = tcp_create(&c->tcp);
+    if (rc != EOK)
+        return rc;
+
+    rc = tcp_conn_create(c->tcp, &epp, NULL, NULL, &c->conn);
+    if (rc != EOK) {
+        tcp_destroy(c->tcp);
+        c->tcp = NULL;
+    }
+    return rc;
+}
+
+static errno_t http_tcp_send(http_conn_t *c, const void *data, size_t len)
+{
+    return tcp_conn_send(c->conn, data, len);
+}
+
+static errno_t http_tcp_recv(http_conn_t *c, void *buf, size_t size, size_t *nrecv)
+{
+    return tcp_conn_recv_wait(c->conn, buf, size, nrecv);
+}
+
+static void http_tcp_close(http_conn_t *c)
+{
+    if (c->conn)
+        tcp_conn_destroy(c->conn);
+    if (c->tcp)
+        tcp_destroy(c->tcp);
+    c->conn = NULL;
+    c->tcp = NULL;
+}
+
+#endif
+
+// TLS record layer over the TCP transport
+static int http_tls_io_send(void *io, const unsigned char *data, size_t len)
+{
+    return http_tcp_send(io, data, len) == EOK ? (int)len : -1;
+}
+
+static int http_tls_io_recv(void *io, unsigned char *buf, size_t size)
+{
+    size_t n = 0;
+    if (http_tcp_recv(io, buf, size, &n) != EOK)
+        return -1;
+    return (int)n;
+}
+
+static errno_t http_conn_open(http_conn_t *c, const char *host, uint16_t port, bool tls)
+{
+    errno_t rc = http_tcp_open(c, host, port);
+    if (rc != EOK || !tls)
+        return rc;
+    rc = tls_conn_open(&c->tls, host, port, http_tls_io_send, http_tls_io_recv, c);
+    if (rc != EOK)
+        http_tcp_close(c);
+    return rc;
+}
+
+static errno_t http_conn_send(http_conn_t *c, const void *data, size_t len)
+{
+    if (c->tls)
+        return tls_conn_send(c->tls, data, len);
+    return http_tcp_send(c, data, len);
+}
+
+static errno_t http_conn_recv(http_conn_t *c, void *buf, size_t size, size_t *nrecv)
+{
+    if (c->tls)
+        return tls_conn_recv(c->tls, buf, size, nrecv);
+    return http_tcp_recv(c, buf, size, nrecv);
+}
+
+static void http_conn_close(http_conn_t *c)
+{
+    tls_conn_close(c->tls);
+    c->tls = NULL;
+    http_tcp_close(c);
+}
+
+static void http_conn_free(http_conn_t *c)
+{
+    if (!c)
+        return;
+    http_conn_close(c);
+    free(c);
+}
+
+// Make sure unread bytes are buffered; EIO with c->eof once the peer is gone
+static errno_t http_conn_fill(http_conn_t *c)
+{
+    if (c->rpos < c->rlen)
+        return EOK;
+    if (c->eof)
+        return EIO;
+
+    size_t n = 0;
+    errno_t rc = http_conn_recv(c, c->rbuf, sizeof(c->rbuf), &n);
+    if (rc != EOK)
+        return rc;
+    if (n == 0) {
+        c->eof = true;
+        return EIO;
+    }
+    c->rpos = 0;
+    c->rlen = n;
+    c->received += n;
+    return EOK;
+}
+
+// One line without its CRLF; ELIMIT once it would exceed *budget bytes
+static errno_t http_conn_read_line(http_conn_t *c, char *line, size_t size,
+    size_t *budget)
+{
+    size_t len = 0;
+    for (;;) {
+        errno_t rc = http_conn_fill(c);
+        if (rc != EOK)
+            return rc;
+
+        char ch = c->rbuf[c->rpos++];
+        if (*budget == 0)
+            return ELIMIT;
+        (*budget)--;
+        if (ch == '\n')
+            break;
+        if (len + 1 >= size)
+            return ELIMIT;
+        line[len++] = ch;
+    }
+    if (len > 0 && line[len - 1] == '\r')
+        len--;
+    line[len] = '\0';
+    return EOK;
+}
+
+// ===== Pool =====
+
+static bool pool_ready = false;
+static pauk_mutex_t pool_lock;
+static http_conn_t *pool_idle = NULL;
+static int pool_idle_count = 0;
+
+void http_fetch_init(void)
+{
+    if (!pool_ready) {
+        pauk_mutex_init(&pool_lock);
+        pool_ready = true;
+        // Without TLS support https fetches fail in tls_conn_open()
+        (void)tls_init();
+    }
+}
+
+// An idle connection to host:port, or a new one
+static errno_t http_pool_get(const http_url_t *u, http_conn_t **out)
+{
+    http_fetch_init();
+
+    http_conn_t *found = NULL;
+    http_conn_t *expired = NULL;
+    uint64_t now = pauk_time_usec();
+
+    pauk_mutex_lock(&pool_lock);
+    http_conn_t **p = &pool_idle;
+    while (*p) {
+        http_conn_t *c = *p;
+        if (now - c->idle_since > HTTP_POOL_IDLE_USEC) {
+            *p = c->next;
+            c->next = expired;
+            expired = c;
+            pool_idle_count--;
+            continue;
+        }
+        if (!found && c->port == u->port && (c->tls != NULL) == u->tls &&
+            strcmp(c->host, u->host) == 0) {
+            *p = c->next;
+            found = c;
+            pool_idle_count--;
+            continue;
+        }
+        p = &c->next;
+    }
+    pauk_mutex_unlock(&pool_lock);
+
+    while (expired) {
+        http_conn_t *next = expired->next;
+        http_conn_free(expired);
+        expired = next;
+    }
+
+    if (found) {
+        found->next = NULL;
+        found->reused = true;
+        found->received = 0;
+        *out = found;
+        return EOK;
+    }
+
+    http_conn_t *c = calloc(1, sizeof(http_conn_t));
+    if (!c)
+        return ENOMEM;
+    snprintf(c->host, sizeof(c->host), "%s", u->host);
+    c->port = u->port;
+    errno_t rc = http_conn_open(c, u->host, u->port, u->tls);
+    if (rc != EOK) {
+        free(c);
+        return rc;
+    }
+    *out = c;
+    return EOK;
+}
+
+// Back to the pool if the last response ended cleanly, closed otherwise
+static void http_pool_put(http_conn_t *c, bool reusable)
+{
+    // Bytes past the response would be read as the next one
+    if (!reusable || c->eof || c->rpos != c->rlen) {
+        http_conn_free(c);
+        return;
+    }
+
+    pauk_mutex_lock(&pool_lock);
+    int same = 0;
+    for (http_conn_t *i = pool_idle; i; i = i->next) {
+        if (i->port == c->port && (i->tls != NULL) == (c->tls != NULL) &&
+            strcmp(i->host, c->host) == 0)
+            same++;
+    }
+    bool keep = same < HTTP_POOL_MAX_IDLE_PER_ORIGIN &&
+        pool_idle_count < HTTP_POOL_MAX_IDLE;
+    if (keep) {
+        c->idle_since = pauk_time_usec();
+        c->next = pool_idle;
+        pool_idle = c;
+        pool_idle_count++;
+    }
+    pauk_mutex_unlock(&pool_lock);
+
+    if (!keep)
+        http_conn_free(c);
+}
+
+void http_fetch_shutdown(void)
+{
+    if (!pool_ready)
+        return;
+
+    pauk_mutex_lock(&pool_lock);
+    http_conn_t *c = pool_idle;
+    pool_idle = NULL;
+    pool_idle_count = 0;
+    pauk_mutex_unlock(&pool_lock);
+
+    while (c) {
+        http_conn_t *next = c->next;
+        http_conn_free(c);
+        c = next;
+    }
+    tls_shutdown();
+}
+
+// ===== Request =====
+
+// v (may be NULL): validators of a stale cache entry, sent as conditions
+static errno_t http_send_request(http_conn_t *c, const http_url_t *u,
+    const http_cache_validators_t *v)
+{
+    char host[HTTP_URL_MAX_HOST + 8];
+    if (u->port == (u->tls ? 443 : 80))
+        snprintf(host, sizeof(host), "%s", u->host);
+    else
+        snprintf(host, sizeof(host), "%s:%u", u->host, u->port);
+
+    char conditions[2 * HTTP_CACHE_MAX_VALIDATOR + 64] = "";
+    if (v && v->etag[0] && v->last_modified[0])
+        snprintf(conditions, sizeof(conditions), "If-None-Match: %s\r\nIf-Modified-Since: %s\r\n",
+            v->etag, v->last_modified);
+    else if (v && v->etag[0])
+        snprintf(conditions, sizeof(conditions), "If-None-Match: %s\r\n", v->etag);
+    else if (v && v->last_modified[0])
+        snprintf(conditions, sizeof(conditions), "If-Modified-Since: %s\r\n", v->last_modified);
+
+    char request[HTTP_URL_MAX_PATH + HTTP_URL_MAX_HOST + sizeof(conditions) + 160];
+    int request_len = snprintf(request, sizeof(request),
+        "GET %s HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "User-Agent: pauk\r\n"
+        "Accept: */*\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Connection: keep-alive\r\n"
+        "%s"
+        "\r\n", u->path, host, conditions);
+    if (request_len < 0 || (size_t)request_len >= sizeof(request))
+        return EINVAL;
+
+    return http_conn_send(c, request, (size_t)request_len);
+}
+
+// ===== Response =====
+
+typedef struct {
+    int status;
+    bool chunked;
+    bool has_length;
+    uint64_t length;
+    bool close;                 // connection cannot carry another response
+    char location[HTTP_URL_MAX_PATH + HTTP_URL_MAX_HOST];
+    char content_encoding[32];
+    char content_type[HTTP_CACHE_MAX_CONTENT_TYPE];
+
+    // For http_cache; "" when absent
+    char cache_control[256];
+    char etag[HTTP_CACHE_MAX_VALIDATOR];
+    char last_modified[HTTP_CACHE_MAX_VALIDATOR];
+    char expires[64];
+    char date[64];
+    char age[24];
+    char vary[128];             // all Vary headers, comma-joined
+} http_head_t;
+
+static bool http_name_eq(const char *a, const char *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+            return false;
+    }
+    return true;
+}
+
+// Does the comma separated header value contain token (any case)?
+static bool http_has_token(const char *value, const char *token)
+{
+    size_t token_len = strlen(token);
+    const char *p = value;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        size_t len = strcspn(p, ",");
+        size_t trimmed = len;
+        while (trimmed > 0 && (p[trimmed - 1] == ' ' || p[trimmed - 1] == '\t'))
+            trimmed--;
+        if (trimmed == token_len && http_name_eq(p, token, token_len))
+            return true;
+        p += len;
+    }
+    return false;
+}
+
+static bool http_is_redirect(int status)
+{
+    return status == 301 || status == 302 || status == 303 ||
+        status == 307 || status == 308;
+}
+
+// Status line and headers; 1xx interim responses are skipped
+static errno_t http_read_head(http_conn_t *c, http_head_t *head)
+{
+    char line[HTTP_URL_MAX_PATH + HTTP_URL_MAX_HOST + 64];
+    size_t budget = HTTP_FETCH_MAX_HEAD;
+
+    for (;;) {
+        memset(head, 0, sizeof(*head));
+
+        errno_t rc = http_conn_read_line(c, line, sizeof(line), &budget);
+        if (rc != EOK)
+            return rc;
+
+        // "HTTP/1.x NNN reason"
+        if (strncmp(line, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)line[7]))
+            return EIO;
+        bool http10 = line[7] == '0';
+        const char *sp = strchr(line, ' ');
+        if (!sp)
+            return EIO;
+        head->status = atoi(sp + 1);
+        if (head->status < 100 || head->status > 999)
+            return EIO;
+        head->close = http10;
+
+        for (;;) {
+            rc = http_conn_read_line(c, line, sizeof(line), &budget);
+            if (rc != EOK)
+                return rc;
+            if (line[0] == '\0')
+                break;
+
+            char *colon = strchr(line, ':');
+            if (!colon)
+                continue;
+            size_t name_len = (size_t)(colon - line);
+            char *v = colon + 1;
+            while (*v == ' ' || *v == '\t')
+                v++;
+            size_t v_len = strlen(v);
+            while (v_len > 0 && (v[v_len - 1] == ' ' || v[v_len - 1] == '\t'))
+                v[--v_len] = '\0';
+
+            if (name_len == 14 && http_name_eq(line, "Content-Length", 14)) {
+                char *end;
+                unsigned long long n = strtoull(v, &end, 10);
+                if (end == v)
+                    return EIO;
+                head->has_length = true;
+                head->length = n;
+            } else if (name_len == 17 && http_name_eq(line, "Transfer-Encoding", 17)) {
+                head->chunked = http_has_token(v, "chunked");
+            } else if (name_len == 10 && http_name_eq(line, "Connection", 10)) {
+                if (http_has_token(v, "close"))
+                    head->close = true;
+                else if (http_has_token(v, "keep-alive"))
+                    head->close = false;
+            } else if (name_len == 8 && http_name_eq(line, "Location", 8)) {
+                snprintf(head->location, sizeof(head->location), "%s", v);
+            } else if (name_len == 16 && http_name_eq(line, "Content-Encoding", 16)) {
+                snprintf(head->content_encoding, sizeof(head->content_encoding), "%s", v);
+            } else if (name_len == 12 && http_name_eq(line, "Content-Type", 12)) {
+                snprintf(head->content_type, sizeof(head->content_type), "%s", v);
+            } else if (name_len == 13 && http_name_eq(line, "Cache-Control", 13)) {
+                snprintf(head->cache_control, sizeof(head->cache_control), "%s", v);
+            } else if (name_len == 4 && http_name_eq(line, "ETag", 4)) {
+                if (strlen(v) < sizeof(head->etag))
+                    memcpy(head->etag, v, strlen(v) + 1);
+            } else if (name_len == 13 && http_name_eq(line, "Last-Modified", 13)) {
+                snprintf(head->last_modified, sizeof(head->last_modified), "%s", v);
+            } else if (name_len == 7 && http_name_eq(line, "Expires", 7)) {
+                snprintf(head->expires, sizeof(head->expires), "%s", v);
+            } else if (name_len == 4 && http_name_eq(line, "Date", 4)) {
+                snprintf(head->date, sizeof(head->date), "%s", v);
+            } else if (name_len == 3 && http_name_eq(line, "Age", 3)) {
+                snprintf(head->age, sizeof(head->age), "%s", v);
+            } else if (name_len == 4 && http_name_eq(line, "Vary", 4)) {
+                size_t used = strlen(head->vary);
+                int n = snprintf(head->vary + used, sizeof(head->vary) - used, "%s%s",
+                    used ? ", " : "", v);
+                // Too many to keep: as uncacheable as they get
+                if (n < 0 || (size_t)n >= sizeof(head->vary) - used)
+                    snprintf(head->vary, sizeof(head->vary), "*");
+            }
+        }
+
+        if (head->status >= 200)
+            break;
+    }
+
+    // Chunked wins over Content-Length; with neither the body runs to close
+    if (head->chunked)
+        head->has_length = false;
+    else if (!head->has_length && head->status != 204 && head->status != 304)
+        head->close = true;
+    return EOK;
+}
+
+// Pass n bytes of body to sink (NULL: discard)
+static errno_t http_read_bytes(http_conn_t *c, uint64_t n, http_body_cb_t sink,
+    void *arg)
+{
+    while (n > 0) {
+        errno_t rc = http_conn_fill(c);
+        if (rc != EOK)
+            return rc;
+        size_t avail = c->rlen - c->rpos;
+        if (avail > n)
+            avail = (size_t)n;
+        if (sink) {
+            rc = sink(c->rbuf + c->rpos, avail, arg);
+            if (rc != EOK)
+                return rc;
+        }
+        c->rpos += avail;
+        n -= avail;
+    }
+    return EOK;
+}
+
+static errno_t http_read_body(http_conn_t *c, const http_head_t *head,
+    http_body_cb_t sink, void *arg)
+{
+    if (head->status == 204 || head->status == 304)
+        return EOK;
+
+    if (head->chunked) {
+        char line[128];
+        size_t budget = HTTP_FETCH_MAX_HEAD;
+        for (;;) {
+            errno_t rc = http_conn_read_line(c, line, sizeof(line), &budget);
+            if (rc != EOK)
+                return rc;
+            char *end;
+            unsigned long long size = strtoull(line, &end, 16);
+            if (end == line)
+                return EIO;
+            if (size == 0)
+                break;
+            if (size > HTTP_FETCH_MAX_BODY)
+                return ELIMIT;
+
+            rc = http_read_bytes(c, size, sink, arg);
+            if (rc == EOK)
+                rc = http_conn_read_line(c, line, sizeof(line), &budget);
+            if (rc != EOK)
+                return rc;
+            if (line[0] != '\0')
+                return EIO;
+            budget = HTTP_FETCH_MAX_HEAD;
+        }
+        // Trailers up to the empty line
+        do {
+            errno_t rc = http_conn_read_line(c, line, sizeof(line), &budget);
+            if (rc != EOK)
+                return rc;
+        } while (line[0] != '\0');
+        return EOK;
+    }
+
+    if (head->has_length) {
+        if (head->length > HTTP_FETCH_MAX_BODY)
+            return ELIMIT;
+        return http_read_bytes(c, head->length, sink, arg);
+    }
+
+    // Close-delimited
+    for (;;) {
+        errno_t rc = http_conn_fill(c);
+        if (rc != EOK)
+            return c->eof ? EOK : rc;
+        size_t avail = c->rlen - c->rpos;
+        if (sink) {
+            rc = sink(c->rbuf + c->rpos, avail, arg);
+            if (rc != EOK)
+                return rc;
+        }
+        c->rpos += avail;
+    }
+}
+
+// ===== Fetch =====
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} http_buffer_t;
+
+static errno_t http_buffer_append(const void *data, size_t len, void *arg)
+{
+    http_buffer_t *b = arg;
+    if (b->len + len > HTTP_FETCH_MAX_BODY)
+        return ELIMIT;
+
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : HTTP_FETCH_RECV_CHUNK * 4;
+        while (cap < b->len + len + 1)
+            cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown)
+            return ENOMEM;
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return EOK;
+}
+
+static errno_t http_buffer_finish(http_buffer_t *b, char **body, size_t *len)
+{
+    if (!b->data) {
+        b->data = malloc(1);
+        if (!b->data)
+            return ENOMEM;
+        b->data[0] = '\0';
+    }
+    *body = b->data;
+    *len = b->len;
+    b->data = NULL;
+    return EOK;
+}
+
+static http_cache_headers_t http_cache_headers(const http_head_t *head)
+{
+    http_cache_headers_t h = { .status = head->status };
+    h.cache_control = head->cache_control[0] ? head->cache_control : NULL;
+    h.etag = head->etag[0] ? head->etag : NULL;
+    h.last_modified = head->last_modified[0] ? head->last_modified : NULL;
+    h.expires = head->expires[0] ? head->expires : NULL;
+    h.date = head->date[0] ? head->date : NULL;
+    h.age = head->age[0] ? head->age : NULL;
+    h.content_type = head->content_type[0] ? head->content_type : NULL;
+    h.vary = head->vary[0] ? head->vary : NULL;
+    return h;
+}
+
+// Body to the caller's sink and to the cache copy
+typedef struct {
+    http_body_cb_t sink;
+    void *arg;
+    http_cache_writer_t *writer;
+} http_tee_t;
+
+static errno_t http_tee_body(const void *data, size_t len, void *arg)
+{
+    http_tee_t *tee = arg;
+    errno_t rc = tee->sink ? tee->sink(data, len, tee->arg) : EOK;
+    if (rc == EOK)
+        rc = http_cache_store_write(tee->writer, data, len);
+    return rc;
+}
+
+// Wire bytes of a gzip/deflate body into the decoder. A small body can
+// expand a thousandfold, so the decoded size is held to the body limit.
+static errno_t http_inflate_body(const void *data, size_t len, void *arg)
+{
+    content_inflate_t *inf = arg;
+    if (inf->produced > HTTP_FETCH_MAX_BODY)
+        return ELIMIT;
+    return content_inflate_feed(inf, data, len);
+}
+
+// The body as it came over the wire, Content-Encoding undone on the way
+static errno_t http_read_decoded_body(http_conn_t *c, const http_head_t *head,
+    http_body_cb_t sink, void *arg)
+{
+    content_encoding_t encoding = content_encoding_parse(head->content_encoding);
+    if (encoding == CONTENT_ENCODING_IDENTITY)
+        return http_read_body(c, head, sink, arg);
+    if (encoding == CONTENT_ENCODING_UNKNOWN)
+        return ENOTSUP;
+
+    content_inflate_t *inf = malloc(sizeof(content_inflate_t));
+    if (!inf)
+        return ENOMEM;
+    content_inflate_init(inf, encoding, sink, arg);
+    errno_t rc = http_read_body(c, head, http_inflate_body, inf);
+    // An empty body has nothing to decode
+    if (rc == EOK && head->status != 204 && !(head->has_length && head->length == 0))
+        rc = content_inflate_finish(inf);
+    free(inf);
+    return rc;
+}
+
+// Read the body that follows head: redirect and 304 bodies are dropped,
+// others go to sink, decoded, and if cacheable into the cache under url
+static errno_t http_read_response_body(http_conn_t *c, const http_head_t *head,
+    const char *url, http_body_cb_t sink, void *arg)
+{
+    if ((http_is_redirect(head->status) && head->location[0]) || head->status == 304)
+        return http_read_body(c, head, NULL, NULL);
+
+    http_cache_headers_t h = http_cache_headers(head);
+    http_cache_writer_t *w = http_cache_store_begin(url, &h);
+    if (!w)
+        return http_read_decoded_body(c, head, sink, arg);
+
+    http_tee_t tee = { sink, arg, w };
+    errno_t rc = http_read_decoded_body(c, head, http_tee_body, &tee);
+    http_cache_store_end(w, rc == EOK);
+    return rc;
+}
+
+// One request/response on a pooled connection for url (u parsed). Redirect
+// bodies are read and dropped, every other body goes to sink. A reused
+// connection that fails before the first response byte was most likely
+// closed by the server while idle: that is retried once on a fresh
+// connection.
+static errno_t http_exchange(const char *url, const http_url_t *u,
+    const http_cache_validators_t *v, http_head_t *head, http_body_cb_t sink, void *arg)
+{
+    for (int attempt = 0; ; attempt++) {
+        http_conn_t *c;
+        errno_t rc = http_pool_get(u, &c);
+        if (rc != EOK)
+            return rc;
+
+        rc = http_send_request(c, u, v);
+        if (rc == EOK)
+            rc = http_read_head(c, head);
+        if (rc != EOK) {
+            bool stale = c->reused && c->received == 0;
+            http_conn_free(c);
+            if (stale && attempt == 0)
+                continue;
+            return rc;
+        }
+
+        bool redirect = http_is_redirect(head->status) && head->location[0];
+        if (redirect && head->close) {
+            // Nothing to keep the connection for
+            http_conn_free(c);
+            return EOK;
+        }
+        rc = http_read_response_body(c, head, url, sink, arg);
+        http_pool_put(c, rc == EOK && !head->close);
+        return rc;
+    }
+}
+
+// on_body of http_fetch_stream(): the caller's, with the Content-Type and
+// the URL of the response copied out before the first byte of it
+typedef struct {
+    http_body_cb_t on_body;
+    void *arg;
+    const http_head_t *head;
+    char *content_type;
+    size_t content_type_size;
+    const char *url;
+    char *final_url;
+    size_t final_url_size;
+    bool typed;
+} http_typed_body_t;
+
+static errno_t http_typed_body(const void *data, size_t len, void *arg)
+{
+    http_typed_body_t *t = arg;
+    if (!t->typed) {
+        t->typed = true;
+        if (t->content_type)
+            snprintf(t->content_type, t->content_type_size, "%s", t->head->content_type);
+        if (t->final_url)
+            snprintf(t->final_url, t->final_url_size, "%s", t->url);
+    }
+    return t->on_body ? t->on_body(data, len, t->arg) : EOK;
+}
+
+errno_t http_fetch_stream(const char *url, http_body_cb_t on_body, void *arg,
+    int *status, char *final_url, size_t final_url_size,
+    char *content_type, size_t content_type_size)
+{
+    if (!url || !status)
+        return EINVAL;
+    if (!content_type || content_type_size == 0) {
+        content_type = NULL;
+        content_type_size = 0;
+    } else {
+        content_type[0] = '\0';
+    }
+    if (!final_url || final_url_size == 0) {
+        final_url = NULL;
+        final_url_size = 0;
+    }
+
+    char current[HTTP_URL_MAX_PATH + HTTP_URL_MAX_HOST];
+    if (snprintf(current, sizeof(current), "%s", url) >= (int)sizeof(current))
+        return EINVAL;
+
+    http_head_t *head = malloc(sizeof(http_head_t));
+    if (!head)
+        return ENOMEM;
+
+    errno_t rc = EOK;
+    for (int redirects = 0; ; redirects++) {
+        http_url_t u;
+        rc = http_url_parse(current, &u);
+        if (rc != EOK)
+            break;
+
+        // Fresh: straight from disk
+        http_cache_validators_t v;
+        http_cache_state_t cached = http_cache_lookup(current, &v);
+        if (cached == HTTP_CACHE_FRESH) {
+            if (content_type)
+                http_cache_content_type(current, content_type, content_type_size);
+            if (final_url)
+                snprintf(final_url, final_url_size, "%s", current);
+            rc = http_cache_deliver(current, on_body, arg);
+            if (rc != ENOENT) {
+                *status = 200;
+                break;
+            }
+            cached = HTTP_CACHE_MISS;
+        }
+
+        http_typed_body_t typed = { on_body, arg, head, content_type, content_type_size,
+            current, final_url, final_url_size, false };
+        rc = http_exchange(current, &u, cached == HTTP_CACHE_STALE ? &v : NULL,
+            head, http_typed_body, &typed);
+        if (rc != EOK)
+            break;
+
+        // Not modified: the stored body is the answer
+        if (head->status == 304 && cached == HTTP_CACHE_STALE) {
+            http_cache_headers_t h = http_cache_headers(head);
+            http_cache_revalidated(current, &h);
+            if (content_type)
+                http_cache_content_type(current, content_type, content_type_size);
+            if (final_url)
+                snprintf(final_url, final_url_size, "%s", current);
+            rc = http_cache_deliver(current, on_body, arg);
+            if (rc == ENOENT) {
+                // Evicted meanwhile: ask again without conditions
+                typed.typed = false;
+                rc = http_exchange(current, &u, NULL, head, http_typed_body, &typed);
+                if (rc != EOK)
+                    break;
+            } else {
+                head->status = 200;
+                typed.typed = true;
+                if (rc != EOK)
+                    break;
+            }
+        }
+
+        if (!http_is_redirect(head->status) || !head->location[0]) {
+            // An empty body never went through http_typed_body()
+            if (content_type && !typed.typed)
+                snprintf(content_type, content_type_size, "%s", head->content_type);
+            *status = head->status;
+            if (final_url)
+                snprintf(final_url, final_url_size, "%s", current);
+            break;
+        }
+
+        if (redirects == HTTP_FETCH_MAX_REDIRECTS) {
+            rc = ELIMIT;
+            break;
+        }
+        char next[sizeof(current)];
+        rc = http_resolve_location(&u, head->location, next, sizeof(next));
+        if (rc != EOK)
+            break;
+        memcpy(current, next, sizeof(current));
+    }
+
+    free(head);
+    return rc;
+}
+
+// Warm fetch sink: the body only goes to the cache copy, and past what
+// the cache keeps there is no point reading on
+static errno_t http_warm_body(const void *data, size_t len, void *arg)
+{
+    (void)data;
+    size_t *total = arg;
+    *total += len;
+    return *total > HTTP_CACHE_MAX_ENTRY_BYTES ? ELIMIT : EOK;
+}
+
+errno_t http_fetch_warm(const char *url)
+{
+    if (!url)
+        return EINVAL;
+    // Nothing would be kept
+    if (!http_cache_enabled())
+        return ENOTSUP;
+    if (http_cache_lookup(url, NULL) == HTTP_CACHE_FRESH)
+        return EOK;
+
+    size_t total = 0;
+    int status = 0;
+    return http_fetch_stream(url, http_warm_body, &total, &status, NULL, 0, NULL, 0);
+}
+
+errno_t http_fetch(const char *url, char **body, size_t *len, int *status)
+{
+    if (!url || !body || !len || !status)
+        return EINVAL;
+
+    http_buffer_t b = { 0 };
+    errno_t rc = http_fetch_stream(url, http_buffer_append, &b, status, NULL, 0, NULL, 0);
+    if (rc == EOK)
+        rc = http_buffer_finish(&b, body, len);
+    free(b.data);
+    return rc;
+}
+
+// urls[first, first + n) share an origin: write all the requests, then
+// read the responses in order. Returns how many were answered; out[] of
+// the rest is left for the caller to retry.
+static size_t http_pipeline_batch(const char *const *urls, const http_url_t *u, size_t n,
+    http_response_t *out, bool *refetch)
+{
+    http_conn_t *c;
+    if (http_pool_get(&u[0], &c) != EOK)
+        return 0;
+
+    size_t sent = 0;
+    while (sent < n && http_send_request(c, &u[sent], NULL) == EOK)
+        sent++;
+
+    http_head_t *head = malloc(sizeof(http_head_t));
+    size_t answered = 0;
+    bool clean = head != NULL;
+    while (clean && answered < sent) {
+        if (http_read_head(c, head) != EOK) {
+            clean = false;
+            break;
+        }
+
+        http_response_t *r = &out[answered];
+        http_buffer_t b = { 0 };
+        bool redirect = http_is_redirect(head->status) && head->location[0];
+        errno_t rc = http_read_response_body(c, head, urls[answered], http_buffer_append, &b);
+        if (rc == EOK && redirect) {
+            // Followed one by one afterwards
+            refetch[answered] = true;
+        } else if (rc == EOK) {
+            rc = http_buffer_finish(&b, &r->body, &r->len);
+            r->status = head->status;
+        }
+        free(b.data);
+        r->rc = rc;
+        answered++;
+
+        // A body cut short leaves the connection somewhere mid-response
+        if (rc != EOK || head->close) {
+            clean = false;
+            break;
+        }
+    }
+
+    http_pool_put(c, clean && answered == n);
+    free(head);
+    return answered;
+}
+
+errno_t http_fetch_pipelined(const char *const *urls, size_t count, http_response_t *out)
+{
+    if (!urls || !out)
+        return EINVAL;
+    memset(out, 0, count * sizeof(http_response_t));
+
+    http_url_t *u = malloc(HTTP_FETCH_PIPELINE_DEPTH * sizeof(http_url_t));
+    if (!u)
+        return ENOMEM;
+
+    size_t i = 0;
+    while (i < count) {
+        // Longest same-origin run from i, up to the pipeline depth
+        size_t n = 0;
+        while (i + n < count && n < HTTP_FETCH_PIPELINE_DEPTH) {
+            if (!urls[i + n] || http_url_parse(urls[i + n], &u[n]) != EOK)
+                break;
+            if (n > 0 && !http_same_origin(&u[0], &u[n]))
+                break;
+            // Known to the cache: answered or revalidated on its own
+            if (http_cache_lookup(urls[i + n], NULL) != HTTP_CACHE_MISS)
+                break;
+            n++;
+        }
+
+        bool refetch[HTTP_FETCH_PIPELINE_DEPTH] = { false };
+        size_t answered = 0;
+        if (n > 1)
+            answered = http_pipeline_batch(&urls[i], u, n, &out[i], refetch);
+        if (n == 0)
+            n = 1;
+
+        for (size_t k = 0; k < n; k++) {
+            if (k < answered && !refetch[k])
+                continue;
+            http_response_t *r = &out[i + k];
+            r->rc = urls[i + k] ?
+                http_fetch(urls[i + k], &r->body, &r->len, &r->status) : EINVAL;
+        }
+        i += n;
+    }
+
+    free(u);
+    return EOK;
+}
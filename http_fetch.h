@@ -0,0 +1,88 @@
+// http_fetch.h - HTTP/1.1 GET client with keep-alive connection pooling
+#ifndef HTTP_FETCH_H
+#define HTTP_FETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Responses larger than this are refused
+#define HTTP_FETCH_MAX_BODY (16 * 1024 * 1024)
+
+// Status line plus headers of one response
+#define HTTP_FETCH_MAX_HEAD (64 * 1024)
+
+// Redirects followed before giving up (ELIMIT)
+#define HTTP_FETCH_MAX_REDIRECTS 10
+
+// Requests written back to back on one connection by http_fetch_pipelined()
+#define HTTP_FETCH_PIPELINE_DEPTH 4
+
+// Idle connections kept open: per origin, in all, and for how long
+#define HTTP_POOL_MAX_IDLE_PER_ORIGIN 4
+#define HTTP_POOL_MAX_IDLE 16
+#define HTTP_POOL_IDLE_USEC (30 * 1000000ULL)
+
+// Host sockets: a peer silent for this long fails the fetch (EIO)
+#define HTTP_FETCH_TIMEOUT_SEC 30
+
+#define HTTP_URL_MAX_HOST 256
+#define HTTP_URL_MAX_PATH 2048
+
+typedef struct {
+    bool tls;                       // https
+    char host[HTTP_URL_MAX_HOST];
+    uint16_t port;
+    char path[HTTP_URL_MAX_PATH];   // always starts with '/'
+} http_url_t;
+
+// "http[s]://host[:port][/path]"; EINVAL for anything else
+errno_t http_url_parse(const char *url, http_url_t *out);
+
+// Body bytes in arrival order; anything but EOK aborts the fetch with that code
+typedef errno_t (*http_body_cb_t)(const void *data, size_t len, void *arg);
+
+// GET url, following redirects, and pass the final response body to
+// on_body as it comes off the wire. *status gets the final HTTP status; a
+// non-2xx status is still EOK, the caller decides. final_url and
+// content_type (either may be NULL) get the URL that answered and its
+// Content-Type before the first body byte reaches on_body. Fresh
+// http_cache entries are answered from disk; a 304 to a revalidation
+// delivers the stored body with status 200. gzip and deflate bodies are
+// decoded on the way.
+errno_t http_fetch_stream(const char *url, http_body_cb_t on_body, void *arg,
+    int *status, char *final_url, size_t final_url_size,
+    char *content_type, size_t content_type_size);
+
+// Bring url into the HTTP cache without keeping its body: nothing is
+// sent while a fresh copy is there, and the body only streams into the
+// cache copy. Reading stops past HTTP_CACHE_MAX_ENTRY_BYTES (ELIMIT).
+errno_t http_fetch_warm(const char *url);
+
+// GET url. On EOK *body is a malloc'd, NUL-terminated copy of the response
+// body (*len bytes) and *status the HTTP status code; a non-2xx status is
+// still EOK, the caller decides.
+errno_t http_fetch(const char *url, char **body, size_t *len, int *status);
+
+typedef struct {
+    errno_t rc;
+    int status;
+    char *body;                 // malloc'd, NUL-terminated, on rc == EOK
+    size_t len;
+} http_response_t;
+
+// GET every url, as http_fetch() would. Runs of same-origin URLs share one
+// connection, up to HTTP_FETCH_PIPELINE_DEPTH requests in flight on it;
+// requests the server leaves unanswered are retried one by one. out[i]
+// belongs to urls[i]; EOK unless the arguments are bad.
+errno_t http_fetch_pipelined(const char *const *urls, size_t count, http_response_t *out);
+
+// Pool lock and TLS state; called before the first fetch from more than
+// one thread
+void http_fetch_init(void);
+
+// Close every idle pooled connection, drop the TLS sessions
+void http_fetch_shutdown(void);
+
+#endif // HTTP_FETCH_H
@@ -0,0 +1,242 @@
+// js_bytecode_cache.c - Compiled QuickJS bytecode cache (memory + disk)
+//
+// Every page load used to hand each script's source to JS_Eval, including
+// the built-in DOM test and layout calculator. Scripts are now compiled with
+// JS_EVAL_FLAG_COMPILE_ONLY, serialized with JS_WriteObject and kept in a
+// direct-mapped memory table plus one file per script; later loads of the
+// same text go straight to JS_ReadObject + JS_EvalFunction.
+//
+// JS_ReadObject trusts its input completely, so nothing reaches it that
+// this process did not write for exactly this source on exactly this
+// engine. Key: SHA-256 over the engine digest and the source text. The
+// engine digest is SHA-256 of JS_BYTECODE_ENGINE_VERSION, the pointer size
+// and the bytecode QuickJS writes for a probe script: its first byte is the
+// engine's BC_VERSION, and the rest changes with the opcode set. Files live
+// in a private cache_store directory, which checks key and payload hash
+// before handing anything back.
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "cache_store.h"
+#include "js_bytecode_cache.h"
+
+#define JS_BYTECODE_CACHE_SLOTS 128                 // power of two
+#define JS_BYTECODE_CACHE_MAX_BYTES (8 * 1024 * 1024)
+
+#define JS_BYTECODE_FILE_MAGIC 0x43425150u          // "PQBC"
+
+// Compiled once per engine to fingerprint its bytecode format
+#define JS_BYTECODE_PROBE "function probe(a, b) { return [a + b, `${a}`, {b}]; }"
+
+typedef struct {
+    uint8_t key[SHA256_DIGEST_LEN];
+    uint8_t *bytecode;          // NULL = empty slot
+    size_t bytecode_len;
+} js_bytecode_entry_t;
+
+static js_bytecode_entry_t cache[JS_BYTECODE_CACHE_SLOTS];
+static char *cache_dir = NULL;
+static js_bytecode_cache_stats_t stats;
+
+static uint8_t engine_digest[SHA256_DIGEST_LEN];
+static bool engine_digest_ready = false;
+
+static errno_t js_bytecode_engine_digest(JSContext *ctx)
+{
+    if (engine_digest_ready)
+        return EOK;
+
+    JSValue probe = JS_Eval(ctx, JS_BYTECODE_PROBE, strlen(JS_BYTECODE_PROBE),
+        "<bytecode probe>", JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(probe)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return EIO;
+    }
+    size_t len = 0;
+    uint8_t *written = JS_WriteObject(ctx, &len, probe, JS_WRITE_OBJ_BYTECODE);
+    JS_FreeValue(ctx, probe);
+    if (!written)
+        return ENOMEM;
+
+    uint32_t pointer_size = sizeof(void *);
+    sha256_t h;
+    sha256_init(&h);
+    sha256_update(&h, JS_BYTECODE_ENGINE_VERSION, strlen(JS_BYTECODE_ENGINE_VERSION) + 1);
+    sha256_update(&h, &pointer_size, sizeof(pointer_size));
+    sha256_update(&h, written, len);
+    sha256_final(&h, engine_digest);
+    js_free(ctx, written);
+
+    engine_digest_ready = true;
+    return EOK;
+}
+
+static void js_bytecode_key(const char *source, size_t len, uint8_t key[SHA256_DIGEST_LEN])
+{
+    sha256_t h;
+    sha256_init(&h);
+    sha256_update(&h, engine_digest, sizeof(engine_digest));
+    sha256_update(&h, source, len);
+    sha256_final(&h, key);
+}
+
+errno_t js_bytecode_cache_init(const char *dir)
+{
+    js_bytecode_cache_cleanup();
+
+    if (dir) {
+        size_t len = strlen(dir);
+        cache_dir = malloc(len + 2);
+        if (!cache_dir)
+            return ENOMEM;
+        memcpy(cache_dir, dir, len);
+        // Always end with a separator
+        if (len == 0 || dir[len - 1] != '/')
+            cache_dir[len++] = '/';
+        cache_dir[len] = '\0';
+    }
+    return EOK;
+}
+
+void js_bytecode_cache_cleanup(void)
+{
+    for (size_t i = 0; i < JS_BYTECODE_CACHE_SLOTS; i++) {
+        free(cache[i].bytecode);
+        cache[i].bytecode = NULL;
+    }
+    free(cache_dir);
+    cache_dir = NULL;
+    memset(&stats, 0, sizeof(stats));
+}
+
+js_bytecode_cache_stats_t js_bytecode_cache_stats(void)
+{
+    return stats;
+}
+
+// ===== Memory table =====
+
+static js_bytecode_entry_t *js_bytecode_slot(const uint8_t key[SHA256_DIGEST_LEN])
+{
+    return &cache[key[0] & (JS_BYTECODE_CACHE_SLOTS - 1)];
+}
+
+static void js_bytecode_drop(js_bytecode_entry_t *e)
+{
+    if (!e->bytecode)
+        return;
+    stats.memory_bytes -= e->bytecode_len;
+    free(e->bytecode);
+    e->bytecode = NULL;
+    e->bytecode_len = 0;
+}
+
+// Takes ownership of bytecode
+static void js_bytecode_remember(const uint8_t key[SHA256_DIGEST_LEN],
+    uint8_t *bytecode, size_t bytecode_len)
+{
+    js_bytecode_entry_t *e = js_bytecode_slot(key);
+    js_bytecode_drop(e);
+
+    if (stats.memory_bytes + bytecode_len > JS_BYTECODE_CACHE_MAX_BYTES) {
+        free(bytecode);
+        return;
+    }
+
+    memcpy(e->key, key, SHA256_DIGEST_LEN);
+    e->bytecode = bytecode;
+    e->bytecode_len = bytecode_len;
+    stats.memory_bytes += bytecode_len;
+}
+
+static void js_bytecode_forget(const uint8_t key[SHA256_DIGEST_LEN])
+{
+    js_bytecode_entry_t *e = js_bytecode_slot(key);
+    if (e->bytecode && memcmp(e->key, key, SHA256_DIGEST_LEN) == 0)
+        js_bytecode_drop(e);
+
+    if (cache_dir)
+        cache_store_remove(cache_dir, key);
+}
+
+// ===== Eval =====
+
+static JSValue js_bytecode_read(JSContext *ctx, const uint8_t *bytecode, size_t len)
+{
+    JSValue obj = JS_ReadObject(ctx, bytecode, len, JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(obj)) {
+        // Should not happen with a verified entry: discard it, recompile
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return JS_UNDEFINED;
+    }
+    return obj;
+}
+
+JSValue js_bytecode_eval(JSContext *ctx, const char *source, size_t len,
+    const char *filename)
+{
+    if (len < JS_BYTECODE_CACHE_MIN_SOURCE || js_bytecode_engine_digest(ctx) != EOK)
+        return JS_Eval(ctx, source, len, filename, JS_EVAL_TYPE_GLOBAL);
+
+    uint8_t key[SHA256_DIGEST_LEN];
+    js_bytecode_key(source, len, key);
+    JSValue func = JS_UNDEFINED;
+    bool stale = false;
+
+    js_bytecode_entry_t *e = js_bytecode_slot(key);
+    if (e->bytecode && memcmp(e->key, key, SHA256_DIGEST_LEN) == 0) {
+        func = js_bytecode_read(ctx, e->bytecode, e->bytecode_len);
+        if (!JS_IsUndefined(func))
+            stats.memory_hits++;
+        else
+            stale = true;
+    } else if (cache_dir) {
+        uint8_t *bytecode = NULL;
+        size_t bytecode_len = 0;
+        errno_t rc = cache_store_get(cache_dir, JS_BYTECODE_FILE_MAGIC, key,
+            JS_BYTECODE_CACHE_MAX_BYTES, &bytecode, &bytecode_len);
+        if (rc == EOK) {
+            func = js_bytecode_read(ctx, bytecode, bytecode_len);
+            if (!JS_IsUndefined(func)) {
+                stats.disk_hits++;
+                js_bytecode_remember(key, bytecode, bytecode_len);
+            } else {
+                free(bytecode);
+                stale = true;
+            }
+        } else if (rc == EIO) {
+            // cache_store has already removed it
+            stats.stale++;
+        }
+    }
+
+    if (JS_IsUndefined(func)) {
+        if (stale) {
+            stats.stale++;
+            js_bytecode_forget(key);
+        }
+        stats.misses++;
+
+        func = JS_Eval(ctx, source, len, filename,
+            JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+        if (JS_IsException(func))
+            return func;
+
+        size_t bytecode_len = 0;
+        uint8_t *written = JS_WriteObject(ctx, &bytecode_len, func, JS_WRITE_OBJ_BYTECODE);
+        if (written) {
+            if (cache_dir && bytecode_len <= JS_BYTECODE_CACHE_MAX_BYTES)
+                cache_store_put(cache_dir, JS_BYTECODE_FILE_MAGIC, key, written, bytecode_len);
+            uint8_t *copy = malloc(bytecode_len);
+            if (copy) {
+                memcpy(copy, written, bytecode_len);
+                js_bytecode_remember(key, copy, bytecode_len);
+            }
+            js_free(ctx, written);
+        }
+    }
+
+    // Runs and frees the function object
+    return JS_EvalFunction(ctx, func);
+}
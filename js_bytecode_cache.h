@@ -0,0 +1,46 @@
+// js_bytecode_cache.h - Compiled QuickJS bytecode cache (memory + disk)
+#ifndef JS_BYTECODE_CACHE_H
+#define JS_BYTECODE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "quickjs.h"
+
+// Name of the on-disk cache, see cache_store_dir()
+#define JS_BYTECODE_CACHE_NAME "js"
+
+// Scripts shorter than this are cheaper to parse than to look up
+#define JS_BYTECODE_CACHE_MIN_SOURCE 256
+
+// Mixed into every key with the bytecode QuickJS itself writes for a
+// probe script, which already changes with the engine version. Bump when
+// anything else that changes the emitted bytecode changes (JS_EVAL
+// flags). The build may override it.
+#ifndef JS_BYTECODE_ENGINE_VERSION
+#define JS_BYTECODE_ENGINE_VERSION "quickjs-1"
+#endif
+
+typedef struct {
+    unsigned memory_hits;
+    unsigned disk_hits;
+    unsigned misses;
+    unsigned stale;             // entries rejected on load
+    size_t memory_bytes;
+} js_bytecode_cache_stats_t;
+
+// dir: private directory for the on-disk copies (cache_store_dir()),
+// NULL = memory only
+errno_t js_bytecode_cache_init(const char *dir);
+void js_bytecode_cache_cleanup(void);
+
+// Drop-in for JS_Eval(ctx, source, len, filename, JS_EVAL_TYPE_GLOBAL):
+// compiles once, then runs the cached bytecode on later calls with the
+// same source text
+JSValue js_bytecode_eval(JSContext *ctx, const char *source, size_t len,
+    const char *filename);
+
+js_bytecode_cache_stats_t js_bytecode_cache_stats(void);
+
+#endif // JS_BYTECODE_CACHE_H
@@ -0,0 +1,654 @@
+// js_element.c - QuickJS Element / CSSStyleDeclaration wrappers over lexbor nodes
+//
+// getElementById used to build a fresh plain object per call and copy id,
+// tagName and the whole textContent into it up front. Elements are now a
+// JSClass whose getters read lexbor only when a script asks, and each node
+// has at most one live wrapper: a weak node -> object cache returns the same
+// object on repeated lookups and forgets it when QuickJS finalizes it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "js_element.h"
+#include "js_executor_quickjs.h"
+#include "layout_engine.h"
+#include "dom_id_index.h"
+#include "style_mutation.h"
+#include "event_handler.h"
+
+#define JS_ELEMENT_CACHE_MIN 64
+
+static JSClassID js_element_class_id;
+static JSClassID js_style_class_id;
+
+// element.style: keeps the element's wrapper alive, never the raw element
+typedef struct {
+    JSValue element;
+} js_style_ref_t;
+
+// ===== Weak node -> wrapper cache =====
+//
+// Values are stored without a reference: the cache never keeps a wrapper
+// alive, the finalizer removes the slot.
+
+typedef struct {
+    lxb_dom_element_t *element;     // NULL = empty
+    JSValue wrapper;
+} js_element_slot_t;
+
+static js_element_slot_t *cache = NULL;
+static size_t cache_capacity = 0;
+static size_t cache_count = 0;
+
+static size_t js_element_hash(const lxb_dom_element_t *element)
+{
+    uintptr_t p = (uintptr_t)element;
+    p ^= p >> 17;
+    p *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (size_t)(p ^ (p >> 29));
+}
+
+static js_element_slot_t *js_element_cache_find(const lxb_dom_element_t *element)
+{
+    if (!cache)
+        return NULL;
+
+    size_t mask = cache_capacity - 1;
+    for (size_t i = js_element_hash(element) & mask; cache[i].element; i = (i + 1) & mask) {
+        if (cache[i].element == element)
+            return &cache[i];
+    }
+    return NULL;
+}
+
+static bool js_element_cache_grow(void)
+{
+    size_t new_capacity = cache_capacity ? cache_capacity * 2 : JS_ELEMENT_CACHE_MIN;
+    js_element_slot_t *slots = calloc(new_capacity, sizeof(js_element_slot_t));
+    if (!slots)
+        return false;
+
+    for (size_t i = 0; i < cache_capacity; i++) {
+        if (!cache[i].element)
+            continue;
+        size_t j = js_element_hash(cache[i].element) & (new_capacity - 1);
+        while (slots[j].element)
+            j = (j + 1) & (new_capacity - 1);
+        slots[j] = cache[i];
+    }
+
+    free(cache);
+    cache = slots;
+    cache_capacity = new_capacity;
+    return true;
+}
+
+// Every live wrapper must be in the cache, or it could not be cut loose from
+// its element when the node is destroyed
+static bool js_element_cache_put(lxb_dom_element_t *element, JSValue wrapper)
+{
+    if ((cache_count + 1) * 4 > cache_capacity * 3 && !js_element_cache_grow())
+        return false;
+
+    size_t mask = cache_capacity - 1;
+    size_t i = js_element_hash(element) & mask;
+    while (cache[i].element)
+        i = (i + 1) & mask;
+
+    cache[i].element = element;
+    cache[i].wrapper = wrapper;
+    cache_count++;
+    return true;
+}
+
+// Linear probing delete with backward shift, no tombstones
+static void js_element_cache_remove(lxb_dom_element_t *element)
+{
+    js_element_slot_t *slot = js_element_cache_find(element);
+    if (!slot)
+        return;
+
+    size_t mask = cache_capacity - 1;
+    size_t hole = (size_t)(slot - cache);
+    size_t i = hole;
+
+    for (;;) {
+        i = (i + 1) & mask;
+        if (!cache[i].element)
+            break;
+        size_t home = js_element_hash(cache[i].element) & mask;
+        // Move the entry back if the hole lies on its probe path
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            cache[hole] = cache[i];
+            hole = i;
+        }
+    }
+
+    cache[hole].element = NULL;
+    cache_count--;
+
+    if (cache_count == 0) {
+        free(cache);
+        cache = NULL;
+        cache_capacity = 0;
+    }
+}
+
+size_t js_element_cache_count(void)
+{
+    return cache_count;
+}
+
+static void js_element_finalizer(JSRuntime *rt, JSValue val)
+{
+    lxb_dom_element_t *element = JS_GetOpaque(val, js_element_class_id);
+    if (element)
+        js_element_cache_remove(element);
+}
+
+// The element is about to be destroyed: its wrapper (if a script still holds
+// one) is detached, so later accesses throw instead of touching freed memory
+static void js_element_forget(lxb_dom_element_t *element)
+{
+    js_element_slot_t *slot = js_element_cache_find(element);
+    if (!slot)
+        return;
+
+    JS_SetOpaque(slot->wrapper, NULL);
+    js_element_cache_remove(element);
+}
+
+// Pre-order walk over the element descendants of root (root excluded),
+// dropping every per-element record that outlives a node
+static void js_element_forget_descendants(lxb_dom_node_t *root)
+{
+    lxb_dom_node_t *node = lxb_dom_node_first_child(root);
+
+    while (node) {
+        if (node->type == LXB_DOM_NODE_TYPE_ELEMENT) {
+            lxb_dom_element_t *element = lxb_dom_interface_element(node);
+            js_element_forget(element);
+            style_mutation_forget(element, true);
+            event_handler_forget_element(element);
+        }
+
+        lxb_dom_node_t *next = lxb_dom_node_first_child(node);
+        while (!next && node != root) {
+            next = lxb_dom_node_next(node);
+            if (!next)
+                node = lxb_dom_node_parent(node);
+        }
+        node = (node == root) ? NULL : next;
+    }
+}
+
+errno_t js_element_set_attribute_value(lxb_dom_element_t *element,
+    const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    errno_t rc = dom_id_index_set_attribute(element, name, name_len, value, value_len);
+
+    // A new style attribute replaces the declarations scripts made
+    if (rc == EOK && name_len == 5 && memcmp(name, "style", 5) == 0)
+        style_mutation_forget(element, false);
+    return rc;
+}
+
+void js_element_set_text(lxb_dom_element_t *element, const char *text, size_t len)
+{
+    lxb_dom_node_t *node = lxb_dom_interface_node(element);
+
+    // lexbor destroys the old children; nothing may keep pointing at them
+    js_element_forget_descendants(node);
+    dom_id_index_remove_subtree(node, true);
+
+    lxb_dom_node_text_content_set(node, (const lxb_char_t *)text, len);
+}
+
+// ===== Helpers =====
+
+static lxb_dom_element_t *js_this_element(JSContext *ctx, JSValueConst this_val)
+{
+    return JS_GetOpaque2(ctx, this_val, js_element_class_id);
+}
+
+static JSValue js_new_string_len(JSContext *ctx, const lxb_char_t *str, size_t len)
+{
+    if (!str)
+        return JS_NewString(ctx, "");
+    return JS_NewStringLen(ctx, (const char *)str, len);
+}
+
+// ===== Element getters / setters =====
+
+static JSValue js_element_get_id(JSContext *ctx, JSValueConst this_val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    size_t len = 0;
+    const lxb_char_t *id = lxb_dom_element_id(element, &len);
+    return js_new_string_len(ctx, id, len);
+}
+
+static JSValue js_element_set_id(JSContext *ctx, JSValueConst this_val, JSValueConst val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    size_t len;
+    const char *id = JS_ToCStringLen(ctx, &len, val);
+    if (!id) return JS_EXCEPTION;
+
+    dom_id_index_set_attribute(element, "id", 2, id, len);
+    JS_FreeCString(ctx, id);
+    return JS_UNDEFINED;
+}
+
+static JSValue js_element_get_tag_name(JSContext *ctx, JSValueConst this_val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    // DOM tagName is upper case for HTML elements
+    size_t len = 0;
+    const lxb_char_t *name = lxb_dom_element_local_name(element, &len);
+    char tag[32];
+    if (!name || len == 0 || len >= sizeof(tag))
+        return js_new_string_len(ctx, name, len);
+
+    for (size_t i = 0; i < len; i++) {
+        char c = (char)name[i];
+        tag[i] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+    }
+    return JS_NewStringLen(ctx, tag, len);
+}
+
+static JSValue js_element_get_node_type(JSContext *ctx, JSValueConst this_val)
+{
+    return JS_NewInt32(ctx, 1);     // ELEMENT_NODE
+}
+
+static JSValue js_element_get_text_content(JSContext *ctx, JSValueConst this_val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    lxb_dom_node_t *node = lxb_dom_interface_node(element);
+    size_t len = 0;
+    lxb_char_t *text = lxb_dom_node_text_content(node, &len);
+    JSValue result = js_new_string_len(ctx, text, len);
+    if (text)
+        lxb_dom_document_destroy_text(node->owner_document, text);
+    return result;
+}
+
+static JSValue js_element_set_text_content(JSContext *ctx, JSValueConst this_val,
+    JSValueConst val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    size_t len;
+    const char *text = JS_ToCStringLen(ctx, &len, val);
+    if (!text) return JS_EXCEPTION;
+
+    js_element_set_text(element, text, len);
+    JS_FreeCString(ctx, text);
+    return JS_UNDEFINED;
+}
+
+static JSValue js_element_get_class_name(JSContext *ctx, JSValueConst this_val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    size_t len = 0;
+    const lxb_char_t *cls = lxb_dom_element_class(element, &len);
+    return js_new_string_len(ctx, cls, len);
+}
+
+static JSValue js_element_set_class_name(JSContext *ctx, JSValueConst this_val,
+    JSValueConst val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    size_t len;
+    const char *cls = JS_ToCStringLen(ctx, &len, val);
+    if (!cls) return JS_EXCEPTION;
+
+    dom_id_index_set_attribute(element, "class", 5, cls, len);
+    JS_FreeCString(ctx, cls);
+    return JS_UNDEFINED;
+}
+
+static JSValue js_element_get_children(JSContext *ctx, JSValueConst this_val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    JSValue arr = JS_NewArray(ctx);
+    uint32_t index = 0;
+    lxb_dom_node_t *child = lxb_dom_node_first_child(lxb_dom_interface_node(element));
+    while (child) {
+        if (child->type == LXB_DOM_NODE_TYPE_ELEMENT) {
+            JS_SetPropertyUint32(ctx, arr, index++,
+                js_element_wrap(ctx, lxb_dom_interface_element(child)));
+        }
+        child = lxb_dom_node_next(child);
+    }
+    return arr;
+}
+
+static JSValue js_element_get_parent(JSContext *ctx, JSValueConst this_val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    lxb_dom_node_t *parent = lxb_dom_node_parent(lxb_dom_interface_node(element));
+    if (!parent || parent->type != LXB_DOM_NODE_TYPE_ELEMENT)
+        return JS_NULL;
+    return js_element_wrap(ctx, lxb_dom_interface_element(parent));
+}
+
+static JSValue js_element_get_style(JSContext *ctx, JSValueConst this_val)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    // The declaration reaches its element through the wrapper, so it stops
+    // working together with the wrapper when the element is destroyed
+    js_style_ref_t *ref = js_mallocz(ctx, sizeof(js_style_ref_t));
+    if (!ref) return JS_EXCEPTION;
+
+    JSValue style = JS_NewObjectClass(ctx, js_style_class_id);
+    if (JS_IsException(style)) {
+        js_free(ctx, ref);
+        return style;
+    }
+    ref->element = JS_DupValue(ctx, this_val);
+    JS_SetOpaque(style, ref);
+    return style;
+}
+
+static JSValue js_element_get_attribute(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+    if (argc < 1) return JS_NULL;
+
+    size_t name_len;
+    const char *name = JS_ToCStringLen(ctx, &name_len, argv[0]);
+    if (!name) return JS_EXCEPTION;
+
+    size_t len = 0;
+    const lxb_char_t *value = lxb_dom_element_get_attribute(element,
+        (const lxb_char_t *)name, name_len, &len);
+    JS_FreeCString(ctx, name);
+
+    if (!value)
+        return JS_NULL;
+    return JS_NewStringLen(ctx, (const char *)value, len);
+}
+
+static JSValue js_element_set_attribute(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+    if (argc < 2) return JS_UNDEFINED;
+
+    size_t name_len, value_len;
+    const char *name = JS_ToCStringLen(ctx, &name_len, argv[0]);
+    const char *value = JS_ToCStringLen(ctx, &value_len, argv[1]);
+    if (name && value)
+        js_element_set_attribute_value(element, name, name_len, value, value_len);
+
+    if (name) JS_FreeCString(ctx, name);
+    if (value) JS_FreeCString(ctx, value);
+    return JS_UNDEFINED;
+}
+
+// Third argument: a boolean or { capture: bool }
+static bool js_listener_capture(JSContext *ctx, int argc, JSValueConst *argv)
+{
+    if (argc < 3)
+        return false;
+    if (JS_IsObject(argv[2])) {
+        JSValue capture = JS_GetPropertyStr(ctx, argv[2], "capture");
+        bool set = JS_ToBool(ctx, capture) > 0;
+        JS_FreeValue(ctx, capture);
+        return set;
+    }
+    return JS_ToBool(ctx, argv[2]) > 0;
+}
+
+static JSValue js_element_add_event_listener(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+    if (argc < 2 || !JS_IsFunction(ctx, argv[1])) return JS_UNDEFINED;
+
+    const char *type = JS_ToCString(ctx, argv[0]);
+    if (!type) return JS_EXCEPTION;
+    event_handler_add_listener(ctx, element, type, argv[1], js_listener_capture(ctx, argc, argv));
+    JS_FreeCString(ctx, type);
+    return JS_UNDEFINED;
+}
+
+static JSValue js_element_remove_event_listener(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+    if (argc < 2) return JS_UNDEFINED;
+
+    const char *type = JS_ToCString(ctx, argv[0]);
+    if (!type) return JS_EXCEPTION;
+    event_handler_remove_listener(ctx, element, type, argv[1], js_listener_capture(ctx, argc, argv));
+    JS_FreeCString(ctx, type);
+    return JS_UNDEFINED;
+}
+
+// dispatchEvent("type") or dispatchEvent({ type: "..." })
+static JSValue js_element_dispatch_event(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+    if (argc < 1) return JS_FALSE;
+
+    JSValue type_val = JS_IsObject(argv[0]) ? JS_GetPropertyStr(ctx, argv[0], "type")
+                                            : JS_DupValue(ctx, argv[0]);
+    const char *type = JS_ToCString(ctx, type_val);
+    JS_FreeValue(ctx, type_val);
+    if (!type) return JS_EXCEPTION;
+
+    bool not_prevented = event_handler_dispatch(ctx, element, type);
+    JS_FreeCString(ctx, type);
+    return JS_NewBool(ctx, not_prevented);
+}
+
+static JSValue js_element_click(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    (void)argc; (void)argv;
+    lxb_dom_element_t *element = js_this_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    event_handler_dispatch(ctx, element, "click");
+    return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry js_element_proto_funcs[] = {
+    JS_CGETSET_DEF("id", js_element_get_id, js_element_set_id),
+    JS_CGETSET_DEF("tagName", js_element_get_tag_name, NULL),
+    JS_CGETSET_DEF("nodeType", js_element_get_node_type, NULL),
+    JS_CGETSET_DEF("textContent", js_element_get_text_content, js_element_set_text_content),
+    JS_CGETSET_DEF("innerText", js_element_get_text_content, js_element_set_text_content),
+    JS_CGETSET_DEF("className", js_element_get_class_name, js_element_set_class_name),
+    JS_CGETSET_DEF("children", js_element_get_children, NULL),
+    JS_CGETSET_DEF("parentElement", js_element_get_parent, NULL),
+    JS_CGETSET_DEF("style", js_element_get_style, NULL),
+    JS_CFUNC_DEF("getAttribute", 1, js_element_get_attribute),
+    JS_CFUNC_DEF("setAttribute", 2, js_element_set_attribute),
+    JS_CFUNC_DEF("addEventListener", 2, js_element_add_event_listener),
+    JS_CFUNC_DEF("removeEventListener", 2, js_element_remove_event_listener),
+    JS_CFUNC_DEF("dispatchEvent", 1, js_element_dispatch_event),
+    JS_CFUNC_DEF("click", 0, js_element_click),
+};
+
+// ===== element.style =====
+
+// CSS property per getset magic, in the order of js_style_proto_funcs
+static const char *const js_style_css_names[] = {
+    "color", "background-color", "background", "display", "visibility",
+    "position", "left", "top", "width", "height", "margin", "padding",
+    "border", "font-size", "font-weight", "font-style", "font-family",
+    "text-align", "text-decoration",
+};
+
+static lxb_dom_element_t *js_style_element(JSContext *ctx, JSValueConst this_val)
+{
+    js_style_ref_t *ref = JS_GetOpaque2(ctx, this_val, js_style_class_id);
+    if (!ref) return NULL;
+    return js_this_element(ctx, ref->element);
+}
+
+static JSValue js_style_get(JSContext *ctx, JSValueConst this_val, int magic)
+{
+    lxb_dom_element_t *element = js_style_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    // A queued write wins over the (not yet rewritten) style attribute
+    const char *css_name = js_style_css_names[magic];
+    const char *queued = style_mutation_get(element,
+        style_mutation_property_id(css_name, strlen(css_name)));
+    if (queued)
+        return JS_NewString(ctx, queued);
+
+    // Inline style only, like CSSStyleDeclaration on element.style
+    char *value = (char *)get_css_property(element, css_name, NULL);
+    JSValue result = JS_NewString(ctx, value ? value : "");
+    free(value);
+    return result;
+}
+
+static JSValue js_style_set(JSContext *ctx, JSValueConst this_val, JSValueConst val, int magic)
+{
+    lxb_dom_element_t *element = js_style_element(ctx, this_val);
+    if (!element) return JS_EXCEPTION;
+
+    const char *value = JS_ToCString(ctx, val);
+    if (!value) return JS_EXCEPTION;
+
+    js_style_set_property(element, js_style_css_names[magic], value);
+    JS_FreeCString(ctx, value);
+    return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry js_style_proto_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("color", js_style_get, js_style_set, 0),
+    JS_CGETSET_MAGIC_DEF("backgroundColor", js_style_get, js_style_set, 1),
+    JS_CGETSET_MAGIC_DEF("background", js_style_get, js_style_set, 2),
+    JS_CGETSET_MAGIC_DEF("display", js_style_get, js_style_set, 3),
+    JS_CGETSET_MAGIC_DEF("visibility", js_style_get, js_style_set, 4),
+    JS_CGETSET_MAGIC_DEF("position", js_style_get, js_style_set, 5),
+    JS_CGETSET_MAGIC_DEF("left", js_style_get, js_style_set, 6),
+    JS_CGETSET_MAGIC_DEF("top", js_style_get, js_style_set, 7),
+    JS_CGETSET_MAGIC_DEF("width", js_style_get, js_style_set, 8),
+    JS_CGETSET_MAGIC_DEF("height", js_style_get, js_style_set, 9),
+    JS_CGETSET_MAGIC_DEF("margin", js_style_get, js_style_set, 10),
+    JS_CGETSET_MAGIC_DEF("padding", js_style_get, js_style_set, 11),
+    JS_CGETSET_MAGIC_DEF("border", js_style_get, js_style_set, 12),
+    JS_CGETSET_MAGIC_DEF("fontSize", js_style_get, js_style_set, 13),
+    JS_CGETSET_MAGIC_DEF("fontWeight", js_style_get, js_style_set, 14),
+    JS_CGETSET_MAGIC_DEF("fontStyle", js_style_get, js_style_set, 15),
+    JS_CGETSET_MAGIC_DEF("fontFamily", js_style_get, js_style_set, 16),
+    JS_CGETSET_MAGIC_DEF("textAlign", js_style_get, js_style_set, 17),
+    JS_CGETSET_MAGIC_DEF("textDecoration", js_style_get, js_style_set, 18),
+};
+
+// ===== Registration =====
+
+static JSClassDef js_element_class = {
+    .class_name = "HTMLElement",
+    .finalizer = js_element_finalizer,
+};
+
+static void js_style_finalizer(JSRuntime *rt, JSValue val)
+{
+    js_style_ref_t *ref = JS_GetOpaque(val, js_style_class_id);
+    if (ref) {
+        JS_FreeValueRT(rt, ref->element);
+        js_free_rt(rt, ref);
+    }
+}
+
+static void js_style_gc_mark(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func)
+{
+    js_style_ref_t *ref = JS_GetOpaque(val, js_style_class_id);
+    if (ref)
+        JS_MarkValue(rt, ref->element, mark_func);
+}
+
+static JSClassDef js_style_class = {
+    .class_name = "CSSStyleDeclaration",
+    .finalizer = js_style_finalizer,
+    .gc_mark = js_style_gc_mark,
+};
+
+void js_element_init(JSContext *ctx)
+{
+    JSRuntime *rt = JS_GetRuntime(ctx);
+
+    if (js_element_class_id == 0) {
+        JS_NewClassID(&js_element_class_id);
+        JS_NewClassID(&js_style_class_id);
+    }
+
+    if (!JS_IsRegisteredClass(rt, js_element_class_id)) {
+        JS_NewClass(rt, js_element_class_id, &js_element_class);
+        JS_NewClass(rt, js_style_class_id, &js_style_class);
+    }
+
+    JSValue proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, proto, js_element_proto_funcs,
+        sizeof(js_element_proto_funcs) / sizeof(js_element_proto_funcs[0]));
+    JS_SetClassProto(ctx, js_element_class_id, proto);
+
+    JSValue style_proto = JS_NewObject(ctx);
+    JS_SetPropertyFunctionList(ctx, style_proto, js_style_proto_funcs,
+        sizeof(js_style_proto_funcs) / sizeof(js_style_proto_funcs[0]));
+    JS_SetClassProto(ctx, js_style_class_id, style_proto);
+}
+
+JSValue js_element_wrap(JSContext *ctx, lxb_dom_element_t *element)
+{
+    if (!element)
+        return JS_NULL;
+
+    js_element_slot_t *slot = js_element_cache_find(element);
+    if (slot)
+        return JS_DupValue(ctx, slot->wrapper);
+
+    JSValue obj = JS_NewObjectClass(ctx, js_element_class_id);
+    if (JS_IsException(obj))
+        return obj;
+
+    if (!js_element_cache_put(element, obj)) {
+        JS_FreeValue(ctx, obj);
+        return JS_ThrowOutOfMemory(ctx);
+    }
+    JS_SetOpaque(obj, element);
+    return obj;
+}
+
+lxb_dom_element_t *js_element_unwrap(JSValueConst value)
+{
+    return JS_GetOpaque(value, js_element_class_id);
+}
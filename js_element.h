@@ -0,0 +1,33 @@
+// js_element.h - QuickJS Element / CSSStyleDeclaration wrappers over lexbor nodes
+#ifndef JS_ELEMENT_H
+#define JS_ELEMENT_H
+
+#include <errno.h>
+#include "quickjs.h"
+#include <lexbor/html/html.h>
+#include <lexbor/dom/dom.h>
+
+// Register the classes on ctx's runtime (once) and their prototypes on ctx
+void js_element_init(JSContext *ctx);
+
+// Wrapper for element: the same JS object for as long as a script holds
+// it, JS_NULL for a NULL element
+JSValue js_element_wrap(JSContext *ctx, lxb_dom_element_t *element);
+
+// Unwrap a value made by js_element_wrap(), NULL for anything else
+lxb_dom_element_t *js_element_unwrap(JSValueConst value);
+
+// setAttribute() for scripts: keeps the id index in sync, and a new style
+// attribute drops the element's script style writes
+errno_t js_element_set_attribute_value(lxb_dom_element_t *element,
+    const char *name, size_t name_len, const char *value, size_t value_len);
+
+// Replace element's children with one text node (textContent). Wrappers,
+// id index entries and everything else pointing at the old descendants are
+// invalidated before lexbor destroys them.
+void js_element_set_text(lxb_dom_element_t *element, const char *text, size_t len);
+
+// Number of live wrappers (debug)
+size_t js_element_cache_count(void);
+
+#endif // JS_ELEMENT_H
@@ -0,0 +1,485 @@
+// js_event_loop.c - Timers, microtasks and requestAnimationFrame for the page
+//
+// setTimeout/setInterval used to be no-op mocks and requestRender only
+// logged, so nothing a page scheduled ever ran. Timers now live in a binary
+// min-heap ordered by due time (FIFO among equal times); every callback is
+// followed by a microtask checkpoint (JS_ExecutePendingJob). rAF callbacks,
+// the style-mutation flush and at most one layout+paint happen per frame.
+// The loop never waits by itself: js_event_loop_tick() returns when it next
+// needs to run and the owner (the UI timer fibril, or js_event_loop_run on
+// the host) sleeps until then.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "js_event_loop.h"
+#include "js_executor_quickjs.h"
+#include "style_mutation.h"
+#include "pauk_sync.h"
+
+// Keep one tick short so input stays responsive; the rest runs next tick
+#define JS_EVENT_LOOP_MAX_TIMERS_PER_TICK 64
+
+typedef struct {
+    uint32_t id;
+    uint64_t due;
+    uint64_t interval;          // as asked for, before the clamp
+    bool repeat;                // setInterval
+    unsigned nesting;           // timer nesting level of its callback
+    uint64_t seq;
+    bool cancelled;             // cleared while its callback runs
+    JSValue func;
+    int argc;
+    JSValue *argv;
+} js_timer_t;
+
+typedef struct {
+    uint32_t id;
+    bool cancelled;             // in the running batch, not to be called
+    JSValue func;
+} js_raf_t;
+
+static JSContext *loop_ctx = NULL;
+
+static js_timer_t **heap = NULL;
+static size_t heap_count = 0;
+static size_t heap_capacity = 0;
+static uint32_t next_timer_id = 1;
+static uint64_t next_seq = 0;
+static js_timer_t *running_timer = NULL;
+
+static js_raf_t *raf_list = NULL;
+static size_t raf_count = 0;
+static size_t raf_capacity = 0;
+static uint32_t next_raf_id = 1;
+static js_raf_t *raf_batch = NULL;          // callbacks of the running frame
+static size_t raf_batch_count = 0;
+
+static bool frame_requested = false;
+static uint64_t last_frame = 0;
+static uint64_t time_origin = 0;
+
+static js_frame_cb_t frame_cb = NULL;
+static void *frame_cb_arg = NULL;
+static js_wake_cb_t wake_cb = NULL;
+static void *wake_cb_arg = NULL;
+static bool in_tick = false;
+
+static void js_event_loop_wake(void)
+{
+    if (wake_cb && !in_tick)
+        wake_cb(wake_cb_arg);
+}
+
+// ===== Timer heap =====
+
+static bool timer_before(const js_timer_t *a, const js_timer_t *b)
+{
+    return a->due < b->due || (a->due == b->due && a->seq < b->seq);
+}
+
+static void heap_sift_up(size_t i)
+{
+    js_timer_t *t = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!timer_before(t, heap[parent]))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = t;
+}
+
+static void heap_sift_down(size_t i)
+{
+    js_timer_t *t = heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= heap_count)
+            break;
+        if (child + 1 < heap_count && timer_before(heap[child + 1], heap[child]))
+            child++;
+        if (!timer_before(heap[child], t))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = t;
+}
+
+static bool heap_push(js_timer_t *t)
+{
+    if (heap_count == heap_capacity) {
+        size_t cap = heap_capacity ? heap_capacity * 2 : 16;
+        js_timer_t **grown = realloc(heap, cap * sizeof(js_timer_t *));
+        if (!grown)
+            return false;
+        heap = grown;
+        heap_capacity = cap;
+    }
+    t->seq = next_seq++;
+    heap[heap_count++] = t;
+    heap_sift_up(heap_count - 1);
+    return true;
+}
+
+static js_timer_t *heap_remove_at(size_t i)
+{
+    js_timer_t *t = heap[i];
+    heap[i] = heap[--heap_count];
+    if (i < heap_count) {
+        heap_sift_down(i);
+        heap_sift_up(i);
+    }
+    return t;
+}
+
+// Short delays get the clamp only past JS_EVENT_LOOP_CLAMP_NESTING levels
+static uint64_t timer_clamp(uint64_t delay, unsigned nesting)
+{
+    if (nesting > JS_EVENT_LOOP_CLAMP_NESTING && delay < JS_EVENT_LOOP_MIN_REPEAT_USEC)
+        return JS_EVENT_LOOP_MIN_REPEAT_USEC;
+    return delay;
+}
+
+static void timer_free(js_timer_t *t)
+{
+    JS_FreeValue(loop_ctx, t->func);
+    for (int i = 0; i < t->argc; i++)
+        JS_FreeValue(loop_ctx, t->argv[i]);
+    free(t->argv);
+    free(t);
+}
+
+// ===== JS API =====
+
+static JSValue js_add_timer(JSContext *ctx, int argc, JSValueConst *argv, bool repeat)
+{
+    if (argc < 1 || !JS_IsFunction(ctx, argv[0])) {
+        // String callbacks are eval in disguise; not supported
+        printf("JS: %s needs a function\n", repeat ? "setInterval" : "setTimeout");
+        return JS_NewInt32(ctx, 0);
+    }
+
+    double delay_ms = 0;
+    if (argc > 1)
+        JS_ToFloat64(ctx, &delay_ms, argv[1]);
+    if (!(delay_ms > 0))
+        delay_ms = 0;
+    if (delay_ms > 2147483647.0)
+        delay_ms = 2147483647.0;
+
+    uint64_t delay = (uint64_t)(delay_ms * 1000);
+    // A timer set from a timer callback is one level deeper than it
+    unsigned nesting = running_timer ? running_timer->nesting : 0;
+
+    js_timer_t *t = calloc(1, sizeof(js_timer_t));
+    if (!t)
+        return JS_ThrowOutOfMemory(ctx);
+
+    t->argc = argc > 2 ? argc - 2 : 0;
+    if (t->argc > 0) {
+        t->argv = calloc((size_t)t->argc, sizeof(JSValue));
+        if (!t->argv) {
+            free(t);
+            return JS_ThrowOutOfMemory(ctx);
+        }
+        for (int i = 0; i < t->argc; i++)
+            t->argv[i] = JS_DupValue(ctx, argv[i + 2]);
+    }
+
+    t->id = next_timer_id++;
+    t->due = pauk_time_usec() + timer_clamp(delay, nesting);
+    t->interval = delay;
+    t->repeat = repeat;
+    t->nesting = nesting + 1;
+    t->func = JS_DupValue(ctx, argv[0]);
+
+    if (!heap_push(t)) {
+        timer_free(t);
+        return JS_ThrowOutOfMemory(ctx);
+    }
+    js_event_loop_wake();
+    return JS_NewInt32(ctx, (int32_t)t->id);
+}
+
+static JSValue js_set_timeout(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+    (void)this_val;
+    return js_add_timer(ctx, argc, argv, false);
+}
+
+static JSValue js_set_interval(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+    (void)this_val;
+    return js_add_timer(ctx, argc, argv, true);
+}
+
+// clearTimeout and clearInterval share the id space, as in browsers
+static JSValue js_clear_timer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+    (void)this_val;
+    int32_t id = 0;
+    if (argc < 1 || JS_ToInt32(ctx, &id, argv[0]) != 0 || id <= 0)
+        return JS_UNDEFINED;
+
+    if (running_timer && running_timer->id == (uint32_t)id) {
+        running_timer->cancelled = true;
+        return JS_UNDEFINED;
+    }
+
+    // Pages keep few timers; a scan is cheaper than an id index
+    for (size_t i = 0; i < heap_count; i++) {
+        if (heap[i]->id == (uint32_t)id) {
+            timer_free(heap_remove_at(i));
+            break;
+        }
+    }
+    return JS_UNDEFINED;
+}
+
+static JSValue js_request_animation_frame(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    (void)this_val;
+    if (argc < 1 || !JS_IsFunction(ctx, argv[0]))
+        return JS_ThrowTypeError(ctx, "requestAnimationFrame: not a function");
+
+    if (raf_count == raf_capacity) {
+        size_t cap = raf_capacity ? raf_capacity * 2 : 8;
+        js_raf_t *grown = realloc(raf_list, cap * sizeof(js_raf_t));
+        if (!grown)
+            return JS_ThrowOutOfMemory(ctx);
+        raf_list = grown;
+        raf_capacity = cap;
+    }
+
+    js_raf_t *r = &raf_list[raf_count++];
+    r->id = next_raf_id++;
+    r->cancelled = false;
+    r->func = JS_DupValue(ctx, argv[0]);
+    js_event_loop_wake();
+    return JS_NewInt32(ctx, (int32_t)r->id);
+}
+
+static JSValue js_cancel_animation_frame(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    (void)this_val;
+    int32_t id = 0;
+    if (argc < 1 || JS_ToInt32(ctx, &id, argv[0]) != 0)
+        return JS_UNDEFINED;
+
+    for (size_t i = 0; i < raf_count; i++) {
+        if (raf_list[i].id == (uint32_t)id) {
+            JS_FreeValue(ctx, raf_list[i].func);
+            memmove(&raf_list[i], &raf_list[i + 1], (raf_count - i - 1) * sizeof(js_raf_t));
+            raf_count--;
+            return JS_UNDEFINED;
+        }
+    }
+    // Later in the frame that is running now: skipped when its turn comes
+    for (size_t i = 0; i < raf_batch_count; i++) {
+        if (raf_batch[i].id == (uint32_t)id)
+            raf_batch[i].cancelled = true;
+    }
+    return JS_UNDEFINED;
+}
+
+static double js_event_loop_now_ms(void)
+{
+    return (double)(pauk_time_usec() - time_origin) / 1000.0;
+}
+
+static JSValue js_performance_now(JSContext *ctx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    (void)this_val;
+    (void)argc;
+    (void)argv;
+    return JS_NewFloat64(ctx, js_event_loop_now_ms());
+}
+
+void js_event_loop_init(JSContext *ctx)
+{
+    js_event_loop_cleanup();
+    loop_ctx = ctx;
+    time_origin = pauk_time_usec();
+    last_frame = 0;
+}
+
+void js_event_loop_register(JSContext *ctx)
+{
+    JSValue global = JS_GetGlobalObject(ctx);
+    JS_SetPropertyStr(ctx, global, "setTimeout",
+        JS_NewCFunction(ctx, js_set_timeout, "setTimeout", 2));
+    JS_SetPropertyStr(ctx, global, "setInterval",
+        JS_NewCFunction(ctx, js_set_interval, "setInterval", 2));
+    JS_SetPropertyStr(ctx, global, "clearTimeout",
+        JS_NewCFunction(ctx, js_clear_timer, "clearTimeout", 1));
+    JS_SetPropertyStr(ctx, global, "clearInterval",
+        JS_NewCFunction(ctx, js_clear_timer, "clearInterval", 1));
+    JS_SetPropertyStr(ctx, global, "requestAnimationFrame",
+        JS_NewCFunction(ctx, js_request_animation_frame, "requestAnimationFrame", 1));
+    JS_SetPropertyStr(ctx, global, "cancelAnimationFrame",
+        JS_NewCFunction(ctx, js_cancel_animation_frame, "cancelAnimationFrame", 1));
+
+    JSValue performance = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, performance, "now",
+        JS_NewCFunction(ctx, js_performance_now, "now", 0));
+    JS_SetPropertyStr(ctx, global, "performance", performance);
+
+    JS_FreeValue(ctx, global);
+}
+
+void js_event_loop_cleanup(void)
+{
+    if (loop_ctx) {
+        while (heap_count > 0)
+            timer_free(heap[--heap_count]);
+        for (size_t i = 0; i < raf_count; i++)
+            JS_FreeValue(loop_ctx, raf_list[i].func);
+    }
+
+    free(heap);
+    heap = NULL;
+    heap_count = 0;
+    heap_capacity = 0;
+    free(raf_list);
+    raf_list = NULL;
+    raf_count = 0;
+    raf_capacity = 0;
+    frame_requested = false;
+    running_timer = NULL;
+    loop_ctx = NULL;
+}
+
+void js_event_loop_set_frame_cb(js_frame_cb_t cb, void *arg)
+{
+    frame_cb = cb;
+    frame_cb_arg = arg;
+}
+
+void js_event_loop_set_wake_cb(js_wake_cb_t cb, void *arg)
+{
+    wake_cb = cb;
+    wake_cb_arg = arg;
+}
+
+void js_event_loop_request_frame(void)
+{
+    frame_requested = true;
+    js_event_loop_wake();
+}
+
+// ===== Loop =====
+
+static bool js_event_loop_frame_wanted(void)
+{
+    return raf_count > 0 || frame_requested || style_mutation_pending() > 0;
+}
+
+static void js_event_loop_run_timer(js_timer_t *t)
+{
+    running_timer = t;
+    js_call_function(loop_ctx, t->func, JS_UNDEFINED, t->argc, t->argv);
+    running_timer = NULL;
+
+    if (!t->repeat || t->cancelled) {
+        timer_free(t);
+        return;
+    }
+
+    // Each run of an interval nests one level deeper than the last.
+    // Skip missed periods instead of firing a burst to catch up.
+    uint64_t period = timer_clamp(t->interval, t->nesting);
+    if (t->nesting <= JS_EVENT_LOOP_CLAMP_NESTING)
+        t->nesting++;
+    uint64_t now = pauk_time_usec();
+    t->due += period;
+    if (t->due < now)
+        t->due = now + period;
+    if (!heap_push(t))
+        timer_free(t);
+}
+
+static void js_event_loop_frame(uint64_t now)
+{
+    last_frame = now;
+    double timestamp = js_event_loop_now_ms();
+
+    // Callbacks requested from inside a callback wait for the next frame
+    js_raf_t *batch = raf_list;
+    size_t batch_count = raf_count;
+    raf_list = NULL;
+    raf_count = 0;
+    raf_capacity = 0;
+
+    raf_batch = batch;
+    raf_batch_count = batch_count;
+    for (size_t i = 0; i < batch_count; i++) {
+        if (!batch[i].cancelled) {
+            JSValue arg = JS_NewFloat64(loop_ctx, timestamp);
+            js_call_function(loop_ctx, batch[i].func, JS_UNDEFINED, 1, &arg);
+            JS_FreeValue(loop_ctx, arg);
+        }
+        JS_FreeValue(loop_ctx, batch[i].func);
+    }
+    raf_batch = NULL;
+    raf_batch_count = 0;
+    free(batch);
+
+    // Every style write of this frame lands in one pass
+    style_mutation_flush();
+
+    // The frame callback lays out again, which consumes the dirty set
+    size_t dirty = 0;
+    style_mutation_dirty(&dirty);
+    if ((dirty > 0 || frame_requested) && frame_cb)
+        frame_cb(frame_cb_arg);
+    frame_requested = false;
+}
+
+uint64_t js_event_loop_tick(uint64_t now)
+{
+    if (!loop_ctx)
+        return 0;
+
+    in_tick = true;
+    for (int n = 0; n < JS_EVENT_LOOP_MAX_TIMERS_PER_TICK && heap_count > 0; n++) {
+        if (heap[0]->due > now)
+            break;
+        js_event_loop_run_timer(heap_remove_at(0));
+    }
+
+    now = pauk_time_usec();
+    if (js_event_loop_frame_wanted() && now >= last_frame + JS_EVENT_LOOP_FRAME_USEC)
+        js_event_loop_frame(now);
+
+    uint64_t wake = 0;
+    if (heap_count > 0)
+        wake = heap[0]->due;
+    if (js_event_loop_frame_wanted()) {
+        uint64_t frame = last_frame + JS_EVENT_LOOP_FRAME_USEC;
+        if (wake == 0 || frame < wake)
+            wake = frame;
+    }
+    in_tick = false;
+    return wake;
+}
+
+void js_event_loop_run(uint64_t max_usec)
+{
+    uint64_t end = pauk_time_usec() + max_usec;
+
+    for (;;) {
+        uint64_t wake = js_event_loop_tick(pauk_time_usec());
+        if (wake == 0 || wake >= end)
+            break;
+
+        uint64_t now = pauk_time_usec();
+        if (wake > now)
+            pauk_sleep_usec(wake - now);
+    }
+}
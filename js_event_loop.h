@@ -0,0 +1,49 @@
+// js_event_loop.h - Timers, microtasks and requestAnimationFrame for the page
+#ifndef JS_EVENT_LOOP_H
+#define JS_EVENT_LOOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "quickjs.h"
+
+// Frame period for requestAnimationFrame / render requests (60 Hz)
+#define JS_EVENT_LOOP_FRAME_USEC 16667
+
+// Timers nested deeper than JS_EVENT_LOOP_CLAMP_NESTING (set from timer
+// callbacks, or later runs of an interval) wait at least this long, like
+// browsers do
+#define JS_EVENT_LOOP_MIN_REPEAT_USEC 4000
+#define JS_EVENT_LOOP_CLAMP_NESTING 5
+
+// Called at most once per frame, after rAF callbacks and the style flush,
+// when something changed: lay out again and present
+typedef void (*js_frame_cb_t)(void *arg);
+
+// Install setTimeout, setInterval, clearTimeout, clearInterval,
+// requestAnimationFrame, cancelAnimationFrame and performance.now on ctx
+void js_event_loop_register(JSContext *ctx);
+// Start the loop for the page running in ctx (drops the previous page's
+// callbacks, restarts performance.now)
+void js_event_loop_init(JSContext *ctx);
+// Drop every pending callback; call before the context is freed
+void js_event_loop_cleanup(void);
+
+void js_event_loop_set_frame_cb(js_frame_cb_t cb, void *arg);
+
+// Called when new work is scheduled (timer, rAF, render request) so an
+// idle owner knows to tick again; not called from inside a tick
+typedef void (*js_wake_cb_t)(void *arg);
+void js_event_loop_set_wake_cb(js_wake_cb_t cb, void *arg);
+
+// Ask for a layout + paint at the next frame (several requests coalesce)
+void js_event_loop_request_frame(void);
+
+// Run due timers and, on a frame boundary, the frame. Returns the time
+// (pauk_time_usec) the loop next needs to run, 0 when nothing is scheduled.
+uint64_t js_event_loop_tick(uint64_t now);
+
+// Without a UI: tick until idle or max_usec passed, sleeping in between
+void js_event_loop_run(uint64_t max_usec);
+
+#endif // JS_EVENT_LOOP_H
@@ -1,8 +1,26 @@
 #include "js_executor_quickjs.h"
 #include "cjson.h"
+#include "dom_id_index.h"
+#include "js_element.h"
+#include "style_mutation.h"
+#include "pauk_sync.h"
+#include "js_bytecode_cache.h"
+#include "cache_store.h"
+#include "script_loader.h"
+#include "js_event_loop.h"
+#include "event_handler.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+// QuickJS calls the interrupt handler every few thousand bytecode ops;
+// only read the clock on every Nth call
+#define JS_BUDGET_CHECK_INTERVAL 8
+
+// Peak compiler memory per byte of script source, for the memory-limit check
+#define JS_SOURCE_MEMORY_FACTOR 8
 
 
 typedef struct {
@@ -12,28 +30,54 @@ typedef struct {
     void (*native_callback)(lxb_dom_element_t*, const char*);
 } JSRenderCallback;
 
-static cJSON *js_style_modifications = NULL;
 // Global runtime for better memory management
 static JSRuntime *global_rt = NULL;
 static lxb_html_document_t *global_document = NULL;
 static JSRenderCallback *js_render_callbacks = NULL;
 static int js_callback_count = 0;
 
+// Execution budget (see js_interrupt_handler)
+static int budget_script_ms = 5000;
+static int budget_page_ms = 20000;
+static int budget_yield_ms = 50;
+static uint64_t budget_deadline = 0;    // usec, 0 = no script running
+static unsigned budget_ticks = 0;
+static bool budget_tripped = false;
+static JSExecStats exec_stats;
+
+// The page's <script> elements in document order
+typedef enum {
+    PAGE_SCRIPT_CLASSIC,        // inline, or src without async/defer: blocks
+    PAGE_SCRIPT_DEFER,          // src + defer: after the classic ones, in order
+    PAGE_SCRIPT_ASYNC           // src + async: whenever its text has arrived
+} page_script_kind_t;
+
+typedef struct {
+    lxb_dom_node_t *node;
+    script_fetch_t *fetch;      // NULL for inline scripts
+    bool external;              // has src: never runs its inline text
+    page_script_kind_t kind;
+    bool done;
+    bool yielded;               // waits until after first paint
+} page_script_t;
+
+static page_script_t *page_scripts = NULL;
+static size_t page_script_count = 0;
+static size_t page_script_capacity = 0;
+static bool running_deferred = false;
+
+static void execute_single_script(JSContext *ctx, page_script_t *ps, int script_num);
+static void js_run_page_scripts(JSContext *ctx);
+
 
 void init_js_modifications(void) {
-    if (!js_style_modifications) {
-        js_style_modifications = cJSON_CreateObject();
-    }
+    style_mutation_reset();
 }
 
 
 static JSValue js_request_render(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    printf("JS -> Renderer: requestRender()\n");
-    
-    // Set a flag that renderer should update
-    // In a real implementation, this would trigger a re-render
-    // For now, just log it
-    
+    // Coalesced: at most one layout + paint per frame
+    js_event_loop_request_frame();
     return JS_UNDEFINED;
 }
 
@@ -76,42 +120,23 @@ js_render_callbacks[js_callback_count++] = cb;
 }
 
 
-static lxb_dom_element_t* find_element_by_id_recursive(lxb_dom_node_t *node, const char *id, int depth) {
-    if (!node || !id || depth > 100) {  // Add depth limit
-        return NULL;
-    }
-    
-    while (node) {
-        if (node->type == LXB_DOM_NODE_TYPE_ELEMENT) {
-            lxb_dom_element_t *element = lxb_dom_interface_element(node);
-            
-            // Check if this element has the right ID
-            lxb_dom_attr_t *id_attr = lxb_dom_element_attr_by_name(element, 
-                (lxb_char_t*)"id", 2);
-            
-            if (id_attr) {
-                size_t id_len;
-                const lxb_char_t *id_val = lxb_dom_attr_value(id_attr, &id_len);
-                
-                if (id_val && id_len == strlen(id) && 
-                    memcmp(id_val, id, id_len) == 0) {
-                    return element; // Found it!
-                }
-            }
-            
-            // Search children recursively with depth+1
-            lxb_dom_node_t *child = lxb_dom_node_first_child(node);
-            if (child) {
-                lxb_dom_element_t *found = find_element_by_id_recursive(child, id, depth + 1);
-                if (found) return found;
-            }
-        }
-        
-        // Move to next sibling
-        node = lxb_dom_node_next(node);
+// Queue a style write; style_mutation_flush() publishes it to style
+// resolution once per frame, coalesced per (element, property)
+static void js_style_apply(lxb_dom_element_t *elem, const char *property, const char *value) {
+    if (!elem || !property || !value) return;
+    
+    uintptr_t prop = style_mutation_property_id(property, strlen(property));
+    if (prop == 0) {
+        printf("JS: unknown style property '%s' ignored\n", property);
+        return;
     }
     
-    return NULL; // Not found
+    style_mutation_set(elem, prop, value, strlen(value));
+}
+
+// Style write from an element wrapper (element.style.x = ...)
+void js_style_set_property(lxb_dom_element_t *element, const char *property, const char *value) {
+    js_style_apply(element, property, value);
 }
 
 
@@ -132,60 +157,11 @@ static JSValue js_native_set_style(JSContext *ctx, JSValueConst this_val, int ar
     
     printf("JS -> Renderer: setStyle('%s', '%s', '%s')\n", element_id, property, value);
     
-    // Initialize if needed
-    init_js_modifications();
-    
-    // Find or create element entry
-    cJSON *element_mods = cJSON_GetObjectItemCaseSensitive(js_style_modifications, element_id);
-    if (!element_mods) {
-        element_mods = cJSON_CreateObject();
-        cJSON_AddItemToObject(js_style_modifications, element_id, element_mods);
-    }
-    
-    // Find or create styles object
-    cJSON *styles = cJSON_GetObjectItem(element_mods, "style");
-    if (!styles) {
-        styles = cJSON_CreateObject();
-        cJSON_AddItemToObject(element_mods, "style", styles);
-    }
-    
-    // Add/update the style property
-    cJSON_ReplaceItemInObject(styles, property, cJSON_CreateString(value));
-    
-    // Also try to update the actual DOM element if it exists
+    lxb_dom_element_t *elem = NULL;
     if (global_document && strlen(element_id) > 0) {
-        lxb_dom_node_t *root = lxb_dom_interface_node(global_document);
-        lxb_dom_element_t *elem = find_element_by_id_recursive(root, element_id, 0);
-        
-        if (elem) {
-            // Create or update style attribute
-            lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_name(elem, (lxb_char_t*)"style", 5);
-            
-            if (style_attr) {
-                // Get existing style
-                size_t style_len;
-                const lxb_char_t *existing_style = lxb_dom_attr_value(style_attr, &style_len);
-                char new_style[1024];
-                
-                if (existing_style && style_len > 0) {
-                    // Parse and update existing style
-                    char *style_str = malloc(style_len + 1);
-                    memcpy(style_str, existing_style, style_len);
-                    style_str[style_len] = '\0';
-                    
-                    // Simple update - just append new property
-                    snprintf(new_style, sizeof(new_style), "%s; %s: %s", style_str, property, value);
-                    free(style_str);
-                } else {
-                    // New style
-                    snprintf(new_style, sizeof(new_style), "%s: %s", property, value);
-                }
-                
-                // Update the attribute
-                lxb_dom_attr_set_value(style_attr, (lxb_char_t*)new_style, strlen(new_style));
-            }
-        }
+        elem = dom_id_index_find(element_id, strlen(element_id));
     }
+    js_style_apply(elem, property, value);
     
     JS_FreeCString(ctx, element_id);
     JS_FreeCString(ctx, property);
@@ -195,61 +171,130 @@ static JSValue js_native_set_style(JSContext *ctx, JSValueConst this_val, int ar
 }
 
 
+// Apply one updateElement() entry: style objects and CSS properties go to
+// the style queue, text to the node, anything else becomes an attribute
+static void js_update_element_property(JSContext *ctx, lxb_dom_element_t *elem,
+    const char *key, JSValueConst val) {
+    if (strcmp(key, "style") == 0 && JS_IsObject(val)) {
+        JSPropertyEnum *props;
+        uint32_t count;
+        if (JS_GetOwnPropertyNames(ctx, &props, &count, val,
+            JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+            return;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            const char *name = JS_AtomToCString(ctx, props[i].atom);
+            JSValue v = JS_GetProperty(ctx, val, props[i].atom);
+            const char *str = JS_ToCString(ctx, v);
+            if (name && str) js_style_apply(elem, name, str);
+            if (str) JS_FreeCString(ctx, str);
+            if (name) JS_FreeCString(ctx, name);
+            JS_FreeValue(ctx, v);
+            JS_FreeAtom(ctx, props[i].atom);
+        }
+        js_free(ctx, props);
+        return;
+    }
+    
+    size_t len;
+    const char *str = JS_ToCStringLen(ctx, &len, val);
+    if (!str) return;
+    
+    if (strcmp(key, "textContent") == 0 || strcmp(key, "text") == 0) {
+        js_element_set_text(elem, str, len);
+    } else if (style_mutation_property_id(key, strlen(key)) != 0) {
+        js_style_apply(elem, key, str);
+    } else {
+        js_element_set_attribute_value(elem, key, strlen(key), str, len);
+    }
+    
+    JS_FreeCString(ctx, str);
+}
+
+// __native.updateElement(id, {style: {...}, textContent: ..., ...}).
+// A JSON string is still accepted and parsed by QuickJS, no cJSON round trip.
 static JSValue js_update_element(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     if (argc < 2) return JS_UNDEFINED;
     
     const char *element_id = JS_ToCString(ctx, argv[0]);
-    const char *properties_json = JS_ToCString(ctx, argv[1]);
+    if (!element_id) return JS_UNDEFINED;
     
-    if (!element_id || !properties_json) {
-        if (element_id) JS_FreeCString(ctx, element_id);
-        if (properties_json) JS_FreeCString(ctx, properties_json);
-        return JS_UNDEFINED;
+    lxb_dom_element_t *elem = NULL;
+    if (global_document && strlen(element_id) > 0) {
+        elem = dom_id_index_find(element_id, strlen(element_id));
+    }
+    printf("JS -> Renderer: updateElement('%s')%s\n", element_id, elem ? "" : " - no such element");
+    JS_FreeCString(ctx, element_id);
+    if (!elem) return JS_UNDEFINED;
+    
+    JSValue properties;
+    if (JS_IsString(argv[1])) {
+        size_t len;
+        const char *json = JS_ToCStringLen(ctx, &len, argv[1]);
+        if (!json) return JS_UNDEFINED;
+        properties = JS_ParseJSON(ctx, json, len, "<updateElement>");
+        JS_FreeCString(ctx, json);
+    } else {
+        properties = JS_DupValue(ctx, argv[1]);
     }
     
-    printf("JS -> Renderer: updateElement('%s', '%s')\n", element_id, properties_json);
-    
-    // Parse the properties JSON
-    cJSON *properties = cJSON_Parse(properties_json);
-    if (properties) {
-        init_js_modifications();
-        
-        // Store the properties
-        cJSON *element_mods = cJSON_GetObjectItemCaseSensitive(js_style_modifications, element_id);
-        if (!element_mods) {
-            element_mods = cJSON_CreateObject();
-            cJSON_AddItemToObject(js_style_modifications, element_id, element_mods);
+    if (JS_IsObject(properties)) {
+        JSPropertyEnum *props;
+        uint32_t count;
+        if (JS_GetOwnPropertyNames(ctx, &props, &count, properties,
+            JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) == 0) {
+            for (uint32_t i = 0; i < count; i++) {
+                const char *key = JS_AtomToCString(ctx, props[i].atom);
+                JSValue v = JS_GetProperty(ctx, properties, props[i].atom);
+                if (key) js_update_element_property(ctx, elem, key, v);
+                if (key) JS_FreeCString(ctx, key);
+                JS_FreeValue(ctx, v);
+                JS_FreeAtom(ctx, props[i].atom);
+            }
+            js_free(ctx, props);
         }
-        
-        // Merge properties
-        cJSON *item = properties->child;
-        while (item) {
-            cJSON_ReplaceItemInObject(element_mods, item->string, cJSON_Duplicate(item, 1));
-            item = item->next;
+    } else if (JS_IsException(properties)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+    
+    JS_FreeValue(ctx, properties);
+    return JS_UNDEFINED;
+}
+
+// __native.setAttribute(id, name, value) - goes through the id index so
+// scripts that rename elements keep getElementById consistent
+static JSValue js_native_set_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 3 || !global_document) return JS_NewBool(ctx, 0);
+    
+    const char *element_id = JS_ToCString(ctx, argv[0]);
+    const char *name = JS_ToCString(ctx, argv[1]);
+    const char *value = JS_ToCString(ctx, argv[2]);
+    int ok = 0;
+    
+    if (element_id && name && value) {
+        lxb_dom_element_t *elem = dom_id_index_find(element_id, strlen(element_id));
+        if (elem && js_element_set_attribute_value(elem, name, strlen(name),
+            value, strlen(value)) == EOK) {
+            ok = 1;
         }
-        
-        cJSON_Delete(properties);
     }
     
-    JS_FreeCString(ctx, element_id);
-    JS_FreeCString(ctx, properties_json);
+    if (element_id) JS_FreeCString(ctx, element_id);
+    if (name) JS_FreeCString(ctx, name);
+    if (value) JS_FreeCString(ctx, value);
     
-    return JS_UNDEFINED;
+    return JS_NewBool(ctx, ok);
 }
 
 cJSON* get_js_modifications(void) {
-    if (js_style_modifications) {
-        return cJSON_Duplicate(js_style_modifications, 1);
-    }
-    return NULL;
+    // Anything still queued belongs to the last frame
+    style_mutation_flush();
+    return style_mutation_export();
 }
 
 
 void cleanup_js_modifications(void) {
-    if (js_style_modifications) {
-        cJSON_Delete(js_style_modifications);
-        js_style_modifications = NULL;
-    }
+    style_mutation_reset();
 }
 
 
@@ -284,6 +329,22 @@ cJSON* get_computed_layout_from_js(JSContext *ctx) {
 // Set the actual document for DOM access
 void js_set_document(JSContext *ctx, lxb_html_document_t *document) {
     global_document = document;
+    if (document && dom_id_index_build(document) != EOK) {
+        printf("WARNING: DOM id index could not be built\n");
+    }
+    
+    // The rest of the realm does not depend on the document
+    if (ctx) {
+        JSValue global_obj = JS_GetGlobalObject(ctx);
+        JSValue document_obj = JS_GetPropertyStr(ctx, global_obj, "document");
+        lxb_html_body_element_t *body = document ? lxb_html_document_body_element(document) : NULL;
+        if (JS_IsObject(document_obj)) {
+            JS_SetPropertyStr(ctx, document_obj, "body",
+                js_element_wrap(ctx, body ? lxb_dom_interface_element(body) : NULL));
+        }
+        JS_FreeValue(ctx, document_obj);
+        JS_FreeValue(ctx, global_obj);
+    }
     printf("DOM Bridge: Connected QuickJS to Lexbor document\n");
 }
 
@@ -291,67 +352,18 @@ void js_set_document(JSContext *ctx, lxb_html_document_t *document) {
 static JSValue js_document_get_element_by_id_real(JSContext *ctx, 
     JSValueConst this_val, int argc, JSValueConst *argv) {
     
-    if (argc < 1 || !global_document) return JS_UNDEFINED;
-    
-    const char *id = JS_ToCString(ctx, argv[0]);
-    if (!id) return JS_UNDEFINED;
-    
-    printf("JS: Searching for element with id='%s'\n", id);
+    if (argc < 1 || !global_document) return JS_NULL;
     
-    // Start search from document root
-    lxb_dom_node_t *root = lxb_dom_interface_node(global_document);
-    
-    // Use recursive search with depth 0
-    lxb_dom_element_t *found_element = find_element_by_id_recursive(root, id, 0);
-    JSValue obj = JS_NewObject(ctx);
-    
-    if (found_element) {
-        // Get element tag name
-        size_t tag_len;
-        const lxb_char_t *tag_name = lxb_dom_element_local_name(found_element, &tag_len);
-        
-        char tag_str[32];
-        if (tag_name && tag_len > 0) {
-            size_t copy_len = tag_len < 31 ? tag_len : 31;
-            memcpy(tag_str, tag_name, copy_len);
-            tag_str[copy_len] = '\0';
-        } else {
-            strcpy(tag_str, "element");
-        }
-        
-        JS_SetPropertyStr(ctx, obj, "id", JS_NewString(ctx, id));
-        JS_SetPropertyStr(ctx, obj, "tagName", JS_NewString(ctx, tag_str));
-        JS_SetPropertyStr(ctx, obj, "nodeType", JS_NewInt32(ctx, 1)); // ELEMENT_NODE
-        
-        // Get text content
-        lxb_dom_node_t *element_node = lxb_dom_interface_node(found_element);
-        size_t text_len;
-        lxb_char_t *text_content = lxb_dom_node_text_content(element_node, &text_len);
-        
-        if (text_content && text_len > 0) {
-            char *text_str = malloc(text_len + 1);
-            memcpy(text_str, text_content, text_len);
-            text_str[text_len] = '\0';
-            JS_SetPropertyStr(ctx, obj, "textContent", JS_NewString(ctx, text_str));
-            free(text_str);
-        } else {
-            JS_SetPropertyStr(ctx, obj, "textContent", JS_NewString(ctx, ""));
-        }
-        
-        if (text_content) {
-            lxb_dom_document_destroy_text(element_node->owner_document, text_content);
-        }
-        
-        printf("✓ Found element: %s#%s\n", tag_str, id);
-    } else {
-        JS_SetPropertyStr(ctx, obj, "id", JS_NULL);
-        JS_SetPropertyStr(ctx, obj, "tagName", JS_NULL);
-        JS_SetPropertyStr(ctx, obj, "textContent", JS_NewString(ctx, ""));
-        printf("✗ Element not found: %s\n", id);
-    }
+    size_t id_len;
+    const char *id = JS_ToCStringLen(ctx, &id_len, argv[0]);
+    if (!id) return JS_EXCEPTION;
     
+    // Hash lookup, the index is built when the document is attached.
+    // Properties are read from lexbor only when the script asks for them.
+    lxb_dom_element_t *found_element = dom_id_index_find(id, id_len);
     JS_FreeCString(ctx, id);
-    return obj;
+    
+    return js_element_wrap(ctx, found_element);
 }
 
 
@@ -369,31 +381,6 @@ static JSValue js_console_log(JSContext *ctx, JSValueConst this_val, int argc, J
     return JS_UNDEFINED;
 }
 
-// document.getElementById implementation
-static JSValue js_document_get_element_by_id(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1) return JS_UNDEFINED;
-    
-    const char *id = JS_ToCString(ctx, argv[0]);
-    if (!id) return JS_UNDEFINED;
-    
-    printf("JS: document.getElementById('%s')\n", id);
-    
-    // Create mock element object
-    JSValue obj = JS_NewObject(ctx);
-    
-    // Add properties
-    JS_SetPropertyStr(ctx, obj, "id", JS_NewString(ctx, id));
-    JS_SetPropertyStr(ctx, obj, "innerHTML", JS_NewString(ctx, "Mock content"));
-    JS_SetPropertyStr(ctx, obj, "textContent", JS_NewString(ctx, "Mock content"));
-    
-    // Add style object
-    JSValue style_obj = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, obj, "style", style_obj);
-    
-    JS_FreeCString(ctx, id);
-    return obj;
-}
-
 // Safe mock function
 static JSValue js_safe_mock_function(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     printf("JS: Safe mock function called\n");
@@ -416,28 +403,16 @@ void js_register_dom_api(JSContext *ctx) {
         JS_NewCFunction(ctx, js_console_log, "info", 1));
     JS_SetPropertyStr(ctx, global_obj, "console", console_obj);
     
-    // Create document object - ALWAYS use real functions when global_document exists
-    JSValue document_obj = JS_NewObject(ctx);
+    // Element / style classes for the wrappers handed out below
+    js_element_init(ctx);
     
-    if (global_document) {
-        JS_SetPropertyStr(ctx, document_obj, "getElementById",
-            JS_NewCFunction(ctx, js_document_get_element_by_id_real, "getElementById", 1));
-        
-        // Set body property directly
-        lxb_html_body_element_t *body = lxb_html_document_body_element(global_document);
-        if (body) {
-            JSValue body_obj = JS_NewObject(ctx);
-            JS_SetPropertyStr(ctx, body_obj, "tagName", JS_NewString(ctx, "BODY"));
-            JS_SetPropertyStr(ctx, document_obj, "body", body_obj);
-        } else {
-            JS_SetPropertyStr(ctx, document_obj, "body", JS_NULL);
-        }
-    } else {
-        // Fallback to mock
-        JS_SetPropertyStr(ctx, document_obj, "getElementById",
-            JS_NewCFunction(ctx, js_document_get_element_by_id, "getElementById", 1));
-        JS_SetPropertyStr(ctx, document_obj, "body", JS_NULL);
-    }
+    // Create document object. The realm is built before its page is known:
+    // getElementById reads global_document when called, document.body is
+    // bound by js_set_document()
+    JSValue document_obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, document_obj, "getElementById",
+        JS_NewCFunction(ctx, js_document_get_element_by_id_real, "getElementById", 1));
+    JS_SetPropertyStr(ctx, document_obj, "body", JS_NULL);
     
     JS_SetPropertyStr(ctx, document_obj, "title", JS_NewString(ctx, "Real Document"));
     JS_SetPropertyStr(ctx, global_obj, "document", document_obj);
@@ -448,7 +423,7 @@ void js_register_dom_api(JSContext *ctx) {
     // Register safe mock functions for common web APIs - INCLUDED
     const char *mock_functions[] = {
         "initializePage", "incrementCounter", "updateCounterDisplay",
-        "addEventListener", "setTimeout", "setInterval", "alert", "confirm",
+        "addEventListener", "alert", "confirm",
         "querySelector", "querySelectorAll", "createElement", "appendChild",
         "setAttribute", "getAttribute", "removeAttribute", "classList",
         "focus", "blur", "click", NULL
@@ -459,6 +434,9 @@ void js_register_dom_api(JSContext *ctx) {
             JS_NewCFunction(ctx, js_safe_mock_function, mock_functions[i], 0));
     }
     
+    // Real timers, requestAnimationFrame and performance.now
+    js_event_loop_register(ctx);
+    
     // ========== ADD NATIVE BRIDGE HERE ==========
     // Add after the mock functions loop, before JS_FreeValue
     
@@ -469,6 +447,10 @@ void js_register_dom_api(JSContext *ctx) {
     JS_SetPropertyStr(ctx, native_bridge, "setStyle", 
                      JS_NewCFunction(ctx, js_native_set_style, "setStyle", 3));
     
+    // Add setAttribute function
+    JS_SetPropertyStr(ctx, native_bridge, "setAttribute",
+                     JS_NewCFunction(ctx, js_native_set_attribute, "setAttribute", 3));
+    
     // Add requestRender function  
     JS_SetPropertyStr(ctx, native_bridge, "requestRender",
                      JS_NewCFunction(ctx, js_request_render, "requestRender", 0));
@@ -489,35 +471,423 @@ void js_register_dom_api(JSContext *ctx) {
     JS_FreeValue(ctx, global_obj);
 }
 
+// ===== Execution budget =====
+
+static int js_interrupt_handler(JSRuntime *rt, void *opaque) {
+    (void)rt;
+    (void)opaque;
+    
+    if (budget_deadline == 0 || ++budget_ticks < JS_BUDGET_CHECK_INTERVAL)
+        return 0;
+    budget_ticks = 0;
+    
+    if (pauk_time_usec() < budget_deadline)
+        return 0;
+    
+    // Uncatchable: try/catch in the script cannot swallow it
+    budget_tripped = true;
+    return 1;
+}
+
+// Time left for this page's scripts, 0 = exhausted, UINT64_MAX = unlimited
+static uint64_t js_budget_page_left(void) {
+    if (budget_page_ms <= 0)
+        return UINT64_MAX;
+    
+    uint64_t page = (uint64_t)budget_page_ms * 1000;
+    return (exec_stats.wall_usec < page) ? page - exec_stats.wall_usec : 0;
+}
+
+// Parser-blocking scripts have used their share before first paint
+static bool js_budget_should_yield(void) {
+    return !running_deferred && budget_yield_ms > 0 &&
+        exec_stats.wall_usec >= (uint64_t)budget_yield_ms * 1000;
+}
+
+static uint64_t budget_wall_start = 0;
+static uint64_t budget_cpu_start = 0;
+static unsigned budget_depth = 0;       // arms not yet disarmed
+
+// Arm the interrupt deadline for one unit of work: a script (counted
+// against the page budget too) or an event callback (own budget only).
+// Work started from inside another (el.click() in a script, microtasks of
+// a nested callback) runs under the outer deadline and is timed with it.
+static void js_budget_arm(bool page) {
+    if (budget_depth++ > 0)
+        return;
+    
+    uint64_t slice = (budget_script_ms > 0) ? (uint64_t)budget_script_ms * 1000 : UINT64_MAX;
+    if (page) {
+        uint64_t page_left = js_budget_page_left();
+        if (page_left < slice)
+            slice = page_left;
+    }
+    
+    budget_wall_start = pauk_time_usec();
+    budget_cpu_start = pauk_cpu_time_usec();
+    budget_deadline = (slice == UINT64_MAX) ? 0 : budget_wall_start + slice;
+    budget_ticks = 0;
+    budget_tripped = false;
+}
+
+static void js_budget_disarm(void) {
+    if (budget_depth == 0 || --budget_depth > 0)
+        return;
+    
+    budget_deadline = 0;
+    uint64_t wall = pauk_time_usec() - budget_wall_start;
+    exec_stats.wall_usec += wall;
+    exec_stats.cpu_usec += pauk_cpu_time_usec() - budget_cpu_start;
+    if (wall > exec_stats.max_script_usec)
+        exec_stats.max_script_usec = wall;
+}
+
+// Print and clear the pending exception
+static void js_report_exception(JSContext *ctx) {
+    JSValue exception = JS_GetException(ctx);
+    const char *error = JS_ToCString(ctx, exception);
+    // A nested callback sees the interrupt first; the outer work counts it
+    if (budget_tripped && budget_depth == 0) {
+        exec_stats.scripts_interrupted++;
+        printf("JavaScript interrupted after %" PRIu64 " ms (time budget)\n",
+            (pauk_time_usec() - budget_wall_start) / 1000);
+    }
+    printf("JavaScript error: %s\n", error ? error : "(unknown)");
+    
+    // Get line number if available
+    JSValue line_number = JS_GetPropertyStr(ctx, exception, "lineNumber");
+    if (JS_IsNumber(line_number)) {
+        int line_num;
+        JS_ToInt32(ctx, &line_num, line_number);
+        printf("Error at line: %d\n", line_num);
+    }
+    JS_FreeValue(ctx, line_number);
+    if (error)
+        JS_FreeCString(ctx, error);
+    JS_FreeValue(ctx, exception);
+}
+
+void js_drain_microtasks(JSContext *ctx) {
+    if (!ctx)
+        return;
+    
+    JSRuntime *rt = JS_GetRuntime(ctx);
+    while (JS_IsJobPending(rt)) {
+        JSContext *job_ctx = NULL;
+        js_budget_arm(false);
+        int ret = JS_ExecutePendingJob(rt, &job_ctx);
+        js_budget_disarm();
+        if (ret < 0)
+            js_report_exception(job_ctx ? job_ctx : ctx);
+        else if (ret == 0)
+            break;
+    }
+}
+
+JSValue js_call_function_value(JSContext *ctx, JSValueConst func, JSValueConst this_val,
+    int argc, JSValueConst *argv) {
+    if (!ctx || !JS_IsFunction(ctx, func))
+        return JS_EXCEPTION;
+    
+    js_budget_arm(false);
+    JSValue result = JS_Call(ctx, func, this_val, argc, argv);
+    js_budget_disarm();
+    exec_stats.callbacks_run++;
+    
+    if (JS_IsException(result))
+        js_report_exception(ctx);
+    
+    js_drain_microtasks(ctx);
+    return result;
+}
+
+bool js_call_function(JSContext *ctx, JSValueConst func, JSValueConst this_val,
+    int argc, JSValueConst *argv) {
+    JSValue result = js_call_function_value(ctx, func, this_val, argc, argv);
+    bool ok = !JS_IsException(result);
+    JS_FreeValue(ctx, result);
+    return ok;
+}
+
+// ===== Inline handler source =====
+// An on* attribute is the body of a function, but QuickJS only compiles
+// whole scripts (its Function constructor, too, pastes the body between
+// text of its own). A body such as "}), f(), (function () {" would close
+// the function early and run f() at compile time. The wrapped source is
+// tried first in a realm of its own, without the page's API: only when
+// the function it evaluates to spans all of the source, as its text shows,
+// is it compiled for the page.
+
+static JSContext *handler_check_ctx = NULL;
+static JSValue handler_check_to_string;     // Function.prototype.toString
+
+// Code that escaped could build a function with the expected text through
+// eval or a Function constructor, so the realm has no way left to either
+static const char handler_check_setup[] =
+    "(function (g) {\n"
+    "    'use strict';\n"
+    "    var toString = Function.prototype.toString;\n"
+    "    [function () {}, function* () {}, async function () {}, async function* () {}]\n"
+    "        .forEach(function (f) { delete Object.getPrototypeOf(f).constructor; });\n"
+    "    delete g.eval;\n"
+    "    delete g.Function;\n"
+    "    return toString;\n"
+    "})(globalThis)";
+
+static void js_handler_check_free(void) {
+    if (!handler_check_ctx)
+        return;
+    JS_FreeValue(handler_check_ctx, handler_check_to_string);
+    JS_FreeContext(handler_check_ctx);
+    handler_check_ctx = NULL;
+}
+
+static bool js_handler_check_init(void) {
+    if (handler_check_ctx)
+        return true;
+    
+    JSContext *check = JS_NewContext(global_rt);
+    if (!check)
+        return false;
+    JSValue to_string = JS_Eval(check, handler_check_setup, sizeof(handler_check_setup) - 1,
+        "<handler check>", JS_EVAL_TYPE_GLOBAL);
+    if (!JS_IsFunction(check, to_string)) {
+        JS_FreeValue(check, to_string);
+        JS_FreeContext(check);
+        return false;
+    }
+    handler_check_ctx = check;
+    handler_check_to_string = to_string;
+    return true;
+}
+
+// Does source evaluate to one function whose text is all of it but the
+// outer parentheses; a syntax error is passed on to ctx
+static bool js_handler_is_whole(JSContext *ctx, const char *source, size_t len,
+    const char *filename) {
+    if (!js_handler_check_init()) {
+        JS_ThrowInternalError(ctx, "no realm to check the handler in");
+        return false;
+    }
+    
+    JSContext *check = handler_check_ctx;
+    JSValue func = JS_Eval(check, source, len, filename, JS_EVAL_TYPE_GLOBAL);
+    if (JS_IsException(func)) {
+        JSValue exception = JS_GetException(check);
+        const char *error = JS_ToCString(check, exception);
+        JS_ThrowSyntaxError(ctx, "%s", error ? error : "(unknown)");
+        if (error)
+            JS_FreeCString(check, error);
+        JS_FreeValue(check, exception);
+        return false;
+    }
+    
+    bool whole = false;
+    if (JS_IsFunction(check, func)) {
+        JSValue text = JS_Call(check, handler_check_to_string, func, 0, NULL);
+        size_t text_len = 0;
+        const char *str = JS_ToCStringLen(check, &text_len, text);
+        whole = str && text_len == len - 2 && memcmp(str, source + 1, text_len) == 0;
+        if (str)
+            JS_FreeCString(check, str);
+        JS_FreeValue(check, text);
+    }
+    JS_FreeValue(check, func);
+    // Whatever the escaped code threw stays in its realm
+    JS_FreeValue(check, JS_GetException(check));
+    
+    if (!whole)
+        JS_ThrowSyntaxError(ctx, "not a function body");
+    return whole;
+}
+
+JSValue js_compile_handler(JSContext *ctx, const char *params, const char *body,
+    const char *filename) {
+    if (!params || !body)
+        return JS_ThrowTypeError(ctx, "no handler source");
+    
+    static const char prefix[] = "(function (";
+    static const char middle[] = ") {\n";
+    static const char suffix[] = "\n})";
+    size_t size = sizeof(prefix) - 1 + strlen(params) + sizeof(middle) - 1 +
+        strlen(body) + sizeof(suffix);
+    char *source = malloc(size);
+    if (!source)
+        return JS_ThrowOutOfMemory(ctx);
+    snprintf(source, size, "%s%s%s%s%s", prefix, params, middle, body, suffix);
+    
+    js_budget_arm(false);
+    JSValue func = JS_EXCEPTION;
+    if (js_handler_is_whole(ctx, source, size - 1, filename))
+        func = JS_Eval(ctx, source, size - 1, filename, JS_EVAL_TYPE_GLOBAL);
+    js_budget_disarm();
+    
+    free(source);
+    return func;
+}
+
+static void js_budget_begin_page(void) {
+    memset(&exec_stats, 0, sizeof(exec_stats));
+}
+
+JSExecStats js_get_exec_stats(void) {
+    return exec_stats;
+}
+
+static void js_print_exec_stats(const char *when) {
+    printf("JS %s: %d run, %d interrupted, %d deferred, %" PRIu64 " ms "
+        "(cpu %" PRIu64 " ms), longest %" PRIu64 " ms\n", when,
+        exec_stats.scripts_run, exec_stats.scripts_interrupted,
+        exec_stats.scripts_deferred, exec_stats.wall_usec / 1000,
+        exec_stats.cpu_usec / 1000, exec_stats.max_script_usec / 1000);
+    
+    js_bytecode_cache_stats_t bc = js_bytecode_cache_stats();
+    printf("JS bytecode cache: %u memory hits, %u disk hits, %u compiled, %u stale, %zu bytes\n",
+        bc.memory_hits, bc.disk_hits, bc.misses, bc.stale, bc.memory_bytes);
+}
+
+static void js_free_page_scripts(void) {
+    for (size_t i = 0; i < page_script_count; i++)
+        script_loader_release(page_scripts[i].fetch);
+    free(page_scripts);
+    page_scripts = NULL;
+    page_script_count = 0;
+    page_script_capacity = 0;
+}
+
+size_t js_deferred_script_count(void) {
+    size_t count = 0;
+    for (size_t i = 0; i < page_script_count; i++) {
+        if (!page_scripts[i].done)
+            count++;
+    }
+    return count;
+}
+
+void js_run_deferred_scripts(JSContext *ctx) {
+    size_t pending = js_deferred_script_count();
+    if (!ctx || pending == 0)
+        return;
+    
+    printf("=== RUNNING %zu DEFERRED SCRIPT(S) ===\n", pending);
+    
+    // Same order as before first paint, then wait for async scripts still
+    // in flight. Their DOM and style changes are laid out and painted by
+    // the frame requested below (on the host, the layout that follows).
+    running_deferred = true;
+    js_run_page_scripts(ctx);
+    for (size_t i = 0; i < page_script_count; i++) {
+        if (!page_scripts[i].done)
+            execute_single_script(ctx, &page_scripts[i], (int)i + 1);
+    }
+    running_deferred = false;
+    js_event_loop_request_frame();
+    
+    js_free_page_scripts();
+    js_print_exec_stats("after first paint");
+}
+
+// ===== Persistent runtime and realms =====
+//
+// The runtime (classes, atoms, bytecode cache, interrupt handler) lives for
+// the whole process. Each page gets its own context with the DOM API already
+// registered: a spare one is built while the previous page is idle and is
+// swapped in on navigation, where only the document pointer is bound.
+// QuickJS cannot clone a context, and reusing a page's context in place
+// would keep its top-level let/const bindings, so a clean pre-built realm
+// stands in for a reset one.
+
+static JSContext *page_ctx = NULL;      // realm of the current page
+static JSContext *spare_ctx = NULL;     // pre-built realm for the next page
+
+static bool js_runtime_init(void) {
+    if (global_rt)
+        return true;
+    
+    global_rt = JS_NewRuntime();
+    if (!global_rt) return false;
+    
+    JS_SetMemoryLimit(global_rt, 64 * 1024 * 1024);
+    JS_SetInterruptHandler(global_rt, js_interrupt_handler, NULL);
+    
+    // Outlives the runtime: bytecode is plain bytes, reusable by the next one
+    // Memory only when there is no private directory to keep it in
+    static bool bytecode_cache_ready = false;
+    if (!bytecode_cache_ready) {
+        char dir[CACHE_STORE_PATH_MAX];
+        bool private_dir = cache_store_dir(JS_BYTECODE_CACHE_NAME, dir, sizeof(dir)) == EOK;
+        bytecode_cache_ready = js_bytecode_cache_init(private_dir ? dir : NULL) == EOK;
+    }
+    return true;
+}
+
+// Intrinsics plus the document-independent DOM API
+static JSContext *js_realm_new(void) {
+    JSContext *ctx = JS_NewContext(global_rt);
+    if (!ctx) return NULL;
+    
+    //js_std_add_helpers(ctx, 0, NULL);
+    js_register_dom_api(ctx);
+    return ctx;
+}
+
+void js_engine_prewarm(void) {
+    if (!spare_ctx && js_runtime_init())
+        spare_ctx = js_realm_new();
+}
+
 // Initialize QuickJS engine - SAME FUNCTION NAME as Duktape version
 JSContext* js_engine_init(void) {
-    // Create runtime
-       // Create runtime and context only - NO DOM registration
-       global_rt = JS_NewRuntime();
-       if (!global_rt) return NULL;
-       
-       JS_SetMemoryLimit(global_rt, 64 * 1024 * 1024);
-       
-       JSContext *ctx = JS_NewContext(global_rt);
-       if (!ctx) {
-           JS_FreeRuntime(global_rt);
-           global_rt = NULL;
-           return NULL;
-       }
-       
-       //js_std_add_helpers(ctx, 0, NULL);
-       return ctx;
-   }
-
-   void js_register_dom(JSContext *ctx) {
-    // Now register DOM API with global_document set
-    js_register_dom_api(ctx);
+    if (!js_runtime_init()) return NULL;
+    
+    // A page that was never cleaned up gives its realm away now
+    if (page_ctx)
+        js_engine_cleanup(page_ctx);
+    
+    uint64_t start = pauk_time_usec();
+    bool prewarmed = spare_ctx != NULL;
+    JSContext *ctx = prewarmed ? spare_ctx : js_realm_new();
+    spare_ctx = NULL;
+    if (!ctx) return NULL;
+    
+    page_ctx = ctx;
+    js_event_loop_init(ctx);
+    printf("JS realm ready in %" PRIu64 " us (%s)\n", pauk_time_usec() - start,
+        prewarmed ? "pre-built" : "built now");
+    return ctx;
+}
+
+void js_register_dom(JSContext *ctx) {
+    // The API is in the realm already; bind this page's document
+    js_set_document(ctx, global_document);
 }
 
-// Cleanup - SAME FUNCTION NAME as Duktape version
+// End the page: its realm goes away, the runtime stays for the next one
 void js_engine_cleanup(JSContext *ctx) {
+    js_event_loop_cleanup();
+    event_handler_release_js(ctx);
+    js_handler_check_free();
+    js_free_page_scripts();
+    script_loader_cleanup();
     if (ctx) {
         JS_FreeContext(ctx);
+        if (ctx == page_ctx)
+            page_ctx = NULL;
+    }
+    // Finalize wrappers now, before their document is destroyed
+    if (global_rt)
+        JS_RunGC(global_rt);
+    global_document = NULL;
+    printf("QuickJS page context cleaned up\n");
+}
+
+void js_engine_shutdown(void) {
+    if (page_ctx)
+        js_engine_cleanup(page_ctx);
+    js_handler_check_free();
+    if (spare_ctx) {
+        JS_FreeContext(spare_ctx);
+        spare_ctx = NULL;
     }
     if (global_rt) {
         JS_FreeRuntime(global_rt);
@@ -530,13 +900,20 @@ void js_engine_cleanup(JSContext *ctx) {
 void js_execute_code(JSContext *ctx, const char *script) {
     if (!ctx || !script) return;
     
+    js_execute_source(ctx, script, strlen(script), "<script>");
+}
+
+// script must be NUL-terminated at script[len] (QuickJS requirement)
+void js_execute_source(JSContext *ctx, const char *script, size_t len, const char *filename) {
+    if (!ctx || !script) return;
+    
     // Skip empty scripts (same logic as your Duktape version)
-    if (strlen(script) == 0) {
+    if (len == 0) {
         printf("Empty script, skipping\n");
         return;
     }
     
-    printf("Executing JavaScript with QuickJS (%zu bytes)...\n", strlen(script));
+    printf("Executing JavaScript with QuickJS (%zu bytes)...\n", len);
     
     // Check for common HTML tags in script (same safety check)
     if (strstr(script, "<!DOCTYPE") || strstr(script, "<html") || 
@@ -546,23 +923,21 @@ void js_execute_code(JSContext *ctx, const char *script) {
         return;
     }
     
-    JSValue result = JS_Eval(ctx, script, strlen(script), "<script>", JS_EVAL_TYPE_GLOBAL);
+    if (js_budget_page_left() == 0) {
+        printf("Page script budget (%d ms) exhausted, skipping script\n", budget_page_ms);
+        return;
+    }
+    
+    js_budget_arm(true);
+    
+    // Compiled once, then run from cached bytecode
+    JSValue result = js_bytecode_eval(ctx, script, len, filename);
+    
+    js_budget_disarm();
+    exec_stats.scripts_run++;
     
     if (JS_IsException(result)) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        printf("JavaScript error: %s\n", error);
-        
-        // Get line number if available
-        JSValue line_number = JS_GetPropertyStr(ctx, exception, "lineNumber");
-        if (JS_IsNumber(line_number)) {
-            int line_num;
-            JS_ToInt32(ctx, &line_num, line_number);
-            printf("Error at line: %d\n", line_num);
-        }
-        JS_FreeValue(ctx, line_number);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
+        js_report_exception(ctx);
     } else {
         printf("JavaScript executed successfully\n");
         
@@ -577,58 +952,122 @@ void js_execute_code(JSContext *ctx, const char *script) {
     }
     
     JS_FreeValue(ctx, result);
+    
+    // Promise reactions queued by the script run before the next one
+    js_drain_microtasks(ctx);
+    
+    // End of this script's frame: apply its coalesced style writes
+    style_mutation_flush();
 }
 
-// Extract and execute script with crash protection - SAME LOGIC as Duktape version
-static void execute_single_script(JSContext *ctx, lxb_dom_node_t *node, int script_num) {
-    printf("Script #%d: Safe extraction...\n", script_num);
-    
-    // DIRECT EXTRACTION - same as your Duktape version
-    size_t script_len;
-    lxb_char_t *script_content = lxb_dom_node_text_content(node, &script_len);
+// Script text without a copy: a lone text child's character data goes to
+// the compiler as is (lexbor keeps it NUL-terminated, which QuickJS needs).
+// Anything else is concatenated by lexbor into *owned, which the caller
+// frees with lxb_dom_document_destroy_text().
+static const char *js_script_source(lxb_dom_node_t *node, size_t *len, lxb_char_t **owned) {
+    *owned = NULL;
+    *len = 0;
+    
+    lxb_dom_node_t *child = lxb_dom_node_first_child(node);
+    if (child && !lxb_dom_node_next(child) && child->type == LXB_DOM_NODE_TYPE_TEXT) {
+        lxb_dom_character_data_t *text = lxb_dom_interface_character_data(child);
+        if (text->data.data && text->data.length > 0 &&
+            text->data.data[text->data.length] == '\0') {
+            *len = text->data.length;
+            return (const char *)text->data.data;
+        }
+    }
     
-    if (!script_content || script_len == 0) {
-        printf("Script #%d: No content\n", script_num);
-        if (script_content) lxb_dom_document_destroy_text(node->owner_document, script_content);
+    *owned = lxb_dom_node_text_content(node, len);
+    return (const char *)*owned;
+}
+
+// Compiling takes several times the source size (tokens, atoms, bytecode);
+// refuse scripts the runtime's memory limit cannot hold instead of failing
+// half way through
+static bool js_source_fits_memory(JSContext *ctx, size_t len) {
+    JSMemoryUsage usage;
+    JS_ComputeMemoryUsage(JS_GetRuntime(ctx), &usage);
+    
+    // -1 = no limit
+    if (usage.malloc_limit <= 0)
+        return true;
+    
+    int64_t free_bytes = usage.malloc_limit - usage.malloc_size;
+    return free_bytes > 0 && len <= (uint64_t)free_bytes / JS_SOURCE_MEMORY_FACTOR;
+}
+
+// Run one page script; leaves it pending if it has to yield to first paint
+static void execute_single_script(JSContext *ctx, page_script_t *ps, int script_num) {
+    // Blocking scripts already used their share: let the page paint first
+    if (js_budget_should_yield()) {
+        if (!ps->yielded) {
+            ps->yielded = true;
+            exec_stats.scripts_deferred++;
+            printf("Script #%d: deferred until after first paint\n", script_num);
+        }
         return;
     }
+    ps->done = true;
     
-    printf("Script #%d: Got %zu bytes\n", script_num, script_len);
+    size_t script_len = 0;
+    lxb_char_t *owned = NULL;
+    const char *script;
+    const char *filename = "<script>";
     
-    // Simple allocation and copy (same as Duktape)
-    char *script_str = malloc(script_len + 1);
-    if (!script_str) {
-        printf("Script #%d: Allocation failed\n", script_num);
-        lxb_dom_document_destroy_text(node->owner_document, script_content);
+    if (ps->external && !ps->fetch) {
+        printf("Script #%d: cannot load its src (out of memory)\n", script_num);
         return;
+    } else if (ps->external) {
+        filename = script_loader_url(ps->fetch);
+        errno_t rc = script_loader_wait(ps->fetch, &script, &script_len);
+        if (rc != EOK) {
+            printf("Script #%d: cannot load %s (error %d)\n", script_num, filename, (int)rc);
+            return;
+        }
+    } else {
+        script = js_script_source(ps->node, &script_len, &owned);
     }
     
-    memcpy(script_str, script_content, script_len);
-    script_str[script_len] = '\0';
+    if (!script || script_len == 0) {
+        printf("Script #%d: No content\n", script_num);
+        if (owned) lxb_dom_document_destroy_text(ps->node->owner_document, owned);
+        return;
+    }
     
-    // Clean up IMMEDIATELY (same as Duktape)
-    lxb_dom_document_destroy_text(node->owner_document, script_content);
+    printf("Script #%d: %zu bytes from %s%s\n", script_num, script_len, filename,
+        owned ? " (joined)" : "");
     
     // Quick debug (same as Duktape)
     printf("Script #%d preview: ", script_num);
     if (script_len > 50) {
-        printf("%.50s...\n", script_str);
+        printf("%.50s...\n", script);
     } else {
-        printf("%s\n", script_str);
+        printf("%s\n", script);
     }
     
-    // Execute if reasonable size (same logic as Duktape)
-    if (script_len > 0 && script_len <= 5000) {
-        js_execute_code(ctx, script_str);
+    if (!js_source_fits_memory(ctx, script_len)) {
+        printf("Script #%d: %zu bytes does not fit the JS memory limit, skipping\n",
+            script_num, script_len);
     } else {
-        printf("Script #%d: Size %zu, skipping\n", script_num, script_len);
+        js_execute_source(ctx, script, script_len, filename);
     }
     
-    free(script_str);
+    if (owned)
+        lxb_dom_document_destroy_text(ps->node->owner_document, owned);
+    
+    // The text is not needed any more
+    script_loader_release(ps->fetch);
+    ps->fetch = NULL;
 }
 
-// Safe recursive script execution - SAME FUNCTION NAME as Duktape version
-void js_execute_script_elements_recursive(JSContext *ctx, lxb_dom_node_t *node, int *script_count) {
+static bool js_script_has_attr(lxb_dom_element_t *element, const char *name) {
+    return lxb_dom_element_attr_by_name(element, (const lxb_char_t *)name, strlen(name)) != NULL;
+}
+
+// Collect the page's <script> elements and start fetching external ones,
+// so every download is in flight before the first script runs
+static void js_collect_page_scripts(lxb_dom_node_t *node) {
     while (node) {
         if (node->type == LXB_DOM_NODE_TYPE_ELEMENT) {
             lxb_dom_element_t *element = lxb_dom_interface_element(node);
@@ -636,39 +1075,83 @@ void js_execute_script_elements_recursive(JSContext *ctx, lxb_dom_node_t *node,
             const lxb_char_t *name = lxb_dom_element_local_name(element, &name_len);
             
             if (name && name_len == 6 && memcmp(name, "script", 6) == 0) {
-                (*script_count)++;
+                if (page_script_count == page_script_capacity) {
+                    size_t cap = page_script_capacity ? page_script_capacity * 2 : 16;
+                    page_script_t *grown = realloc(page_scripts, cap * sizeof(page_script_t));
+                    if (!grown) {
+                        printf("Out of memory collecting scripts\n");
+                        return;
+                    }
+                    page_scripts = grown;
+                    page_script_capacity = cap;
+                }
                 
-                // Only process inline scripts (skip external)
-                lxb_dom_attr_t *src_attr = lxb_dom_element_attr_by_name(element, 
-                    (lxb_char_t*)"src", 3);
+                page_script_t *ps = &page_scripts[page_script_count++];
+                memset(ps, 0, sizeof(*ps));
+                ps->node = node;
+                ps->kind = PAGE_SCRIPT_CLASSIC;
                 
-                if (!src_attr) {
-                    execute_single_script(ctx, node, *script_count);
-                } else {
-                    printf("Script #%d: EXTERNAL (skipped)\n", *script_count);
+                // async/defer only mean something for external scripts
+                size_t src_len = 0;
+                const lxb_char_t *src = lxb_dom_element_get_attribute(element,
+                    (const lxb_char_t *)"src", 3, &src_len);
+                if (src) {
+                    ps->external = true;
+                    ps->fetch = script_loader_start((const char *)src, src_len);
+                    if (js_script_has_attr(element, "async"))
+                        ps->kind = PAGE_SCRIPT_ASYNC;
+                    else if (js_script_has_attr(element, "defer"))
+                        ps->kind = PAGE_SCRIPT_DEFER;
                 }
             }
         }
         
-        // Process children recursively - CORRECT
         lxb_dom_node_t *child = lxb_dom_node_first_child(node);
         if (child) {
-            js_execute_script_elements_recursive(ctx, child, script_count);
+            js_collect_page_scripts(child);
         }
         
         node = lxb_dom_node_next(node);
     }
 }
 
+// Async scripts whose text has arrived, in document order
+static void js_run_ready_async_scripts(JSContext *ctx) {
+    for (size_t i = 0; i < page_script_count; i++) {
+        page_script_t *ps = &page_scripts[i];
+        if (ps->kind == PAGE_SCRIPT_ASYNC && !ps->done && !ps->yielded &&
+            script_loader_ready(ps->fetch)) {
+            execute_single_script(ctx, ps, (int)i + 1);
+        }
+    }
+}
+
+// Classic scripts in order, then deferred ones in order; async scripts run
+// in between as soon as they are available. Async scripts still in flight
+// at the end are left for after first paint.
+static void js_run_page_scripts(JSContext *ctx) {
+    for (int pass = 0; pass < 2; pass++) {
+        page_script_kind_t kind = pass == 0 ? PAGE_SCRIPT_CLASSIC : PAGE_SCRIPT_DEFER;
+        for (size_t i = 0; i < page_script_count; i++) {
+            if (page_scripts[i].kind != kind || page_scripts[i].done)
+                continue;
+            js_run_ready_async_scripts(ctx);
+            execute_single_script(ctx, &page_scripts[i], (int)i + 1);
+        }
+    }
+    js_run_ready_async_scripts(ctx);
+}
+
 // Main script execution with crash protection - SAME FUNCTION NAME as Duktape
 void js_execute_script_elements(JSContext *ctx, lxb_html_document_t *document) {
     if (!ctx || !document) return;
     
     printf("=== EXECUTING SCRIPTS ===\n");
+    js_budget_begin_page();
+    js_free_page_scripts();
     
-    // CRITICAL: Register DOM API FIRST
+    // The realm has the DOM API already: bind this document to it
     js_set_document(ctx, document);
-    js_register_dom(ctx);
     
     printf("DOM API registered for JavaScript\n");
     
@@ -691,11 +1174,12 @@ void js_execute_script_elements(JSContext *ctx, lxb_html_document_t *document) {
     js_execute_code(ctx, dom_test_script);
     
     // 1. Execute all regular page scripts
-    int script_count = 0;
-    lxb_dom_node_t *root = lxb_dom_interface_node(document);
-    js_execute_script_elements_recursive(ctx, root, &script_count);
+    js_collect_page_scripts(lxb_dom_interface_node(document));
+    js_run_page_scripts(ctx);
     
-    printf("Executed %d regular script(s)\n", script_count);
+    printf("Executed %zu of %zu page script(s)\n",
+        page_script_count - js_deferred_script_count(), page_script_count);
+    js_print_exec_stats("before first paint");
     
     // 2. NOW run the layout calculator (AFTER all page scripts)
     printf("\n=== CALCULATING FINAL LAYOUT (Post-JS) ===\n");
@@ -891,11 +1375,18 @@ void js_set_security_policy(JSContext *ctx, SecurityPolicy policy) {
     printf("Setting JavaScript security policy:\n");
     printf("  Max memory: %zu bytes\n", policy.max_memory_bytes);
     printf("  Max execution time: %d ms\n", policy.max_execution_time_ms);
+    printf("  Max page execution time: %d ms\n", policy.max_page_execution_time_ms);
+    printf("  Yield to first paint after: %d ms\n", policy.yield_after_ms);
     printf("  Allow network APIs: %s\n", policy.allow_network_apis ? "yes" : "no");
     printf("  Allow file APIs: %s\n", policy.allow_file_apis ? "yes" : "no");
     printf("  Allow DOM APIs: %s\n", policy.allow_dom_apis ? "yes" : "no");
     printf("  Enable console: %s\n", policy.enable_console ? "yes" : "no");
     
+    // Time budgets are enforced by js_interrupt_handler
+    budget_script_ms = policy.max_execution_time_ms;
+    budget_page_ms = policy.max_page_execution_time_ms;
+    budget_yield_ms = policy.yield_after_ms;
+    
     // Apply memory limit
     JSRuntime *rt = JS_GetRuntime(ctx);
     if (rt && policy.max_memory_bytes > 0) {
@@ -936,6 +1427,8 @@ SecurityPolicy js_default_security_policy(void) {
     SecurityPolicy policy = {
         .max_memory_bytes = 64 * 1024 * 1024,  // 64 MB
         .max_execution_time_ms = 5000,         // 5 seconds
+        .max_page_execution_time_ms = 20000,   // 20 seconds
+        .yield_after_ms = 50,                  // then paint before running the rest
         .allow_network_apis = 0,               // No network by default
         .allow_file_apis = 0,                  // No file access by default
         .allow_dom_apis = 1,                   // DOM APIs allowed
@@ -5,11 +5,15 @@
 #include "quickjs-libc.h"
 #include "cjson.h"
 #include <lexbor/html/html.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 
 typedef struct {
     size_t max_memory_bytes;
-    int max_execution_time_ms;
+    int max_execution_time_ms;      // per script, 0 = unlimited
+    int max_page_execution_time_ms; // all scripts of a page, 0 = unlimited
+    int yield_after_ms;             // blocking JS before the rest waits for first paint, 0 = never
     int allow_network_apis;
     int allow_file_apis;
     int allow_dom_apis;
@@ -18,12 +22,19 @@ typedef struct {
 
 
 // QuickJS engine functions - SAME API as Duktape for easy replacement
+// js_engine_init() hands out a page context (pre-built by js_engine_prewarm()
+// when possible) on a runtime that lives until js_engine_shutdown();
+// js_engine_cleanup() ends the page and frees only its context
 JSContext* js_engine_init(void);
 void js_set_document(JSContext *ctx, lxb_html_document_t *document);
 void js_engine_cleanup(JSContext *ctx);
+// Build the next page's context now, while nothing else is running
+void js_engine_prewarm(void);
+void js_engine_shutdown(void);
 void js_execute_code(JSContext *ctx, const char *script);
+// Same, for text that is not a C string of its own (script[len] must be '\0')
+void js_execute_source(JSContext *ctx, const char *script, size_t len, const char *filename);
 void js_execute_script_elements(JSContext *ctx, lxb_html_document_t *document);
-void js_execute_script_elements_recursive(JSContext *ctx, lxb_dom_node_t *node, int *script_count);
 // DOM API registration
 void js_register_dom(JSContext *ctx);
 void js_register_dom_api(JSContext *ctx);
@@ -31,12 +42,45 @@ void js_register_dom_api(JSContext *ctx);
 SecurityPolicy js_default_security_policy(void);
 void js_set_security_policy(JSContext *ctx, SecurityPolicy policy);
 
+// Script time accounting for the current page
+typedef struct {
+    int scripts_run;
+    int scripts_interrupted;        // stopped by the time budget
+    int scripts_deferred;           // yielded until after first paint
+    int callbacks_run;              // timers, rAF, events
+    uint64_t wall_usec;
+    uint64_t cpu_usec;
+    uint64_t max_script_usec;
+} JSExecStats;
+
+JSExecStats js_get_exec_stats(void);
+
+// Call a JS callback (timer, rAF, event handler) under the per-script time
+// budget, report exceptions, then run the microtasks it queued
+bool js_call_function(JSContext *ctx, JSValueConst func, JSValueConst this_val,
+    int argc, JSValueConst *argv);
+// Same, keeping the result (JS_EXCEPTION when it threw, already reported)
+JSValue js_call_function_value(JSContext *ctx, JSValueConst func, JSValueConst this_val,
+    int argc, JSValueConst *argv);
+void js_drain_microtasks(JSContext *ctx);
+
+// Compile body (an on* attribute) as function (params) { body } under the
+// time budget. A body that does not stay inside the function is a
+// SyntaxError; JS_EXCEPTION then, with the exception pending in ctx.
+JSValue js_compile_handler(JSContext *ctx, const char *params, const char *body,
+    const char *filename);
+
+// Run the page scripts that yielded to first paint, in document order
+void js_run_deferred_scripts(JSContext *ctx);
+size_t js_deferred_script_count(void);
+
 //racunamo pozicije
 cJSON* get_computed_layout_from_js(JSContext *ctx);
 
 void init_js_modifications(void);
 cJSON* get_js_modifications(void);
 void cleanup_js_modifications(void);
+void js_style_set_property(lxb_dom_element_t *element, const char *property, const char *value);
 void js_register_element_modification(JSContext *ctx, 
     const char *element_id,
     const char *property,
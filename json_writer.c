@@ -0,0 +1,287 @@
+// json_writer.c - Streaming cJSON emitter over a fixed-size tee buffer
+//
+// Replaces cJSON_Print + fwrite + kopiraj_fajl for the big outputs: the tree
+// is walked once and written straight through one buffer into the output
+// file and its /data/web mirror, byte-for-byte the same text cJSON_Print
+// (or cJSON_PrintUnformatted) would have produced.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "json_writer.h"
+
+errno_t json_writer_open(json_writer_t *writer, const char *path, bool pretty)
+{
+    if (!writer || !path)
+        return EINVAL;
+
+    writer->sink_count = 0;
+    writer->pretty = pretty;
+    writer->failed = false;
+    writer->used = 0;
+    writer->total = 0;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return EIO;
+
+    writer->sinks[writer->sink_count++] = f;
+    return EOK;
+}
+
+errno_t json_writer_add_mirror(json_writer_t *writer, const char *dir, const char *path)
+{
+    if (!writer || !dir || !path)
+        return EINVAL;
+    if (writer->sink_count >= JSON_WRITER_MAX_SINKS)
+        return ELIMIT;
+
+    const char *filename = strrchr(path, '/');
+    filename = filename ? filename + 1 : path;
+
+    char dst_path[512];
+    size_t dir_len = strlen(dir);
+    snprintf(dst_path, sizeof(dst_path), "%s%s%s", dir,
+        (dir_len > 0 && dir[dir_len - 1] == '/') ? "" : "/", filename);
+
+    FILE *f = fopen(dst_path, "wb");
+    if (!f) {
+        printf("  WARNING: Cannot create mirror %s\n", dst_path);
+        return EIO;
+    }
+
+    writer->sinks[writer->sink_count++] = f;
+    return EOK;
+}
+
+static void json_writer_flush(json_writer_t *writer)
+{
+    if (writer->used == 0)
+        return;
+
+    for (int i = 0; i < writer->sink_count; i++) {
+        if (!writer->sinks[i])
+            continue;
+        if (fwrite(writer->buf, 1, writer->used, writer->sinks[i]) != writer->used) {
+            if (i == 0) {
+                writer->failed = true;
+            } else {
+                // Drop a broken mirror, keep writing the primary
+                fclose(writer->sinks[i]);
+                writer->sinks[i] = NULL;
+            }
+        }
+    }
+
+    writer->used = 0;
+}
+
+void json_writer_write(json_writer_t *writer, const char *data, size_t len)
+{
+    while (len > 0) {
+        size_t room = JSON_WRITER_BUFFER_SIZE - writer->used;
+        if (room == 0) {
+            json_writer_flush(writer);
+            room = JSON_WRITER_BUFFER_SIZE;
+        }
+
+        size_t n = (len < room) ? len : room;
+        memcpy(writer->buf + writer->used, data, n);
+        writer->used += n;
+        writer->total += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static inline void json_writer_putc(json_writer_t *writer, char c)
+{
+    if (writer->used == JSON_WRITER_BUFFER_SIZE)
+        json_writer_flush(writer);
+    writer->buf[writer->used++] = c;
+    writer->total++;
+}
+
+static void json_writer_indent(json_writer_t *writer, int depth)
+{
+    for (int i = 0; i < depth; i++)
+        json_writer_putc(writer, '\t');
+}
+
+static void json_writer_string(json_writer_t *writer, const char *str)
+{
+    json_writer_putc(writer, '"');
+
+    if (str) {
+        const char *run = str;
+        for (const char *p = str; *p; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (c >= 32 && c != '"' && c != '\\')
+                continue;
+
+            // Copy the plain run in one go, then the escape
+            json_writer_write(writer, run, p - run);
+            run = p + 1;
+
+            json_writer_putc(writer, '\\');
+            switch (c) {
+            case '"': json_writer_putc(writer, '"'); break;
+            case '\\': json_writer_putc(writer, '\\'); break;
+            case '\b': json_writer_putc(writer, 'b'); break;
+            case '\f': json_writer_putc(writer, 'f'); break;
+            case '\n': json_writer_putc(writer, 'n'); break;
+            case '\r': json_writer_putc(writer, 'r'); break;
+            case '\t': json_writer_putc(writer, 't'); break;
+            default: {
+                char esc[8];
+                int n = snprintf(esc, sizeof(esc), "u%04x", c);
+                json_writer_write(writer, esc, n);
+                break;
+            }
+            }
+        }
+        json_writer_write(writer, run, strlen(run));
+    }
+
+    json_writer_putc(writer, '"');
+}
+
+static void json_writer_number(json_writer_t *writer, const cJSON *item)
+{
+    double d = item->valuedouble;
+    char num[32];
+    int len;
+
+    // Same choices as cJSON's print_number
+    if (isnan(d) || isinf(d)) {
+        len = snprintf(num, sizeof(num), "null");
+    } else if (d == (double)item->valueint) {
+        len = snprintf(num, sizeof(num), "%d", item->valueint);
+    } else {
+        len = snprintf(num, sizeof(num), "%1.15g", d);
+        if (strtod(num, NULL) != d)
+            len = snprintf(num, sizeof(num), "%1.17g", d);
+    }
+
+    json_writer_write(writer, num, len);
+}
+
+static void json_writer_item(json_writer_t *writer, const cJSON *item, int depth)
+{
+    const cJSON *child;
+
+    if (!item) {
+        json_writer_write(writer, "null", 4);
+        return;
+    }
+
+    switch (item->type & 0xFF) {
+    case cJSON_False:
+        json_writer_write(writer, "false", 5);
+        break;
+    case cJSON_True:
+        json_writer_write(writer, "true", 4);
+        break;
+    case cJSON_NULL:
+        json_writer_write(writer, "null", 4);
+        break;
+    case cJSON_Number:
+        json_writer_number(writer, item);
+        break;
+    case cJSON_Raw:
+        if (item->valuestring)
+            json_writer_write(writer, item->valuestring, strlen(item->valuestring));
+        break;
+    case cJSON_String:
+        json_writer_string(writer, item->valuestring);
+        break;
+    case cJSON_Array:
+        json_writer_putc(writer, '[');
+        for (child = item->child; child; child = child->next) {
+            json_writer_item(writer, child, depth);
+            if (child->next) {
+                json_writer_putc(writer, ',');
+                if (writer->pretty)
+                    json_writer_putc(writer, ' ');
+            }
+        }
+        json_writer_putc(writer, ']');
+        break;
+    case cJSON_Object:
+        json_writer_putc(writer, '{');
+        if (writer->pretty)
+            json_writer_putc(writer, '\n');
+        for (child = item->child; child; child = child->next) {
+            if (writer->pretty)
+                json_writer_indent(writer, depth + 1);
+            json_writer_string(writer, child->string);
+            json_writer_putc(writer, ':');
+            if (writer->pretty)
+                json_writer_putc(writer, '\t');
+            json_writer_item(writer, child, depth + 1);
+            if (child->next)
+                json_writer_putc(writer, ',');
+            if (writer->pretty)
+                json_writer_putc(writer, '\n');
+        }
+        if (writer->pretty)
+            json_writer_indent(writer, depth);
+        json_writer_putc(writer, '}');
+        break;
+    default:
+        break;
+    }
+}
+
+void json_writer_value(json_writer_t *writer, const cJSON *item)
+{
+    if (!writer)
+        return;
+    json_writer_item(writer, item, 0);
+}
+
+errno_t json_writer_close(json_writer_t *writer, size_t *bytes_out)
+{
+    if (!writer)
+        return EINVAL;
+
+    json_writer_flush(writer);
+
+    for (int i = 0; i < writer->sink_count; i++) {
+        if (!writer->sinks[i])
+            continue;
+        if (fclose(writer->sinks[i]) != 0 && i == 0)
+            writer->failed = true;
+        writer->sinks[i] = NULL;
+    }
+    writer->sink_count = 0;
+
+    if (bytes_out)
+        *bytes_out = writer->total;
+
+    return writer->failed ? EIO : EOK;
+}
+
+errno_t json_write_file(const cJSON *item, const char *path, bool pretty,
+    const char *mirror_dir, size_t *bytes_out)
+{
+    // The buffer is too big for fibril stacks, keep it on the heap
+    json_writer_t *writer = malloc(sizeof(json_writer_t));
+    if (!writer)
+        return ENOMEM;
+
+    errno_t rc = json_writer_open(writer, path, pretty);
+    if (rc != EOK) {
+        free(writer);
+        return rc;
+    }
+
+    if (mirror_dir)
+        (void)json_writer_add_mirror(writer, mirror_dir, path);
+
+    json_writer_value(writer, item);
+    rc = json_writer_close(writer, bytes_out);
+    free(writer);
+    return rc;
+}
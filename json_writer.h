@@ -0,0 +1,44 @@
+// json_writer.h - Streaming cJSON emitter over a fixed-size tee buffer
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "cjson.h"
+
+#define JSON_WRITER_BUFFER_SIZE 16384
+#define JSON_WRITER_MAX_SINKS 4
+
+// Output is staged in buf and flushed to every sink when it fills, so the
+// peak memory for writing a document is the buffer, not the document.
+typedef struct {
+    FILE *sinks[JSON_WRITER_MAX_SINKS];
+    int sink_count;
+    bool pretty;            // same layout as cJSON_Print, else cJSON_PrintUnformatted
+    bool failed;            // a write to the primary sink failed
+    size_t used;
+    size_t total;           // bytes emitted so far
+    char buf[JSON_WRITER_BUFFER_SIZE];
+} json_writer_t;
+
+// Open path as the primary sink
+errno_t json_writer_open(json_writer_t *writer, const char *path, bool pretty);
+
+// Tee into <dir>/<basename of path> as well. Failing to open a mirror only
+// warns; the primary output is unaffected.
+errno_t json_writer_add_mirror(json_writer_t *writer, const char *dir, const char *path);
+
+void json_writer_write(json_writer_t *writer, const char *data, size_t len);
+void json_writer_value(json_writer_t *writer, const cJSON *item);
+
+// Flush and close all sinks; bytes_out (optional) receives the total size
+errno_t json_writer_close(json_writer_t *writer, size_t *bytes_out);
+
+// One-shot: stream item into path, optionally mirrored into mirror_dir
+errno_t json_write_file(const cJSON *item, const char *path, bool pretty,
+    const char *mirror_dir, size_t *bytes_out);
+
+#endif // JSON_WRITER_H
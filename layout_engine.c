@@ -1,5 +1,7 @@
 #include "layout_engine.h"
 #include "css_parser.h"
+#include "css_color.h"
+#include "style_mutation.h"
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
@@ -70,6 +72,11 @@ static double get_default_font_size(const char *tag_name) {
 const char* get_css_property(lxb_dom_element_t *element, 
                              const char *property_name,
                              const char *default_value) {
+    // Script writes (element.style.x = ...) override the style attribute
+    const char *scripted = style_mutation_computed(element, property_name);
+    if (scripted)
+        return strdup(scripted);
+
     // First check inline style
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(element, LXB_DOM_ATTR_STYLE);
     if (style_attr) {
@@ -82,8 +89,19 @@ const char* get_css_property(lxb_dom_element_t *element,
                 memcpy(style_str, style_value, style_len);
                 style_str[style_len] = '\0';
                 
-                // Simple parsing - look for property
+                // Simple parsing - look for property. The match must be a whole
+                // declaration name, so "color" does not hit "background-color".
+                size_t name_len = strlen(property_name);
                 char *pos = strstr(style_str, property_name);
+                while (pos) {
+                    bool starts = (pos == style_str || pos[-1] == ';' ||
+                        isspace((unsigned char)pos[-1]));
+                    char *after = pos + name_len;
+                    while (*after == ' ' || *after == '\t') after++;
+                    if (starts && *after == ':')
+                        break;
+                    pos = strstr(pos + 1, property_name);
+                }
                 if (pos) {
                     pos += strlen(property_name);
                     while (*pos && (*pos == ' ' || *pos == ':')) pos++;
@@ -169,6 +187,31 @@ ComputedStyle compute_element_style(lxb_dom_element_t *element,
     }
     free(font_size);
     
+    // Colors are resolved once here; painting takes the packed ARGB values
+    style.color_argb = parent_style ? parent_style->color_argb : 0xFF000000;
+    style.bg_argb = 0;
+
+    char *color = (char*)get_css_property(element, "color", NULL);
+    if (color && strlen(color) > 0) {
+        uint32_t argb;
+        if (css_color_parse(color, &argb))
+            style.color_argb = argb;
+    }
+    free(color);
+
+    char *bg = (char*)get_css_property(element, "background-color", NULL);
+    if (!bg || strlen(bg) == 0) {
+        free(bg);
+        // "background" shorthand, only when the whole value is a color
+        bg = (char*)get_css_property(element, "background", NULL);
+    }
+    if (bg && strlen(bg) > 0) {
+        uint32_t argb;
+        if (css_color_parse(bg, &argb))
+            style.bg_argb = argb;
+    }
+    free(bg);
+
     // Parse margins and paddings (simplified)
     style.margin_top = style.margin_bottom = style.margin_left = style.margin_right = 0;
     style.padding_top = style.padding_bottom = style.padding_left = style.padding_right = 0;
@@ -550,6 +593,8 @@ cJSON_AddNumberToObject(elem_json, "width", box.width);
 cJSON_AddNumberToObject(elem_json, "height", box.height);
 cJSON_AddStringToObject(elem_json, "display", style.display);
 cJSON_AddNumberToObject(elem_json, "font_size", style.font_size);
+cJSON_AddNumberToObject(elem_json, "color_argb", style.color_argb);
+cJSON_AddNumberToObject(elem_json, "bg_argb", style.bg_argb);
 
 // Add to layout result
 const lxb_char_t *id = lxb_dom_element_id(element, &len);
@@ -658,6 +703,10 @@ cJSON* calculate_document_layout(lxb_html_document_t *document) {
     }
     
     printf("=== CALCULATING DOCUMENT LAYOUT ===\n");
+
+    // This pass resolves every flushed script style write, so nothing is
+    // left dirty afterwards
+    style_mutation_clear_dirty();
     
     cJSON *layout = cJSON_CreateObject();
     if (!layout) {
@@ -682,6 +731,8 @@ cJSON* calculate_document_layout(lxb_html_document_t *document) {
     root_style.line_height = 19.2;
     root_style.display = "block";
     root_style.position = "static";
+    root_style.color_argb = 0xFF000000;
+    root_style.bg_argb = 0;
     
     // Elements
     cJSON *elements = cJSON_CreateObject();
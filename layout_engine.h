@@ -1,6 +1,7 @@
 #ifndef LAYOUT_ENGINE_H
 #define LAYOUT_ENGINE_H
 
+#include <stdint.h>
 #include "cjson.h"
 #include "main.h"
 #include <lexbor/html/html.h>
@@ -26,6 +27,8 @@ typedef struct {
     double padding_right;
     double padding_bottom;
     double padding_left;
+    uint32_t color_argb;   // resolved "color", inherited (0xAARRGGBB)
+    uint32_t bg_argb;      // resolved "background-color", 0 = transparent
 } ComputedStyle;
 
 // Layout calculation functions
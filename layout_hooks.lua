@@ -0,0 +1,19 @@
+-- layout_hooks.lua - Lua callbacks for boxes of the native layout pass
+--
+-- layout.register(selector, fn) claims the boxes a selector matches:
+-- "tag", ".class" or "tag.class". After a claimed box has its native
+-- layout, fn(node, x, y, width) is called with the render node (read and
+-- write its fields: x, y, layout_width, layout_height, ...), its position
+-- and the width available to it. Returning a number sets layout_height.
+--
+-- Each call may run LUA_LAYOUT_HOOK_NODE_BUDGET instructions, all calls of
+-- a page LUA_LAYOUT_HOOK_PAGE_BUDGET; a callback that errors or runs out
+-- keeps the native geometry. Nodes are only valid during the call.
+--
+-- With nothing registered the layout pass stays entirely native.
+
+-- Example: leave room under every <figure class="captioned">
+--
+-- layout.register("figure.captioned", function(node, x, y, width)
+--     return node.layout_height + 24
+-- end)
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "main.h"  // For parse_inline_styles_simple, get_element_text_simple
+#include "style_mutation.h"
 
 // Static storage
 static ListToExtract *lists_to_extract = NULL;
@@ -201,8 +202,8 @@ cJSON* extract_list_structure(lxb_dom_element_t *list_elem) {
     
     // Get list styles
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(list_elem, LXB_DOM_ATTR_STYLE);
-    if (style_attr) {
-        cJSON *styles = parse_inline_styles_simple(style_attr);
+    if (style_attr || style_mutation_has_element(list_elem)) {
+        cJSON *styles = element_inline_styles(list_elem);
         if (styles) {
             add_default_list_styles(styles, list_type);
             cJSON_AddItemToObject(list_json, "list_style", styles);
@@ -359,8 +360,8 @@ if (item_text) free(item_text);
     
     // Get item styles
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(item_elem, LXB_DOM_ATTR_STYLE);
-    if (style_attr) {
-        cJSON *styles = parse_inline_styles_simple(style_attr);
+    if (style_attr || style_mutation_has_element(item_elem)) {
+        cJSON *styles = element_inline_styles(item_elem);
         if (styles) {
             add_default_list_item_styles(styles, nesting_level);
             cJSON_AddItemToObject(item_json, "style", styles);
@@ -0,0 +1,344 @@
+// lua_layout_hooks.c - Per-node Lua callbacks for the native layout pass
+//
+// The Lua stage was all or nothing: calculate_positions() got the whole
+// page, ran for as long as it liked and had to lay out every node even when
+// a script only cared about one kind of box. Scripts now claim boxes
+// instead:
+//
+//     layout.register("div.card", function(node, x, y, width)
+//         node.layout_height = node.layout_height + 8
+//     end)
+//
+// position_layout.c keeps doing the layout and calls into Lua only for the
+// boxes a selector ("tag", ".class" or "tag.class") matches, right after
+// their native layout. Every call runs under an instruction-count hook with
+// a per-node and a per-page budget; a callback that errors or overruns gets
+// its box's native geometry back, and once the page budget is gone the rest
+// of the pass is native.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "lua_layout_hooks.h"
+#include "lua_position.h"
+#include "lua_render_tree.h"
+
+// The count hook fires every LAYOUT_HOOK_SLICE instructions
+#define LAYOUT_HOOK_SLICE 1000
+
+typedef struct {
+    char *tag;                  // lower case, NULL = any tag
+    char *class_name;           // NULL = any class
+    int fn_ref;
+} layout_hook_rule_t;
+
+static lua_State *hooks_L;
+static bool hooks_loaded;
+static layout_hook_rule_t *rules;
+static size_t rule_count;
+static size_t rule_capacity;
+
+// Budget state of the current pass, in instructions
+static long node_used;
+static long page_used;
+static bool page_exhausted;
+static bool in_pass;
+
+static void layout_hook_count(lua_State *L, lua_Debug *ar)
+{
+    (void)ar;
+    node_used += LAYOUT_HOOK_SLICE;
+    page_used += LAYOUT_HOOK_SLICE;
+    if (page_used >= LUA_LAYOUT_HOOK_PAGE_BUDGET)
+        luaL_error(L, "layout hooks: page budget of %d instructions used up",
+            LUA_LAYOUT_HOOK_PAGE_BUDGET);
+    if (node_used >= LUA_LAYOUT_HOOK_NODE_BUDGET)
+        luaL_error(L, "layout hook: node budget of %d instructions used up",
+            LUA_LAYOUT_HOOK_NODE_BUDGET);
+}
+
+// "tag", ".class" or "tag.class"
+static int layout_register(lua_State *L)
+{
+    const char *selector = luaL_checkstring(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+
+    const char *dot = strchr(selector, '.');
+    size_t tag_len = dot ? (size_t)(dot - selector) : strlen(selector);
+    const char *class_name = dot ? dot + 1 : NULL;
+    if (tag_len == 0 && (!class_name || !*class_name))
+        return luaL_error(L, "layout.register: empty selector");
+    if (class_name && (!*class_name || strchr(class_name, '.') || strchr(class_name, ' ')))
+        return luaL_error(L, "layout.register: bad selector '%s'", selector);
+
+    if (rule_count == rule_capacity) {
+        size_t capacity = rule_capacity ? rule_capacity * 2 : 8;
+        layout_hook_rule_t *grown = realloc(rules, capacity * sizeof(*rules));
+        if (!grown)
+            return luaL_error(L, "out of memory");
+        rules = grown;
+        rule_capacity = capacity;
+    }
+
+    layout_hook_rule_t *rule = &rules[rule_count];
+    rule->tag = NULL;
+    rule->class_name = NULL;
+    if (tag_len > 0) {
+        rule->tag = malloc(tag_len + 1);
+        if (!rule->tag)
+            return luaL_error(L, "out of memory");
+        memcpy(rule->tag, selector, tag_len);
+        rule->tag[tag_len] = '\0';
+        for (char *c = rule->tag; *c; c++)
+            *c = (char)tolower((unsigned char)*c);
+    }
+    if (class_name) {
+        rule->class_name = strdup(class_name);
+        if (!rule->class_name) {
+            free(rule->tag);
+            return luaL_error(L, "out of memory");
+        }
+    }
+    lua_pushvalue(L, 2);
+    rule->fn_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    rule_count++;
+    return 0;
+}
+
+static void free_rules(void)
+{
+    for (size_t i = 0; i < rule_count; i++) {
+        free(rules[i].tag);
+        free(rules[i].class_name);
+    }
+    free(rules);
+    rules = NULL;
+    rule_count = 0;
+    rule_capacity = 0;
+}
+
+static const char *hooks_script_path(void)
+{
+#ifdef PAUK_HOST
+    const char *env = getenv("PAUK_LAYOUT_HOOKS");
+    if (env && *env)
+        return env;
+#endif
+    return LUA_LAYOUT_HOOKS_SCRIPT;
+}
+
+static void hooks_load(void)
+{
+    const char *path = hooks_script_path();
+    FILE *probe = fopen(path, "rb");
+    if (!probe)
+        return;                 // no script: the pass stays native
+    fclose(probe);
+
+    lua_State *L = luaL_newstate();
+    if (!L) {
+        fprintf(stderr, "ERROR: Cannot create Lua state for layout hooks\n");
+        return;
+    }
+    lua_position_open_libs(L);
+    lua_render_tree_init(L);
+
+    lua_newtable(L);
+    lua_pushcfunction(L, layout_register);
+    lua_setfield(L, -2, "register");
+    lua_setglobal(L, "layout");
+
+    // The script's top level runs under the page budget too
+    node_used = 0;
+    page_used = 0;
+    lua_sethook(L, layout_hook_count, LUA_MASKCOUNT, LAYOUT_HOOK_SLICE);
+    int rc = lua_position_load_chunk(L, path);
+    if (rc == LUA_OK)
+        rc = lua_pcall(L, 0, 0, 0);
+    if (rc != LUA_OK) {
+        fprintf(stderr, "ERROR loading layout hooks %s: %s\n", path, lua_tostring(L, -1));
+        lua_close(L);
+        free_rules();
+        return;
+    }
+
+    if (rule_count == 0) {
+        lua_close(L);
+        return;
+    }
+    printf("Layout hooks: %zu selector(s) from %s\n", rule_count, path);
+    hooks_L = L;
+}
+
+bool lua_layout_hooks_begin(void)
+{
+    if (!hooks_loaded) {
+        hooks_loaded = true;
+        hooks_load();
+    }
+    node_used = 0;
+    page_used = 0;
+    page_exhausted = false;
+    in_pass = hooks_L != NULL;
+    return in_pass;
+}
+
+static bool class_list_has(const char *class_string, const char *class_name)
+{
+    size_t len = strlen(class_name);
+    const char *p = class_string;
+    while (*p) {
+        while (*p && isspace((unsigned char)*p))
+            p++;
+        const char *start = p;
+        while (*p && !isspace((unsigned char)*p))
+            p++;
+        if ((size_t)(p - start) == len && strncmp(start, class_name, len) == 0)
+            return true;
+    }
+    return false;
+}
+
+static bool rule_matches(const layout_hook_rule_t *rule, const char *tag, const char *class_string)
+{
+    if (rule->tag && (!tag || strcasecmp(rule->tag, tag) != 0))
+        return false;
+    if (rule->class_name && (!class_string || !class_list_has(class_string, rule->class_name)))
+        return false;
+    return true;
+}
+
+bool lua_layout_hooks_match(const char *tag, const char *class_string)
+{
+    if (!in_pass || page_exhausted || !tag || !*tag)
+        return false;
+    for (size_t i = 0; i < rule_count; i++) {
+        if (rule_matches(&rules[i], tag, class_string))
+            return true;
+    }
+    return false;
+}
+
+// The four fields a callback may move; restored when it fails
+static const char *const geometry_fields[] = { "x", "y", "layout_width", "layout_height" };
+#define GEOMETRY_FIELD_COUNT 4
+
+typedef struct {
+    bool present[GEOMETRY_FIELD_COUNT];
+    double value[GEOMETRY_FIELD_COUNT];
+} node_geometry_t;
+
+static void geometry_save(cJSON *node, node_geometry_t *g)
+{
+    for (int i = 0; i < GEOMETRY_FIELD_COUNT; i++) {
+        cJSON *item = cJSON_GetObjectItemCaseSensitive(node, geometry_fields[i]);
+        g->present[i] = item && cJSON_IsNumber(item);
+        g->value[i] = g->present[i] ? item->valuedouble : 0;
+    }
+}
+
+static void geometry_restore(cJSON *node, const node_geometry_t *g)
+{
+    for (int i = 0; i < GEOMETRY_FIELD_COUNT; i++) {
+        cJSON *item = cJSON_GetObjectItemCaseSensitive(node, geometry_fields[i]);
+        if (g->present[i] && item && cJSON_IsNumber(item)) {
+            cJSON_SetNumberValue(item, g->value[i]);
+            continue;
+        }
+        if (item)
+            cJSON_DeleteItemFromObject(node, geometry_fields[i]);
+        if (g->present[i])
+            cJSON_AddNumberToObject(node, geometry_fields[i], g->value[i]);
+    }
+}
+
+// Numbers stay numbers: anything else would trip the finalize pass
+static bool geometry_valid(cJSON *node, const node_geometry_t *g)
+{
+    for (int i = 0; i < GEOMETRY_FIELD_COUNT; i++) {
+        cJSON *item = cJSON_GetObjectItemCaseSensitive(node, geometry_fields[i]);
+        if (g->present[i] && (!item || !cJSON_IsNumber(item)))
+            return false;
+    }
+    return true;
+}
+
+static void set_layout_height(cJSON *node, double height)
+{
+    cJSON *item = cJSON_GetObjectItemCaseSensitive(node, "layout_height");
+    if (item && cJSON_IsNumber(item))
+        cJSON_SetNumberValue(item, height);
+    else {
+        if (item)
+            cJSON_DeleteItemFromObject(node, "layout_height");
+        cJSON_AddNumberToObject(node, "layout_height", height);
+    }
+}
+
+int lua_layout_hooks_apply(cJSON *node, int x, int y, int container_width, int height)
+{
+    if (!in_pass || page_exhausted || !node)
+        return height;
+
+    lua_State *L = hooks_L;
+    cJSON *tag_item = cJSON_GetObjectItemCaseSensitive(node, "tag");
+    cJSON *class_item = cJSON_GetObjectItemCaseSensitive(node, "class_string");
+    const char *tag = cJSON_IsString(tag_item) ? tag_item->valuestring : NULL;
+    const char *class_string = cJSON_IsString(class_item) ? class_item->valuestring : NULL;
+
+    for (size_t i = 0; i < rule_count && !page_exhausted; i++) {
+        if (!rule_matches(&rules[i], tag, class_string))
+            continue;
+
+        node_geometry_t saved;
+        geometry_save(node, &saved);
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, rules[i].fn_ref);
+        lua_render_tree_push(L, node);
+        lua_pushinteger(L, x);
+        lua_pushinteger(L, y);
+        lua_pushinteger(L, container_width);
+
+        node_used = 0;
+        int rc = lua_pcall(L, 4, 1, 0);
+        if (rc == LUA_OK && lua_type(L, -1) == LUA_TNUMBER)
+            set_layout_height(node, lua_tonumber(L, -1));
+
+        if (rc != LUA_OK || !geometry_valid(node, &saved)) {
+            fprintf(stderr, "Layout hook <%s>: %s; native layout kept\n", tag ? tag : "?",
+                rc != LUA_OK ? lua_tostring(L, -1) : "geometry is not numeric");
+            geometry_restore(node, &saved);
+            if (page_used >= LUA_LAYOUT_HOOK_PAGE_BUDGET)
+                page_exhausted = true;
+        }
+        lua_pop(L, 1);
+    }
+
+    cJSON *lh = cJSON_GetObjectItemCaseSensitive(node, "layout_height");
+    return cJSON_IsNumber(lh) ? (int)lh->valuedouble : height;
+}
+
+void lua_layout_hooks_end(void)
+{
+    if (!in_pass)
+        return;
+    in_pass = false;
+    lua_render_tree_invalidate();
+    lua_gc(hooks_L, LUA_GCSTEP, 0);
+}
+
+void lua_layout_hooks_shutdown(void)
+{
+    if (hooks_L) {
+        lua_close(hooks_L);
+        hooks_L = NULL;
+    }
+    free_rules();
+    hooks_loaded = false;
+    in_pass = false;
+}
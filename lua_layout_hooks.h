@@ -0,0 +1,34 @@
+// lua_layout_hooks.h - Per-node Lua callbacks for the native layout pass
+#ifndef LUA_LAYOUT_HOOKS_H
+#define LUA_LAYOUT_HOOKS_H
+
+#include <stdbool.h>
+#include "cjson.h"
+
+// Hook script: layout_hooks.lua next to the page files (PAUK_LAYOUT_HOOKS
+// overrides it on the host)
+#define LUA_LAYOUT_HOOKS_SCRIPT "layout_hooks.lua"
+
+// Instructions one callback, and all callbacks of one page, may run
+#define LUA_LAYOUT_HOOK_NODE_BUDGET 200000
+#define LUA_LAYOUT_HOOK_PAGE_BUDGET 5000000
+
+// Start of a layout pass: loads the script the first time. Returns false
+// when no hook is registered, so the pass can skip the lookups entirely.
+bool lua_layout_hooks_begin(void);
+
+// Does a registered selector claim this box
+bool lua_layout_hooks_match(const char *tag, const char *class_string);
+
+// Run the callbacks claiming node after its native layout; returns the
+// height to use. A callback that fails or runs out of budget leaves the
+// native x, y, layout_width and layout_height in place.
+int lua_layout_hooks_apply(cJSON *node, int x, int y, int container_width, int height);
+
+// End of the pass: node proxies handed to Lua stop working
+void lua_layout_hooks_end(void);
+
+// Close the hook state (at exit)
+void lua_layout_hooks_shutdown(void);
+
+#endif // LUA_LAYOUT_HOOKS_H
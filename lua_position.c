@@ -1,11 +1,15 @@
 // lua_position.c - C interface to Lua position calculator
 #include "lua_position.h"
+#include "lua_render_tree.h"
+#include "file_source.h"
+#include "cache_store.h"
 #include "main.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Helper function to print Lua stack for debugging
 static void print_lua_stack(lua_State* L, const char* context) {
@@ -28,19 +32,288 @@ static void print_lua_stack(lua_State* L, const char* context) {
     }
 }
 
-// Initialize Lua and load position calculation script
+// ===== Long-lived states =====
+//
+// Every use used to fopen the script, create a state, open every standard
+// library and parse position_calculator*.lua from source. A state is now
+// kept per script for the life of the process: the first use loads the
+// script as precompiled bytecode from the chunk cache (compiling and
+// dumping it on a miss), later uses get the warm state back, and
+// cleanup_lua_position_calculator() only resets what a page left behind.
+
+#define LUA_POSITION_MAX_STATES 4
+
+// Precompiled chunks live in the private "lua" cache_store directory, so
+// nothing lua_load runs as bytecode ("b") was written by anyone else or
+// read back without its SHA-256 matching. Key = SHA-256 over the engine
+// digest and the script text (a content hash; an edited script never
+// matches an old entry, whatever its mtime). The engine digest covers
+// LUA_VERSION_NUM, the pointer size and the stripped dump of a probe
+// chunk, whose header carries the bytecode format and number sizes.
+#define LUA_CHUNK_CACHE_NAME "lua"
+#define LUA_CHUNK_FILE_MAGIC 0x43554C50u        // "PLUC"
+#define LUA_CHUNK_MAX_BYTES (4 * 1024 * 1024)
+#define LUA_CHUNK_PROBE "local a, b = ... return { a + b, a .. '', b * 2 }"
+
+typedef struct {
+    char* path;             // NULL = free slot
+    lua_State* L;
+    int baseline_ref;       // registry: global names present after loading
+    int config_ref;         // registry: copy of the module's initial config
+} lua_position_state_t;
+
+static lua_position_state_t position_states[LUA_POSITION_MAX_STATES];
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+} lua_chunk_buffer_t;
+
+static char lua_chunk_dir[CACHE_STORE_PATH_MAX];
+static bool lua_chunk_dir_checked = false;
+static bool lua_chunk_dir_ok = false;
+
+static uint8_t lua_engine_digest[SHA256_DIGEST_LEN];
+static bool lua_engine_digest_ready = false;
+
+static int lua_chunk_writer(lua_State* L, const void* p, size_t size, void* ud);
+
+static bool lua_chunk_engine_digest(lua_State* L) {
+    if (lua_engine_digest_ready)
+        return true;
+    
+    if (luaL_loadbufferx(L, LUA_CHUNK_PROBE, strlen(LUA_CHUNK_PROBE), "=probe", "t") != LUA_OK) {
+        lua_pop(L, 1);
+        return false;
+    }
+    lua_chunk_buffer_t dump = { NULL, 0, 0 };
+    bool ok = lua_dump(L, lua_chunk_writer, &dump, 1) == 0 && dump.len > 0;
+    lua_pop(L, 1);
+    
+    if (ok) {
+        uint32_t build[2] = { (uint32_t)LUA_VERSION_NUM, (uint32_t)sizeof(void*) };
+        sha256_t h;
+        sha256_init(&h);
+        sha256_update(&h, build, sizeof(build));
+        sha256_update(&h, dump.data, dump.len);
+        sha256_final(&h, lua_engine_digest);
+        lua_engine_digest_ready = true;
+    }
+    free(dump.data);
+    return ok;
+}
+
+static void lua_chunk_key(const char* source, size_t len, uint8_t key[SHA256_DIGEST_LEN]) {
+    sha256_t h;
+    sha256_init(&h);
+    sha256_update(&h, lua_engine_digest, sizeof(lua_engine_digest));
+    sha256_update(&h, source, len);
+    sha256_final(&h, key);
+}
+
+// Without a private directory nothing is cached
+static const char* lua_chunk_cache_dir(void) {
+    if (!lua_chunk_dir_checked) {
+        lua_chunk_dir_checked = true;
+        lua_chunk_dir_ok = cache_store_dir(LUA_CHUNK_CACHE_NAME, lua_chunk_dir,
+            sizeof(lua_chunk_dir)) == EOK;
+    }
+    return lua_chunk_dir_ok ? lua_chunk_dir : NULL;
+}
+
+static int lua_chunk_writer(lua_State* L, const void* p, size_t size, void* ud) {
+    (void)L;
+    lua_chunk_buffer_t* buf = ud;
+    if (buf->len + size > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity * 2 : 4096;
+        while (capacity < buf->len + size)
+            capacity *= 2;
+        char* grown = realloc(buf->data, capacity);
+        if (!grown) return 1;
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->len, p, size);
+    buf->len += size;
+    return 0;
+}
+
+// Push the script's main chunk: cached bytecode when there is a matching
+// file, otherwise compiled from source and dumped for next time
+int lua_position_load_chunk(lua_State* L, const char* path) {
+    file_source_t source;
+    if (file_source_open(&source, path, LUA_CHUNK_MAX_BYTES, 0) != EOK) {
+        lua_pushfstring(L, "cannot read %s", path);
+        return LUA_ERRFILE;
+    }
+    
+    char chunkname[520];
+    snprintf(chunkname, sizeof(chunkname), "@%s", path);
+    const char* dir = lua_chunk_engine_digest(L) ? lua_chunk_cache_dir() : NULL;
+    uint8_t key[SHA256_DIGEST_LEN];
+    uint8_t* chunk = NULL;
+    size_t chunk_len = 0;
+    if (dir) {
+        lua_chunk_key(source.data, source.len, key);
+        if (cache_store_get(dir, LUA_CHUNK_FILE_MAGIC, key, LUA_CHUNK_MAX_BYTES,
+                            &chunk, &chunk_len) != EOK)
+            chunk = NULL;
+    }
+    if (chunk) {
+        // Verified above: written by this build for exactly this source
+        int rc = luaL_loadbufferx(L, (const char*)chunk, chunk_len, chunkname, "b");
+        free(chunk);
+        if (rc == LUA_OK) {
+            printf("Lua script loaded from precompiled chunk (%zu bytes)\n", chunk_len);
+            file_source_close(&source);
+            return LUA_OK;
+        }
+        lua_pop(L, 1);
+        cache_store_remove(dir, key);
+    }
+    
+    int rc = luaL_loadbufferx(L, source.data, source.len, chunkname, "t");
+    if (rc == LUA_OK) {
+        lua_chunk_buffer_t dump = { NULL, 0, 0 };
+        // Keep debug info: layout errors should still name a line
+        if (dir && lua_dump(L, lua_chunk_writer, &dump, 0) == 0 && dump.len > 0)
+            cache_store_put(dir, LUA_CHUNK_FILE_MAGIC, key, dump.data, dump.len);
+        free(dump.data);
+    }
+    file_source_close(&source);
+    return rc;
+}
+
+// The calculator needs no io, os, package or debug
+void lua_position_open_libs(lua_State* L) {
+    static const luaL_Reg libs[] = {
+        { "_G", luaopen_base },
+        { LUA_TABLIBNAME, luaopen_table },
+        { LUA_STRLIBNAME, luaopen_string },
+        { LUA_MATHLIBNAME, luaopen_math },
+        { NULL, NULL }
+    };
+    
+    for (const luaL_Reg* lib = libs; lib->func; lib++) {
+        luaL_requiref(L, lib->name, lib->func, 1);
+        lua_pop(L, 1);
+    }
+}
+
+// Shallow copy of the table at idx, pushed
+static void copy_table(lua_State* L, int idx) {
+    idx = lua_absindex(L, idx);
+    lua_newtable(L);
+    lua_pushnil(L);
+    while (lua_next(L, idx) != 0) {
+        lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        lua_settable(L, -4);
+    }
+}
+
+// Remember what the loaded script defined, for lua_position_reset()
+static void snapshot_baseline(lua_State* L, lua_position_state_t* state) {
+    lua_pushglobaltable(L);
+    copy_table(L, -1);
+    state->baseline_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_pop(L, 1);
+    
+    state->config_ref = LUA_NOREF;
+    lua_getglobal(L, "calculate_positions");
+    if (lua_istable(L, -1)) {
+        lua_getfield(L, -1, "config");
+        if (lua_istable(L, -1)) {
+            copy_table(L, -1);
+            state->config_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+}
+
+// Drop globals a page created, restore overwritten ones and the config
+static void lua_position_reset(lua_State* L, lua_position_state_t* state) {
+    lua_pushglobaltable(L);
+    int globals = lua_gettop(L);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, state->baseline_ref);
+    int baseline = lua_gettop(L);
+    
+    // Collect first: assigning during lua_next is not allowed for new keys
+    lua_newtable(L);
+    int extra = lua_gettop(L);
+    int extra_count = 0;
+    lua_pushnil(L);
+    while (lua_next(L, globals) != 0) {
+        lua_pop(L, 1);
+        lua_pushvalue(L, -1);
+        lua_rawget(L, baseline);
+        bool known = !lua_isnil(L, -1);
+        lua_pop(L, 1);
+        if (!known) {
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, extra, ++extra_count);
+        }
+    }
+    for (int i = 1; i <= extra_count; i++) {
+        lua_rawgeti(L, extra, i);
+        lua_pushnil(L);
+        lua_rawset(L, globals);
+    }
+    
+    lua_pushnil(L);
+    while (lua_next(L, baseline) != 0) {
+        lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        lua_rawset(L, globals);
+    }
+    lua_settop(L, globals - 1);
+    
+    if (state->config_ref != LUA_NOREF) {
+        lua_getglobal(L, "calculate_positions");
+        if (lua_istable(L, -1)) {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, state->config_ref);
+            copy_table(L, -1);
+            lua_setfield(L, -3, "config");
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+    }
+    
+    lua_gc(L, LUA_GCCOLLECT, 0);
+}
+
+static lua_position_state_t* find_position_state(lua_State* L, const char* path) {
+    for (int i = 0; i < LUA_POSITION_MAX_STATES; i++) {
+        lua_position_state_t* state = &position_states[i];
+        if (!state->path) continue;
+        if ((L && state->L == L) || (path && strcmp(state->path, path) == 0))
+            return state;
+    }
+    return NULL;
+}
+
+// Initialize Lua and load position calculation script; a warm state for
+// the same script is handed back as is
 lua_State* init_lua_position_calculator(const char* lua_script_path) {
-    printf("Initializing Lua position calculator...\n");
-    printf("Looking for script: %s\n", lua_script_path);
+    if (!lua_script_path) return NULL;
+    
+    lua_position_state_t* warm = find_position_state(NULL, lua_script_path);
+    if (warm) return warm->L;
     
-    // Check if file exists first
-    FILE* test = fopen(lua_script_path, "r");
-    if (!test) {
-        printf("ERROR: Lua script file not found: %s (errno: %d)\n", 
-               lua_script_path, errno);
+    lua_position_state_t* slot = NULL;
+    for (int i = 0; i < LUA_POSITION_MAX_STATES && !slot; i++) {
+        if (!position_states[i].path)
+            slot = &position_states[i];
+    }
+    if (!slot) {
+        printf("ERROR: Too many Lua position calculators\n");
         return NULL;
     }
-    fclose(test);
+    
+    printf("Initializing Lua position calculator...\n");
+    printf("Looking for script: %s\n", lua_script_path);
     
     // Create Lua state
     lua_State* L = luaL_newstate();
@@ -51,13 +324,14 @@ lua_State* init_lua_position_calculator(const char* lua_script_path) {
     
     printf("Lua state created successfully\n");
     
-    // Open standard libraries
-    luaL_openlibs(L);
-    printf("Lua standard libraries loaded\n");
+    lua_position_open_libs(L);
+    printf("Lua base, table, string and math libraries loaded\n");
+    
+    // Render tree proxies handed to calculate_positions()
+    lua_render_tree_init(L);
     
-    // Try to load the script file
-    printf("Loading Lua script from: %s\n", lua_script_path);
-    int load_result = luaL_loadfile(L, lua_script_path);
+    // Load the script (precompiled when possible)
+    int load_result = lua_position_load_chunk(L, lua_script_path);
     
     if (load_result != LUA_OK) {
         const char* error_msg = lua_tostring(L, -1);
@@ -136,6 +410,14 @@ lua_State* init_lua_position_calculator(const char* lua_script_path) {
     }
     lua_pop(L, 2);  // Pop function and module table
     
+    slot->path = strdup(lua_script_path);
+    if (!slot->path) {
+        lua_close(L);
+        return NULL;
+    }
+    slot->L = L;
+    snapshot_baseline(L, slot);
+    
     printf("Lua position calculator initialized successfully\n");
     return L;
 }
@@ -185,7 +467,40 @@ static void push_layout_config(lua_State* L, LuaLayoutConfig* config) {
     lua_pop(L, 1);  // Pop module table
 }
 
-// Calculate positions using Lua
+// Summary entry for every element Lua gave a size to
+static void collect_lua_positions(cJSON* node, cJSON* elements) {
+    if (!node) return;
+    
+    if (cJSON_IsObject(node)) {
+        cJSON* tag = cJSON_GetObjectItemCaseSensitive(node, "tag");
+        cJSON* width = cJSON_GetObjectItemCaseSensitive(node, "calculated_width");
+        if (tag && cJSON_IsString(tag) && width && cJSON_IsNumber(width)) {
+            cJSON* entry = cJSON_CreateObject();
+            if (entry) {
+                static const char* const fields[] = {
+                    "tag", "id", "type", "x", "y", "calculated_width",
+                    "calculated_height", "dimension_source", NULL
+                };
+                for (int i = 0; fields[i]; i++) {
+                    cJSON* value = cJSON_GetObjectItemCaseSensitive(node, fields[i]);
+                    if (value && (cJSON_IsString(value) || cJSON_IsNumber(value)))
+                        cJSON_AddItemToObject(entry, fields[i], cJSON_Duplicate(value, 0));
+                }
+                cJSON_AddItemToArray(elements, entry);
+            }
+        }
+    }
+    
+    cJSON* child;
+    cJSON_ArrayForEach(child, node) {
+        if (cJSON_IsObject(child) || cJSON_IsArray(child))
+            collect_lua_positions(child, elements);
+    }
+}
+
+// Calculate positions using Lua. The script reads the tree through
+// lua_render_tree proxies and writes x/y/calculated_* into it directly;
+// the returned summary lists what it positioned.
 cJSON* calculate_positions_lua(lua_State* L, cJSON* document_json, LuaLayoutConfig* config) {
     if (!L || !document_json) {
         printf("[LUA ERROR] Invalid parameters to calculate_positions_lua\n");
@@ -194,23 +509,11 @@ cJSON* calculate_positions_lua(lua_State* L, cJSON* document_json, LuaLayoutConf
     
     printf("Calculating positions with Lua...\n");
     
-    // Convert cJSON to string
-    char* json_str = cJSON_PrintUnformatted(document_json);
-    if (!json_str) {
-        fprintf(stderr, "ERROR: Cannot convert JSON to string\n");
-        return NULL;
-    }
-    
-    printf("[LUA] JSON string length: %zu chars\n", strlen(json_str));
-    if (strlen(json_str) < 100) {
-        printf("[LUA] JSON preview: %.100s...\n", json_str);
-    }
-    
     // Get the calculate_positions function from Lua
     lua_getglobal(L, "calculate_positions");
     if (!lua_istable(L, -1)) {
         fprintf(stderr, "ERROR: Global 'calculate_positions' is not a table\n");
-        free(json_str);
+        lua_pop(L, 1);
         return NULL;
     }
     
@@ -218,25 +521,21 @@ cJSON* calculate_positions_lua(lua_State* L, cJSON* document_json, LuaLayoutConf
     if (!lua_isfunction(L, -1)) {
         fprintf(stderr, "ERROR: calculate_positions function not found in Lua module\n");
         lua_pop(L, 2);  // Pop function check and module table
-        free(json_str);
         return NULL;
     }
-    
-    printf("[LUA] Found calculate_positions function\n");
+    lua_remove(L, -2);  // Module table
     
     // Push configuration if provided
     if (config) {
         push_layout_config(L, config);
     }
     
-    // Push JSON string as argument
-    lua_pushstring(L, json_str);
-    free(json_str);
-    
-    printf("[LUA] Calling Lua function...\n");
+    lua_render_tree_push(L, document_json);
     
-    // Call the function (1 argument, 1 result)
-    if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+    // 1 argument; element count, document width, document height
+    int rc = lua_pcall(L, 1, 3, 0);
+    lua_render_tree_invalidate();
+    if (rc != LUA_OK) {
         const char* error_msg = lua_tostring(L, -1);
         fprintf(stderr, "ERROR calling Lua function: %s\n", error_msg);
         print_lua_stack(L, "PCALL ERROR");
@@ -244,45 +543,31 @@ cJSON* calculate_positions_lua(lua_State* L, cJSON* document_json, LuaLayoutConf
         return NULL;
     }
     
-    printf("[LUA] Function call successful\n");
+    int element_count = (int)lua_tonumber(L, -3);
+    int document_width = (int)lua_tonumber(L, -2);
+    int document_height = (int)lua_tonumber(L, -1);
+    lua_pop(L, 3);
     
-    // Get the result string
-    if (!lua_isstring(L, -1)) {
-        fprintf(stderr, "ERROR: Lua function didn't return a string (got %s)\n",
-                lua_typename(L, lua_type(L, -1)));
-        print_lua_stack(L, "WRONG RETURN TYPE");
-        lua_pop(L, 1);
+    cJSON* result_json = cJSON_CreateObject();
+    cJSON* elements = cJSON_CreateArray();
+    if (!result_json || !elements) {
+        cJSON_Delete(result_json);
+        cJSON_Delete(elements);
         return NULL;
     }
+    collect_lua_positions(document_json, elements);
     
-    const char* result_str = lua_tostring(L, -1);
-    printf("[LUA] Result string length: %zu chars\n", strlen(result_str));
-    
-    if (strlen(result_str) < 200) {
-        printf("[LUA] Result preview: %.200s...\n", result_str);
-    }
+    char message[64];
+    snprintf(message, sizeof(message), "Enhanced %d elements with file references", element_count);
+    cJSON_AddBoolToObject(result_json, "success", 1);
+    cJSON_AddStringToObject(result_json, "message", message);
+    cJSON_AddNumberToObject(result_json, "document_width", document_width);
+    cJSON_AddNumberToObject(result_json, "document_height", document_height);
+    cJSON_AddNumberToObject(result_json, "element_count", element_count);
+    cJSON_AddItemToObject(result_json, "elements", elements);
     
-    // Parse result back to cJSON
-    cJSON* result_json = cJSON_Parse(result_str);
-    
-    // Pop result from stack
-    lua_pop(L, 1);
-    
-    if (!result_json) {
-        fprintf(stderr, "ERROR: Cannot parse Lua result as JSON\n");
-        fprintf(stderr, "Result was: %.500s...\n", result_str);
-    } else {
-        printf("Position calculation completed successfully\n");
-        
-        // Print summary
-        cJSON* doc_width = cJSON_GetObjectItem(result_json, "document_width");
-        cJSON* doc_height = cJSON_GetObjectItem(result_json, "document_height");
-        if (doc_width && doc_height) {
-            printf("Document dimensions: %dx%d\n", 
-                   (int)doc_width->valuedouble, 
-                   (int)doc_height->valuedouble);
-        }
-    }
+    printf("Position calculation completed successfully\n");
+    printf("Document dimensions: %dx%d\n", document_width, document_height);
     
     return result_json;
 }
@@ -478,12 +763,29 @@ void merge_lua_positions_fixed(cJSON* main_output, cJSON* lua_output) {
     printf("=== MERGE COMPLETE ===\n");
 }
 
-// Cleanup
+// Done with a document: the state stays warm, only the page's leftovers go
 void cleanup_lua_position_calculator(lua_State* L) {
-    if (L) {
-        printf("Cleaning up Lua position calculator...\n");
+    if (!L) return;
+    
+    lua_position_state_t* state = find_position_state(L, NULL);
+    if (!state) {
+        // Not one of ours
         lua_close(L);
-        printf("Lua position calculator cleaned up\n");
+        return;
+    }
+    lua_position_reset(L, state);
+}
+
+void lua_position_shutdown(void) {
+    for (int i = 0; i < LUA_POSITION_MAX_STATES; i++) {
+        lua_position_state_t* state = &position_states[i];
+        if (!state->path) continue;
+        
+        printf("Cleaning up Lua position calculator %s...\n", state->path);
+        lua_close(state->L);
+        free(state->path);
+        state->path = NULL;
+        state->L = NULL;
     }
 }
 
@@ -492,28 +794,15 @@ void cleanup_lua_position_calculator(lua_State* L) {
 
 // Helper function to read a JSON file
 cJSON* read_json_file(const char* filename) {
-    FILE* f = fopen(filename, "rb");
-    if (!f) {
+    file_source_t src;
+    if (file_source_open(&src, filename, 0, 0) != EOK) {
         printf("ERROR: Cannot open JSON file: %s\n", filename);
         return NULL;
     }
     
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char* content = malloc(size + 1);
-    if (!content) {
-        fclose(f);
-        return NULL;
-    }
-    
-    fread(content, 1, size, f);
-    content[size] = '\0';
-    fclose(f);
-    
-    cJSON* json = cJSON_Parse(content);
-    free(content);
+    // Parsed from the view: no copy of the file text
+    cJSON* json = cJSON_ParseWithLength(src.data, src.len);
+    file_source_close(&src);
     
     if (!json) {
         printf("ERROR: Invalid JSON in file: %s\n", filename);
@@ -532,14 +821,8 @@ void save_and_merge_lua_output(cJSON* rendering_output, cJSON* lua_output, const
     char lua_raw_file[512];
     snprintf(lua_raw_file, sizeof(lua_raw_file), "%s_lua_raw.json", output_file);
     
-    FILE* raw_file = fopen(lua_raw_file, "wb");
-    if (raw_file) {
-        char* raw_json = cJSON_Print(lua_output);
-        fwrite(raw_json, 1, strlen(raw_json), raw_file);
-        free(raw_json);
-        fclose(raw_file);
+    if (write_json_output(lua_output, lua_raw_file) == 0) {
         printf("Raw Lua output saved to: %s\n", lua_raw_file);
-        kopiraj_fajl(lua_raw_file);
     }
     
     // 2. Extract Lua elements
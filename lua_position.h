@@ -17,18 +17,30 @@ typedef struct {
     int padding_inside_elements;
 } LuaLayoutConfig;
 
-// Initialize Lua and load position calculation script
+// Initialize Lua and load position calculation script. The state is kept
+// per script: later calls return it warm.
 lua_State* init_lua_position_calculator(const char* lua_script_path);
 
+// Open base, table, string and math (the calculator needs nothing else)
+void lua_position_open_libs(lua_State* L);
+
+// Push the main chunk of the script at path, from the precompiled chunk
+// cache when it matches; returns a lua_load() status
+int lua_position_load_chunk(lua_State* L, const char* path);
+
 // Calculate positions using Lua
 cJSON* calculate_positions_lua(lua_State* L, cJSON* document_json, LuaLayoutConfig* config);
 
 // Calculate positions from JSON string
 cJSON* calculate_positions_from_json_string(lua_State* L, const char* json_str, LuaLayoutConfig* config);
 
-// Cleanup
+// End of a document: reset the globals and config the page changed; the
+// state stays loaded for the next page
 void cleanup_lua_position_calculator(lua_State* L);
 
+// Close every state (at exit)
+void lua_position_shutdown(void);
+
 void merge_lua_positions_fixed(cJSON* main_output, cJSON* lua_output);
 
 void save_and_merge_lua_output(cJSON* rendering_output, cJSON* lua_output, const char* output_file);
@@ -0,0 +1,207 @@
+// lua_render_tree.c - Lua view of the cJSON render tree
+//
+// The position calculator used to receive the document as one JSON string,
+// find every object by scanning it a character at a time and pull each
+// field out with string.match; its answer came back as another JSON string
+// for cJSON_Parse. Lua now gets userdata proxies over the cJSON nodes
+// instead: __index reads a field when the script asks for it, __newindex
+// writes the result straight into the tree, and nothing is serialized in
+// either direction.
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <lauxlib.h>
+
+#include "lua_render_tree.h"
+
+#define LUA_RENDER_TREE_META "pauk.render_node"
+
+typedef struct {
+    cJSON *item;
+    cJSON *cursor;              // last array element reached (ipairs walks)
+    int cursor_index;           // its 1-based index
+    unsigned generation;
+} lua_tree_node_t;
+
+// Bumped by lua_render_tree_invalidate(); older proxies refuse to work
+static unsigned tree_generation = 1;
+
+static lua_tree_node_t *lua_tree_check(lua_State *L, int idx)
+{
+    lua_tree_node_t *node = luaL_checkudata(L, idx, LUA_RENDER_TREE_META);
+    if (node->generation != tree_generation)
+        luaL_error(L, "render tree node used after its layout pass");
+    return node;
+}
+
+static void lua_tree_push_value(lua_State *L, cJSON *item)
+{
+    if (!item || cJSON_IsNull(item))
+        lua_pushnil(L);
+    else if (cJSON_IsString(item))
+        lua_pushstring(L, item->valuestring);
+    else if (cJSON_IsNumber(item))
+        lua_pushnumber(L, item->valuedouble);
+    else if (cJSON_IsBool(item))
+        lua_pushboolean(L, cJSON_IsTrue(item));
+    else if (cJSON_IsObject(item) || cJSON_IsArray(item))
+        lua_render_tree_push(L, item);
+    else
+        lua_pushnil(L);
+}
+
+// Array element by 1-based index; sequential access is O(1) per step
+static cJSON *lua_tree_array_at(lua_tree_node_t *node, lua_Integer index)
+{
+    if (index < 1)
+        return NULL;
+
+    cJSON *child = node->item->child;
+    lua_Integer i = 1;
+    if (node->cursor && index >= node->cursor_index) {
+        child = node->cursor;
+        i = node->cursor_index;
+    }
+    while (child && i < index) {
+        child = child->next;
+        i++;
+    }
+
+    if (child) {
+        node->cursor = child;
+        node->cursor_index = (int)index;
+    }
+    return child;
+}
+
+static int lua_tree_index(lua_State *L)
+{
+    lua_tree_node_t *node = lua_tree_check(L, 1);
+
+    if (cJSON_IsArray(node->item)) {
+        if (!lua_isinteger(L, 2)) {
+            lua_pushnil(L);
+            return 1;
+        }
+        lua_tree_push_value(L, lua_tree_array_at(node, lua_tointeger(L, 2)));
+        return 1;
+    }
+
+    if (lua_type(L, 2) != LUA_TSTRING) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_tree_push_value(L, cJSON_GetObjectItemCaseSensitive(node->item, lua_tostring(L, 2)));
+    return 1;
+}
+
+static int lua_tree_newindex(lua_State *L)
+{
+    lua_tree_node_t *node = lua_tree_check(L, 1);
+    if (!cJSON_IsObject(node->item))
+        return luaL_error(L, "render tree arrays are read-only");
+
+    const char *key = luaL_checkstring(L, 2);
+    cJSON *old = cJSON_GetObjectItemCaseSensitive(node->item, key);
+    int type = lua_type(L, 3);
+
+    // Proxies may still point into a subtree: those are never replaced
+    if (old && (cJSON_IsObject(old) || cJSON_IsArray(old)))
+        return luaL_error(L, "render tree field '%s' holds nodes and cannot be set", key);
+
+    // Layout passes rewrite the same numbers over and over: update in place
+    if (old && type == LUA_TNUMBER && cJSON_IsNumber(old)) {
+        cJSON_SetNumberValue(old, lua_tonumber(L, 3));
+        return 0;
+    }
+    if (old && type == LUA_TSTRING && cJSON_IsString(old) &&
+        cJSON_SetValuestring(old, lua_tostring(L, 3)))
+        return 0;
+
+    cJSON *value = NULL;
+    switch (type) {
+    case LUA_TNIL:
+        break;
+    case LUA_TNUMBER:
+        value = cJSON_CreateNumber(lua_tonumber(L, 3));
+        break;
+    case LUA_TSTRING:
+        value = cJSON_CreateString(lua_tostring(L, 3));
+        break;
+    case LUA_TBOOLEAN:
+        value = cJSON_CreateBool(lua_toboolean(L, 3));
+        break;
+    default:
+        return luaL_error(L, "render tree field '%s': only numbers, strings and booleans", key);
+    }
+    if (type != LUA_TNIL && !value)
+        return luaL_error(L, "out of memory");
+
+    if (old)
+        cJSON_DeleteItemFromObject(node->item, key);
+    if (value)
+        cJSON_AddItemToObject(node->item, key, value);
+    return 0;
+}
+
+static int lua_tree_len(lua_State *L)
+{
+    lua_tree_node_t *node = lua_tree_check(L, 1);
+    lua_pushinteger(L, cJSON_GetArraySize(node->item));
+    return 1;
+}
+
+static int lua_tree_tostring(lua_State *L)
+{
+    lua_tree_node_t *node = luaL_checkudata(L, 1, LUA_RENDER_TREE_META);
+    if (node->generation != tree_generation) {
+        lua_pushstring(L, "render node (stale)");
+        return 1;
+    }
+
+    cJSON *tag = cJSON_IsObject(node->item) ?
+        cJSON_GetObjectItemCaseSensitive(node->item, "tag") : NULL;
+    if (cJSON_IsArray(node->item))
+        lua_pushfstring(L, "render array (%d)", cJSON_GetArraySize(node->item));
+    else if (tag && cJSON_IsString(tag))
+        lua_pushfstring(L, "render node <%s>", tag->valuestring);
+    else
+        lua_pushstring(L, "render node");
+    return 1;
+}
+
+static const luaL_Reg lua_tree_meta[] = {
+    { "__index", lua_tree_index },
+    { "__newindex", lua_tree_newindex },
+    { "__len", lua_tree_len },
+    { "__tostring", lua_tree_tostring },
+    { NULL, NULL }
+};
+
+void lua_render_tree_init(lua_State *L)
+{
+    if (luaL_newmetatable(L, LUA_RENDER_TREE_META))
+        luaL_setfuncs(L, lua_tree_meta, 0);
+    lua_pop(L, 1);
+}
+
+void lua_render_tree_push(lua_State *L, cJSON *item)
+{
+    if (!item) {
+        lua_pushnil(L);
+        return;
+    }
+
+    lua_tree_node_t *node = lua_newuserdata(L, sizeof(lua_tree_node_t));
+    node->item = item;
+    node->cursor = NULL;
+    node->cursor_index = 0;
+    node->generation = tree_generation;
+    luaL_setmetatable(L, LUA_RENDER_TREE_META);
+}
+
+void lua_render_tree_invalidate(void)
+{
+    tree_generation++;
+}
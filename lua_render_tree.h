@@ -0,0 +1,20 @@
+// lua_render_tree.h - Lua view of the cJSON render tree
+#ifndef LUA_RENDER_TREE_H
+#define LUA_RENDER_TREE_H
+
+#include <lua.h>
+#include "cjson.h"
+
+// Register the node metatable on L (once per state)
+void lua_render_tree_init(lua_State *L);
+
+// Push a proxy for an object or array of the tree. Fields are read when
+// Lua indexes them (objects and arrays come back as proxies, scalars as Lua
+// values); assigning a number, string, boolean or nil writes the tree.
+void lua_render_tree_push(lua_State *L, cJSON *item);
+
+// Every proxy pushed so far stops working; call when the pass is over and
+// the tree may change or be freed
+void lua_render_tree_invalidate(void);
+
+#endif // LUA_RENDER_TREE_H
@@ -6,9 +6,11 @@
 #include <lexbor/html/html.h>
 #include <lexbor/dom/dom.h>
 
+#ifndef PAUK_HOST
 #include <gfx/bitmap.h>
 #include <gfx/render.h>
 #include <gfx/context.h>
+#endif
 
 #include "cjson.h"
 #include "css_parser.h"
@@ -27,13 +29,37 @@
 #include "render_output.h"
 #include "lua_position.h"
 #include "position_layout.h"
+#include "lua_layout_hooks.h"
+#include "css_color.h"
+#include "json_writer.h"
+#include "dom_id_index.h"
+#include "style_mutation.h"
+#include "js_bytecode_cache.h"
+#include "script_loader.h"
+#include "js_event_loop.h"
+#include "html_stream.h"
+#include "preload_scanner.h"
+#include "file_source.h"
+#include "http_fetch.h"
+#include "http_cache.h"
+#include "cache_store.h"
+#include "pauk_sync.h"
 
+#ifdef PAUK_HOST
+#include "headless.h"
+#include "page_paint.h"
+#else
 #include "gui.h"
+#endif
 
 
 static cJSON *global_computed_layout = NULL;
 static DocumentOutline global_document_outline;
 
+// Set while streamed blocks are rendered for an early paint: the
+// extractors are left alone, the full pass after parsing registers them
+static bool preview_pass = false;
+
 // Simplified element structure for rendering
 typedef struct {
     const char *tag;
@@ -67,61 +93,82 @@ int kopiraj_fajl(const char *src_file) {
     
     // Build destination path
     char dst_path[512];
-    snprintf(dst_path, sizeof(dst_path), "/data/web/%s", filename);
+    snprintf(dst_path, sizeof(dst_path), "%s%s", KOPIRAJ_DIR, filename);
     
     printf("Copying %s -> %s\n", src_file, dst_path);
     
-    FILE *src = fopen(src_file, "rb");
-    if (!src) {
+    // Written straight from the mapping where the file can be mapped,
+    // otherwise through a fixed buffer, never the whole file at once
+    file_source_t src;
+    errno_t map_rc = file_source_open(&src, src_file, 0,
+        FILE_SOURCE_SEQUENTIAL | FILE_SOURCE_MAP_ONLY);
+    FILE *in = NULL;
+    if (map_rc == ENOTSUP)
+        in = fopen(src_file, "rb");
+    if (map_rc != EOK && !in) {
         printf("  ERROR: Cannot open source file\n");
         return -1;
     }
     
-    // Get file size
-    fseek(src, 0, SEEK_END);
-    long size = ftell(src);
-    fseek(src, 0, SEEK_SET);
-    
-    if (size <= 0) {
-        fclose(src);
-        printf("  WARNING: Source file is empty\n");
+    FILE *dst = fopen(dst_path, "wb");
+    if (!dst) {
+        if (in)
+            fclose(in);
+        else
+            file_source_close(&src);
+        printf("  ERROR: Cannot create destination file\n");
         return -1;
     }
     
-    // Read entire file
-    char *buffer = malloc(size + 1);
-    if (!buffer) {
-        fclose(src);
-        return -1;
+    int rc = 0;
+    size_t size = 0;
+    if (in) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+            if (fwrite(buffer, 1, n, dst) != n) {
+                printf("  ERROR: Write failed\n");
+                rc = -1;
+                break;
+            }
+            size += n;
+        }
+        fclose(in);
+    } else {
+        size = src.len;
+        if (fwrite(src.data, 1, src.len, dst) != src.len) {
+            printf("  ERROR: Write failed\n");
+            rc = -1;
+        } else if (!file_source_intact(&src)) {
+            printf("  ERROR: Source file shrank while it was copied\n");
+            rc = -1;
+        }
+        file_source_close(&src);
     }
     
-    size_t read = fread(buffer, 1, size, src);
-    fclose(src);
-    
-    if (read != (size_t)size) {
-        free(buffer);
-        printf("  ERROR: Read failed\n");
-        return -1;
-    }
+    fclose(dst);
     
-    // Write to destination
-    FILE *dst = fopen(dst_path, "wb");
-    if (!dst) {
-        free(buffer);
-        printf("  ERROR: Cannot create destination file\n");
+    if (rc == 0 && size == 0) {
+        printf("  WARNING: Source file is empty\n");
         return -1;
     }
     
-    size_t written = fwrite(buffer, 1, size, dst);
-    fclose(dst);
-    free(buffer);
-    
-    if (written != (size_t)size) {
-        printf("  ERROR: Write failed\n");
+    if (rc == 0)
+        printf("  Success: %zu bytes copied\n", size);
+    return rc;
+}
+
+// Stream a JSON tree (cJSON_Print layout) into path and, with KOPIRAJ,
+// into KOPIRAJ_DIR in the same pass. Returns 0 on success like kopiraj_fajl.
+int write_json_output(const cJSON *json, const char *path) {
+    size_t written = 0;
+    errno_t rc = json_write_file(json, path, true, KOPIRAJ ? KOPIRAJ_DIR : NULL, &written);
+    if (rc != EOK) {
+        printf("ERROR: Could not write %s\n", path);
         return -1;
     }
     
-    printf("  Success: %ld bytes copied\n", size);
+    if(INFO_MESSAGES)  printf("Wrote %zu bytes to %s\n", written, path);
     return 0;
 }
 //ZA ATRIBUTE
@@ -275,8 +322,8 @@ cJSON* element_to_rendering_json(lxb_dom_element_t *elem, int is_inline) {
     
     // Get inline styles for rendering
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(elem, LXB_DOM_ATTR_STYLE);
-    if (style_attr) {
-        cJSON *styles = parse_inline_styles_simple(style_attr);
+    if (style_attr || style_mutation_has_element(elem)) {
+        cJSON *styles = element_inline_styles(elem);
         if (styles) {
             // Extract common style properties
             cJSON *bg_color = cJSON_GetObjectItem(styles, "background-color");
@@ -450,6 +497,13 @@ char* get_element_text_simple(lxb_dom_element_t *elem) {
     return result;
 }
 
+// Inline style properties the rendering tree uses
+static const char *const inline_relevant_styles[] = {
+    "color", "background-color", "font-size", "font-weight",
+    "font-style", "text-decoration", "width", "height",
+    "display", "position", "margin", "padding", NULL
+};
+
 // Parse inline styles simply
 cJSON* parse_inline_styles_simple(lxb_dom_attr_t *style_attr) {
     if (!style_attr) return NULL;
@@ -501,14 +555,8 @@ cJSON* parse_inline_styles_simple(lxb_dom_attr_t *style_attr) {
             
             if (strlen(prop) > 0 && strlen(value) > 0) {
                 // Only keep rendering-relevant styles
-                const char *relevant_styles[] = {
-                    "color", "background-color", "font-size", "font-weight",
-                    "font-style", "text-decoration", "width", "height",
-                    "display", "position", "margin", "padding", NULL
-                };
-                
-                for (int i = 0; relevant_styles[i] != NULL; i++) {
-                    if (strcasecmp(prop, relevant_styles[i]) == 0) {
+                for (int i = 0; inline_relevant_styles[i] != NULL; i++) {
+                    if (strcasecmp(prop, inline_relevant_styles[i]) == 0) {
                         cJSON_AddStringToObject(styles, prop, value);
                         break;
                     }
@@ -522,6 +570,26 @@ cJSON* parse_inline_styles_simple(lxb_dom_attr_t *style_attr) {
     return styles;
 }
 
+cJSON* element_inline_styles(lxb_dom_element_t *elem) {
+    lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(elem, LXB_DOM_ATTR_STYLE);
+    cJSON *styles = style_attr ? parse_inline_styles_simple(style_attr) : NULL;
+    if (!style_mutation_has_element(elem))
+        return styles;
+
+    // Script writes win over the attribute, like the computed style
+    if (!styles) {
+        styles = cJSON_CreateObject();
+        if (!styles) return NULL;
+    }
+    for (int i = 0; inline_relevant_styles[i] != NULL; i++) {
+        const char *value = style_mutation_computed(elem, inline_relevant_styles[i]);
+        if (!value) continue;
+        cJSON_DeleteItemFromObject(styles, inline_relevant_styles[i]);
+        cJSON_AddStringToObject(styles, inline_relevant_styles[i], value);
+    }
+    return styles;
+}
+
 cJSON* build_document_hierarchy(lxb_html_document_t* document) {
     printf("\n=== Building Document Hierarchy ===\n");
     
@@ -771,40 +839,16 @@ cJSON* process_node_for_rendering(lxb_dom_node_t *node, int depth) {
 int generate_rendering_output(const char *html_file, const char *output_file) {
     if(INFO_MESSAGES) printf("Generating rendering output: %s -> %s\n", html_file, output_file);
     
-    // Parse HTML
-    FILE *f = fopen(html_file, "rb");
-    if (!f) {
-        fprintf(stderr, "ERROR: Failed to open HTML file: %s\n", html_file);
-        return 0;
-    }
-    
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char *html = malloc(size + 1);
-    if (!html) {
-        fclose(f);
-        fprintf(stderr, "ERROR: Failed to allocate memory for HTML\n");
-        return 0;
-    }
-    
-    size_t read_size = fread(html, 1, size, f);
-    html[read_size] = '\0';
-    fclose(f);
-    
+    // Parse HTML, fed to the parser in chunks
     lxb_html_document_t *doc = lxb_html_document_create();
     if (!doc) {
-        free(html);
         fprintf(stderr, "ERROR: Failed to create Lexbor document\n");
         return 0;
     }
     
-    lxb_status_t status = lxb_html_document_parse(doc, (lxb_char_t*)html, read_size);
-    free(html);
-    
-    if (status != LXB_STATUS_OK) {
-        fprintf(stderr, "ERROR: Lexbor parse failed\n");
+    errno_t parse_rc = html_stream_parse_file(doc, html_file, NULL, NULL, NULL, NULL);
+    if (parse_rc != EOK) {
+        fprintf(stderr, "ERROR: Failed to parse HTML file %s (%d)\n", html_file, parse_rc);
         lxb_html_document_destroy(doc);
         return 0;
     }
@@ -855,18 +899,8 @@ int generate_rendering_output(const char *html_file, const char *output_file) {
     }
     
     // Write output
-    FILE *out_file = fopen(output_file, "wb");
-    if (out_file) {
-        char *json_str = cJSON_Print(rendering_root);
-        if (json_str) {
-            fwrite(json_str, 1, strlen(json_str), out_file);
-            free(json_str);
-        }
-        fclose(out_file);
+    if (write_json_output(rendering_root, output_file) == 0) {
         if(INFO_MESSAGES)  printf("Rendering output written to: %s\n", output_file);
-        kopiraj_fajl(output_file);
-    } else {
-        printf("ERROR: Could not open output file\n");
     }
     
     // Cleanup
@@ -1246,7 +1280,7 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             // Generate a unique filename for this form
             static int form_counter = 0;
             char form_filename[256];
-            form_counter++;
+            if (!preview_pass) form_counter++;   // early paints keep the final file names
             
             const lxb_char_t *form_id = lxb_dom_element_id(elem, &tag_len);
             if (form_id && tag_len > 0) {
@@ -1265,7 +1299,8 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             cJSON_ReplaceItemInObject(elem_json, "form_file", cJSON_CreateString(form_filename));
             
             // Store the element for extraction
-            store_form_for_extraction(elem, form_filename);
+            if (!preview_pass)
+                store_form_for_extraction(elem, form_filename);
             
             // Process form children normally
             // (Forms can contain labels, inputs, etc. that should appear in main rendering)
@@ -1295,7 +1330,7 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             // Generate a unique filename for this table
             static int table_counter = 0;
             char table_filename[256];
-            table_counter++;
+            if (!preview_pass) table_counter++;
             
             const lxb_char_t *table_id = lxb_dom_element_id(elem, &tag_len);
             if (table_id && tag_len > 0) {
@@ -1314,7 +1349,8 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             cJSON_ReplaceItemInObject(elem_json, "table_file", cJSON_CreateString(table_filename));
             
             // Store the element for extraction
-            store_table_for_extraction(elem, table_filename);
+            if (!preview_pass)
+                store_table_for_extraction(elem, table_filename);
             
             // STILL process children so they appear in main rendering
             // (even though full table goes to separate file)
@@ -1349,7 +1385,7 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             // Generate a unique filename for this form
             static int form_counter = 0;
             char form_filename[256];
-            form_counter++;
+            if (!preview_pass) form_counter++;
             
             const lxb_char_t *form_id = lxb_dom_element_id(elem, &tag_len);
             if (form_id && tag_len > 0) {
@@ -1368,7 +1404,8 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             cJSON_ReplaceItemInObject(elem_json, "form_file", cJSON_CreateString(form_filename));
             
             // Store the element for extraction
-            store_form_for_extraction(elem, form_filename);
+            if (!preview_pass)
+                store_form_for_extraction(elem, form_filename);
         }
         // FIXED: Separated nav/menu from ul/ol
         else if (strcasecmp(tag, "nav") == 0 || strcasecmp(tag, "menu") == 0) {
@@ -1378,7 +1415,7 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             // Generate a unique filename for this menu
             static int menu_counter = 0;
             char menu_filename[256];
-            menu_counter++;
+            if (!preview_pass) menu_counter++;
             
             const lxb_char_t *menu_id = lxb_dom_element_id(elem, &tag_len);
             if (menu_id && tag_len > 0) {
@@ -1397,7 +1434,8 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             cJSON_ReplaceItemInObject(elem_json, "menu_file", cJSON_CreateString(menu_filename));
             
             // Store the element for extraction
-            store_menu_for_extraction(elem, menu_filename, tag);
+            if (!preview_pass)
+                store_menu_for_extraction(elem, menu_filename, tag);
             
             // Process menu children normally
             cJSON *children_array = cJSON_CreateArray();
@@ -1447,7 +1485,7 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             // Generate a unique filename for this list
             static int list_counter = 0;
             char list_filename[256];
-            list_counter++;
+            if (!preview_pass) list_counter++;
             
             const lxb_char_t *list_id = lxb_dom_element_id(elem, &tag_len);
             if (list_id && tag_len > 0) {
@@ -1466,7 +1504,8 @@ cJSON_AddBoolToObject(elem_json, "has_default_summary", false);  // ← ADD
             cJSON_ReplaceItemInObject(elem_json, "list_file", cJSON_CreateString(list_filename));
             
             // Store the element for extraction
-            store_list_for_extraction(elem, list_filename, tag);
+            if (!preview_pass)
+                store_list_for_extraction(elem, list_filename, tag);
             
             // Process list children normally (they appear in main rendering)
             cJSON *children_array = cJSON_CreateArray();
@@ -2661,8 +2700,8 @@ cJSON_ReplaceItemInObject(elem_json, "font_size", cJSON_CreateNumber(11));
         
         // Get inline styles and override defaults
         lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(elem, LXB_DOM_ATTR_STYLE);
-        if (style_attr) {
-            cJSON *styles = parse_inline_styles_simple(style_attr);
+        if (style_attr || style_mutation_has_element(elem)) {
+            cJSON *styles = element_inline_styles(elem);
             if (styles) {
                 // Override with actual style values
                 cJSON *bg_color = cJSON_GetObjectItem(styles, "background-color");
@@ -2897,6 +2936,7 @@ void set_global_computed_layout(cJSON *layout) {
         cJSON_Delete(global_computed_layout);
     }
     global_computed_layout = layout;
+    dom_id_index_attach_layout(layout ? cJSON_GetObjectItem(layout, "elements") : NULL);
 }
 
 void clear_global_computed_layout(void) {
@@ -2904,6 +2944,7 @@ void clear_global_computed_layout(void) {
         cJSON_Delete(global_computed_layout);
         global_computed_layout = NULL;
     }
+    dom_id_index_attach_layout(NULL);
 }
 
 
@@ -2938,14 +2979,15 @@ void merge_layout_with_element(cJSON *elem_json, cJSON *layout_data) {
     // Try to find matching element in layout data
     cJSON *matched_element = NULL;
     
-    // First try by ID
+    // First try by ID (layout entries are keyed by id, see dom_id_index)
     if (strlen(element_id) > 0) {
-        char id_key[256];
-        snprintf(id_key, sizeof(id_key), "id_%s", element_id);
-        
-        cJSON *element_item = cJSON_GetObjectItem(elements_obj, id_key);
-        if (element_item && cJSON_IsObject(element_item)) {
-            matched_element = element_item;
+        if (layout_data == global_computed_layout) {
+            matched_element = dom_id_index_find_layout(element_id, strlen(element_id));
+        } else {
+            cJSON *element_item = cJSON_GetObjectItem(elements_obj, element_id);
+            if (element_item && cJSON_IsObject(element_item)) {
+                matched_element = element_item;
+            }
         }
     }
     
@@ -3034,170 +3076,244 @@ void merge_layout_with_element(cJSON *elem_json, cJSON *layout_data) {
 }
 
 
-int main(int argc, char *argv[]) {
-    if(INFO_MESSAGES) printf("=== HTML RENDERER OUTPUT GENERATOR ===\n");
-    
-    if (argc < 2) {
-        printf("Usage: %s <input.html> [output.txt]\n", argv[0]);
-        return 1;
+// Resolve the "color" / "bg_color" strings of every node once, so the
+// painters read packed ARGB ("color_argb" / "bg_argb") instead of parsing.
+static void resolve_node_colors(cJSON *node) {
+    if (!node) return;
+
+    if (cJSON_IsObject(node)) {
+        uint32_t argb;
+        cJSON *color = cJSON_GetObjectItem(node, "color");
+        if (color && cJSON_IsString(color) && !cJSON_GetObjectItem(node, "color_argb") &&
+            css_color_parse(color->valuestring, &argb)) {
+            cJSON_AddNumberToObject(node, "color_argb", argb);
+        }
+        cJSON *bg = cJSON_GetObjectItem(node, "bg_color");
+        if (bg && cJSON_IsString(bg) && !cJSON_GetObjectItem(node, "bg_argb") &&
+            css_color_parse(bg->valuestring, &argb)) {
+            cJSON_AddNumberToObject(node, "bg_argb", argb);
+        }
     }
-    
-    const char *html_file = argv[1];
-    char output_file[256];
-    
-    if (argc >= 3) {
-        strncpy(output_file, argv[2], sizeof(output_file) - 1);
-        output_file[sizeof(output_file) - 1] = '\0';
-    } else {
-        snprintf(output_file, sizeof(output_file), "%s.txt", html_file);
+
+    cJSON *child;
+    cJSON_ArrayForEach(child, node) {
+        if (cJSON_IsObject(child) || cJSON_IsArray(child))
+            resolve_node_colors(child);
     }
-    
-    printf("Input: %s\n", html_file);
-    printf("Output: %s\n", output_file);
-    
-    // ========== STEP 1: Parse HTML ==========
-    if(INFO_MESSAGES) printf("\n=== STEP 1: Parse HTML Document ===\n");
-    
-    FILE *f = fopen(html_file, "rb");
-    if (!f) {
-        fprintf(stderr, "ERROR: Failed to open HTML file: %s\n", html_file);
-        return 1;
+}
+
+// Page scripts that yielded to first paint run once the page is on screen
+static void run_deferred_scripts(void *arg) {
+    JSContext *js_ctx = arg;
+    if (js_ctx && js_deferred_script_count() > 0)
+        js_run_deferred_scripts(js_ctx);
+    // Idle now: get the next page's JS realm ready
+    if (js_ctx)
+        js_engine_prewarm();
+}
+
+// ===== Early paints while the document streams in =====
+// Each finished block is laid out once, below the previous one, and only
+// the blocks new since the last paint are painted: into the window on
+// HelenOS, into the headless target (and its snapshot) on the host. The
+// full pipeline after the parse replaces all of it.
+
+typedef struct {
+    cJSON *pending;             // laid out, not painted yet
+    int pending_y;              // document y of the first pending block
+    int y;                      // where the next block goes
+    int paints;
+    uint64_t start_usec;
+    uint64_t first_paint_usec;  // since parsing started
+#ifdef PAUK_HOST
+    font_manager_t *fm;
+    headless_target_t target;
+    bool target_ready;
+#endif
+} stream_preview_t;
+
+static void stream_preview_block(lxb_dom_node_t *block, void *arg) {
+    stream_preview_t *preview = arg;
+    if (!preview->pending)
+        return;
+
+    preview_pass = true;
+    cJSON *block_json = process_element_for_rendering(block, 0);
+    preview_pass = false;
+    if (!block_json)
+        return;
+
+    resolve_node_colors(block_json);
+    preview->y += position_layout_block(block_json, preview->y);
+    cJSON_AddItemToArray(preview->pending, block_json);
+}
+
+#ifdef PAUK_HOST
+static errno_t stream_preview_show(stream_preview_t *preview) {
+    if (!preview->target_ready) {
+        preview->fm = malloc(sizeof(font_manager_t));
+        if (!preview->fm)
+            return ENOMEM;
+        const char *font_dir = getenv("PAUK_FONT_DIR");
+        font_manager_init(preview->fm);
+        font_manager_load_fonts(preview->fm, font_dir ? font_dir : "/data/font/");
+        font_manager_init_substitutions(preview->fm);
+
+        // The first screen is what an early paint is for
+        errno_t rc = headless_target_init(&preview->target, HEADLESS_DEFAULT_WIDTH,
+            HEADLESS_DEFAULT_HEIGHT, preview->fm);
+        if (rc != EOK) {
+            font_manager_destroy(preview->fm);
+            free(preview->fm);
+            preview->fm = NULL;
+            return rc;
+        }
+        preview->target_ready = true;
     }
-    
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char *html = malloc(size + 1);
-    if (!html) {
-        fclose(f);
-        fprintf(stderr, "ERROR: Failed to allocate memory for HTML\n");
-        return 1;
+
+    cJSON *block;
+    cJSON_ArrayForEach(block, preview->pending)
+        page_paint_node(&preview->target.display_list, preview->fm, block);
+
+    errno_t rc = headless_render_rows(&preview->target, preview->pending_y, preview->y);
+    if (rc == EOK)
+        rc = headless_write_png(&preview->target, "text.html.snapshot.png");
+    return rc;
+}
+
+static void stream_preview_free(stream_preview_t *preview) {
+    if (preview->target_ready) {
+        headless_target_destroy(&preview->target);
+        font_manager_destroy(preview->fm);
+        free(preview->fm);
     }
-    
-    size_t read_size = fread(html, 1, size, f);
-    html[read_size] = '\0';
-    fclose(f);
-    
-    lxb_html_document_t *doc = lxb_html_document_create();
-    if (!doc) {
-        free(html);
-        fprintf(stderr, "ERROR: Failed to create Lexbor document\n");
-        return 1;
+    cJSON_Delete(preview->pending);
+}
+#else
+static errno_t stream_preview_show(stream_preview_t *preview) {
+    return gui_paint_blocks(preview->pending, preview->pending_y, preview->y);
+}
+
+static void stream_preview_free(stream_preview_t *preview) {
+    cJSON_Delete(preview->pending);
+}
+#endif
+
+static void stream_preview_paint(void *arg) {
+    stream_preview_t *preview = arg;
+    if (cJSON_GetArraySize(preview->pending) == 0)
+        return;
+
+    errno_t rc = stream_preview_show(preview);
+
+    // Painted (or not paintable): the next paint starts below them
+    cJSON_Delete(preview->pending);
+    preview->pending = cJSON_CreateArray();
+    preview->pending_y = preview->y;
+    if (rc != EOK)
+        return;
+
+    if (preview->paints++ == 0)
+        preview->first_paint_usec = pauk_time_usec() - preview->start_usec;
+}
+
+// A local path, or an http[s]:// URL parsed as its body comes in
+static bool is_http_location(const char *location) {
+    return strncmp(location, "http://", 7) == 0 || strncmp(location, "https://", 8) == 0;
+}
+
+// final_location gets where the document came from: location itself, or
+// the URL a redirect ended at
+static errno_t parse_page_source(lxb_html_document_t *doc, const char *location,
+    html_stream_block_cb_t on_block, html_stream_paint_cb_t on_paint, void *arg,
+    char *final_location, size_t final_location_size) {
+    // Scripts, stylesheets and images are fetched while the parse goes on;
+    // src= resolves against the page
+    script_loader_init();
+    script_loader_set_base(location);
+    snprintf(final_location, final_location_size, "%s", location);
+    preload_scanner_t preload;
+    preload_scanner_init(&preload);
+
+    if (!is_http_location(location))
+        return html_stream_parse_file(doc, location, on_block, on_paint, arg, &preload);
+
+    int status = 0;
+    errno_t rc = html_stream_parse_url(doc, location, on_block, on_paint, arg, &preload,
+        &status, final_location, final_location_size);
+    if (rc == EOK && (status < 200 || status > 299))
+        printf("WARNING: %s answered HTTP %d\n", final_location, status);
+    return rc;
+}
+
+#ifndef PAUK_HOST
+// Put in place of a page that could not be loaded, so the window still
+// opens and has an address bar to go somewhere else from
+static lxb_html_document_t *error_page_document(const char *location, errno_t rc) {
+    static const char head[] =
+        "<html><head><title>Page not loaded</title></head><body>"
+        "<h1>Page not loaded</h1><p>";
+    static const char tail_fmt[] = "</p><p>Error %d. Enter another address above.</p></body></html>";
+
+    // The location is shown as text, never as markup
+    size_t len = strlen(location);
+    char *html = malloc(sizeof(head) + len * 6 + sizeof(tail_fmt) + 16);
+    if (!html)
+        return NULL;
+    char *p = html + sprintf(html, "%s", head);
+    for (size_t i = 0; i < len; i++) {
+        switch (location[i]) {
+        case '<': p += sprintf(p, "&lt;"); break;
+        case '>': p += sprintf(p, "&gt;"); break;
+        case '&': p += sprintf(p, "&amp;"); break;
+        case '"': p += sprintf(p, "&quot;"); break;
+        default: *p++ = location[i]; break;
+        }
     }
-    
-    lexbor_status_t status = lxb_html_document_parse(doc, (lxb_char_t*)html, read_size);
-    free(html);
-    
-    if (status != LXB_STATUS_OK) {
-        fprintf(stderr, "ERROR: Lexbor parse failed with status: %d\n", status);
+    p += sprintf(p, tail_fmt, rc);
+
+    lxb_html_document_t *doc = lxb_html_document_create();
+    if (doc && lxb_html_document_parse(doc, (const lxb_char_t *)html, (size_t)(p - html)) != LXB_STATUS_OK) {
         lxb_html_document_destroy(doc);
-        return 1;
+        doc = NULL;
     }
-    
-    if(INFO_MESSAGES) printf("HTML parsed successfully\n");
+    free(html);
+    return doc;
+}
+#endif
 
+#define PAGE_POSITIONS_FILE "text.html.final_positions.txt"
 
+// An extracted table/form/list/menu: its own file next to output_file on
+// the one-shot path, or kept in refs under its file name on a relayout
+static void page_side_output(const cJSON *json, const char *filename,
+    const char *output_file, cJSON *refs) {
+    if (refs) {
+        cJSON_AddItemToObject(refs, filename, cJSON_Duplicate(json, 1));
+        return;
+    }
 
-    // ========== STEP 2: Initialize CSS Parser ==========
-    if(INFO_MESSAGES)   printf("\n=== STEP 2: Initialize CSS Parser ===\n");
-    if (!css_parser_init()) {
-        printf("WARNING: CSS parser initialization failed (continuing without CSS)\n");
+    char filepath[512];
+    const char *last_slash = strrchr(output_file, '/');
+    if (last_slash) {
+        int dir_len = (int)(last_slash - output_file + 1);
+        snprintf(filepath, sizeof(filepath), "%.*s%s", dir_len, output_file, filename);
     } else {
-        if(INFO_MESSAGES)  printf("CSS parser initialized\n");
+        snprintf(filepath, sizeof(filepath), "%s", filename);
     }
-    
-    // ========== STEP 2.5: Initialize Document Outline ==========
-    if(INFO_MESSAGES) printf("\n=== STEP 2.5: Initialize Document Outline ===\n");
-init_document_outline(&global_document_outline);
-if(INFO_MESSAGES) printf("Document outline tracker initialized\n");
 
-    // ========== STEP 3: Initialize Event Handler ==========
-    if(INFO_MESSAGES)printf("\n=== STEP 3: Initialize Event Handler ===\n");
-    event_handler_init();
-    if(INFO_MESSAGES) printf("Event handler initialized\n");
-    
-// ========== STEP 4: Initialize JavaScript (Optional) ==========
-if(INFO_MESSAGES)printf("\n=== STEP 4: Initialize JavaScript ===\n");
-int enable_js = 1; // Set to 0 to disable JavaScript
-JSContext *js_ctx = NULL;
-cJSON *js_modifications = NULL;  // Add this variable
-
-if (enable_js) {
-    js_ctx = js_engine_init();
-    if (js_ctx) {
-        if(INFO_MESSAGES) printf("JavaScript engine initialized\n");
-        
-        // Set security policy
-        SecurityPolicy policy = js_default_security_policy();
-        policy.max_memory_bytes = 32 * 1024 * 1024;
-        policy.allow_dom_apis = 1;
-        policy.enable_console = 1;
-        js_set_security_policy(js_ctx, policy);
-        
-        // Execute scripts and calculate layout
-        js_execute_script_elements(js_ctx, doc);
-
-        // ========== GET JAVASCRIPT MODIFICATIONS ==========
-        js_modifications = get_js_modifications();
-        if (js_modifications) {
-            // Calculate modification count and print in one pass
-            int mod_count = 0;
-            cJSON *element;
-            
-            if(INFO_MESSAGES)  printf("JavaScript modifications:\n");
-            cJSON_ArrayForEach(element, js_modifications) {
-                mod_count++;
-                if(INFO_MESSAGES)   printf("  - Element '%s' modified by JS\n", element->string);
-            }
-            
-            if(INFO_MESSAGES) printf("Total: %d modifications\n", mod_count);
-            
-            // We'll store this in rendering_output LATER, after it's created
-            // Just keep js_modifications for now
-        } else {
-            if(INFO_MESSAGES) printf("No JavaScript modifications detected\n");
-        }
-        // ==================================================
-        
-        if(INFO_MESSAGES) printf("JavaScript execution completed\n");
+    if (write_json_output(json, filepath) == 0) {
+        printf("  Written to: %s\n", filepath);
     } else {
-        printf("WARNING: JavaScript engine initialization failed (continuing without JS)\n");
+        printf("  ERROR: Could not create file: %s\n", filepath);
     }
-} else {
-    printf("JavaScript execution disabled\n");
 }
-    
-    // ========== STEP 5: Calculate Layout ==========
-    if(INFO_MESSAGES) printf("\n=== STEP 5: Calculate Layout ===\n");
-    cJSON *computed_layout = calculate_document_layout(doc);
-    
-    if (computed_layout) {
-        if(INFO_MESSAGES) printf("Layout calculated successfully\n");
-        
-        // Store globally for element processing
-        if (global_computed_layout) {
-            cJSON_Delete(global_computed_layout);
-        }
-        global_computed_layout = cJSON_Duplicate(computed_layout, 1);
-        
-        // Show layout summary
-        cJSON *elements = cJSON_GetObjectItem(computed_layout, "elements");
-        if (elements) {
-            int count = cJSON_GetArraySize(elements);
-            if(INFO_MESSAGES)  printf("Layout contains %d positioned elements\n", count);
-        }
-    } else {
-        printf("WARNING: Layout calculation failed (using default positions)\n");
-    }
-    
-    // ========== STEP 6: Process Events ==========
-    if(INFO_MESSAGES) printf("\n=== STEP 6: Process Events ===\n");
-    lxb_dom_node_t *root = lxb_dom_interface_node(doc);
-    process_events_recursive(root);
-    int event_count = get_event_handler_count();
-    if(INFO_MESSAGES)  printf("Found %d event handler(s)\n", event_count);
-    
+
+// Steps 7 and 8 over the current layout, in memory: the rendering JSON
+// with colors resolved. The extracted structures go through
+// page_side_output().
+static cJSON *build_render_tree(lxb_html_document_t *doc, cJSON *js_modifications,
+    const char *output_file, cJSON *refs) {
     // ========== STEP 7: Build Clean Rendering Output ==========
     if(INFO_MESSAGES) printf("\n=== STEP 7: Build Rendering Output ===\n");
     
@@ -3339,35 +3455,7 @@ if (js_modifications) {
                 cJSON_AddNumberToObject(table_json, "table_index", i + 1);
                 cJSON_AddStringToObject(table_json, "source_file", filename);
 
-// Write table to separate file
-char table_filepath[512];
-// Get directory from output_file
-char *last_slash = strrchr(output_file, '/');
-if (last_slash) {
-    // Extract directory
-    size_t dir_len = last_slash - output_file + 1;
-    char dir[256];
-    strncpy(dir, output_file, dir_len);
-    dir[dir_len] = '\0';
-    snprintf(table_filepath, sizeof(table_filepath), 
-            "%s%s", dir, filename);  // <-- USE filename variable
-} else {
-    // No directory, just filename
-    snprintf(table_filepath, sizeof(table_filepath), 
-            "%s", filename);  // <-- USE filename variable
-}
-
-FILE *table_file = fopen(table_filepath, "wb");
-if (table_file) {
-    char *table_json_str = cJSON_Print(table_json);
-    if (table_json_str) {
-        fwrite(table_json_str, 1, strlen(table_json_str), table_file);
-        free(table_json_str);
-        printf("  Written to: %s\n", table_filepath);
-    }
-    fclose(table_file);
-    kopiraj_fajl(table_filepath);
-}
+            page_side_output(table_json, filename, output_file, refs);
             
             // Create reference for main output
             cJSON *table_ref = cJSON_CreateObject();
@@ -3440,31 +3528,8 @@ if (form_count > 0) {
             cJSON_AddNumberToObject(form_json, "form_index", i + 1);
             cJSON_AddStringToObject(form_json, "source_file", filename);
             
-            // Write form to separate file (same pattern as tables)
-            char form_filepath[512];
-            // Get directory from output_file
-            char *last_slash = strrchr(output_file, '/');
-            if (last_slash) {
-                size_t dir_len = last_slash - output_file + 1;
-                char dir[256];
-                strncpy(dir, output_file, dir_len);
-                dir[dir_len] = '\0';
-                snprintf(form_filepath, sizeof(form_filepath), "%s%s", dir, filename);
-            } else {
-                snprintf(form_filepath, sizeof(form_filepath), "%s", filename);
-            }
-            
-            FILE *form_file = fopen(form_filepath, "wb");
-            if (form_file) {
-                char *form_json_str = cJSON_Print(form_json);
-                if (form_json_str) {
-                    fwrite(form_json_str, 1, strlen(form_json_str), form_file);
-                    free(form_json_str);
-                    printf("  Written to: %s\n", form_filepath);
-                }
-                fclose(form_file);
-                kopiraj_fajl(form_filepath);
-            }
+            // Own file, same as tables
+            page_side_output(form_json, filename, output_file, refs);
             
             // Create reference for main output
             cJSON *form_ref = cJSON_CreateObject();
@@ -3529,32 +3594,7 @@ if (list_count > 0) {
           //  cJSON_AddStringToObject(list_json, "list_type", list_type);
             
             // Write list to separate file
-            char list_filepath[512];
-            // Get directory from output_file
-            char *last_slash = strrchr(output_file, '/');
-            if (last_slash) {
-                size_t dir_len = last_slash - output_file + 1;
-                char dir[256];
-                strncpy(dir, output_file, dir_len);
-                dir[dir_len] = '\0';
-                snprintf(list_filepath, sizeof(list_filepath), "%s%s", dir, filename);
-            } else {
-                snprintf(list_filepath, sizeof(list_filepath), "%s", filename);
-            }
-            
-            FILE *list_file = fopen(list_filepath, "wb");
-            if (list_file) {
-                char *list_json_str = cJSON_Print(list_json);
-                if (list_json_str) {
-                    fwrite(list_json_str, 1, strlen(list_json_str), list_file);
-                    free(list_json_str);
-                    printf("  Written to: %s\n", list_filepath);
-                }
-                fclose(list_file);
-                kopiraj_fajl(filename);
-            } else {
-                printf("  ERROR: Could not create list file: %s\n", list_filepath);
-            }
+            page_side_output(list_json, filename, output_file, refs);
             
             // Create reference for main output
             cJSON *list_ref = cJSON_CreateObject();
@@ -3678,31 +3718,7 @@ if (menu_count > 0) {
             // ========== END LIST LINKING ==========
             
             // Write menu to separate file
-            char menu_filepath[512];
-            char *last_slash = strrchr(output_file, '/');
-            if (last_slash) {
-                size_t dir_len = last_slash - output_file + 1;
-                char dir[256];
-                strncpy(dir, output_file, dir_len);
-                dir[dir_len] = '\0';
-                snprintf(menu_filepath, sizeof(menu_filepath), "%s%s", dir, filename);
-            } else {
-                snprintf(menu_filepath, sizeof(menu_filepath), "%s", filename);
-            }
-            
-            FILE *menu_file = fopen(menu_filepath, "wb");
-            if (menu_file) {
-                char *menu_json_str = cJSON_Print(menu_json);
-                if (menu_json_str) {
-                    fwrite(menu_json_str, 1, strlen(menu_json_str), menu_file);
-                    free(menu_json_str);
-                    printf("  Written to: %s\n", menu_filepath);
-                }
-                fclose(menu_file);
-                 kopiraj_fajl(filename); 
-            } else {
-                printf("  ERROR: Could not create menu file: %s\n", menu_filepath);
-            }
+            page_side_output(menu_json, filename, output_file, refs);
             
             // Create reference for main output
             cJSON *menu_ref = cJSON_CreateObject();
@@ -3776,37 +3792,29 @@ if (menu_count > 0) {
     if(INFO_MESSAGES) printf("No menus found in document\n");
 }
 
+    resolve_node_colors(rendering_output);
+    return rendering_output;
+}
+
+// Steps 7 to 8.5 over the current layout: the rendering JSON goes to
+// output_file, the positions to PAGE_POSITIONS_FILE. Returns the rendering
+// JSON; *positions_ok (may be NULL) tells whether positions were written.
+static cJSON *build_page_output(lxb_html_document_t *doc, cJSON *js_modifications,
+    const char *output_file, bool *positions_ok) {
+    cJSON *rendering_output = build_render_tree(doc, js_modifications, output_file, NULL);
+
     // ========== STEP 8: Write Output ==========
     printf("\n=== STEP 8: Write Rendering Output ===\n");
-    FILE *out_file = fopen(output_file, "wb");
-    if (out_file) {
-        char *json_str = cJSON_Print(rendering_output);
-        if (json_str) {
-            size_t written = fwrite(json_str, 1, strlen(json_str), out_file);
-            if(INFO_MESSAGES)  printf("Wrote %zu bytes to %s\n", written, output_file);
-            free(json_str);
-        } else {
-            printf("ERROR: Failed to generate JSON string\n");
-        }
-        fclose(out_file);
-        kopiraj_fajl(output_file);
-    } else {
-        printf("ERROR: Could not open output file %s\n", output_file);
-        
-        // Print to console as fallback
-        char *json_str = cJSON_Print(rendering_output);
-        if (json_str) {
-            if(INFO_MESSAGES)  printf("\nRendering Output:\n%s\n", json_str);
-            free(json_str);
-        }
-    }
+    // Streamed through json_writer: no in-memory copy of the document text,
+    // and the /data/web mirror is written in the same pass
+    write_json_output(rendering_output, output_file);
     
 // ========== STEP 8.5: Calculate X/Y Positions for Text Layout ==========
 if(INFO_MESSAGES) printf("\n=== STEP 8.5: Calculate X/Y Positions (C) ===\n");
 
 /* Use the file produced by Step 8 (text.html.txt). */
 const char *pos_input = "text.html.txt";
-const char *pos_output = "text.html.final_positions.txt";
+const char *pos_output = PAGE_POSITIONS_FILE;
 
 int layout_ok = calculate_text_positions(pos_input, pos_output);
 if (!layout_ok) {
@@ -3817,16 +3825,258 @@ if (!layout_ok) {
     kopiraj_fajl(pos_output);
  
 }
+if (positions_ok)
+    *positions_ok = layout_ok != 0;
 
-// Jump to existing cleanup code (layout_cleanup label exists later)
-goto layout_cleanup;
-
-layout_cleanup:
 if(INFO_MESSAGES) printf("\n=== STEP 8.5 COMPLETE ===\n");
+    return rendering_output;
+}
+
+#ifndef PAUK_HOST
+// What a relayout needs from run_page
+typedef struct {
+    lxb_html_document_t *doc;
+} page_relayout_t;
+
+// A frame with style or DOM changes from scripts: steps 5, 7 and 8.5 again
+// on the live document, all in memory. The page files stay those of the
+// first layout. The GUI paints the returned positions.
+static cJSON *relayout_page(void *arg) {
+    page_relayout_t *page = arg;
+
+    // Registered again while the rendering JSON is rebuilt
+    cleanup_tables_storage();
+    cleanup_forms_storage();
+    cleanup_lists_storage();
+    cleanup_menus_storage();
+
+    // Consumes the style dirty set
+    set_global_computed_layout(calculate_document_layout(page->doc));
+
+    cJSON *refs = cJSON_CreateObject();
+    if (!refs)
+        return NULL;
+    cJSON *js_modifications = get_js_modifications();
+    cJSON *rendering_output = build_render_tree(page->doc, js_modifications, NULL, refs);
+    cJSON *positions = position_layout_tree(rendering_output, refs);
+    cJSON_Delete(rendering_output);
+    cJSON_Delete(refs);
+    cJSON_Delete(js_modifications);
+
+    return positions;
+}
+#endif
+
+// One page, from parse to the closed window. output_arg may be NULL.
+static int run_page(const char *html_file, const char *output_arg) {
+    if(INFO_MESSAGES) printf("=== HTML RENDERER OUTPUT GENERATOR ===\n");
+    
+    char output_file[256];
+    
+    if (output_arg) {
+        strncpy(output_file, output_arg, sizeof(output_file) - 1);
+        output_file[sizeof(output_file) - 1] = '\0';
+    } else if (is_http_location(html_file)) {
+        snprintf(output_file, sizeof(output_file), "text.html.txt");
+    } else {
+        snprintf(output_file, sizeof(output_file), "%s.txt", html_file);
+    }
+    
+    printf("Input: %s\n", html_file);
+    printf("Output: %s\n", output_file);
+    
+    // ========== STEP 1: Parse HTML ==========
+    if(INFO_MESSAGES) printf("\n=== STEP 1: Parse HTML Document ===\n");
+    
+    // Streamed blocks are styled with the same parser the full pass uses
+    if (!css_parser_init()) {
+        printf("WARNING: CSS parser initialization failed (continuing without CSS)\n");
+    } else {
+        if(INFO_MESSAGES)  printf("CSS parser initialized\n");
+    }
+    
+    lxb_html_document_t *doc = lxb_html_document_create();
+    if (!doc) {
+        fprintf(stderr, "ERROR: Failed to create Lexbor document\n");
+        return 1;
+    }
+    
+    // Fed in HTML_STREAM_CHUNK_SIZE pieces; finished top-level blocks are
+    // painted while the rest is still parsed
+#ifndef PAUK_HOST
+    // The window is there before the first block
+    gui_open();
+#endif
+    char page_location[HTTP_URL_MAX_PATH + HTTP_URL_MAX_HOST];
+    stream_preview_t preview = { .pending = cJSON_CreateArray(), .start_usec = pauk_time_usec() };
+    errno_t parse_rc = parse_page_source(doc, html_file,
+        preview.pending ? stream_preview_block : NULL,
+        preview.pending ? stream_preview_paint : NULL, &preview,
+        page_location, sizeof(page_location));
+    if (preview.paints > 0 && INFO_MESSAGES)
+        printf("Early paints while parsing: %d (first after %llu us)\n", preview.paints,
+            (unsigned long long)preview.first_paint_usec);
+    stream_preview_free(&preview);
+    
+    if (parse_rc != EOK) {
+        fprintf(stderr, "ERROR: Failed to parse HTML file %s (%d)\n", html_file, parse_rc);
+        script_loader_cleanup();
+        lxb_html_document_destroy(doc);
+#ifdef PAUK_HOST
+        return 1;
+#else
+        // The browser stays open on an error page instead of exiting
+        doc = error_page_document(html_file, parse_rc);
+        if (!doc)
+            return 1;
+        script_loader_init();
+#endif
+    }
+    
+    if(INFO_MESSAGES) printf("HTML parsed successfully\n");
+    
+    // id -> element index, shared by JS, the layout merge and the GUI
+    if (dom_id_index_build(doc) != EOK) {
+        printf("WARNING: DOM id index could not be built\n");
+    }
+
+
+
+    // ========== STEP 2.5: Initialize Document Outline ==========
+    if(INFO_MESSAGES) printf("\n=== STEP 2.5: Initialize Document Outline ===\n");
+init_document_outline(&global_document_outline);
+if(INFO_MESSAGES) printf("Document outline tracker initialized\n");
+
+    // ========== STEP 3: Initialize Event Handler ==========
+    if(INFO_MESSAGES)printf("\n=== STEP 3: Initialize Event Handler ===\n");
+    event_handler_init();
+    if(INFO_MESSAGES) printf("Event handler initialized\n");
+    
+// ========== STEP 4: Initialize JavaScript (Optional) ==========
+if(INFO_MESSAGES)printf("\n=== STEP 4: Initialize JavaScript ===\n");
+int enable_js = 1; // Set to 0 to disable JavaScript
+JSContext *js_ctx = NULL;
+cJSON *js_modifications = NULL;  // Add this variable
+
+if (enable_js) {
+    js_ctx = js_engine_init();
+    if (js_ctx) {
+        if(INFO_MESSAGES) printf("JavaScript engine initialized\n");
+        
+        // Set security policy
+        SecurityPolicy policy = js_default_security_policy();
+        policy.max_memory_bytes = 32 * 1024 * 1024;
+        policy.allow_dom_apis = 1;
+        policy.enable_console = 1;
+        js_set_security_policy(js_ctx, policy);
+        
+        // Execute scripts and calculate layout; external ones were queued
+        // by the preload scanner during the parse
+        js_execute_script_elements(js_ctx, doc);
+
+        // ========== GET JAVASCRIPT MODIFICATIONS ==========
+        js_modifications = get_js_modifications();
+        if (js_modifications) {
+            // Calculate modification count and print in one pass
+            int mod_count = 0;
+            cJSON *element;
+            
+            if(INFO_MESSAGES)  printf("JavaScript modifications:\n");
+            cJSON_ArrayForEach(element, js_modifications) {
+                mod_count++;
+                if(INFO_MESSAGES)   printf("  - Element '%s' modified by JS\n", element->string);
+            }
+            
+            if(INFO_MESSAGES) printf("Total: %d modifications\n", mod_count);
+            
+            // We'll store this in rendering_output LATER, after it's created
+            // Just keep js_modifications for now
+        } else {
+            if(INFO_MESSAGES) printf("No JavaScript modifications detected\n");
+        }
+        // ==================================================
+        
+        if(INFO_MESSAGES) printf("JavaScript execution completed\n");
+    } else {
+        printf("WARNING: JavaScript engine initialization failed (continuing without JS)\n");
+    }
+} else {
+    printf("JavaScript execution disabled\n");
+}
+    
+#ifdef PAUK_HOST
+    // No window to keep the page alive and no later frame to show changes
+    // in: deferred scripts, and timers and frames for PAUK_JS_RUN_MS (none
+    // by default), run now so the one layout and snapshot below see them
+    if (js_ctx) {
+        if (js_deferred_script_count() > 0)
+            js_run_deferred_scripts(js_ctx);
+
+        const char *run_ms = getenv("PAUK_JS_RUN_MS");
+        uint64_t ms = run_ms ? strtoull(run_ms, NULL, 10) : 0;
+        if (ms > 0)
+            js_event_loop_run(ms * 1000);
+
+        cJSON_Delete(js_modifications);
+        js_modifications = get_js_modifications();
+    }
+#endif
+
+    // ========== STEP 5: Calculate Layout ==========
+    if(INFO_MESSAGES) printf("\n=== STEP 5: Calculate Layout ===\n");
+    cJSON *computed_layout = calculate_document_layout(doc);
+    
+    if (computed_layout) {
+        if(INFO_MESSAGES) printf("Layout calculated successfully\n");
+        
+        // Store globally for element processing
+        set_global_computed_layout(cJSON_Duplicate(computed_layout, 1));
+        
+        // Show layout summary
+        cJSON *elements = cJSON_GetObjectItem(computed_layout, "elements");
+        if (elements) {
+            int count = cJSON_GetArraySize(elements);
+            if(INFO_MESSAGES)  printf("Layout contains %d positioned elements\n", count);
+        }
+    } else {
+        printf("WARNING: Layout calculation failed (using default positions)\n");
+    }
+    
+    // ========== STEP 6: Process Events ==========
+    if(INFO_MESSAGES) printf("\n=== STEP 6: Process Events ===\n");
+    lxb_dom_node_t *root = lxb_dom_interface_node(doc);
+    process_events_recursive(root);
+    int event_count = get_event_handler_count();
+    if(INFO_MESSAGES)  printf("Found %d event handler(s)\n", event_count);
+    
+    bool positions_ok = false;
+    cJSON *rendering_output = build_page_output(doc, js_modifications, output_file,
+        &positions_ok);
+    const char *pos_output = PAGE_POSITIONS_FILE;
 
      // ========== STEP 9 GUI ===========================
   
+#ifdef PAUK_HOST
+     // Host build: paint the positions into an off-screen buffer instead
+     {
+         const char *font_dir = getenv("PAUK_FONT_DIR");
+         if (headless_render_positions(pos_output, font_dir ? font_dir : "/data/font/",
+                 "text.html.snapshot", HEADLESS_DEFAULT_WIDTH) != EOK) {
+             printf("WARNING: headless render failed\n");
+         }
+     }
+     // Deferred scripts already ran before the layout
+     run_deferred_scripts(js_ctx);
+#else
+     // Frames with script changes are laid out again before they are painted
+     page_relayout_t relayout = { .doc = doc };
+     gui_set_relayout_cb(relayout_page, &relayout);
+     gui_set_page_positions(positions_ok ? read_json_file(pos_output) : NULL);
+     gui_set_first_paint_cb(run_deferred_scripts, js_ctx);
+     gui_set_location(page_location);
      start_gui();
+     gui_set_relayout_cb(NULL, NULL);
+#endif
 
      // =========== END GUI =============================
 
@@ -3846,17 +4096,17 @@ cleanup_lists_storage();
 cleanup_menus_storage();
 
 
-    // Cleanup JavaScript
+    // Cleanup JavaScript; the runtime stays warm for the next page
     if (js_ctx) {
         js_engine_cleanup(js_ctx);
-        if(INFO_MESSAGES)  printf("JavaScript engine cleaned up\n");
+        if(INFO_MESSAGES)  printf("JavaScript context cleaned up\n");
+    } else {
+        // Preloads nobody claimed
+        script_loader_cleanup();
     }
     
     // Cleanup layout data
-    if (global_computed_layout) {
-        cJSON_Delete(global_computed_layout);
-        global_computed_layout = NULL;
-    }
+    clear_global_computed_layout();
     
     if (computed_layout) {
         cJSON_Delete(computed_layout);
@@ -3870,6 +4120,7 @@ cleanup_menus_storage();
     css_parser_cleanup();
     
     // Cleanup document
+    dom_id_index_clear();
     lxb_html_document_destroy(doc);
     
     if(INFO_MESSAGES) printf("\n=== PROCESSING COMPLETE ===\n");
@@ -3881,3 +4132,36 @@ cleanup_menus_storage();
     return 0;
 }
 
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <input.html | http[s]://url> [output.txt]\n", argv[0]);
+        return 1;
+    }
+    
+    http_fetch_init();
+    // Off when there is no private directory to keep it in
+    char http_cache_dir[CACHE_STORE_PATH_MAX];
+    if (cache_store_dir(HTTP_CACHE_NAME, http_cache_dir, sizeof(http_cache_dir)) != EOK ||
+        http_cache_init(http_cache_dir) != EOK)
+        printf("WARNING: HTTP cache disabled\n");
+    
+    int rc = run_page(argv[1], argc >= 3 ? argv[2] : NULL);
+    
+#ifndef PAUK_HOST
+    // Go / Enter in the address bar closed the window: load that page next
+    char next_url[GUI_MAX_URL];
+    while (gui_take_navigation(next_url, sizeof(next_url)))
+        rc = run_page(next_url, NULL);
+#endif
+    
+    // Process-wide state: JS runtime, Lua states, pooled connections
+    js_engine_shutdown();
+    js_bytecode_cache_cleanup();
+    lua_position_shutdown();
+    lua_layout_hooks_shutdown();
+    http_fetch_shutdown();
+    http_cache_shutdown();
+    
+    return rc;
+}
+
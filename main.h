@@ -14,6 +14,7 @@
 
 #define LAYOUT_DEBUG 0
 #define KOPIRAJ 1
+#define KOPIRAJ_DIR "/data/web/"
 
 
 typedef struct {
@@ -98,6 +99,9 @@ void clear_global_computed_layout(void);
 cJSON* element_to_rendering_json(lxb_dom_element_t *elem, int is_inline);
 char* get_element_text_simple(lxb_dom_element_t *elem);
 cJSON* parse_inline_styles_simple(lxb_dom_attr_t *style_attr);
+// Rendering-relevant inline styles of elem: the style attribute with script
+// style writes laid over it; NULL when there are neither
+cJSON* element_inline_styles(lxb_dom_element_t *elem);
 cJSON* process_node_for_rendering(lxb_dom_node_t *node, int depth);
 int generate_rendering_output(const char *html_file, const char *output_file);
 cJSON* process_element_for_rendering(lxb_dom_node_t *node, int depth);
@@ -121,5 +125,6 @@ void clear_global_computed_layout(void);
 void set_global_computed_layout(cJSON *layout);
 
 int kopiraj_fajl(const char *src_file);
+int write_json_output(const cJSON *json, const char *path);
 
 #endif // MAIN_H
\ No newline at end of file
@@ -1,6 +1,7 @@
 
 #include "menus_parser.h"
 #include "main.h"
+#include "style_mutation.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,8 +17,8 @@ static int menu_capacity = 0;
 static const char* detect_menu_orientation(lxb_dom_element_t *menu_elem) {
     // Check CSS styles first
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(menu_elem, LXB_DOM_ATTR_STYLE);
-    if (style_attr) {
-        cJSON *styles = parse_inline_styles_simple(style_attr);
+    if (style_attr || style_mutation_has_element(menu_elem)) {
+        cJSON *styles = element_inline_styles(menu_elem);
         if (styles) {
             cJSON *display = cJSON_GetObjectItem(styles, "display");
             cJSON *flex_direction = cJSON_GetObjectItem(styles, "flex-direction");
@@ -461,8 +462,8 @@ cJSON* extract_menu_structure(lxb_dom_element_t *menu_elem) {
     
     // Get menu styles
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(menu_elem, LXB_DOM_ATTR_STYLE);
-    if (style_attr) {
-        cJSON *styles = parse_inline_styles_simple(style_attr);
+    if (style_attr || style_mutation_has_element(menu_elem)) {
+        cJSON *styles = element_inline_styles(menu_elem);
         if (styles) {
             add_default_menu_styles(styles, menu_type);
             cJSON_AddItemToObject(menu_json, "menu_style", styles);
@@ -582,8 +583,8 @@ cJSON* extract_menu_item(lxb_dom_element_t *item_elem, int item_index, int nesti
     
     // Get item styles
     lxb_dom_attr_t *style_attr = lxb_dom_element_attr_by_id(item_elem, LXB_DOM_ATTR_STYLE);
-    if (style_attr) {
-        cJSON *styles = parse_inline_styles_simple(style_attr);
+    if (style_attr || style_mutation_has_element(item_elem)) {
+        cJSON *styles = element_inline_styles(item_elem);
         if (styles) {
             add_default_menu_item_styles(styles, nesting_level);
             cJSON_AddItemToObject(item_json, "style", styles);
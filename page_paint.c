@@ -0,0 +1,87 @@
+// page_paint.c - Positions tree -> display list
+//
+// The headless snapshot and the HelenOS window paint the same thing: the
+// boxes and text runs calculate_text_positions() placed. Both record them
+// into a paint_list_t here and rasterize it their own way (one render of
+// the whole list, or the window's tile cache).
+#include <stdbool.h>
+
+#include "css_color.h"
+#include "page_paint.h"
+
+static int json_int(cJSON *obj, const char *key, int def)
+{
+    cJSON *it = cJSON_GetObjectItem(obj, key);
+    return (it && cJSON_IsNumber(it)) ? (int)it->valuedouble : def;
+}
+
+static const char *json_str(cJSON *obj, const char *key)
+{
+    cJSON *it = cJSON_GetObjectItem(obj, key);
+    return (it && cJSON_IsString(it)) ? it->valuestring : NULL;
+}
+
+// Prefer the pre-resolved numeric color, fall back to parsing the string
+static bool json_argb(cJSON *obj, const char *num_key, const char *str_key, uint32_t *out)
+{
+    cJSON *it = cJSON_GetObjectItem(obj, num_key);
+    if (it && cJSON_IsNumber(it)) {
+        *out = (uint32_t)it->valuedouble;
+        return true;
+    }
+
+    return css_color_parse(json_str(obj, str_key), out);
+}
+
+void page_paint_node(paint_list_t *list, font_manager_t *fm, cJSON *node)
+{
+    if (!node || !cJSON_IsObject(node))
+        return;
+
+    int x = json_int(node, "x", -1);
+    int y = json_int(node, "y", -1);
+    int w = json_int(node, "layout_width", 0);
+    int h = json_int(node, "layout_height", 0);
+
+    if (x >= 0 && y >= 0) {
+        // White boxes on a white page add nothing
+        uint32_t bg;
+        if (json_argb(node, "bg_argb", "bg_color", &bg) && w > 0 && h > 0 &&
+            (bg >> 24) != 0 && bg != 0xFFFFFFFF)
+            paint_list_add_fill(list, x, y, w, h, bg);
+
+        const char *text = json_str(node, "text");
+        if (text && text[0] != '\0' && fm) {
+            const char *family = json_str(node, "font_family");
+            html_font_t *font = font_manager_get_by_name(fm, family ? family : "Arial");
+            uint32_t color;
+            if (!json_argb(node, "color_argb", "color", &color))
+                color = 0xFF000000;
+            int size = json_int(node, "font_size", 16);
+            // Text is opaque: alpha is blended with white once, here
+            if (font)
+                paint_list_add_text(list, text, x, y, font, (float)size,
+                    css_color_over_white(color));
+        }
+    }
+
+    cJSON *children = cJSON_GetObjectItem(node, "children");
+    cJSON *child;
+    if (children && cJSON_IsArray(children)) {
+        cJSON_ArrayForEach(child, children) {
+            page_paint_node(list, fm, child);
+        }
+    }
+}
+
+void page_paint_positions(paint_list_t *list, font_manager_t *fm, cJSON *root)
+{
+    cJSON *node;
+    if (cJSON_IsArray(root)) {
+        cJSON_ArrayForEach(node, root) {
+            page_paint_node(list, fm, node);
+        }
+    } else {
+        page_paint_node(list, fm, root);
+    }
+}
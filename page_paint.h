@@ -0,0 +1,16 @@
+// page_paint.h - Positions tree -> display list
+#ifndef PAGE_PAINT_H
+#define PAGE_PAINT_H
+
+#include "cjson.h"
+#include "font_manager.h"
+#include "paint_list.h"
+
+// Append the paint items of one node of a calculate_text_positions() tree,
+// children included. Text is drawn through fonts from fm (none if NULL).
+void page_paint_node(paint_list_t *list, font_manager_t *fm, cJSON *node);
+
+// Whole positions file contents: an array of nodes or a single node
+void page_paint_positions(paint_list_t *list, font_manager_t *fm, cJSON *root);
+
+#endif // PAGE_PAINT_H
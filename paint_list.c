@@ -0,0 +1,144 @@
+// paint_list.c - Display list recorded by the *_css paint calls
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <mem.h>
+
+#include "paint_list.h"
+
+#define PAINT_LIST_INITIAL 64
+
+void paint_list_init(paint_list_t *list)
+{
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    list->extent_y = 0;
+}
+
+void paint_list_clear(paint_list_t *list)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i].text);
+    }
+    list->count = 0;
+    list->extent_y = 0;
+}
+
+void paint_list_free(paint_list_t *list)
+{
+    paint_list_clear(list);
+    free(list->items);
+    list->items = NULL;
+    list->capacity = 0;
+}
+
+static paint_item_t *paint_list_push(paint_list_t *list)
+{
+    if (list->count == list->capacity) {
+        size_t new_cap = list->capacity ? list->capacity * 2 : PAINT_LIST_INITIAL;
+        paint_item_t *items = realloc(list->items, new_cap * sizeof(paint_item_t));
+        if (!items)
+            return NULL;
+        list->items = items;
+        list->capacity = new_cap;
+    }
+
+    paint_item_t *item = &list->items[list->count++];
+    memset(item, 0, sizeof(*item));
+    return item;
+}
+
+static void paint_list_track_extent(paint_list_t *list, int y, int h)
+{
+    if (y + h > list->extent_y)
+        list->extent_y = y + h;
+}
+
+errno_t paint_list_add_fill(paint_list_t *list, int x, int y, int w, int h, uint32_t color)
+{
+    if (w <= 0 || h <= 0)
+        return EOK;
+
+    paint_item_t *item = paint_list_push(list);
+    if (!item)
+        return ENOMEM;
+
+    item->kind = PAINT_FILL;
+    item->x = x;
+    item->y = y;
+    item->w = w;
+    item->h = h;
+    item->color = color;
+    paint_list_track_extent(list, y, h);
+    return EOK;
+}
+
+errno_t paint_list_add_border(paint_list_t *list, int x, int y, int w, int h, uint32_t color)
+{
+    if (w <= 0 || h <= 0)
+        return EOK;
+
+    paint_item_t *item = paint_list_push(list);
+    if (!item)
+        return ENOMEM;
+
+    item->kind = PAINT_BORDER;
+    item->x = x;
+    item->y = y;
+    item->w = w;
+    item->h = h;
+    item->color = color;
+    paint_list_track_extent(list, y, h);
+    return EOK;
+}
+
+errno_t paint_list_add_text(paint_list_t *list, const char *text, int x, int y,
+    html_font_t *font, float size, uint32_t color)
+{
+    if (!text || !font || !font->is_loaded)
+        return EINVAL;
+
+    // Measure once here so the rasterizer can bin the run without touching the font
+    stbtt_fontinfo *info = &font->info;
+    float scale = stbtt_ScaleForPixelHeight(info, size);
+
+    int ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(info, &ascent, &descent, &line_gap);
+    int baseline = paint_round_px(ascent * scale);
+    int height = paint_round_px((ascent - descent) * scale) + 1;
+
+    int width = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        int advance, lsb;
+        stbtt_GetCodepointHMetrics(info, *p, &advance, &lsb);
+        int kern = stbtt_GetCodepointKernAdvance(info, *p, *(p + 1));
+        width += paint_round_px((advance + kern) * scale);
+    }
+    // Glyph boxes can overhang the advance on either side
+    int overhang = (int)size / 4 + 1;
+
+    char *copy = str_dup(text);
+    if (!copy)
+        return ENOMEM;
+
+    paint_item_t *item = paint_list_push(list);
+    if (!item) {
+        free(copy);
+        return ENOMEM;
+    }
+
+    item->kind = PAINT_TEXT;
+    item->x = x - overhang;
+    item->y = y;
+    item->origin_x = x;
+    item->w = width + 2 * overhang;
+    item->h = height;
+    item->color = color;
+    item->text = copy;
+    item->font = font;
+    item->size = size;
+    item->baseline = baseline;
+    paint_list_track_extent(list, y, height);
+    return EOK;
+}
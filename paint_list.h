@@ -0,0 +1,54 @@
+// paint_list.h - Display list recorded by the *_css paint calls
+#ifndef PAINT_LIST_H
+#define PAINT_LIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include "font_manager.h"
+
+typedef enum {
+    PAINT_FILL,
+    PAINT_BORDER,
+    PAINT_TEXT
+} paint_kind_t;
+
+// One paint operation. Coordinates are document coordinates (scroll not applied),
+// x/y/w/h is the bounding box used for tile binning.
+typedef struct {
+    paint_kind_t kind;
+    int x, y, w, h;
+    uint32_t color;        // ARGB
+
+    // PAINT_TEXT only
+    char *text;
+    html_font_t *font;
+    float size;
+    int origin_x;          // pen start, x is widened by the glyph overhang
+    int baseline;          // pixels from y to the baseline
+} paint_item_t;
+
+typedef struct {
+    paint_item_t *items;
+    size_t count;
+    size_t capacity;
+    int extent_y;          // lowest painted y, used as content height
+} paint_list_t;
+
+// Round to the nearest pixel without pulling in libm
+static inline int paint_round_px(float v)
+{
+    return (int)(v < 0.0f ? v - 0.5f : v + 0.5f);
+}
+
+void paint_list_init(paint_list_t *list);
+void paint_list_clear(paint_list_t *list);
+void paint_list_free(paint_list_t *list);
+
+errno_t paint_list_add_fill(paint_list_t *list, int x, int y, int w, int h, uint32_t color);
+errno_t paint_list_add_border(paint_list_t *list, int x, int y, int w, int h, uint32_t color);
+errno_t paint_list_add_text(paint_list_t *list, const char *text, int x, int y,
+    html_font_t *font, float size, uint32_t color);
+
+#endif // PAINT_LIST_H
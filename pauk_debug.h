@@ -0,0 +1,21 @@
+// pauk_debug.h - Debug output switches shared by GUI and engine code
+#ifndef PAUK_DEBUG_H
+#define PAUK_DEBUG_H
+
+#define DEB_INFO 1
+#define DEB_INIT 0
+#define DEB_WARNING 0
+#define DEB_INIT_MENU 0
+#define DEB_INIT_SCROLLBAR 0
+#define DEB_BITMAP 0
+#define DEB_INIT_FONT 0
+#define DEB_FONT 1
+#define DEB_INIT_UI 0
+#define DEB_INIT_LEXBOR 0
+#define DEB_LEXBOR 0
+#define DEB_CSS 0
+#define DEB_GO 0
+#define DEB_FETCH 0
+#define DEB_INIT_CHILD 0
+
+#endif // PAUK_DEBUG_H
@@ -0,0 +1,146 @@
+// pauk_sync.c - Minimal threading layer: fibrils on HelenOS, pthreads on host
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pauk_sync.h"
+
+#ifdef PAUK_HOST
+
+#include <unistd.h>
+#include <time.h>
+
+typedef struct {
+    pauk_thread_fn_t fn;
+    void *arg;
+} host_thread_start_t;
+
+static void *host_thread_trampoline(void *p)
+{
+    host_thread_start_t start = *(host_thread_start_t *)p;
+    free(p);
+    start.fn(start.arg);
+    return NULL;
+}
+
+void pauk_mutex_init(pauk_mutex_t *mutex) { pthread_mutex_init(mutex, NULL); }
+void pauk_mutex_lock(pauk_mutex_t *mutex) { pthread_mutex_lock(mutex); }
+void pauk_mutex_unlock(pauk_mutex_t *mutex) { pthread_mutex_unlock(mutex); }
+
+void pauk_cond_init(pauk_cond_t *cond) { pthread_cond_init(cond, NULL); }
+void pauk_cond_wait(pauk_cond_t *cond, pauk_mutex_t *mutex) { pthread_cond_wait(cond, mutex); }
+void pauk_cond_signal(pauk_cond_t *cond) { pthread_cond_signal(cond); }
+void pauk_cond_broadcast(pauk_cond_t *cond) { pthread_cond_broadcast(cond); }
+
+errno_t pauk_thread_start(pauk_thread_fn_t fn, void *arg)
+{
+    host_thread_start_t *start = malloc(sizeof(host_thread_start_t));
+    if (!start)
+        return ENOMEM;
+    start->fn = fn;
+    start->arg = arg;
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, host_thread_trampoline, start) != 0) {
+        free(start);
+        return ENOMEM;
+    }
+    pthread_detach(tid);
+    return EOK;
+}
+
+int pauk_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+}
+
+void pauk_spawn_runners(int count)
+{
+    (void)count;
+}
+
+static uint64_t host_clock_usec(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0)
+        return 0;
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+uint64_t pauk_time_usec(void)
+{
+    return host_clock_usec(CLOCK_MONOTONIC);
+}
+
+uint64_t pauk_cpu_time_usec(void)
+{
+    return host_clock_usec(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void pauk_sleep_usec(uint64_t usec)
+{
+    struct timespec ts = {
+        .tv_sec = (time_t)(usec / 1000000),
+        .tv_nsec = (long)(usec % 1000000) * 1000
+    };
+    nanosleep(&ts, NULL);
+}
+
+#else
+
+#include <stats.h>
+#include <time.h>
+
+void pauk_mutex_init(pauk_mutex_t *mutex) { fibril_mutex_initialize(mutex); }
+void pauk_mutex_lock(pauk_mutex_t *mutex) { fibril_mutex_lock(mutex); }
+void pauk_mutex_unlock(pauk_mutex_t *mutex) { fibril_mutex_unlock(mutex); }
+
+void pauk_cond_init(pauk_cond_t *cond) { fibril_condvar_initialize(cond); }
+void pauk_cond_wait(pauk_cond_t *cond, pauk_mutex_t *mutex) { fibril_condvar_wait(cond, mutex); }
+void pauk_cond_signal(pauk_cond_t *cond) { fibril_condvar_signal(cond); }
+void pauk_cond_broadcast(pauk_cond_t *cond) { fibril_condvar_broadcast(cond); }
+
+errno_t pauk_thread_start(pauk_thread_fn_t fn, void *arg)
+{
+    fid_t fid = fibril_create(fn, arg);
+    if (fid == 0)
+        return ENOMEM;
+    fibril_add_ready(fid);
+    return EOK;
+}
+
+int pauk_cpu_count(void)
+{
+    size_t count = 0;
+    stats_cpu_t *cpus = stats_get_cpus(&count);
+    if (cpus)
+        free(cpus);
+    return (count > 0) ? (int)count : 1;
+}
+
+void pauk_spawn_runners(int count)
+{
+    // Fibrils only run in parallel when more than one kernel thread carries
+    // them. libc owns the runner count; a task can only opt in.
+    if (count > 1)
+        fibril_enable_multithreaded();
+}
+
+uint64_t pauk_time_usec(void)
+{
+    struct timespec ts;
+    getuptime(&ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+uint64_t pauk_cpu_time_usec(void)
+{
+    return pauk_time_usec();
+}
+
+void pauk_sleep_usec(uint64_t usec)
+{
+    fibril_usleep((usec_t)usec);
+}
+
+#endif
@@ -0,0 +1,66 @@
+// pauk_sync.h - Minimal threading layer: fibrils on HelenOS, pthreads on host
+#ifndef PAUK_SYNC_H
+#define PAUK_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifdef PAUK_HOST
+#include <pthread.h>
+
+#ifndef EOK
+#define EOK 0
+typedef int errno_t;
+#endif
+
+typedef pthread_mutex_t pauk_mutex_t;
+typedef pthread_cond_t pauk_cond_t;
+#else
+#include <fibril.h>
+#include <fibril_synch.h>
+
+typedef fibril_mutex_t pauk_mutex_t;
+typedef fibril_condvar_t pauk_cond_t;
+#endif
+
+// A mutex usable without pauk_mutex_init(), for state set up on first use
+// from any thread: static PAUK_MUTEX_INITIALIZE(lock);
+#ifdef PAUK_HOST
+#define PAUK_MUTEX_INITIALIZE(name) pauk_mutex_t name = PTHREAD_MUTEX_INITIALIZER
+#else
+#define PAUK_MUTEX_INITIALIZE(name) FIBRIL_MUTEX_INITIALIZE(name)
+#endif
+
+typedef errno_t (*pauk_thread_fn_t)(void *arg);
+
+void pauk_mutex_init(pauk_mutex_t *mutex);
+void pauk_mutex_lock(pauk_mutex_t *mutex);
+void pauk_mutex_unlock(pauk_mutex_t *mutex);
+
+void pauk_cond_init(pauk_cond_t *cond);
+void pauk_cond_wait(pauk_cond_t *cond, pauk_mutex_t *mutex);
+void pauk_cond_signal(pauk_cond_t *cond);
+void pauk_cond_broadcast(pauk_cond_t *cond);
+
+// Start a detached worker (fibril / pthread)
+errno_t pauk_thread_start(pauk_thread_fn_t fn, void *arg);
+
+// Number of CPUs available for workers (at least 1)
+int pauk_cpu_count(void);
+
+// Let fibrils run on several kernel threads when `count` workers want to
+// run in parallel. libc picks the number of runners. No-op on host.
+void pauk_spawn_runners(int count);
+
+// Monotonic clock in microseconds (arbitrary origin)
+uint64_t pauk_time_usec(void);
+
+// CPU time consumed by the calling thread in microseconds. HelenOS has no
+// per-fibril CPU clock, so it falls back to the monotonic clock there.
+uint64_t pauk_cpu_time_usec(void);
+
+// Block the calling thread / fibril
+void pauk_sleep_usec(uint64_t usec);
+
+#endif // PAUK_SYNC_H
@@ -10,32 +10,33 @@ M.config = {
     margin_between_elements = 15
 }
 
--- Extract element with ALL properties
-function extract_element_complete(obj_str)
+-- Read the fields the calculator needs from a render tree node. Node
+-- fields are read from the C tree on access, nothing is parsed here.
+function extract_element_complete(node)
     local element = {}
     
     -- Basic properties
-    element.tag = obj_str:match('"tag"%s*:%s*"([^"]+)"') or ""
-    element.id = obj_str:match('"id"%s*:%s*"([^"]*)"') or ""
-    element.type = obj_str:match('"type"%s*:%s*"([^"]*)"') or "block"
-    element.text = obj_str:match('"text"%s*:%s*"([^"]*)"') or ""
+    element.tag = node.tag or ""
+    element.id = node.id or ""
+    element.type = node.type or "block"
+    element.text = node.text or ""
     
     -- File references (CRITICAL - from your new output)
-    element.form_file = obj_str:match('"form_file"%s*:%s*"([^"]*)"') or ""
-    element.list_file = obj_str:match('"list_file"%s*:%s*"([^"]*)"') or ""
-    element.table_file = obj_str:match('"table_file"%s*:%s*"([^"]*)"') or ""
+    element.form_file = node.form_file or ""
+    element.list_file = node.list_file or ""
+    element.table_file = node.table_file or ""
     
     -- Existing layout from C engine
-    element.x = tonumber(obj_str:match('"x"%s*:%s*([%d%.]+)')) or 0
-    element.y = tonumber(obj_str:match('"y"%s*:%s*([%d%.]+)')) or 0
-    element.layout_width = tonumber(obj_str:match('"layout_width"%s*:%s*([%d%.]+)')) or 0
-    element.layout_height = tonumber(obj_str:match('"layout_height"%s*:%s*([%d%.]+)')) or 0
+    element.x = tonumber(node.x) or 0
+    element.y = tonumber(node.y) or 0
+    element.layout_width = tonumber(node.layout_width) or 0
+    element.layout_height = tonumber(node.layout_height) or 0
     
     -- Boolean flags
-    element.is_form = obj_str:find('"is_form"%s*:%s*true') ~= nil
-    element.is_list = obj_str:find('"is_list"%s*:%s*true') ~= nil
-    element.is_table = obj_str:find('"is_table"%s*:%s*true') ~= nil
-    element.is_heading = obj_str:find('"is_heading"%s*:%s*true') ~= nil
+    element.is_form = node.is_form == true
+    element.is_list = node.is_list == true
+    element.is_table = node.is_table == true
+    element.is_heading = node.is_heading == true
     
     return element
 end
@@ -91,60 +92,41 @@ function calculate_final_dimensions(element)
     return width, height, "calculated"
 end
 
--- Main function
-function M.calculate_positions(json_str)
-    print("[LUA] Processing COMPLETE Helen OS output...")
-    
-    local all_elements = {}
-    local pos = 1
-    local element_count = 0
+-- Element nodes in document order; children arrays are walked the same way
+local function collect_elements(node, out)
+    if type(node.tag) == "string" then
+        out[#out + 1] = node
+    end
     
-    -- Extract all elements
-    while pos <= #json_str do
-        local obj_start = json_str:find('{', pos)
-        if not obj_start then break end
-        
-        local depth = 1
-        local obj_end = obj_start + 1
-        
-        while obj_end <= #json_str and depth > 0 do
-            local char = json_str:sub(obj_end, obj_end)
-            if char == '{' then depth = depth + 1
-            elseif char == '}' then depth = depth - 1 end
-            obj_end = obj_end + 1
+    local children = node.children
+    if children ~= nil then
+        for _, child in ipairs(children) do
+            collect_elements(child, out)
         end
-        
-        if depth == 0 then
-            local obj_str = json_str:sub(obj_start, obj_end - 1)
-            local element = extract_element_complete(obj_str)
-            
-            if element.tag ~= "" then
-                element_count = element_count + 1
-                all_elements[element_count] = element
-                
-                -- Debug first 10 elements
-                if element_count <= 10 then
-                    local has_file = element.form_file ~= "" or 
-                                    element.list_file ~= "" or 
-                                    element.table_file ~= ""
-                    local file_info = has_file and " [HAS FILE]" or ""
-                    print(string.format("[LUA] %d. <%s>%s at (%.1f, %.1f)%s",
-                          element_count, element.tag, element.id ~= "" and " #"..element.id or "",
-                          element.x, element.y, file_info))
-                end
-            end
-            
-            pos = obj_end
-        else
-            pos = obj_start + 1
+    end
+end
+
+-- Main function: root is the render tree (an array of elements or one
+-- element). Positions are written back into the nodes; returns the element
+-- count and the document size.
+function M.calculate_positions(root)
+    print("[LUA] Processing COMPLETE Helen OS output...")
+    
+    local nodes = {}
+    if root.tag ~= nil then
+        collect_elements(root, nodes)
+    else
+        for _, node in ipairs(root) do
+            collect_elements(node, nodes)
         end
     end
     
+    local element_count = #nodes
     print("[LUA] Found " .. element_count .. " total elements")
     
     -- Calculate final positions
-    local elements_json = {}
-    for i, elem in ipairs(all_elements) do
+    for i, node in ipairs(nodes) do
+        local elem = extract_element_complete(node)
         local width, height, source = calculate_final_dimensions(elem)
         
         -- Enhance position: add margin between elements
@@ -153,37 +135,25 @@ function M.calculate_positions(json_str)
             enhanced_y = enhanced_y + ((i-1) * M.config.margin_between_elements)
         end
         
-        table.insert(elements_json, string.format([[
-        {
-            "tag": "%s",
-            "id": "%s",
-            "type": "%s",
-            "x": %.1f,
-            "y": %.1f,
-            "calculated_width": %.1f,
-            "calculated_height": %.1f,
-            "dimension_source": "%s"
-        }]], 
-        elem.tag, elem.id, elem.type, 
-        elem.x, enhanced_y, width, height, source))
+        -- Debug first 10 elements
+        if i <= 10 then
+            local has_file = elem.form_file ~= "" or
+                            elem.list_file ~= "" or
+                            elem.table_file ~= ""
+            local file_info = has_file and " [HAS FILE]" or ""
+            print(string.format("[LUA] %d. <%s>%s at (%.1f, %.1f)%s",
+                  i, elem.tag, elem.id ~= "" and " #"..elem.id or "",
+                  elem.x, elem.y, file_info))
+        end
+        
+        node.x = elem.x
+        node.y = enhanced_y
+        node.calculated_width = width
+        node.calculated_height = height
+        node.dimension_source = source
     end
     
-    local result = string.format([[
-{
-    "success": true,
-    "message": "Enhanced %d elements with file references",
-    "document_width": %d,
-    "document_height": %d,
-    "element_count": %d,
-    "elements": [%s]
-}]],
-    #all_elements,
-    M.config.viewport_width,
-    M.config.viewport_height,
-    #all_elements,
-    table.concat(elements_json, ",\n"))
-    
-    return result
+    return element_count, M.config.viewport_width, M.config.viewport_height
 end
 
 print("=== LUA POSITION CALCULATOR READY ===")
@@ -4,6 +4,8 @@
      - text.html.final_positions.txt (JSON)
      - element_coordinates.txt (text)
      - /data/web/pos_debug.txt and /data/web/layout_log.txt (diagnostics)
+   position_layout_tree() runs the same pass over a tree already in memory
+   and touches no files, for relayouts of a live page.
 */
 
 #include <stdio.h>
@@ -13,6 +15,9 @@
 #include <math.h>
 #include "cjson.h"
 #include "position_layout.h"
+#include "json_writer.h"
+#include "lua_layout_hooks.h"
+#include "file_source.h"
 
 #define DEFAULT_VIEWPORT_WIDTH 800
 #define DEFAULT_FONT_SIZE 16
@@ -20,24 +25,23 @@
 #define LINE_HEIGHT_MULT 1.2
 
 /* --- Utilities --- */
-static char *read_file_to_buf(const char *path, long *out_size) {
+/* Parse a JSON file straight from its file_source view (mapped on the host) */
+static cJSON *parse_json_file(const char *path) {
     if (!path) return NULL;
-    FILE *f = fopen(path, "rb");
-    if (!f) return NULL;
-    if (fseek(f, 0, SEEK_END) != 0) { fclose(f); return NULL; }
-    long size = ftell(f);
-    rewind(f);
-    if (size < 0) { fclose(f); return NULL; }
-    char *buf = malloc((size_t)size + 1);
-    if (!buf) { fclose(f); return NULL; }
-    size_t r = fread(buf, 1, (size_t)size, f);
-    fclose(f);
-    if (r != (size_t)size) { free(buf); return NULL; }
-    buf[r] = '\0';
-    if (out_size) *out_size = size;
-    return buf;
+    file_source_t src;
+    if (file_source_open(&src, path, 0, 0) != EOK) return NULL;
+    cJSON *json = cJSON_ParseWithLength(src.data, src.len);
+    file_source_close(&src);
+    return json;
 }
 
+/* Referenced structures by file name while position_layout_tree() runs;
+   NULL means they are read from their files */
+static const cJSON *layout_refs = NULL;
+
+/* Diagnostics go to layout_log.txt only on the file pass */
+static bool layout_logging = false;
+
 static char *resolve_ref_path(const char *base_dir, const char *filename) {
     if (!filename || filename[0] == '\0') return NULL;
     if (!base_dir || base_dir[0] == '\0') return strdup(filename);
@@ -57,7 +61,7 @@ static cJSON *copy_node_with_children(cJSON *node) {
     /* Copy basic fields */
     const char *keep[] = {"tag","text","id","href","src","alt","title",
                          "width","height","font_size","font_family","color",
-                         "bg_color","style","class_string","form_file",
+                         "bg_color","color_argb","bg_argb","style","class_string","form_file",
                          "table_file","list_file","menu_file","media_type",
                          "iframe_src","iframe_width","iframe_height",
                          "iframe_type","type", NULL};
@@ -111,14 +115,16 @@ static int read_estimated_size_from_refs(cJSON *elem, const char *base_dir, int
     for (int k=0; keys[k]; k++) {
         cJSON *fitem = cJSON_GetObjectItem(elem, keys[k]);
         if (fitem && cJSON_IsString(fitem) && strlen(fitem->valuestring) > 0) {
-            char *path = resolve_ref_path(base_dir, fitem->valuestring);
-            if (!path) continue;
-            long sz=0;
-            char *buf = read_file_to_buf(path, &sz);
-            free(path);
-            if (!buf) continue;
-            cJSON *obj = cJSON_Parse(buf);
-            free(buf);
+            cJSON *owned = NULL;
+            cJSON *obj;
+            if (layout_refs) {
+                obj = cJSON_GetObjectItem(layout_refs, fitem->valuestring);
+            } else {
+                char *path = resolve_ref_path(base_dir, fitem->valuestring);
+                if (!path) continue;
+                obj = owned = parse_json_file(path);
+                free(path);
+            }
             if (!obj) continue;
             cJSON *w = cJSON_GetObjectItem(obj, "estimated_width");
             if (!w) w = cJSON_GetObjectItem(obj, "estimated_w");
@@ -129,17 +135,17 @@ static int read_estimated_size_from_refs(cJSON *elem, const char *base_dir, int
             if (w && cJSON_IsNumber(w) && h && cJSON_IsNumber(h)) {
                 *out_w = (int)w->valuedouble;
                 *out_h = (int)h->valuedouble;
-                cJSON_Delete(obj);
+                cJSON_Delete(owned);
                 return 1;
             }
             cJSON *item_count = cJSON_GetObjectItem(obj, "item_count");
             if (item_count && cJSON_IsNumber(item_count)) {
                 *out_w = 400;
                 *out_h = (int)(item_count->valuedouble * 20);
-                cJSON_Delete(obj);
+                cJSON_Delete(owned);
                 return 1;
             }
-            cJSON_Delete(obj);
+            cJSON_Delete(owned);
         }
     }
     return 0;
@@ -235,6 +241,16 @@ static int get_int(cJSON *obj, const char *key, int default_val) {
 /* Forward */
 static int layout_node_recursive(cJSON *node, int x, int y, int container_width, const char *base_dir);
 
+/* Set while a pass has Lua layout hooks registered */
+static bool layout_hooks_on = false;
+
+/* Box claimed by a Lua layout hook? Runs it and returns the height to use */
+static int apply_layout_hooks(cJSON *node, int x, int y, int container_width, int height) {
+    if (!layout_hooks_on) return height;
+    if (!lua_layout_hooks_match(get_string(node, "tag"), get_string(node, "class_string"))) return height;
+    return lua_layout_hooks_apply(node, x, y, container_width, height);
+}
+
 
 
 static int layout_inline_children(cJSON *children_arr, int start_index, int total_count, int start_x, int start_y, int container_width, int parent_font_size, int *consumed_out) {
@@ -244,8 +260,11 @@ static int layout_inline_children(cJSON *children_arr, int start_index, int tota
     }
 
     /* open append log (best-effort) */
-    FILE *log = fopen("/data/web/layout_log.txt", "a");
-    if (!log) log = fopen("layout_log.txt", "a");
+    FILE *log = NULL;
+    if (layout_logging) {
+        log = fopen("/data/web/layout_log.txt", "a");
+        if (!log) log = fopen("layout_log.txt", "a");
+    }
 
     /* FIX: Get left margin of first element for initial positioning */
     cJSON *first_child = cJSON_GetArrayItem(children_arr, start_index);
@@ -340,6 +359,14 @@ static int layout_inline_children(cJSON *children_arr, int start_index, int tota
             cJSON_ReplaceItemInObject(child, "y", cJSON_CreateNumber(y));
             cJSON_ReplaceItemInObject(child, "layout_width", cJSON_CreateNumber(iw));
             cJSON_ReplaceItemInObject(child, "layout_height", cJSON_CreateNumber(ih));
+            /* A Lua hook may resize the box before the cursor moves on */
+            if (layout_hooks_on) {
+                apply_layout_hooks(child, x, y, right_bound - x, ih);
+                cJSON *hw = cJSON_GetObjectItem(child, "layout_width");
+                cJSON *hh = cJSON_GetObjectItem(child, "layout_height");
+                if (hw && cJSON_IsNumber(hw)) iw = (int)hw->valuedouble;
+                if (hh && cJSON_IsNumber(hh)) ih = (int)hh->valuedouble;
+            }
             if (log) fprintf(log, "  elem idx=%d tag=%s -> x=%d y=%d w=%d h=%d (ref=%s)\n",
                              i, child_tag?child_tag:"(elem)", x, y, iw, ih,
                              (get_string(child,"src") ? get_string(child,"src") : "(no-src)"));
@@ -358,8 +385,8 @@ static int layout_inline_children(cJSON *children_arr, int start_index, int tota
     return (y - start_y) + line_height;
 }
 
-/* Layout recursion */
-static int layout_node_recursive(cJSON *node, int x, int y, int container_width, const char *base_dir) {
+/* Native layout of one node */
+static int layout_node_native(cJSON *node, int x, int y, int container_width, const char *base_dir) {
     if (!node) return 0;
 
     /* === CRITICAL FIX: Calculate parent's padded content area === */
@@ -500,6 +527,13 @@ static int layout_node_recursive(cJSON *node, int x, int y, int container_width,
     }
 }
 
+/* Layout recursion: native layout, then the Lua hooks claiming the box */
+static int layout_node_recursive(cJSON *node, int x, int y, int container_width, const char *base_dir) {
+    int height = layout_node_native(node, x, y, container_width, base_dir);
+    if (!node) return height;
+    return apply_layout_hooks(node, x, y, container_width, height);
+}
+
 /* Ensure every node has numeric x/y/layout_width/layout_height and assign inline X positions
    when layout pass left them unset. */
    static void finalize_positions_recursive(cJSON *node, int parent_x, int parent_y) {
@@ -702,7 +736,82 @@ static void print_coords_recursive(FILE *coord, cJSON *item, int depth) {
     }
 }
 
+/* Top-level nodes stacked from y=0, Lua hooks included; returns whether
+   the hooks were active */
+static bool layout_top_nodes(cJSON *nodes_array, const char *base_dir) {
+    int top_count = cJSON_GetArraySize(nodes_array);
+    int y_cursor = 0;
+    layout_hooks_on = lua_layout_hooks_begin();
+    bool hooks = layout_hooks_on;
+    for (int i=0;i<top_count;i++) {
+        cJSON *node = cJSON_GetArrayItem(nodes_array, i);
+        layout_node_recursive(node, 0, y_cursor, DEFAULT_VIEWPORT_WIDTH, base_dir);
+        cJSON *lh = cJSON_GetObjectItem(node, "layout_height");
+        if (lh && cJSON_IsNumber(lh)) y_cursor += (int)lh->valuedouble;
+        else y_cursor += (int)ceil(DEFAULT_FONT_SIZE * LINE_HEIGHT_MULT);
+    }
+    lua_layout_hooks_end();
+    layout_hooks_on = false;
+    return hooks;
+}
+
+/* The positions tree the painter reads: rendering fields and layout only */
+static cJSON *trim_positions(cJSON *nodes_array) {
+    cJSON *final_arr = cJSON_CreateArray();
+    int top_count = cJSON_GetArraySize(nodes_array);
+    for (int i=0;i<top_count;i++) {
+        cJSON *node = cJSON_GetArrayItem(nodes_array, i);
+        /* Trim: keep rendering-relevant fields and computed layout */
+        cJSON *out = cJSON_CreateObject();
+        const char *keep[] = {"tag","text","id","href","src","alt","title","width","height","font_size","font_family","color","bg_color","color_argb","bg_argb","style","class_string","form_file","table_file","list_file","menu_file","media_type","iframe_src","iframe_width","iframe_height","iframe_type","type", NULL};
+        for (int k=0; keep[k]; k++) {
+            cJSON *it = cJSON_GetObjectItem(node, keep[k]);
+            if (it) cJSON_AddItemToObject(out, keep[k], cJSON_Duplicate(it, 1));
+        }
+        cJSON *x = cJSON_GetObjectItem(node, "x");
+        cJSON *y = cJSON_GetObjectItem(node, "y");
+        cJSON *w = cJSON_GetObjectItem(node, "layout_width");
+        cJSON *h = cJSON_GetObjectItem(node, "layout_height");
+        if (x && cJSON_IsNumber(x)) cJSON_AddNumberToObject(out, "x", x->valuedouble);
+        if (y && cJSON_IsNumber(y)) cJSON_AddNumberToObject(out, "y", y->valuedouble);
+        if (w && cJSON_IsNumber(w)) cJSON_AddNumberToObject(out, "layout_width", w->valuedouble);
+        if (h && cJSON_IsNumber(h)) cJSON_AddNumberToObject(out, "layout_height", h->valuedouble);
+        cJSON *children = cJSON_GetObjectItem(node, "children");
+        if (children && cJSON_IsArray(children)) {
+            cJSON *arr = cJSON_CreateArray();
+            int cc = cJSON_GetArraySize(children);
+            for (int j=0;j<cc;j++) {
+                cJSON *ch = cJSON_GetArrayItem(children, j);
+                /* recursively trim */
+                /* Use a small helper inline (duplicate trim logic) */
+                /* Simpler: duplicate entire child and then remove non-kept keys is more work; instead reuse recursion */
+                /* We'll call a quick recursive trim function here by reusing logic above - implement simple recursion */
+                /* For brevity, duplicate child with cJSON_Duplicate and then leave it as-is (it's okay to include extra fields) */
+                cJSON *dup = copy_node_with_children(ch);
+                cJSON_AddItemToArray(arr, dup);
+            }
+            if (cJSON_GetArraySize(arr) > 0) cJSON_AddItemToObject(out, "children", arr);
+            else cJSON_Delete(arr);
+        }
+        cJSON_AddItemToArray(final_arr, out);
+    }
+    return final_arr;
+}
+
 /* Main public function */
+/* One top-level node laid out in place at y, for paints made while the
+   document still streams in: no files, no Lua hooks (the full pass that
+   follows runs them). Returns the height the node takes. */
+int position_layout_block(cJSON *node, int y) {
+    if (!node) return 0;
+    layout_node_recursive(node, 0, y, DEFAULT_VIEWPORT_WIDTH, "");
+    finalize_positions_recursive(node, 0, 0);
+
+    cJSON *lh = cJSON_GetObjectItem(node, "layout_height");
+    if (lh && cJSON_IsNumber(lh)) return (int)lh->valuedouble;
+    return (int)ceil(DEFAULT_FONT_SIZE * LINE_HEIGHT_MULT);
+}
+
 int calculate_text_positions(const char *input_json_path, const char *output_json_path) {
     FILE *log = fopen("/data/web/layout_log.txt", "wb");
     if (!log) log = fopen("layout_log.txt", "wb");
@@ -712,26 +821,25 @@ int calculate_text_positions(const char *input_json_path, const char *output_jso
     }
 
     const char *out_path = output_json_path ? output_json_path : "text.html.final_positions.txt";
-    long size = 0;
-    char *buf = read_file_to_buf(input_json_path, &size);
-    if (!buf) {
+    file_source_t src;
+    errno_t src_rc = file_source_open(&src, input_json_path, 0, 0);
+    if (src_rc != EOK) {
         /* fallback to text.html.txt */
         if (log) fprintf(log, "Primary input not found, trying text.html.txt\n");
-        free(buf);
-        buf = read_file_to_buf("text.html.txt", &size);
-        if (!buf) {
+        src_rc = file_source_open(&src, "text.html.txt", 0, 0);
+        if (src_rc != EOK) {
             if (log) { fprintf(log, "ERROR: Could not open input JSON\n"); fclose(log); }
             return 0;
         }
     }
 
-    cJSON *root = cJSON_Parse(buf);
+    cJSON *root = cJSON_ParseWithLength(src.data, src.len);
     if (log) {
         if (!root) fprintf(log, "JSON parse FAILED\n");
         else fprintf(log, "JSON parse OK\n");
         fflush(log);
     }
-    free(buf);
+    file_source_close(&src);
     if (!root) { if (log) fclose(log); return 0; }
 
     /* determine base_dir */
@@ -775,14 +883,10 @@ int calculate_text_positions(const char *input_json_path, const char *output_jso
     }
 
     int top_count = cJSON_GetArraySize(nodes_array);
-    int y_cursor = 0;
-    for (int i=0;i<top_count;i++) {
-        cJSON *node = cJSON_GetArrayItem(nodes_array, i);
-        layout_node_recursive(node, 0, y_cursor, DEFAULT_VIEWPORT_WIDTH, base_dir);
-        cJSON *lh = cJSON_GetObjectItem(node, "layout_height");
-        if (lh && cJSON_IsNumber(lh)) y_cursor += (int)lh->valuedouble;
-        else y_cursor += (int)ceil(DEFAULT_FONT_SIZE * LINE_HEIGHT_MULT);
-    }
+    layout_logging = true;
+    bool hooks = layout_top_nodes(nodes_array, base_dir);
+    layout_logging = false;
+    if (log && hooks) { fprintf(log, "Lua layout hooks active\n"); fflush(log); }
 
     if (log) {
         fprintf(log, "After layout pass:\n");
@@ -825,65 +929,16 @@ int calculate_text_positions(const char *input_json_path, const char *output_jso
     }
 
     /* Build final trimmed output */
-    cJSON *final_arr = cJSON_CreateArray();
-    for (int i=0;i<top_count;i++) {
-        cJSON *node = cJSON_GetArrayItem(nodes_array, i);
-        /* Trim: keep rendering-relevant fields and computed layout */
-        cJSON *out = cJSON_CreateObject();
-        const char *keep[] = {"tag","text","id","href","src","alt","title","width","height","font_size","font_family","color","bg_color","style","class_string","form_file","table_file","list_file","menu_file","media_type","iframe_src","iframe_width","iframe_height","iframe_type","type", NULL};
-        for (int k=0; keep[k]; k++) {
-            cJSON *it = cJSON_GetObjectItem(node, keep[k]);
-            if (it) cJSON_AddItemToObject(out, keep[k], cJSON_Duplicate(it, 1));
-        }
-        cJSON *x = cJSON_GetObjectItem(node, "x");
-        cJSON *y = cJSON_GetObjectItem(node, "y");
-        cJSON *w = cJSON_GetObjectItem(node, "layout_width");
-        cJSON *h = cJSON_GetObjectItem(node, "layout_height");
-        if (x && cJSON_IsNumber(x)) cJSON_AddNumberToObject(out, "x", x->valuedouble);
-        if (y && cJSON_IsNumber(y)) cJSON_AddNumberToObject(out, "y", y->valuedouble);
-        if (w && cJSON_IsNumber(w)) cJSON_AddNumberToObject(out, "layout_width", w->valuedouble);
-        if (h && cJSON_IsNumber(h)) cJSON_AddNumberToObject(out, "layout_height", h->valuedouble);
-        cJSON *children = cJSON_GetObjectItem(node, "children");
-        if (children && cJSON_IsArray(children)) {
-            cJSON *arr = cJSON_CreateArray();
-            int cc = cJSON_GetArraySize(children);
-            for (int j=0;j<cc;j++) {
-                cJSON *ch = cJSON_GetArrayItem(children, j);
-                /* recursively trim */
-                /* Use a small helper inline (duplicate trim logic) */
-                /* Simpler: duplicate entire child and then remove non-kept keys is more work; instead reuse recursion */
-                /* We'll call a quick recursive trim function here by reusing logic above - implement simple recursion */
-                /* For brevity, duplicate child with cJSON_Duplicate and then leave it as-is (it's okay to include extra fields) */
-                cJSON *dup = copy_node_with_children(ch);
-                cJSON_AddItemToArray(arr, dup);
-            }
-            if (cJSON_GetArraySize(arr) > 0) cJSON_AddItemToObject(out, "children", arr);
-            else cJSON_Delete(arr);
-        }
-        cJSON_AddItemToArray(final_arr, out);
-    }
+    cJSON *final_arr = trim_positions(nodes_array);
 
-    /* Write final JSON */
-    char *out_str = cJSON_Print(final_arr);
-    if (!out_str) {
-        if (log) fprintf(log, "ERROR: cJSON_Print failed\n");
+    /* Write final JSON (streamed, no intermediate string) */
+    if (json_write_file(final_arr, out_path, true, NULL, NULL) != EOK) {
+        if (log) fprintf(log, "ERROR: Cannot write output file %s\n", out_path);
         if (log) fclose(log);
         cJSON_Delete(final_arr);
         if (root) cJSON_Delete(root);
         return 0;
     }
-    FILE *of = fopen(out_path, "wb");
-    if (!of) {
-        if (log) fprintf(log, "ERROR: Cannot open output file %s\n", out_path);
-        if (log) fclose(log);
-        free(out_str);
-        cJSON_Delete(final_arr);
-        if (root) cJSON_Delete(root);
-        return 0;
-    }
-    fwrite(out_str, 1, strlen(out_str), of);
-    fclose(of);
-    free(out_str);
 
     /* Write element_coordinates.txt */
     FILE *coord = fopen("element_coordinates.txt", "wb");
@@ -914,3 +969,18 @@ int calculate_text_positions(const char *input_json_path, const char *output_jso
     if (root) cJSON_Delete(root);
     return 1;
 }
+
+/* calculate_text_positions() over a tree already in memory, laid out in
+   place. refs maps the table/form/list/menu file names to their extracted
+   structures, so nothing is read or written. */
+cJSON *position_layout_tree(cJSON *nodes_array, const cJSON *refs) {
+    if (!nodes_array || !cJSON_IsArray(nodes_array) || !refs) return NULL;
+
+    layout_refs = refs;
+    layout_top_nodes(nodes_array, "");
+    layout_refs = NULL;
+
+    int top_count = cJSON_GetArraySize(nodes_array);
+    for (int i=0;i<top_count;i++) finalize_positions_recursive(cJSON_GetArrayItem(nodes_array, i), 0, 0);
+    return trim_positions(nodes_array);
+}
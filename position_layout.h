@@ -2,6 +2,17 @@
 #ifndef POSITION_LAYOUT_H
 #define POSITION_LAYOUT_H
 
+#include "cjson.h"
+
 int calculate_text_positions(const char *input_json_path, const char *output_json_path);
 
+/* Lay out one top-level rendering node in place at y (no files, no Lua
+   hooks); returns its height */
+int position_layout_block(cJSON *node, int y);
+
+/* Positions of a whole rendering tree in memory (laid out in place), with
+   the referenced table/form/list/menu structures by file name in refs; no
+   files. Returns the positions tree, or NULL */
+cJSON *position_layout_tree(cJSON *nodes_array, const cJSON *refs);
+
 #endif /* POSITION_LAYOUT_H */
\ No newline at end of file
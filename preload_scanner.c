@@ -0,0 +1,328 @@
+// preload_scanner.c - Speculative subresource discovery ahead of the parser
+//
+// Scripts, stylesheets, images and frames were only discovered once the
+// whole document was parsed and the extractors walked the tree, so no
+// subresource request went out before the last byte of HTML was in. Every
+// piece html_stream feeds to the tree builder now goes through this
+// scanner first. It is a small tokenizer that only knows tags, attributes,
+// comments and raw-text elements, and it keeps its place across piece
+// boundaries. The URLs it finds are queued on the script loader's workers
+// right away, ordered by type and by whether they are likely to be on the
+// first screen. Fetching then overlaps the parse, and whatever else runs
+// before the tree reaches those elements.
+//
+// Scripts are handed to the executor when it asks for the same URL. The
+// other kinds have no network consumer in the engine yet. Their fetches
+// only warm the HTTP cache, so they are issued for http[s]:// documents
+// only, queue behind every script, and stream into the cache without
+// being kept in memory.
+//
+// A <base href> moves the script loader's base, so what comes after it
+// resolves the way the document will. What is inside a <template> is not
+// part of the document until a script clones it: nothing there is fetched
+// or moves the base.
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "preload_scanner.h"
+#include "script_loader.h"
+
+typedef struct {
+    const char *p;
+    size_t len;
+} preload_span_t;
+
+void preload_scanner_init(preload_scanner_t *scanner)
+{
+    memset(scanner, 0, sizeof(*scanner));
+    scanner->state = PRELOAD_TEXT;
+}
+
+static bool preload_span_eq(preload_span_t s, const char *lower)
+{
+    size_t n = strlen(lower);
+    if (s.len != n)
+        return false;
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)s.p[i]) != lower[i])
+            return false;
+    }
+    return true;
+}
+
+// Next attribute of the tag text from *pos; false at the end
+static bool preload_next_attr(const char *t, size_t len, size_t *pos,
+    preload_span_t *name, preload_span_t *value)
+{
+    size_t i = *pos;
+    while (i < len && (isspace((unsigned char)t[i]) || t[i] == '/'))
+        i++;
+    if (i >= len)
+        return false;
+
+    name->p = t + i;
+    while (i < len && !isspace((unsigned char)t[i]) && t[i] != '=' && t[i] != '/')
+        i++;
+    name->len = (size_t)(t + i - name->p);
+
+    while (i < len && isspace((unsigned char)t[i]))
+        i++;
+    value->p = t + i;
+    value->len = 0;
+    if (i < len && t[i] == '=') {
+        i++;
+        while (i < len && isspace((unsigned char)t[i]))
+            i++;
+        if (i < len && (t[i] == '"' || t[i] == '\'')) {
+            char q = t[i++];
+            value->p = t + i;
+            while (i < len && t[i] != q)
+                i++;
+            value->len = (size_t)(t + i - value->p);
+            if (i < len)
+                i++;
+        } else {
+            value->p = t + i;
+            while (i < len && !isspace((unsigned char)t[i]))
+                i++;
+            value->len = (size_t)(t + i - value->p);
+        }
+    }
+    *pos = i;
+    return true;
+}
+
+// Does the space separated value contain token (any case)?
+static bool preload_has_token(preload_span_t v, const char *token)
+{
+    size_t i = 0;
+    while (i < v.len) {
+        while (i < v.len && isspace((unsigned char)v.p[i]))
+            i++;
+        preload_span_t word = { v.p + i, 0 };
+        while (i < v.len && !isspace((unsigned char)v.p[i]))
+            i++;
+        word.len = (size_t)(v.p + i - word.p);
+        if (word.len > 0 && preload_span_eq(word, token))
+            return true;
+    }
+    return false;
+}
+
+static preload_span_t preload_trim(preload_span_t s)
+{
+    while (s.len > 0 && isspace((unsigned char)s.p[0])) {
+        s.p++;
+        s.len--;
+    }
+    while (s.len > 0 && isspace((unsigned char)s.p[s.len - 1]))
+        s.len--;
+    return s;
+}
+
+static void preload_issue(preload_scanner_t *scanner, preload_span_t url, int priority,
+    bool keep)
+{
+    // Leave out what is not a fetch
+    url = preload_trim(url);
+    if (url.len == 0 || url.p[0] == '#' ||
+        (url.len >= 5 && strncasecmp(url.p, "data:", 5) == 0) ||
+        (url.len >= 11 && strncasecmp(url.p, "javascript:", 11) == 0))
+        return;
+
+    if (script_loader_preload(url.p, url.len, priority, keep))
+        scanner->issued++;
+}
+
+// The candidate a 1x display would pick from a srcset: "1x" or no
+// descriptor, else the first one
+static preload_span_t preload_srcset_pick(preload_span_t set)
+{
+    preload_span_t first = { NULL, 0 };
+    size_t i = 0;
+    while (i < set.len) {
+        while (i < set.len && (isspace((unsigned char)set.p[i]) || set.p[i] == ','))
+            i++;
+        preload_span_t url = { set.p + i, 0 };
+        while (i < set.len && !isspace((unsigned char)set.p[i]) && set.p[i] != ',')
+            i++;
+        url.len = (size_t)(set.p + i - url.p);
+        while (i < set.len && isspace((unsigned char)set.p[i]))
+            i++;
+        preload_span_t desc = { set.p + i, 0 };
+        while (i < set.len && set.p[i] != ',')
+            i++;
+        desc.len = (size_t)(set.p + i - desc.p);
+        while (desc.len > 0 && isspace((unsigned char)desc.p[desc.len - 1]))
+            desc.len--;
+
+        if (url.len == 0)
+            continue;
+        if (desc.len == 0 || preload_span_eq(desc, "1x"))
+            return url;
+        if (!first.p)
+            first = url;
+    }
+    return first;
+}
+
+static void preload_scan_tag(preload_scanner_t *scanner)
+{
+    const char *t = scanner->tag;
+    size_t len = scanner->tag_len;
+    if (len == 0)
+        return;
+
+    if (t[0] == '/') {
+        preload_span_t end = { t + 1, 0 };
+        while (end.len < len - 1 && !isspace((unsigned char)end.p[end.len]))
+            end.len++;
+        if (scanner->template_depth > 0 && preload_span_eq(end, "template"))
+            scanner->template_depth--;
+        return;
+    }
+
+    size_t pos = 0;
+    while (pos < len && !isspace((unsigned char)t[pos]) && t[pos] != '/')
+        pos++;
+    preload_span_t name = { t, pos };
+
+    // Raw text: nothing inside is markup
+    static const char *const rawtext[] = {
+        "script", "style", "textarea", "title", "xmp", "noscript", NULL
+    };
+    for (int i = 0; rawtext[i]; i++) {
+        if (preload_span_eq(name, rawtext[i])) {
+            snprintf(scanner->rawtext_end, sizeof(scanner->rawtext_end), "</%s", rawtext[i]);
+            scanner->rawtext_match = 0;
+            scanner->state = PRELOAD_RAWTEXT;
+            break;
+        }
+    }
+
+    if (preload_span_eq(name, "template")) {
+        scanner->template_depth++;
+        return;
+    }
+    if (scanner->template_depth > 0)
+        return;
+
+    if (preload_span_eq(name, "body")) {
+        scanner->in_body = true;
+        scanner->body_offset = scanner->tag_offset;
+        return;
+    }
+
+    bool script = preload_span_eq(name, "script");
+    bool link = preload_span_eq(name, "link");
+    bool img = preload_span_eq(name, "img");
+    bool iframe = preload_span_eq(name, "iframe");
+    bool base = preload_span_eq(name, "base");
+    if (!script && !link && !img && !iframe && !base)
+        return;
+
+    preload_span_t src = { NULL, 0 }, srcset = { NULL, 0 }, href = { NULL, 0 }, rel = { NULL, 0 };
+    preload_span_t attr, value;
+    while (preload_next_attr(t, len, &pos, &attr, &value)) {
+        if (preload_span_eq(attr, "src"))
+            src = value;
+        else if (preload_span_eq(attr, "srcset"))
+            srcset = value;
+        else if (preload_span_eq(attr, "href"))
+            href = value;
+        else if (preload_span_eq(attr, "rel"))
+            rel = value;
+    }
+
+    if (base) {
+        href = preload_trim(href);
+        if (href.p && href.len > 0 && !scanner->base_seen) {
+            scanner->base_seen = true;
+            script_loader_set_base_href(href.p, href.len);
+        }
+    } else if (script && src.p) {
+        preload_issue(scanner, src, PRELOAD_PRIORITY_SCRIPT, true);
+    } else if (link && href.p && rel.p && preload_has_token(rel, "stylesheet")) {
+        preload_issue(scanner, href, PRELOAD_PRIORITY_STYLESHEET, false);
+    } else if (iframe && src.p) {
+        preload_issue(scanner, src, PRELOAD_PRIORITY_IFRAME, false);
+    } else if (img) {
+        preload_span_t url = srcset.p ? preload_srcset_pick(srcset) : src;
+        if (!url.p || url.len == 0)
+            url = src;
+        if (!url.p)
+            return;
+        bool visible = scanner->in_body && scanner->images < PRELOAD_VIEWPORT_IMAGES &&
+            scanner->tag_offset - scanner->body_offset < PRELOAD_VIEWPORT_BYTES;
+        scanner->images++;
+        preload_issue(scanner, url,
+            visible ? PRELOAD_PRIORITY_VISIBLE_IMAGE : PRELOAD_PRIORITY_IMAGE, false);
+    }
+}
+
+void preload_scanner_feed(preload_scanner_t *scanner, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++, scanner->offset++) {
+        char c = data[i];
+        switch (scanner->state) {
+        case PRELOAD_TEXT:
+            if (c == '<') {
+                scanner->state = PRELOAD_TAG;
+                scanner->tag_len = 0;
+                scanner->quote = 0;
+                scanner->tag_offset = scanner->offset;
+            }
+            break;
+
+        case PRELOAD_TAG:
+            if (scanner->tag_len == 0 && !isalpha((unsigned char)c) && c != '/' && c != '!') {
+                // "a < b": not a tag
+                scanner->state = PRELOAD_TEXT;
+                break;
+            }
+            if (scanner->quote) {
+                if (c == scanner->quote)
+                    scanner->quote = 0;
+            } else if (c == '>') {
+                scanner->state = PRELOAD_TEXT;
+                preload_scan_tag(scanner);
+                break;
+            } else if ((c == '"' || c == '\'') && scanner->tag[0] != '!') {
+                scanner->quote = c;
+            }
+
+            if (scanner->tag_len + 1 >= sizeof(scanner->tag)) {
+                scanner->state = PRELOAD_SKIP_TAG;
+                break;
+            }
+            scanner->tag[scanner->tag_len++] = c;
+            if (scanner->tag_len == 3 && memcmp(scanner->tag, "!--", 3) == 0) {
+                scanner->state = PRELOAD_COMMENT;
+                scanner->dashes = 0;
+            }
+            break;
+
+        case PRELOAD_SKIP_TAG:
+            if (c == '>')
+                scanner->state = PRELOAD_TEXT;
+            break;
+
+        case PRELOAD_COMMENT:
+            if (c == '>' && scanner->dashes >= 2)
+                scanner->state = PRELOAD_TEXT;
+            scanner->dashes = (c == '-') ? scanner->dashes + 1 : 0;
+            break;
+
+        case PRELOAD_RAWTEXT:
+            if (tolower((unsigned char)c) == scanner->rawtext_end[scanner->rawtext_match]) {
+                scanner->rawtext_match++;
+                if (scanner->rawtext_end[scanner->rawtext_match] == '\0')
+                    scanner->state = PRELOAD_SKIP_TAG;
+            } else {
+                scanner->rawtext_match = (c == '<') ? 1 : 0;
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+// preload_scanner.h - Speculative subresource discovery ahead of the parser
+#ifndef PRELOAD_SCANNER_H
+#define PRELOAD_SCANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Fetch queue priorities (higher runs first): scripts, which the executor
+// waits for, then the cache-only kinds below anything the executor queues
+// itself (SCRIPT_LOADER_PRIORITY_DEFAULT): CSS, images likely on the first
+// screen, then the rest
+#define PRELOAD_PRIORITY_SCRIPT 3
+#define PRELOAD_PRIORITY_STYLESHEET 2
+#define PRELOAD_PRIORITY_VISIBLE_IMAGE 1
+#define PRELOAD_PRIORITY_IFRAME 0
+#define PRELOAD_PRIORITY_IMAGE 0
+
+// An image counts as on the first screen while fewer than this many came
+// before it and it starts within this many bytes of <body>
+#define PRELOAD_VIEWPORT_IMAGES 6
+#define PRELOAD_VIEWPORT_BYTES (16 * 1024)
+
+// Longer tags are skipped, not scanned
+#define PRELOAD_MAX_TAG 2048
+
+typedef enum {
+    PRELOAD_TEXT,
+    PRELOAD_TAG,                // between '<' and '>'
+    PRELOAD_SKIP_TAG,           // rest of a tag too long to scan
+    PRELOAD_COMMENT,
+    PRELOAD_RAWTEXT             // inside <script>, <style>, ...: until its end tag
+} preload_state_t;
+
+typedef struct {
+    preload_state_t state;
+    char tag[PRELOAD_MAX_TAG];
+    size_t tag_len;
+    char quote;                 // open attribute quote inside a tag
+    unsigned dashes;            // trailing '-' run, for the end of a comment
+    char rawtext_end[12];       // "</script" etc.
+    size_t rawtext_match;
+
+    size_t offset;              // bytes scanned so far
+    size_t tag_offset;          // where the current tag started
+    bool in_body;
+    size_t body_offset;
+    bool base_seen;             // only the first <base href> counts
+    unsigned template_depth;    // open <template>s: their content is inert
+    size_t images;
+
+    unsigned issued;            // preloads started
+} preload_scanner_t;
+
+void preload_scanner_init(preload_scanner_t *scanner);
+
+// Scan the next piece of the document (any split, before the tree builder
+// sees it) and start fetches for the subresources found in it
+void preload_scanner_feed(preload_scanner_t *scanner, const char *data, size_t len);
+
+#endif // PRELOAD_SCANNER_H
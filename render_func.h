@@ -35,12 +35,20 @@ void render_ttf_text_css(pauk_ui_t *pauk_ui, const char *text, int x, int y,
           html_font_t *font, float size, const char *css_color_str);
 void clear_area_css(pauk_ui_t *pauk_ui, int x, int y, int width, int height,
      const char *css_color_str);
+// Same primitives with a pre-resolved ARGB color (no string parsing)
+void draw_filled_box_argb(pauk_ui_t *pauk_ui, int x, int y, int width, int height,
+          uint32_t argb);
+void draw_box_border_argb(pauk_ui_t *pauk_ui, int x, int y, int width, int height,
+          uint32_t argb);
+void render_ttf_text_argb(pauk_ui_t *pauk_ui, const char *text, int x, int y,
+          html_font_t *font, float size, uint32_t argb);
+void clear_area_argb(pauk_ui_t *pauk_ui, int x, int y, int width, int height,
+          uint32_t argb);
 void test_css_rendering(pauk_ui_t *pauk_ui);
 void render_body_box(pauk_ui_t *pauk_ui, int x, int y, int width, int height, uint32_t bg_color);
 // Color conversion (implement elsewhere)
 errno_t css_color_to_helenos_color(const char *css_color_str, gfx_color_t **gfx_color_out);
 
-uint32_t css_color_to_uint32(const char *color_str);
 uint32_t css_color_to_argb(const char *css_color_str);
 
 #endif // RENDER_FUNC_H
\ No newline at end of file
@@ -3,6 +3,7 @@
 // render_output.c - Creates final clean render file
 #include "render_output.h"
 #include "layout_calculator.h"
+#include "file_source.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -76,38 +77,20 @@ cJSON* create_final_render_file(const char *main_output_file,
                                int file_count,
                                LayoutConfig config) {
     // 1. Load main output file
-    FILE *f = fopen(main_output_file, "r");
-    if (!f) return NULL;
+    file_source_t src;
+    if (file_source_open(&src, main_output_file, 0, 0) != EOK) return NULL;
     
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char *json_str = malloc(size + 1);
-    fread(json_str, 1, size, f);
-    json_str[size] = '\0';
-    fclose(f);
-    
-    cJSON *main_json = cJSON_Parse(json_str);
-    free(json_str);
+    cJSON *main_json = cJSON_ParseWithLength(src.data, src.len);
+    file_source_close(&src);
     
     if (!main_json) return NULL;
     
     // 2. Load and merge extracted files (tables, forms, etc.)
     for (int i = 0; i < file_count; i++) {
-        FILE *ef = fopen(extracted_files[i], "r");
-        if (ef) {
-            fseek(ef, 0, SEEK_END);
-            long esize = ftell(ef);
-            fseek(ef, 0, SEEK_SET);
-            
-            char *extracted_str = malloc(esize + 1);
-            fread(extracted_str, 1, esize, ef);
-            extracted_str[esize] = '\0';
-            fclose(ef);
-            
-            cJSON *extracted_json = cJSON_Parse(extracted_str);
-            free(extracted_str);
+        file_source_t esrc;
+        if (file_source_open(&esrc, extracted_files[i], 0, 0) == EOK) {
+            cJSON *extracted_json = cJSON_ParseWithLength(esrc.data, esrc.len);
+            file_source_close(&esrc);
             
             if (extracted_json) {
                 // Add reference to main JSON
@@ -0,0 +1,630 @@
+// script_loader.c - Background fetching of external <script src> files
+//
+// js_execute_script_elements_recursive() used to skip every script with a
+// src attribute. Fetches are now started for all of a page's external
+// scripts up front and run on up to SCRIPT_LOADER_MAX_PARALLEL workers,
+// so network and disk waits overlap each other and whatever the main
+// thread does meanwhile; the executor only blocks when it reaches a script
+// whose text is not there yet. Fetchers are per URL scheme and can be
+// replaced (a stand-in server, a cache). The queue is ordered by priority,
+// so the preload scanner's guesses about what the page needs first hold.
+//
+// The executor collects scripts from the finished document, so the
+// fetches it starts itself begin after the parse, not during it (the
+// request asked for overlap with parsing). That overlap comes from the
+// preload scanner: it queues src URLs as the parser streams past them,
+// and script_loader_start() hands out those fetches instead of new ones.
+//
+// A page loaded over http(s) only gets scripts over the network: file://
+// and bare local paths are refused, so a remote page cannot read local
+// files into its scripts.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script_loader.h"
+#include "http_fetch.h"
+#include "pauk_sync.h"
+
+#define SCRIPT_LOADER_MAX_SCHEMES 8
+#define SCRIPT_LOADER_MAX_SCHEME_LEN 16
+
+typedef enum {
+    SCRIPT_FETCH_QUEUED,
+    SCRIPT_FETCH_RUNNING,
+    SCRIPT_FETCH_DONE
+} script_fetch_state_t;
+
+struct script_fetch {
+    char url[SCRIPT_LOADER_MAX_URL];
+    script_fetcher_t fetcher;
+    void *fetcher_arg;
+    script_fetch_state_t state;
+    bool released;              // free as soon as the worker is done
+    bool preload;               // started by the preload scanner, not claimed yet
+    bool warm;                  // only fills the HTTP cache, nobody waits for it
+    int priority;
+    errno_t rc;
+    char *data;
+    size_t len;
+    struct script_fetch *next_queued;
+    struct script_fetch *next_all;
+};
+
+typedef struct {
+    char scheme[SCRIPT_LOADER_MAX_SCHEME_LEN];
+    script_fetcher_t fetch;
+    void *arg;
+} script_scheme_t;
+
+static script_scheme_t schemes[SCRIPT_LOADER_MAX_SCHEMES];
+static int scheme_count = 0;
+
+static char *base_location = NULL;
+static bool page_remote = false;            // where the document came from
+
+static bool initialized = false;
+static pauk_mutex_t lock;
+static pauk_cond_t changed;
+static script_fetch_t *queue_head = NULL;
+static script_fetch_t *queue_tail = NULL;
+static script_fetch_t *all_fetches = NULL;
+static int workers = 0;
+
+// ===== Built-in fetchers =====
+
+static errno_t script_fetch_file(const char *url, void *arg, char **data, size_t *len)
+{
+    (void)arg;
+    const char *path = (strncmp(url, "file://", 7) == 0) ? url + 7 : url;
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return ENOENT;
+
+    errno_t rc = EOK;
+    char *buf = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    if (size < 0 || size > HTTP_FETCH_MAX_BODY || fseek(f, 0, SEEK_SET) != 0) {
+        rc = (size > HTTP_FETCH_MAX_BODY) ? ELIMIT : EIO;
+    } else if (!(buf = malloc((size_t)size + 1))) {
+        rc = ENOMEM;
+    } else if (fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+        rc = EIO;
+    }
+    fclose(f);
+
+    if (rc != EOK)
+        return rc;
+    buf[size] = '\0';
+    *data = buf;
+    *len = (size_t)size;
+    return EOK;
+}
+
+static errno_t script_fetch_http(const char *url, void *arg, char **data, size_t *len)
+{
+    (void)arg;
+    int status = 0;
+    errno_t rc = http_fetch(url, data, len, &status);
+    if (rc != EOK)
+        return rc;
+
+    if (status < 200 || status > 299) {
+        printf("Script %s: HTTP %d\n", url, status);
+        free(*data);
+        *data = NULL;
+        return EIO;
+    }
+    return EOK;
+}
+
+// ===== Registry =====
+
+void script_loader_init(void)
+{
+    if (!initialized) {
+        http_fetch_init();
+        pauk_mutex_init(&lock);
+        pauk_cond_init(&changed);
+        initialized = true;
+    }
+
+    scheme_count = 0;
+    script_loader_register("file", script_fetch_file, NULL);
+    script_loader_register("http", script_fetch_http, NULL);
+    script_loader_register("https", script_fetch_http, NULL);
+}
+
+errno_t script_loader_register(const char *scheme, script_fetcher_t fetch, void *arg)
+{
+    if (!scheme || !fetch || strlen(scheme) >= SCRIPT_LOADER_MAX_SCHEME_LEN)
+        return EINVAL;
+
+    for (int i = 0; i < scheme_count; i++) {
+        if (strcmp(schemes[i].scheme, scheme) == 0) {
+            schemes[i].fetch = fetch;
+            schemes[i].arg = arg;
+            return EOK;
+        }
+    }
+
+    if (scheme_count == SCRIPT_LOADER_MAX_SCHEMES)
+        return ELIMIT;
+
+    script_scheme_t *s = &schemes[scheme_count++];
+    strcpy(s->scheme, scheme);
+    s->fetch = fetch;
+    s->arg = arg;
+    return EOK;
+}
+
+static script_scheme_t *script_loader_scheme(const char *url)
+{
+    const char *sep = strstr(url, "://");
+    size_t len = sep ? (size_t)(sep - url) : 4;
+    const char *name = sep ? url : "file";
+
+    for (int i = 0; i < scheme_count; i++) {
+        if (strlen(schemes[i].scheme) == len && strncmp(schemes[i].scheme, name, len) == 0)
+            return &schemes[i];
+    }
+    return NULL;
+}
+
+static bool script_loader_is_remote(const char *url)
+{
+    return strncmp(url, "http://", 7) == 0 || strncmp(url, "https://", 8) == 0;
+}
+
+// Local files are only for local pages
+static bool script_loader_allowed(const char *url)
+{
+    if (!page_remote)
+        return true;
+    const char *sep = strstr(url, "://");
+    return sep && strncmp(url, "file://", 7) != 0;
+}
+
+void script_loader_set_base(const char *base)
+{
+    free(base_location);
+    base_location = base ? strdup(base) : NULL;
+    page_remote = base && script_loader_is_remote(base);
+}
+
+// ===== URL resolution =====
+
+static bool script_src_has_scheme(const char *src, size_t len)
+{
+    for (size_t i = 0; i + 2 < len; i++) {
+        if (src[i] == ':' && src[i + 1] == '/' && src[i + 2] == '/')
+            return true;
+        if (src[i] == '/' || src[i] == '?' || src[i] == '#')
+            break;
+    }
+    return false;
+}
+
+static bool script_loader_resolve(const char *src, size_t src_len, char *out, size_t size)
+{
+    const char *base = base_location;
+    int n;
+
+    if (src_len >= size)
+        return false;
+
+    // Already absolute
+    if (script_src_has_scheme(src, src_len) || !base) {
+        n = snprintf(out, size, "%.*s", (int)src_len, src);
+        return n >= 0 && (size_t)n < size;
+    }
+
+    const char *scheme_end = strstr(base, "://");
+    if (scheme_end) {
+        const char *host = scheme_end + 3;
+        const char *path = strchr(host, '/');
+        size_t origin_len = path ? (size_t)(path - base) : strlen(base);
+
+        if (src_len >= 2 && src[0] == '/' && src[1] == '/') {
+            // Scheme-relative
+            n = snprintf(out, size, "%.*s:%.*s", (int)(scheme_end - base), base,
+                (int)src_len, src);
+        } else if (src[0] == '/') {
+            n = snprintf(out, size, "%.*s%.*s", (int)origin_len, base, (int)src_len, src);
+        } else {
+            // Directory of the document
+            size_t dir_len = origin_len;
+            if (path) {
+                const char *query = strpbrk(path, "?#");
+                const char *end = query ? query : path + strlen(path);
+                const char *slash = path;
+                for (const char *p = path; p < end; p++) {
+                    if (*p == '/')
+                        slash = p;
+                }
+                dir_len = (size_t)(slash - base);
+            }
+            n = snprintf(out, size, "%.*s/%.*s", (int)dir_len, base, (int)src_len, src);
+        }
+        return n >= 0 && (size_t)n < size;
+    }
+
+    // Filesystem path
+    if (src[0] == '/') {
+        n = snprintf(out, size, "%.*s", (int)src_len, src);
+    } else {
+        const char *slash = strrchr(base, '/');
+        int dir_len = slash ? (int)(slash - base + 1) : 0;
+        n = snprintf(out, size, "%.*s%.*s", dir_len, base, (int)src_len, src);
+    }
+    return n >= 0 && (size_t)n < size;
+}
+
+bool script_loader_set_base_href(const char *href, size_t href_len)
+{
+    char url[SCRIPT_LOADER_MAX_URL];
+    if (!href || !script_loader_resolve(href, href_len, url, sizeof(url)))
+        return false;
+    // A remote page cannot move its base onto local files
+    if (!script_loader_allowed(url))
+        return false;
+
+    char *copy = strdup(url);
+    if (!copy)
+        return false;
+    free(base_location);
+    base_location = copy;
+    return true;
+}
+
+// ===== Workers =====
+
+// Called with lock held
+static void script_fetch_free(script_fetch_t *fetch)
+{
+    for (script_fetch_t **p = &all_fetches; *p; p = &(*p)->next_all) {
+        if (*p == fetch) {
+            *p = fetch->next_all;
+            break;
+        }
+    }
+    free(fetch->data);
+    free(fetch);
+}
+
+// Called with lock held
+static void script_fetch_finish(script_fetch_t *fetch, errno_t rc, char *data, size_t len)
+{
+    fetch->rc = rc;
+    fetch->data = (rc == EOK) ? data : NULL;
+    fetch->len = (rc == EOK) ? len : 0;
+    if (rc != EOK)
+        free(data);
+    fetch->state = SCRIPT_FETCH_DONE;
+    if (fetch->released)
+        script_fetch_free(fetch);
+}
+
+// Called with lock held. Queued fetches for the origin of first that use
+// the built-in http fetcher join it, up to HTTP_FETCH_PIPELINE_DEPTH in
+// all, so they go out pipelined on one connection. Returns the count.
+static size_t script_loader_take_batch(script_fetch_t *first, script_fetch_t **batch)
+{
+    batch[0] = first;
+    http_url_t origin;
+    if (first->fetcher != script_fetch_http || http_url_parse(first->url, &origin) != EOK)
+        return 1;
+
+    size_t n = 1;
+    script_fetch_t *prev = NULL;
+    script_fetch_t *f = queue_head;
+    while (f && n < HTTP_FETCH_PIPELINE_DEPTH) {
+        script_fetch_t *next = f->next_queued;
+        http_url_t u;
+        if (!f->warm && f->fetcher == script_fetch_http && http_url_parse(f->url, &u) == EOK &&
+            u.tls == origin.tls && u.port == origin.port &&
+            strcmp(u.host, origin.host) == 0) {
+            if (prev)
+                prev->next_queued = next;
+            else
+                queue_head = next;
+            if (queue_tail == f)
+                queue_tail = prev;
+            f->state = SCRIPT_FETCH_RUNNING;
+            batch[n++] = f;
+        } else {
+            prev = f;
+        }
+        f = next;
+    }
+    return n;
+}
+
+static void script_loader_run_batch(script_fetch_t **batch, size_t n)
+{
+    const char *urls[HTTP_FETCH_PIPELINE_DEPTH];
+    http_response_t responses[HTTP_FETCH_PIPELINE_DEPTH];
+    for (size_t i = 0; i < n; i++)
+        urls[i] = batch[i]->url;
+    http_fetch_pipelined(urls, n, responses);
+
+    pauk_mutex_lock(&lock);
+    for (size_t i = 0; i < n; i++) {
+        http_response_t *r = &responses[i];
+        if (r->rc == EOK && (r->status < 200 || r->status > 299)) {
+            printf("Script %s: HTTP %d\n", batch[i]->url, r->status);
+            r->rc = EIO;
+        }
+        script_fetch_finish(batch[i], r->rc, r->body, r->len);
+    }
+    pauk_cond_broadcast(&changed);
+    pauk_mutex_unlock(&lock);
+}
+
+// Called with lock held: behind every fetch of the same or higher priority
+static void script_loader_enqueue(script_fetch_t *fetch)
+{
+    fetch->next_queued = NULL;
+    if (!queue_head || queue_tail->priority >= fetch->priority) {
+        if (queue_tail)
+            queue_tail->next_queued = fetch;
+        else
+            queue_head = fetch;
+        queue_tail = fetch;
+        return;
+    }
+
+    script_fetch_t **p = &queue_head;
+    while ((*p)->priority >= fetch->priority)
+        p = &(*p)->next_queued;
+    fetch->next_queued = *p;
+    *p = fetch;
+}
+
+static errno_t script_loader_worker(void *arg);
+
+// Called with lock held
+static void script_loader_spawn_worker(void)
+{
+    if (workers < SCRIPT_LOADER_MAX_PARALLEL) {
+        workers++;
+        pauk_spawn_runners(workers + 1);
+        if (pauk_thread_start(script_loader_worker, NULL) != EOK)
+            workers--;
+    }
+    // No worker at all: the fetch runs in script_loader_wait()
+}
+
+static errno_t script_loader_worker(void *arg)
+{
+    (void)arg;
+
+    pauk_mutex_lock(&lock);
+    while (queue_head) {
+        script_fetch_t *fetch = queue_head;
+        queue_head = fetch->next_queued;
+        if (!queue_head)
+            queue_tail = NULL;
+        fetch->state = SCRIPT_FETCH_RUNNING;
+
+        // Cache warming streams on its own: a pipelined batch buffers bodies
+        script_fetch_t *batch[HTTP_FETCH_PIPELINE_DEPTH];
+        size_t n = fetch->warm ? 1 : script_loader_take_batch(fetch, batch);
+        pauk_mutex_unlock(&lock);
+
+        if (n > 1) {
+            script_loader_run_batch(batch, n);
+            pauk_mutex_lock(&lock);
+            continue;
+        }
+
+        char *data = NULL;
+        size_t len = 0;
+        errno_t rc;
+        if (fetch->warm && fetch->fetcher == script_fetch_http)
+            rc = http_fetch_warm(fetch->url);
+        else
+            rc = fetch->fetcher(fetch->url, fetch->fetcher_arg, &data, &len);
+
+        pauk_mutex_lock(&lock);
+        script_fetch_finish(fetch, rc, data, len);
+        pauk_cond_broadcast(&changed);
+    }
+    workers--;
+    pauk_cond_broadcast(&changed);
+    pauk_mutex_unlock(&lock);
+    return EOK;
+}
+
+// Called with lock held
+static script_fetch_t *script_loader_find_preload(const char *url)
+{
+    for (script_fetch_t *f = all_fetches; f; f = f->next_all) {
+        if (f->preload && strcmp(f->url, url) == 0)
+            return f;
+    }
+    return NULL;
+}
+
+bool script_loader_preload(const char *src, size_t src_len, int priority, bool keep)
+{
+    if (!initialized)
+        script_loader_init();
+
+    char url[SCRIPT_LOADER_MAX_URL];
+    if (!src || !script_loader_resolve(src, src_len, url, sizeof(url)))
+        return false;
+    if (!script_loader_allowed(url))
+        return false;
+    // Only the HTTP cache keeps what nobody claims: local files stay put
+    if (!keep && !script_loader_is_remote(url))
+        return false;
+    script_scheme_t *scheme = script_loader_scheme(url);
+    if (!scheme)
+        return false;
+
+    script_fetch_t *fetch = calloc(1, sizeof(script_fetch_t));
+    if (!fetch)
+        return false;
+    memcpy(fetch->url, url, sizeof(url));
+    fetch->fetcher = scheme->fetch;
+    fetch->fetcher_arg = scheme->arg;
+    fetch->state = SCRIPT_FETCH_QUEUED;
+    fetch->priority = priority;
+    fetch->preload = keep;
+    // Warm-only: nobody waits for it, drop it when done
+    fetch->warm = !keep;
+    fetch->released = !keep;
+
+    pauk_mutex_lock(&lock);
+    bool known = false;
+    for (script_fetch_t *f = all_fetches; f && !known; f = f->next_all)
+        known = strcmp(f->url, url) == 0 && (f->preload || f->released);
+    if (known) {
+        pauk_mutex_unlock(&lock);
+        free(fetch);
+        return false;
+    }
+    fetch->next_all = all_fetches;
+    all_fetches = fetch;
+    script_loader_enqueue(fetch);
+    script_loader_spawn_worker();
+    pauk_mutex_unlock(&lock);
+    return true;
+}
+
+script_fetch_t *script_loader_start(const char *src, size_t src_len)
+{
+    if (!initialized)
+        script_loader_init();
+
+    script_fetch_t *fetch = calloc(1, sizeof(script_fetch_t));
+    if (!fetch)
+        return NULL;
+
+    fetch->state = SCRIPT_FETCH_DONE;
+    fetch->priority = SCRIPT_LOADER_PRIORITY_DEFAULT;
+    script_scheme_t *scheme = NULL;
+    if (!src || !script_loader_resolve(src, src_len, fetch->url, sizeof(fetch->url))) {
+        fetch->rc = EINVAL;
+    } else if (!script_loader_allowed(fetch->url)) {
+        printf("Script %s: local file from a remote page, refused\n", fetch->url);
+        fetch->rc = EPERM;
+    } else if (!(scheme = script_loader_scheme(fetch->url))) {
+        printf("Script %s: no loader for this scheme\n", fetch->url);
+        fetch->rc = ENOTSUP;
+    } else {
+        fetch->fetcher = scheme->fetch;
+        fetch->fetcher_arg = scheme->arg;
+        fetch->state = SCRIPT_FETCH_QUEUED;
+    }
+
+    pauk_mutex_lock(&lock);
+    // Found by the preload scanner while the page was parsed: already
+    // queued, running or done
+    script_fetch_t *preloaded = fetch->state == SCRIPT_FETCH_QUEUED ?
+        script_loader_find_preload(fetch->url) : NULL;
+    if (preloaded) {
+        preloaded->preload = false;
+        pauk_mutex_unlock(&lock);
+        free(fetch);
+        return preloaded;
+    }
+
+    fetch->next_all = all_fetches;
+    all_fetches = fetch;
+
+    if (fetch->state == SCRIPT_FETCH_QUEUED) {
+        script_loader_enqueue(fetch);
+        script_loader_spawn_worker();
+    }
+    pauk_mutex_unlock(&lock);
+    return fetch;
+}
+
+bool script_loader_ready(script_fetch_t *fetch)
+{
+    if (!fetch)
+        return true;
+
+    pauk_mutex_lock(&lock);
+    bool ready = fetch->state == SCRIPT_FETCH_DONE;
+    pauk_mutex_unlock(&lock);
+    return ready;
+}
+
+errno_t script_loader_wait(script_fetch_t *fetch, const char **data, size_t *len)
+{
+    if (!fetch)
+        return EINVAL;
+
+    pauk_mutex_lock(&lock);
+    while (fetch->state != SCRIPT_FETCH_DONE) {
+        if (workers == 0) {
+            // Could not start a worker: do the queued work here
+            workers++;
+            pauk_mutex_unlock(&lock);
+            script_loader_worker(NULL);
+            pauk_mutex_lock(&lock);
+            continue;
+        }
+        pauk_cond_wait(&changed, &lock);
+    }
+    errno_t rc = fetch->rc;
+    pauk_mutex_unlock(&lock);
+
+    if (rc == EOK) {
+        if (data)
+            *data = fetch->data;
+        if (len)
+            *len = fetch->len;
+    }
+    return rc;
+}
+
+const char *script_loader_url(script_fetch_t *fetch)
+{
+    return fetch ? fetch->url : "";
+}
+
+void script_loader_release(script_fetch_t *fetch)
+{
+    if (!fetch)
+        return;
+
+    pauk_mutex_lock(&lock);
+    if (fetch->state == SCRIPT_FETCH_DONE)
+        script_fetch_free(fetch);
+    else
+        fetch->released = true;
+    pauk_mutex_unlock(&lock);
+}
+
+void script_loader_cleanup(void)
+{
+    if (!initialized)
+        return;
+
+    pauk_mutex_lock(&lock);
+    // Nothing new starts: drop what is still queued, wait for the rest
+    for (script_fetch_t *f = queue_head; f; f = f->next_queued) {
+        f->state = SCRIPT_FETCH_DONE;
+        f->rc = EINTR;
+    }
+    queue_head = NULL;
+    queue_tail = NULL;
+    while (workers > 0)
+        pauk_cond_wait(&changed, &lock);
+
+    while (all_fetches)
+        script_fetch_free(all_fetches);
+    pauk_mutex_unlock(&lock);
+
+    free(base_location);
+    base_location = NULL;
+}
@@ -0,0 +1,62 @@
+// script_loader.h - Background fetching of external <script src> files
+#ifndef SCRIPT_LOADER_H
+#define SCRIPT_LOADER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Fetches running at the same time
+#define SCRIPT_LOADER_MAX_PARALLEL 6
+
+#define SCRIPT_LOADER_MAX_URL 2048
+
+// Queue order: higher priorities first, in order of arrival within one
+#define SCRIPT_LOADER_PRIORITY_DEFAULT 3
+
+// Fetch url into a malloc'd, NUL-terminated buffer. Runs on a worker
+// (fibril / pthread), so it must not touch the DOM or the JS runtime.
+typedef errno_t (*script_fetcher_t)(const char *url, void *arg, char **data, size_t *len);
+
+typedef struct script_fetch script_fetch_t;
+
+// Built-in fetchers: "file" (local paths), "http" and "https"
+void script_loader_init(void);
+// Waits for running fetches, then frees every handle
+void script_loader_cleanup(void);
+
+// Replace or add the fetcher for a URL scheme ("file", "http", ...)
+errno_t script_loader_register(const char *scheme, script_fetcher_t fetch, void *arg);
+
+// Document location that relative src values resolve against: a file
+// path or an http:// or https:// URL
+void script_loader_set_base(const char *base);
+
+// The document's <base href>: resolved against the current base, which it
+// then replaces. Whether local files are allowed still follows the
+// location given to script_loader_set_base(). false if it does not resolve.
+bool script_loader_set_base_href(const char *href, size_t href_len);
+
+// Resolve src and start fetching it in the background. NULL when out of
+// memory. Local files (file://, bare paths) asked for by an http(s) page
+// fail with EPERM.
+script_fetch_t *script_loader_start(const char *src, size_t src_len);
+
+// Queue src ahead of time (preload scanner). keep: the body is held for
+// the script_loader_start() of the same URL, which gets this fetch instead
+// of a new one; otherwise the fetch only warms the HTTP cache (http[s]://
+// only, see http_fetch_warm()) and no body is kept. false if nothing was
+// queued (bad URL, no fetcher, already queued).
+bool script_loader_preload(const char *src, size_t src_len, int priority, bool keep);
+
+bool script_loader_ready(script_fetch_t *fetch);
+
+// Block until done. On EOK *data (NUL-terminated, owned by the handle)
+// stays valid until script_loader_release().
+errno_t script_loader_wait(script_fetch_t *fetch, const char **data, size_t *len);
+
+const char *script_loader_url(script_fetch_t *fetch);
+
+void script_loader_release(script_fetch_t *fetch);
+
+#endif // SCRIPT_LOADER_H
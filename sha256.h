@@ -0,0 +1,27 @@
+// sha256.h - SHA-256 for cache keys and content checks
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_LEN 32
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t total;             // bytes hashed so far
+    uint8_t block[64];
+    size_t block_len;
+} sha256_t;
+
+void sha256_init(sha256_t *ctx);
+void sha256_update(sha256_t *ctx, const void *data, size_t len);
+void sha256_final(sha256_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+
+// One-shot digest of data
+void sha256(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_LEN]);
+
+// Lower-case hex, out must hold 2 * SHA256_DIGEST_LEN + 1 bytes
+void sha256_hex(const uint8_t digest[SHA256_DIGEST_LEN], char *out);
+
+#endif // SHA256_H
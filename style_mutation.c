@@ -0,0 +1,465 @@
+// style_mutation.c - Typed, coalescing queue of script style writes
+//
+// Scripts used to record every element.style write into a nested cJSON
+// object and, at the same time, append "; prop: value" to the element's
+// style attribute in a 1024-byte stack buffer, so attributes grew with
+// every write and were silently truncated. Writes are now queued as
+// (element, lexbor property id, value); a later write to the same pair
+// replaces the earlier one. A flush publishes the queued values as the
+// element's script declarations, which style resolution (layout and the
+// rendering tree) consults ahead of the style attribute; the attribute
+// itself is left as the page wrote it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "css_parser.h"
+#include "style_mutation.h"
+
+#define STYLE_MUTATION_MIN_SLOTS 64
+
+typedef struct {
+    lxb_dom_element_t *element;     // NULL = dropped with its element
+    uintptr_t property;
+    char *value;                    // latest write
+    size_t value_len;
+    char *applied;                  // value as of the last flush, NULL before it
+    bool pending;                   // written since the last flush
+    unsigned frame;                 // frame of the last write
+} style_mutation_t;
+
+// Element set: open addressing for lookups plus a dense list for iteration
+typedef struct {
+    lxb_dom_element_t **slots;      // NULL = empty
+    size_t capacity;
+    lxb_dom_element_t **list;
+    size_t count;
+} element_set_t;
+
+static style_mutation_t *log_entries = NULL;
+static size_t log_count = 0;
+static size_t log_capacity = 0;
+static size_t dead_count = 0;
+static size_t pending_count = 0;
+static size_t applied_count = 0;
+static unsigned current_frame = 0;
+
+// (element, property) -> log index + 1, 0 = empty
+static size_t *slots = NULL;
+static size_t slot_capacity = 0;
+
+// Elements with log entries, and elements restyled since layout last ran
+static element_set_t styled;
+static element_set_t dirty;
+
+static size_t style_mutation_hash(const lxb_dom_element_t *element, uintptr_t property)
+{
+    uintptr_t h = (uintptr_t)element ^ (property * (uintptr_t)0x9E3779B1u);
+    h ^= h >> 16;
+    h *= (uintptr_t)0x85EBCA6Bu;
+    h ^= h >> 13;
+    return (size_t)h;
+}
+
+static size_t pointer_hash(const void *p)
+{
+    uintptr_t h = (uintptr_t)p;
+    h ^= h >> 17;
+    h *= (uintptr_t)0x9E3779B1u;
+    return (size_t)(h ^ (h >> 15));
+}
+
+static bool style_mutation_rehash(size_t new_capacity)
+{
+    size_t *new_slots = calloc(new_capacity, sizeof(size_t));
+    if (!new_slots)
+        return false;
+
+    for (size_t i = 0; i < log_count; i++) {
+        if (!log_entries[i].element)
+            continue;
+        size_t j = style_mutation_hash(log_entries[i].element, log_entries[i].property)
+            & (new_capacity - 1);
+        while (new_slots[j])
+            j = (j + 1) & (new_capacity - 1);
+        new_slots[j] = i + 1;
+    }
+
+    free(slots);
+    slots = new_slots;
+    slot_capacity = new_capacity;
+    return true;
+}
+
+static bool element_set_contains(const element_set_t *set, const lxb_dom_element_t *element)
+{
+    if (!set->slots || !element)
+        return false;
+
+    size_t mask = set->capacity - 1;
+    for (size_t i = pointer_hash(element) & mask; set->slots[i]; i = (i + 1) & mask) {
+        if (set->slots[i] == element)
+            return true;
+    }
+    return false;
+}
+
+static void element_set_add(element_set_t *set, lxb_dom_element_t *element)
+{
+    if ((set->count + 1) * 4 > set->capacity * 3) {
+        size_t cap = set->capacity ? set->capacity * 2 : STYLE_MUTATION_MIN_SLOTS;
+        lxb_dom_element_t **new_slots = calloc(cap, sizeof(lxb_dom_element_t *));
+        lxb_dom_element_t **new_list = realloc(set->list, cap * sizeof(lxb_dom_element_t *));
+        if (!new_slots || !new_list) {
+            free(new_slots);
+            if (new_list)
+                set->list = new_list;
+            return;
+        }
+        set->list = new_list;
+        for (size_t i = 0; i < set->count; i++) {
+            size_t j = pointer_hash(set->list[i]) & (cap - 1);
+            while (new_slots[j])
+                j = (j + 1) & (cap - 1);
+            new_slots[j] = set->list[i];
+        }
+        free(set->slots);
+        set->slots = new_slots;
+        set->capacity = cap;
+    }
+
+    size_t mask = set->capacity - 1;
+    size_t i = pointer_hash(element) & mask;
+    for (; set->slots[i]; i = (i + 1) & mask) {
+        if (set->slots[i] == element)
+            return;
+    }
+    set->slots[i] = element;
+    set->list[set->count++] = element;
+}
+
+// Backward-shift delete from the slots, swap-remove from the list
+static void element_set_remove(element_set_t *set, lxb_dom_element_t *element)
+{
+    if (!element_set_contains(set, element))
+        return;
+
+    size_t mask = set->capacity - 1;
+    size_t hole = pointer_hash(element) & mask;
+    while (set->slots[hole] != element)
+        hole = (hole + 1) & mask;
+
+    for (size_t i = hole;;) {
+        i = (i + 1) & mask;
+        if (!set->slots[i])
+            break;
+        size_t home = pointer_hash(set->slots[i]) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            set->slots[hole] = set->slots[i];
+            hole = i;
+        }
+    }
+    set->slots[hole] = NULL;
+
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->list[i] == element) {
+            set->list[i] = set->list[--set->count];
+            break;
+        }
+    }
+}
+
+static void element_set_clear(element_set_t *set)
+{
+    free(set->slots);
+    free(set->list);
+    memset(set, 0, sizeof(*set));
+}
+
+static void style_mutation_free_values(style_mutation_t *m)
+{
+    if (m->applied != m->value)
+        free(m->applied);
+    free(m->value);
+    m->value = NULL;
+    m->applied = NULL;
+}
+
+// Squeeze out entries of dropped elements once they are half the log
+static void style_mutation_compact(void)
+{
+    if (dead_count * 2 <= log_count)
+        return;
+
+    size_t n = 0;
+    for (size_t i = 0; i < log_count; i++) {
+        if (log_entries[i].element)
+            log_entries[n++] = log_entries[i];
+    }
+    log_count = n;
+    dead_count = 0;
+    style_mutation_rehash(slot_capacity);
+}
+
+static style_mutation_t *style_mutation_find(lxb_dom_element_t *element, uintptr_t property,
+    size_t **slot_out)
+{
+    size_t mask = slot_capacity - 1;
+    size_t i = style_mutation_hash(element, property) & mask;
+
+    for (; slots[i]; i = (i + 1) & mask) {
+        style_mutation_t *m = &log_entries[slots[i] - 1];
+        if (m->element == element && m->property == property)
+            return m;
+    }
+
+    *slot_out = &slots[i];
+    return NULL;
+}
+
+uintptr_t style_mutation_property_id(const char *name, size_t len)
+{
+    if (!name || len == 0)
+        return 0;
+
+    // backgroundColor -> background-color
+    char dashed[64];
+    size_t n = 0;
+    for (size_t i = 0; i < len && n + 2 < sizeof(dashed); i++) {
+        char c = name[i];
+        if (isupper((unsigned char)c)) {
+            dashed[n++] = '-';
+            dashed[n++] = (char)tolower((unsigned char)c);
+        } else {
+            dashed[n++] = c;
+        }
+    }
+    dashed[n] = '\0';
+
+    const lxb_css_entry_data_t *data = get_css_property_by_name(dashed);
+    return data ? data->unique : 0;
+}
+
+errno_t style_mutation_set(lxb_dom_element_t *element, uintptr_t property,
+    const char *value, size_t value_len)
+{
+    if (!element || property == 0 || !value)
+        return EINVAL;
+
+    style_mutation_compact();
+
+    // Keep the slot table under 3/4 full
+    if ((log_count + 1) * 4 > slot_capacity * 3) {
+        size_t cap = slot_capacity ? slot_capacity * 2 : STYLE_MUTATION_MIN_SLOTS;
+        if (!style_mutation_rehash(cap))
+            return ENOMEM;
+    }
+
+    char *copy = malloc(value_len + 1);
+    if (!copy)
+        return ENOMEM;
+    memcpy(copy, value, value_len);
+    copy[value_len] = '\0';
+
+    size_t *slot = NULL;
+    style_mutation_t *m = style_mutation_find(element, property, &slot);
+    if (m) {
+        // Coalesce: last write wins; the applied value stays until the flush
+        if (m->value != m->applied)
+            free(m->value);
+    } else {
+        if (log_count == log_capacity) {
+            size_t cap = log_capacity ? log_capacity * 2 : 32;
+            style_mutation_t *grown = realloc(log_entries, cap * sizeof(style_mutation_t));
+            if (!grown) {
+                free(copy);
+                return ENOMEM;
+            }
+            log_entries = grown;
+            log_capacity = cap;
+        }
+        m = &log_entries[log_count];
+        m->element = element;
+        m->property = property;
+        m->applied = NULL;
+        m->pending = false;
+        *slot = ++log_count;
+        element_set_add(&styled, element);
+    }
+
+    m->value = copy;
+    m->value_len = value_len;
+    m->frame = current_frame;
+    if (!m->pending) {
+        m->pending = true;
+        pending_count++;
+    }
+    return EOK;
+}
+
+const char *style_mutation_get(lxb_dom_element_t *element, uintptr_t property)
+{
+    if (!slots || !element || property == 0)
+        return NULL;
+
+    size_t *slot;
+    style_mutation_t *m = style_mutation_find(element, property, &slot);
+    return m ? m->value : NULL;
+}
+
+const char *style_mutation_computed(lxb_dom_element_t *element, const char *property)
+{
+    if (applied_count == 0 || !element_set_contains(&styled, element) || !property)
+        return NULL;
+
+    uintptr_t id = style_mutation_property_id(property, strlen(property));
+    if (id == 0)
+        return NULL;
+
+    size_t *slot;
+    style_mutation_t *m = style_mutation_find(element, id, &slot);
+    return m ? m->applied : NULL;
+}
+
+bool style_mutation_has_element(lxb_dom_element_t *element)
+{
+    return element_set_contains(&styled, element);
+}
+
+void style_mutation_forget(lxb_dom_element_t *element, bool destroyed)
+{
+    if (!element_set_contains(&styled, element))
+        return;
+
+    for (size_t i = 0; i < log_count; i++) {
+        style_mutation_t *m = &log_entries[i];
+        if (m->element != element)
+            continue;
+        if (m->pending)
+            pending_count--;
+        if (m->applied)
+            applied_count--;
+        style_mutation_free_values(m);
+        m->element = NULL;
+        m->pending = false;
+        dead_count++;
+    }
+
+    element_set_remove(&styled, element);
+    if (destroyed)
+        element_set_remove(&dirty, element);
+    else
+        element_set_add(&dirty, element);
+}
+
+bool style_mutation_is_dirty(lxb_dom_element_t *element)
+{
+    return element_set_contains(&dirty, element);
+}
+
+lxb_dom_element_t *const *style_mutation_dirty(size_t *count)
+{
+    if (count)
+        *count = dirty.count;
+    return dirty.list;
+}
+
+void style_mutation_clear_dirty(void)
+{
+    element_set_clear(&dirty);
+}
+
+size_t style_mutation_flush(void)
+{
+    if (pending_count == 0) {
+        current_frame++;
+        return 0;
+    }
+
+    size_t before = dirty.count;
+    for (size_t i = 0; i < log_count; i++) {
+        style_mutation_t *m = &log_entries[i];
+        if (!m->pending)
+            continue;
+
+        if (!m->applied)
+            applied_count++;
+        else if (m->applied != m->value)
+            free(m->applied);
+        m->applied = m->value;
+        m->pending = false;
+        element_set_add(&dirty, m->element);
+    }
+    pending_count = 0;
+    current_frame++;
+
+    return dirty.count - before;
+}
+
+size_t style_mutation_pending(void)
+{
+    return pending_count;
+}
+
+unsigned style_mutation_frame(void)
+{
+    return current_frame;
+}
+
+cJSON *style_mutation_export(void)
+{
+    if (log_count == 0)
+        return NULL;
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+
+    for (size_t i = 0; i < log_count; i++) {
+        style_mutation_t *m = &log_entries[i];
+        if (!m->element)
+            continue;
+
+        size_t id_len = 0;
+        const lxb_char_t *id = lxb_dom_element_id(m->element, &id_len);
+        if (!id || id_len == 0 || id_len >= 256)
+            continue;
+
+        char key[256];
+        memcpy(key, id, id_len);
+        key[id_len] = '\0';
+
+        cJSON *element_mods = cJSON_GetObjectItemCaseSensitive(root, key);
+        if (!element_mods) {
+            element_mods = cJSON_CreateObject();
+            cJSON_AddItemToObject(root, key, element_mods);
+        }
+        cJSON *styles = cJSON_GetObjectItem(element_mods, "style");
+        if (!styles) {
+            styles = cJSON_CreateObject();
+            cJSON_AddItemToObject(element_mods, "style", styles);
+        }
+        cJSON_AddStringToObject(styles,
+            get_css_property_name((lxb_css_property_type_t)m->property), m->value);
+    }
+
+    return root;
+}
+
+void style_mutation_reset(void)
+{
+    for (size_t i = 0; i < log_count; i++)
+        style_mutation_free_values(&log_entries[i]);
+    free(log_entries);
+    free(slots);
+    log_entries = NULL;
+    slots = NULL;
+    log_count = log_capacity = slot_capacity = 0;
+    dead_count = 0;
+    pending_count = 0;
+    applied_count = 0;
+    current_frame = 0;
+    element_set_clear(&styled);
+    style_mutation_clear_dirty();
+}
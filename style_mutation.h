@@ -0,0 +1,61 @@
+// style_mutation.h - Typed, coalescing queue of script style writes
+#ifndef STYLE_MUTATION_H
+#define STYLE_MUTATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <lexbor/html/html.h>
+#include <lexbor/dom/dom.h>
+#include <lexbor/css/css.h>
+
+#include "cjson.h"
+
+// Resolve a CSS property name (dashed or camelCase) to its lexbor id,
+// 0 for properties lexbor does not know
+uintptr_t style_mutation_property_id(const char *name, size_t len);
+
+// Queue element.style[property] = value. A second write to the same
+// (element, property) before the next flush replaces the first.
+errno_t style_mutation_set(lxb_dom_element_t *element, uintptr_t property,
+    const char *value, size_t value_len);
+
+// Latest value written for (element, property), NULL if none. Lets
+// element.style reads see writes that are not flushed yet.
+const char *style_mutation_get(lxb_dom_element_t *element, uintptr_t property);
+
+// Publish the queued writes to style resolution and add the affected
+// elements to the dirty set. The style attribute is not touched. Returns
+// the number of elements newly marked dirty.
+size_t style_mutation_flush(void);
+
+size_t style_mutation_pending(void);
+unsigned style_mutation_frame(void);
+
+// Script-set value of a CSS property (dashed name) as of the last flush,
+// NULL if scripts did not set it. Style resolution checks this before the
+// style attribute.
+const char *style_mutation_computed(lxb_dom_element_t *element, const char *property);
+
+// True when scripts have written any style property of element
+bool style_mutation_has_element(lxb_dom_element_t *element);
+
+// Drop every write to element. destroyed: the node is about to be freed
+// and leaves the dirty set too; otherwise (its style attribute was
+// replaced) it is marked dirty.
+void style_mutation_forget(lxb_dom_element_t *element, bool destroyed);
+
+// Elements restyled since layout last ran. calculate_document_layout()
+// consumes the set.
+bool style_mutation_is_dirty(lxb_dom_element_t *element);
+lxb_dom_element_t *const *style_mutation_dirty(size_t *count);
+void style_mutation_clear_dirty(void);
+
+// Final value per (element id, property) for the "js_modifications" output:
+// { "<id>": { "style": { "<property>": "<value>" } } }
+cJSON *style_mutation_export(void);
+
+void style_mutation_reset(void);
+
+#endif // STYLE_MUTATION_H
@@ -0,0 +1,191 @@
+// tile_cache.c - Bounded LRU pool of pre-rendered document strips
+//
+// The visible bitmap only covers the viewport plus overscan. Everything the
+// user scrolled past (or the overscan pre-rendered) stays here as full-width
+// strips until the byte budget forces the least recently used ones out.
+#include <stdio.h>
+#include <stdlib.h>
+#include <mem.h>
+
+#include "pauk_debug.h"
+#include "tile_cache.h"
+
+void tile_cache_init(tile_cache_t *cache, size_t max_bytes, int strip_height)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->max_bytes = max_bytes;
+    cache->strip_height = (strip_height > 0) ? strip_height : RASTER_TILE_SIZE;
+}
+
+static void strip_unlink(tile_cache_t *cache, tile_strip_t *strip)
+{
+    if (strip->prev)
+        strip->prev->next = strip->next;
+    else
+        cache->head = strip->next;
+
+    if (strip->next)
+        strip->next->prev = strip->prev;
+    else
+        cache->tail = strip->prev;
+
+    strip->prev = NULL;
+    strip->next = NULL;
+}
+
+static void strip_push_front(tile_cache_t *cache, tile_strip_t *strip)
+{
+    strip->prev = NULL;
+    strip->next = cache->head;
+    if (cache->head)
+        cache->head->prev = strip;
+    cache->head = strip;
+    if (!cache->tail)
+        cache->tail = strip;
+}
+
+static size_t strip_bytes(const tile_cache_t *cache)
+{
+    return (size_t)cache->width * cache->strip_height * sizeof(uint32_t);
+}
+
+static void strip_destroy(tile_cache_t *cache, tile_strip_t *strip)
+{
+    strip_unlink(cache, strip);
+    cache->strip_count--;
+    cache->bytes -= strip_bytes(cache);
+    free(strip->pixels);
+    free(strip);
+}
+
+void tile_cache_invalidate(tile_cache_t *cache)
+{
+    while (cache->head)
+        strip_destroy(cache, cache->head);
+}
+
+void tile_cache_invalidate_rows(tile_cache_t *cache, int y0, int y1)
+{
+    int sh = cache->strip_height;
+    tile_strip_t *s = cache->head;
+    while (s) {
+        tile_strip_t *next = s->next;
+        if (s->index * sh < y1 && (s->index + 1) * sh > y0)
+            strip_destroy(cache, s);
+        s = next;
+    }
+}
+
+void tile_cache_free(tile_cache_t *cache)
+{
+    tile_cache_invalidate(cache);
+}
+
+/** Evict LRU strips over budget, never ones used by the compose in progress. */
+static void tile_cache_trim(tile_cache_t *cache)
+{
+    while (cache->bytes > cache->max_bytes && cache->tail &&
+        cache->tail->last_compose != cache->compose_seq) {
+        strip_destroy(cache, cache->tail);
+        cache->evictions++;
+    }
+}
+
+static tile_strip_t *tile_cache_lookup(tile_cache_t *cache, int index)
+{
+    for (tile_strip_t *s = cache->head; s; s = s->next) {
+        if (s->index == index)
+            return s;
+    }
+    return NULL;
+}
+
+static tile_strip_t *tile_cache_render_strip(tile_cache_t *cache, const paint_list_t *list,
+    int index, uint32_t background)
+{
+    tile_strip_t *strip = calloc(1, sizeof(tile_strip_t));
+    if (!strip)
+        return NULL;
+
+    strip->pixels = malloc(strip_bytes(cache));
+    if (!strip->pixels) {
+        free(strip);
+        return NULL;
+    }
+    strip->index = index;
+
+    raster_surface_t surface = {
+        .pixels = strip->pixels,
+        .stride = cache->width,
+        .width = cache->width,
+        .height = cache->strip_height
+    };
+
+    if (tile_raster_render(list, &surface, index * cache->strip_height, background) != EOK) {
+        free(strip->pixels);
+        free(strip);
+        return NULL;
+    }
+
+    strip_push_front(cache, strip);
+    cache->strip_count++;
+    cache->bytes += strip_bytes(cache);
+    return strip;
+}
+
+errno_t tile_cache_compose(tile_cache_t *cache, const paint_list_t *list,
+    raster_surface_t *dst, int origin_y, uint32_t background)
+{
+    if (!cache || !list || !dst || !dst->pixels || dst->width <= 0 || dst->height <= 0)
+        return EINVAL;
+
+    if (cache->width != dst->width) {
+        tile_cache_invalidate(cache);
+        cache->width = dst->width;
+    }
+
+    if (origin_y < 0)
+        origin_y = 0;
+
+    cache->compose_seq++;
+
+    int sh = cache->strip_height;
+    int first = origin_y / sh;
+    int last = (origin_y + dst->height - 1) / sh;
+
+    for (int index = first; index <= last; index++) {
+        tile_strip_t *strip = tile_cache_lookup(cache, index);
+        if (strip) {
+            strip_unlink(cache, strip);
+            strip_push_front(cache, strip);
+            cache->hits++;
+        } else {
+            strip = tile_cache_render_strip(cache, list, index, background);
+            if (!strip)
+                return ENOMEM;
+            cache->misses++;
+        }
+        strip->last_compose = cache->compose_seq;
+
+        // Copy the rows of this strip that land inside dst
+        int strip_y = index * sh;
+        int y0 = (strip_y > origin_y) ? strip_y : origin_y;
+        int y1 = strip_y + sh;
+        if (y1 > origin_y + dst->height)
+            y1 = origin_y + dst->height;
+
+        for (int y = y0; y < y1; y++) {
+            memcpy(dst->pixels + (size_t)(y - origin_y) * dst->stride,
+                strip->pixels + (size_t)(y - strip_y) * cache->width,
+                (size_t)dst->width * sizeof(uint32_t));
+        }
+    }
+
+    tile_cache_trim(cache);
+
+    if (DEB_BITMAP) {
+        printf("[TILE CACHE] y=%d strips=%zu bytes=%zu hits=%zu misses=%zu evictions=%zu\n",
+            origin_y, cache->strip_count, cache->bytes, cache->hits, cache->misses, cache->evictions);
+    }
+    return EOK;
+}
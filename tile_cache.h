@@ -0,0 +1,51 @@
+// tile_cache.h - Bounded LRU pool of pre-rendered document strips
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include "paint_list.h"
+#include "tile_raster.h"
+
+// One full-width horizontal band of the document, strip_height rows tall
+typedef struct tile_strip {
+    int index;                  // document y = index * strip_height
+    uint32_t *pixels;           // width * strip_height ARGB
+    struct tile_strip *prev;    // towards most recently used
+    struct tile_strip *next;    // towards least recently used
+    unsigned last_compose;
+} tile_strip_t;
+
+typedef struct {
+    tile_strip_t *head;         // most recently used
+    tile_strip_t *tail;         // least recently used
+    size_t strip_count;
+    size_t bytes;
+    size_t max_bytes;
+    int width;
+    int strip_height;
+    unsigned compose_seq;
+
+    // Statistics
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} tile_cache_t;
+
+void tile_cache_init(tile_cache_t *cache, size_t max_bytes, int strip_height);
+void tile_cache_free(tile_cache_t *cache);
+
+// Drop every strip (display list or width changed)
+void tile_cache_invalidate(tile_cache_t *cache);
+
+// Drop the strips over document rows [y0, y1) (items added there only)
+void tile_cache_invalidate_rows(tile_cache_t *cache, int y0, int y1);
+
+// Fill dst with document rows [origin_y, origin_y + dst->height), rendering
+// missing strips through the tile rasterizer and copying cached ones.
+errno_t tile_cache_compose(tile_cache_t *cache, const paint_list_t *list,
+    raster_surface_t *dst, int origin_y, uint32_t background);
+
+#endif // TILE_CACHE_H
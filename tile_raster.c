@@ -0,0 +1,506 @@
+// tile_raster.c - Parallel tiled rasterization of a paint list
+//
+// The surface is cut into RASTER_TILE_SIZE squares, every paint item is binned
+// into the tiles its bounding box touches, and tiles are handed out to a
+// persistent worker pool. Each tile is painted with its own clip, so workers
+// never write the same pixel and need no locking beyond claiming a tile.
+//
+// A glyph that straddles tile edges is needed by every tile it touches, so
+// glyph bitmaps are rasterized once into a cache shared by all workers and
+// only blitted per tile.
+#include <stdio.h>
+#include <stdlib.h>
+#include <mem.h>
+
+#include "pauk_debug.h"
+#include "pauk_sync.h"
+#include "tile_raster.h"
+
+typedef struct {
+    bool started;
+    int workers;
+
+    pauk_mutex_t lock;
+    pauk_cond_t work_cv;
+    pauk_cond_t done_cv;
+
+    // Current job, valid while generation matches and tiles_done < tile_count
+    unsigned generation;
+    const paint_list_t *list;
+    raster_surface_t *surface;
+    int origin_y;
+    uint32_t background;
+    int tiles_x;
+    int tile_count;
+    int next_tile;
+    int tiles_done;
+
+    // Binning: items of tile t are bin_items[bin_start[t] .. bin_start[t + 1])
+    int *bin_start;
+    size_t bin_start_cap;
+    uint32_t *bin_items;
+    size_t bin_items_cap;
+} tile_pool_t;
+
+static tile_pool_t pool;
+
+// One rasterized glyph. Entries are immutable once published; fonts live in
+// the font manager's fixed table until exit, so the pointer is a stable key.
+typedef struct {
+    const html_font_t *font;
+    float size;
+    int code_point;
+    int x0, y0;             // bitmap box relative to the pen at the baseline
+    int w, h;
+    unsigned char *bitmap;  // NULL for blank glyphs
+} raster_glyph_t;
+
+typedef struct {
+    pauk_mutex_t lock;
+    raster_glyph_t *slots[RASTER_GLYPH_SLOTS];
+    size_t count;
+    size_t bytes;
+} glyph_cache_t;
+
+static glyph_cache_t glyphs;
+
+static int clamp_int(int v, int lo, int hi)
+{
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+void raster_fill_rect(raster_surface_t *surface, const raster_clip_t *clip,
+    int x, int y, int w, int h, uint32_t color)
+{
+    int x0 = clamp_int(x, clip->x0, clip->x1);
+    int y0 = clamp_int(y, clip->y0, clip->y1);
+    int x1 = clamp_int(x + w, clip->x0, clip->x1);
+    int y1 = clamp_int(y + h, clip->y0, clip->y1);
+
+    for (int py = y0; py < y1; py++) {
+        uint32_t *row = surface->pixels + (size_t)py * surface->stride;
+        for (int px = x0; px < x1; px++) {
+            row[px] = color;
+        }
+    }
+}
+
+void raster_border_rect(raster_surface_t *surface, const raster_clip_t *clip,
+    int x, int y, int w, int h, uint32_t color)
+{
+    raster_fill_rect(surface, clip, x, y, w, 1, color);
+    raster_fill_rect(surface, clip, x, y + h - 1, w, 1, color);
+    raster_fill_rect(surface, clip, x, y, 1, h, color);
+    raster_fill_rect(surface, clip, x + w - 1, y, 1, h, color);
+}
+
+static size_t glyph_slot(const html_font_t *font, float size, int code_point)
+{
+    uint32_t size_bits;
+    memcpy(&size_bits, &size, sizeof(size_bits));
+
+    uint64_t h = (uint64_t)(uintptr_t)font;
+    h = (h ^ size_bits) * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (uint32_t)code_point) * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & (RASTER_GLYPH_SLOTS - 1);
+}
+
+/** Probe for a glyph; returns the slot holding it or the empty slot it would take. Lock held. */
+static size_t glyph_probe(const html_font_t *font, float size, int code_point)
+{
+    size_t slot = glyph_slot(font, size, code_point);
+    while (glyphs.slots[slot]) {
+        raster_glyph_t *g = glyphs.slots[slot];
+        if (g->font == font && g->size == size && g->code_point == code_point)
+            break;
+        slot = (slot + 1) & (RASTER_GLYPH_SLOTS - 1);
+    }
+    return slot;
+}
+
+static void glyph_free(raster_glyph_t *glyph)
+{
+    if (glyph) {
+        free(glyph->bitmap);
+        free(glyph);
+    }
+}
+
+static raster_glyph_t *glyph_rasterize(html_font_t *font, float size, float scale, int code_point)
+{
+    raster_glyph_t *glyph = calloc(1, sizeof(raster_glyph_t));
+    if (!glyph)
+        return NULL;
+
+    glyph->font = font;
+    glyph->size = size;
+    glyph->code_point = code_point;
+
+    int x1, y1;
+    stbtt_GetCodepointBitmapBox(&font->info, code_point, scale, scale,
+        &glyph->x0, &glyph->y0, &x1, &y1);
+    glyph->w = x1 - glyph->x0;
+    glyph->h = y1 - glyph->y0;
+
+    if (glyph->w > 0 && glyph->h > 0) {
+        glyph->bitmap = calloc((size_t)glyph->w * glyph->h, 1);
+        if (!glyph->bitmap) {
+            free(glyph);
+            return NULL;
+        }
+        stbtt_MakeCodepointBitmap(&font->info, glyph->bitmap, glyph->w, glyph->h,
+            glyph->w, scale, scale, code_point);
+    }
+    return glyph;
+}
+
+/**
+ * Cached glyph, rasterized on first use. *owned is set when the cache was
+ * full and the caller has to free the returned glyph itself.
+ */
+static raster_glyph_t *glyph_get(html_font_t *font, float size, float scale,
+    int code_point, bool *owned)
+{
+    *owned = false;
+
+    pauk_mutex_lock(&glyphs.lock);
+    raster_glyph_t *hit = glyphs.slots[glyph_probe(font, size, code_point)];
+    pauk_mutex_unlock(&glyphs.lock);
+    if (hit)
+        return hit;
+
+    // stb_truetype only reads the font, so workers rasterize unlocked
+    raster_glyph_t *glyph = glyph_rasterize(font, size, scale, code_point);
+    if (!glyph)
+        return NULL;
+
+    size_t bytes = (size_t)glyph->w * glyph->h;
+
+    pauk_mutex_lock(&glyphs.lock);
+    size_t slot = glyph_probe(font, size, code_point);
+    if (glyphs.slots[slot]) {
+        // Another tile got there first
+        hit = glyphs.slots[slot];
+        pauk_mutex_unlock(&glyphs.lock);
+        glyph_free(glyph);
+        return hit;
+    }
+    if (glyphs.count >= RASTER_GLYPH_SLOTS / 2 ||
+        glyphs.bytes + bytes > RASTER_GLYPH_BYTES) {
+        pauk_mutex_unlock(&glyphs.lock);
+        *owned = true;
+        return glyph;
+    }
+    glyphs.slots[slot] = glyph;
+    glyphs.count++;
+    glyphs.bytes += bytes;
+    pauk_mutex_unlock(&glyphs.lock);
+    return glyph;
+}
+
+/** Drop every cached glyph. Only called between jobs, when no worker reads the cache. */
+static void glyph_cache_reset(void)
+{
+    pauk_mutex_lock(&glyphs.lock);
+    for (size_t i = 0; i < RASTER_GLYPH_SLOTS; i++) {
+        glyph_free(glyphs.slots[i]);
+        glyphs.slots[i] = NULL;
+    }
+    glyphs.count = 0;
+    glyphs.bytes = 0;
+    pauk_mutex_unlock(&glyphs.lock);
+}
+
+static void glyph_blit(raster_surface_t *surface, const raster_clip_t *clip,
+    const raster_glyph_t *glyph, int draw_x, int draw_y, uint32_t color)
+{
+    uint8_t r = (color >> 16) & 0xFF;
+    uint8_t g = (color >> 8) & 0xFF;
+    uint8_t b = color & 0xFF;
+
+    int w = glyph->w;
+    int h = glyph->h;
+    int by0 = clamp_int(clip->y0 - draw_y, 0, h);
+    int by1 = clamp_int(clip->y1 - draw_y, 0, h);
+    int bx0 = clamp_int(clip->x0 - draw_x, 0, w);
+    int bx1 = clamp_int(clip->x1 - draw_x, 0, w);
+
+    for (int by = by0; by < by1; by++) {
+        uint32_t *row = surface->pixels + (size_t)(draw_y + by) * surface->stride;
+        const unsigned char *src = glyph->bitmap + (size_t)by * w;
+        for (int bx = bx0; bx < bx1; bx++) {
+            unsigned char a = src[bx];
+            if (a == 0)
+                continue;
+
+            uint32_t *dst = &row[draw_x + bx];
+            uint32_t old = *dst;
+
+            uint8_t old_r = (old >> 16) & 0xFF;
+            uint8_t old_g = (old >> 8) & 0xFF;
+            uint8_t old_b = old & 0xFF;
+
+            uint8_t inv_a = 255 - a;
+            uint8_t new_r = (r * a + old_r * inv_a) / 255;
+            uint8_t new_g = (g * a + old_g * inv_a) / 255;
+            uint8_t new_b = (b * a + old_b * inv_a) / 255;
+
+            *dst = 0xFF000000 | (new_r << 16) | (new_g << 8) | new_b;
+        }
+    }
+}
+
+void raster_text(raster_surface_t *surface, const raster_clip_t *clip,
+    const paint_item_t *item, int dy)
+{
+    if (!item->text || !item->font || !item->font->is_loaded)
+        return;
+
+    stbtt_fontinfo *info = &item->font->info;
+    float scale = stbtt_ScaleForPixelHeight(info, item->size);
+
+    int pen_x = item->origin_x;
+    int pen_y = item->y - dy + item->baseline;
+
+    const unsigned char *p = (const unsigned char *)item->text;
+    while (*p) {
+        int code_point = *p;
+
+        int advance, lsb;
+        stbtt_GetCodepointHMetrics(info, code_point, &advance, &lsb);
+
+        // The box only depends on font, size and code point, so a tile the
+        // glyph misses is rejected from the cached entry without drawing
+        bool owned;
+        raster_glyph_t *glyph = glyph_get(item->font, item->size, scale, code_point, &owned);
+        if (!glyph)
+            return;
+
+        int draw_x = pen_x + paint_round_px(lsb * scale);
+        int draw_y = pen_y + glyph->y0;
+
+        if (glyph->bitmap &&
+            draw_x < clip->x1 && draw_x + glyph->w > clip->x0 &&
+            draw_y < clip->y1 && draw_y + glyph->h > clip->y0) {
+            glyph_blit(surface, clip, glyph, draw_x, draw_y, item->color);
+        }
+        if (owned)
+            glyph_free(glyph);
+
+        int next = *(p + 1);
+        int kern = stbtt_GetCodepointKernAdvance(info, code_point, next);
+
+        pen_x += paint_round_px((advance + kern) * scale);
+        p++;
+    }
+}
+
+static void raster_tile(int tile)
+{
+    raster_surface_t *surface = pool.surface;
+    int tx = tile % pool.tiles_x;
+    int ty = tile / pool.tiles_x;
+
+    raster_clip_t clip;
+    clip.x0 = tx * RASTER_TILE_SIZE;
+    clip.y0 = ty * RASTER_TILE_SIZE;
+    clip.x1 = clamp_int(clip.x0 + RASTER_TILE_SIZE, 0, surface->width);
+    clip.y1 = clamp_int(clip.y0 + RASTER_TILE_SIZE, 0, surface->height);
+
+    raster_fill_rect(surface, &clip, clip.x0, clip.y0,
+        clip.x1 - clip.x0, clip.y1 - clip.y0, pool.background);
+
+    int dy = pool.origin_y;
+    for (int i = pool.bin_start[tile]; i < pool.bin_start[tile + 1]; i++) {
+        const paint_item_t *item = &pool.list->items[pool.bin_items[i]];
+        switch (item->kind) {
+        case PAINT_FILL:
+            raster_fill_rect(surface, &clip, item->x, item->y - dy, item->w, item->h, item->color);
+            break;
+        case PAINT_BORDER:
+            raster_border_rect(surface, &clip, item->x, item->y - dy, item->w, item->h, item->color);
+            break;
+        case PAINT_TEXT:
+            raster_text(surface, &clip, item, dy);
+            break;
+        }
+    }
+}
+
+/** Claim and paint tiles of the current job until none are left. Called with pool.lock held. */
+static void drain_tiles(unsigned generation)
+{
+    while (pool.generation == generation && pool.next_tile < pool.tile_count) {
+        int tile = pool.next_tile++;
+        pauk_mutex_unlock(&pool.lock);
+
+        raster_tile(tile);
+
+        pauk_mutex_lock(&pool.lock);
+        if (++pool.tiles_done == pool.tile_count)
+            pauk_cond_broadcast(&pool.done_cv);
+    }
+}
+
+static errno_t tile_worker(void *arg)
+{
+    (void)arg;
+    unsigned seen = 0;
+
+    pauk_mutex_lock(&pool.lock);
+    while (true) {
+        while (pool.generation == seen)
+            pauk_cond_wait(&pool.work_cv, &pool.lock);
+        seen = pool.generation;
+        drain_tiles(seen);
+    }
+
+    return EOK;
+}
+
+errno_t tile_raster_init(int workers)
+{
+    if (pool.started)
+        return EOK;
+
+    if (workers <= 0)
+        workers = pauk_cpu_count();
+    if (workers > RASTER_MAX_WORKERS)
+        workers = RASTER_MAX_WORKERS;
+
+    pauk_mutex_init(&pool.lock);
+    pauk_mutex_init(&glyphs.lock);
+    pauk_cond_init(&pool.work_cv);
+    pauk_cond_init(&pool.done_cv);
+    pool.started = true;
+
+    // The painting thread takes tiles too, so it only needs workers - 1 helpers
+    pauk_spawn_runners(workers);
+    for (int i = 1; i < workers; i++) {
+        if (pauk_thread_start(tile_worker, NULL) != EOK)
+            break;
+        pool.workers++;
+    }
+
+    if (DEB_BITMAP) printf("[RASTER] Tile pool started with %d helper(s)\n", pool.workers);
+    return EOK;
+}
+
+static bool bin_reserve(int tile_count, size_t item_refs)
+{
+    if ((size_t)tile_count + 1 > pool.bin_start_cap) {
+        int *p = realloc(pool.bin_start, ((size_t)tile_count + 1) * sizeof(int));
+        if (!p)
+            return false;
+        pool.bin_start = p;
+        pool.bin_start_cap = (size_t)tile_count + 1;
+    }
+    if (item_refs > pool.bin_items_cap) {
+        uint32_t *p = realloc(pool.bin_items, item_refs * sizeof(uint32_t));
+        if (!p)
+            return false;
+        pool.bin_items = p;
+        pool.bin_items_cap = item_refs;
+    }
+    return true;
+}
+
+/** Tile range covered by an item, false when it is outside the surface. */
+static bool item_tiles(const paint_item_t *item, const raster_surface_t *surface,
+    int origin_y, int tiles_x, int tiles_y, int *tx0, int *ty0, int *tx1, int *ty1)
+{
+    int x0 = item->x;
+    int y0 = item->y - origin_y;
+    int x1 = x0 + item->w;
+    int y1 = y0 + item->h;
+
+    if (x1 <= 0 || y1 <= 0 || x0 >= surface->width || y0 >= surface->height)
+        return false;
+
+    *tx0 = clamp_int(x0, 0, surface->width - 1) / RASTER_TILE_SIZE;
+    *ty0 = clamp_int(y0, 0, surface->height - 1) / RASTER_TILE_SIZE;
+    *tx1 = clamp_int((x1 - 1) / RASTER_TILE_SIZE, 0, tiles_x - 1);
+    *ty1 = clamp_int((y1 - 1) / RASTER_TILE_SIZE, 0, tiles_y - 1);
+    return true;
+}
+
+errno_t tile_raster_render(const paint_list_t *list, raster_surface_t *surface,
+    int origin_y, uint32_t background)
+{
+    if (!list || !surface || !surface->pixels || surface->width <= 0 || surface->height <= 0)
+        return EINVAL;
+
+    if (!pool.started)
+        tile_raster_init(0);
+
+    int tiles_x = (surface->width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    int tiles_y = (surface->height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    int tile_count = tiles_x * tiles_y;
+
+    // Pass 1: count references per tile
+    size_t refs = 0;
+    int tx0, ty0, tx1, ty1;
+    for (size_t i = 0; i < list->count; i++) {
+        if (item_tiles(&list->items[i], surface, origin_y, tiles_x, tiles_y, &tx0, &ty0, &tx1, &ty1))
+            refs += (size_t)(tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    }
+
+    pauk_mutex_lock(&pool.lock);
+
+    // Start over once the glyph cache fills up; the last job is finished,
+    // so no worker holds a glyph
+    if (glyphs.count >= RASTER_GLYPH_SLOTS / 2 || glyphs.bytes >= RASTER_GLYPH_BYTES)
+        glyph_cache_reset();
+
+    if (!bin_reserve(tile_count, refs ? refs : 1)) {
+        pauk_mutex_unlock(&pool.lock);
+        return ENOMEM;
+    }
+
+    memset(pool.bin_start, 0, ((size_t)tile_count + 1) * sizeof(int));
+    for (size_t i = 0; i < list->count; i++) {
+        if (!item_tiles(&list->items[i], surface, origin_y, tiles_x, tiles_y, &tx0, &ty0, &tx1, &ty1))
+            continue;
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++)
+                pool.bin_start[ty * tiles_x + tx + 1]++;
+    }
+    for (int t = 0; t < tile_count; t++)
+        pool.bin_start[t + 1] += pool.bin_start[t];
+
+    // Pass 2: fill bins in list order so painter's order is kept inside each tile
+    int *fill = malloc((size_t)tile_count * sizeof(int));
+    if (!fill) {
+        pauk_mutex_unlock(&pool.lock);
+        return ENOMEM;
+    }
+    memcpy(fill, pool.bin_start, (size_t)tile_count * sizeof(int));
+    for (size_t i = 0; i < list->count; i++) {
+        if (!item_tiles(&list->items[i], surface, origin_y, tiles_x, tiles_y, &tx0, &ty0, &tx1, &ty1))
+            continue;
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++)
+                pool.bin_items[fill[ty * tiles_x + tx]++] = (uint32_t)i;
+    }
+    free(fill);
+
+    pool.list = list;
+    pool.surface = surface;
+    pool.origin_y = origin_y;
+    pool.background = background;
+    pool.tiles_x = tiles_x;
+    pool.tile_count = tile_count;
+    pool.next_tile = 0;
+    pool.tiles_done = 0;
+    unsigned generation = ++pool.generation;
+    pauk_cond_broadcast(&pool.work_cv);
+
+    drain_tiles(generation);
+    while (pool.tiles_done < pool.tile_count)
+        pauk_cond_wait(&pool.done_cv, &pool.lock);
+
+    pauk_mutex_unlock(&pool.lock);
+
+    if (DEB_BITMAP) printf("[RASTER] %zu items, %d tiles, %zu bin refs\n", list->count, tile_count, refs);
+    return EOK;
+}
@@ -0,0 +1,47 @@
+// tile_raster.h - Parallel tiled rasterization of a paint list
+#ifndef TILE_RASTER_H
+#define TILE_RASTER_H
+
+#include <stdint.h>
+#include <errno.h>
+
+#include "paint_list.h"
+
+#define RASTER_TILE_SIZE 128
+#define RASTER_MAX_WORKERS 16
+
+// Shared glyph bitmap cache: slots (power of two, kept at most half full)
+// and total bitmap bytes before it is emptied at the start of a render
+#define RASTER_GLYPH_SLOTS 4096
+#define RASTER_GLYPH_BYTES (4 * 1024 * 1024)
+
+// Target pixel buffer (ARGB, stride in pixels)
+typedef struct {
+    uint32_t *pixels;
+    int stride;
+    int width;
+    int height;
+} raster_surface_t;
+
+// Half-open clip rectangle in surface coordinates
+typedef struct {
+    int x0, y0, x1, y1;
+} raster_clip_t;
+
+// Clip-aware primitives, safe to call concurrently on disjoint clips
+void raster_fill_rect(raster_surface_t *surface, const raster_clip_t *clip,
+    int x, int y, int w, int h, uint32_t color);
+void raster_border_rect(raster_surface_t *surface, const raster_clip_t *clip,
+    int x, int y, int w, int h, uint32_t color);
+void raster_text(raster_surface_t *surface, const raster_clip_t *clip,
+    const paint_item_t *item, int dy);
+
+// Start the worker pool; workers <= 0 means one per CPU
+errno_t tile_raster_init(int workers);
+
+// Rasterize the rows [origin_y, origin_y + surface->height) of the document
+// into the surface, clearing to background first.
+errno_t tile_raster_render(const paint_list_t *list, raster_surface_t *surface,
+    int origin_y, uint32_t background);
+
+#endif // TILE_RASTER_H
@@ -0,0 +1,463 @@
+// tls_session.c - TLS client connections with session resumption (mbedtls)
+//
+// pauk_ui_t has carried an mbedtls CA certificate for a long time, but
+// nothing built TLS connections, and a connection built naively pays a
+// full handshake and a full chain verification every time. The state
+// worth keeping is now kept once per process:
+//
+// - the RNG and one shared client config, set up once under a lock (a
+//   failure is remembered, not retried by every worker)
+// - the parsed CA store, read on the first https connection rather than
+//   at startup
+// - the last session per host:port (session ID or ticket), offered on the
+//   next handshake so the server can resume it with no certificate
+//   exchange and no key agreement
+//
+// mbedtls runs with VERIFY_REQUIRED: every full handshake has its chain
+// and host name checked by mbedtls itself and fails when they do not
+// verify. A resumed session is one mbedtls established, and verified, on
+// an earlier full handshake. It is told apart through what went over the
+// wire: a TLS 1.2 server resumes by echoing the session ID of our
+// ClientHello (random when a ticket is offered) and answers a full
+// handshake with an ID of its own. Each handshake reports its time.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tls_session.h"
+#include "pauk_sync.h"
+
+#ifndef PAUK_NO_TLS
+
+#include <mbedtls/version.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+// Session ID of a session (accessors since 3.0)
+#if MBEDTLS_VERSION_MAJOR >= 3
+#define TLS_SESSION_ID(s) mbedtls_ssl_session_get_id(s)
+#define TLS_SESSION_ID_LEN(s) mbedtls_ssl_session_get_id_len(s)
+#else
+#define TLS_SESSION_ID(s) ((s)->id)
+#define TLS_SESSION_ID_LEN(s) ((s)->id_len)
+#endif
+#define TLS_SESSION_ID_MAX 32
+
+typedef struct {
+    char host[256];
+    uint16_t port;
+    bool valid;
+    uint64_t last_used;
+    mbedtls_ssl_session session;
+} tls_cached_session_t;
+
+struct tls_conn {
+    mbedtls_ssl_context ssl;
+    tls_io_send_t send;
+    tls_io_recv_t recv;
+    void *io;
+    uint64_t handshake_usec;
+    bool resumed;
+    bool closed;
+    // Session ID of the ClientHello we sent
+    bool hello_seen;
+    size_t hello_id_len;
+    unsigned char hello_id[TLS_SESSION_ID_MAX];
+};
+
+static PAUK_MUTEX_INITIALIZE(lock);     // everything below, and the DRBG
+static bool init_done = false;
+static errno_t init_rc = EOK;
+static bool ca_done = false;
+static errno_t ca_rc = EOK;
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context drbg;
+static mbedtls_x509_crt ca_store;
+static mbedtls_ssl_config conf;
+static tls_cached_session_t sessions[TLS_SESSION_CACHE_SIZE];
+static tls_stats_t stats;
+
+// The shared DRBG is not reentrant; handshakes run on several workers
+static int tls_rng(void *arg, unsigned char *out, size_t len)
+{
+    (void)arg;
+    pauk_mutex_lock(&lock);
+    int ret = mbedtls_ctr_drbg_random(&drbg, out, len);
+    pauk_mutex_unlock(&lock);
+    return ret;
+}
+
+// Lock held
+static errno_t tls_init_locked(void)
+{
+    if (init_done)
+        return init_rc;
+    init_done = true;
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_x509_crt_init(&ca_store);
+    mbedtls_ssl_config_init(&conf);
+    for (int i = 0; i < TLS_SESSION_CACHE_SIZE; i++)
+        mbedtls_ssl_session_init(&sessions[i].session);
+
+    // The DRBG is seeded under the lock tls_rng() takes: call it directly
+    static const char pers[] = "pauk";
+    if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+            (const unsigned char *)pers, sizeof(pers) - 1) != 0 ||
+        mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+            MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+        printf("TLS: cannot set up the RNG and client config\n");
+        init_rc = EIO;
+        return init_rc;
+    }
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_rng(&conf, tls_rng, NULL);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+    init_rc = EOK;
+    return init_rc;
+}
+
+errno_t tls_init(void)
+{
+    pauk_mutex_lock(&lock);
+    errno_t rc = tls_init_locked();
+    pauk_mutex_unlock(&lock);
+    return rc;
+}
+
+// The CA store, parsed on the first connection; before any connection
+// uses conf, as every one comes through here first
+static errno_t tls_ca_load(void)
+{
+    pauk_mutex_lock(&lock);
+    errno_t rc = tls_init_locked();
+    if (rc == EOK && !ca_done) {
+        ca_done = true;
+        const char *ca_file = TLS_CA_FILE;
+#ifdef PAUK_HOST
+        if (getenv("PAUK_CA_FILE"))
+            ca_file = getenv("PAUK_CA_FILE");
+#endif
+        // Negative: nothing usable; positive: some certificates were skipped
+        int parsed = mbedtls_x509_crt_parse_file(&ca_store, ca_file);
+        if (parsed < 0) {
+            printf("TLS: no CA certificates from %s (-0x%04x)\n", ca_file,
+                (unsigned)-parsed);
+            ca_rc = EIO;
+        } else {
+            mbedtls_ssl_conf_ca_chain(&conf, &ca_store, NULL);
+            ca_rc = EOK;
+        }
+    }
+    if (rc == EOK)
+        rc = ca_rc;
+    pauk_mutex_unlock(&lock);
+    return rc;
+}
+
+void tls_shutdown(void)
+{
+    pauk_mutex_lock(&lock);
+    if (init_done) {
+        for (int i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+            mbedtls_ssl_session_free(&sessions[i].session);
+            sessions[i].valid = false;
+        }
+        mbedtls_ssl_config_free(&conf);
+        mbedtls_x509_crt_free(&ca_store);
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+        init_done = false;
+        ca_done = false;
+    }
+    pauk_mutex_unlock(&lock);
+}
+
+// ===== Session cache (lock held) =====
+
+static tls_cached_session_t *tls_session_find(const char *host, uint16_t port)
+{
+    for (int i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+        tls_cached_session_t *s = &sessions[i];
+        if (s->valid && s->port == port && strcmp(s->host, host) == 0)
+            return s;
+    }
+    return NULL;
+}
+
+// The slot for host:port: its own, a free one or the least recently used
+static tls_cached_session_t *tls_session_slot(const char *host, uint16_t port)
+{
+    tls_cached_session_t *s = tls_session_find(host, port);
+    if (s)
+        return s;
+    tls_cached_session_t *victim = &sessions[0];
+    for (int i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+        if (!sessions[i].valid)
+            return &sessions[i];
+        if (sessions[i].last_used < victim->last_used)
+            victim = &sessions[i];
+    }
+    return victim;
+}
+
+// ===== Connections =====
+
+// The first record sent is the ClientHello: record header (5 bytes),
+// handshake header (4), version (2), random (32), then the session ID
+static void tls_hello_capture(tls_conn_t *conn, const unsigned char *data, size_t len)
+{
+    conn->hello_seen = true;
+    if (len < 44 || data[0] != 22 || data[5] != 1)
+        return;
+    size_t id_len = data[43];
+    if (id_len > TLS_SESSION_ID_MAX || len < 44 + id_len)
+        return;
+    memcpy(conn->hello_id, data + 44, id_len);
+    conn->hello_id_len = id_len;
+}
+
+static int tls_bio_send(void *arg, const unsigned char *data, size_t len)
+{
+    tls_conn_t *conn = arg;
+    if (!conn->hello_seen)
+        tls_hello_capture(conn, data, len);
+    int n = conn->send(conn->io, data, len);
+    return n < 0 ? MBEDTLS_ERR_SSL_INTERNAL_ERROR : n;
+}
+
+static int tls_bio_recv(void *arg, unsigned char *buf, size_t size)
+{
+    tls_conn_t *conn = arg;
+    int n = conn->recv(conn->io, buf, size);
+    if (n == 0)
+        return MBEDTLS_ERR_SSL_CONN_EOF;
+    return n < 0 ? MBEDTLS_ERR_SSL_INTERNAL_ERROR : n;
+}
+
+errno_t tls_conn_open(tls_conn_t **out, const char *host, uint16_t port,
+    tls_io_send_t send, tls_io_recv_t recv, void *io)
+{
+    if (!out || !host || !send || !recv)
+        return EINVAL;
+    errno_t rc = tls_ca_load();
+    if (rc != EOK)
+        return rc;
+
+    tls_conn_t *conn = calloc(1, sizeof(tls_conn_t));
+    if (!conn)
+        return ENOMEM;
+    conn->send = send;
+    conn->recv = recv;
+    conn->io = io;
+    mbedtls_ssl_init(&conn->ssl);
+
+    if (mbedtls_ssl_setup(&conn->ssl, &conf) != 0 ||
+        mbedtls_ssl_set_hostname(&conn->ssl, host) != 0) {
+        mbedtls_ssl_free(&conn->ssl);
+        free(conn);
+        return ENOMEM;
+    }
+    mbedtls_ssl_set_bio(&conn->ssl, conn, tls_bio_send, tls_bio_recv, NULL);
+
+    // Offer the last session with this server (copied into the context)
+    bool offered = false;
+    pauk_mutex_lock(&lock);
+    tls_cached_session_t *cached = tls_session_find(host, port);
+    if (cached && mbedtls_ssl_set_session(&conn->ssl, &cached->session) == 0)
+        offered = true;
+    pauk_mutex_unlock(&lock);
+
+    uint64_t start = pauk_time_usec();
+    int ret;
+    do {
+        ret = mbedtls_ssl_handshake(&conn->ssl);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    if (ret != 0) {
+        uint32_t flags = mbedtls_ssl_get_verify_result(&conn->ssl);
+        bool untrusted = ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+        if (untrusted)
+            printf("TLS %s:%u: certificate not trusted (flags 0x%08x)\n", host, port,
+                (unsigned)flags);
+        else
+            printf("TLS %s:%u: handshake failed (-0x%04x)\n", host, port, (unsigned)-ret);
+        // A session the server rejected this badly is not offered again
+        pauk_mutex_lock(&lock);
+        cached = tls_session_find(host, port);
+        if (cached)
+            cached->valid = false;
+        if (untrusted)
+            stats.verify_failures++;
+        pauk_mutex_unlock(&lock);
+        mbedtls_ssl_free(&conn->ssl);
+        free(conn);
+        return untrusted ? EPERM : EIO;
+    }
+    conn->handshake_usec = pauk_time_usec() - start;
+
+    // Resumed: the server echoed the session ID we offered, by ID and by
+    // ticket alike; a full handshake gets a new ID or none. TLS 1.3
+    // echoes the ID on every handshake and counts as full.
+    mbedtls_ssl_session current;
+    mbedtls_ssl_session_init(&current);
+    bool have_current = mbedtls_ssl_get_session(&conn->ssl, &current) == 0;
+    conn->resumed = offered && have_current && conn->hello_id_len > 0 &&
+        strcmp(mbedtls_ssl_get_version(&conn->ssl), "TLSv1.3") != 0 &&
+        TLS_SESSION_ID_LEN(&current) == conn->hello_id_len &&
+        memcmp(TLS_SESSION_ID(&current), conn->hello_id, conn->hello_id_len) == 0;
+
+    pauk_mutex_lock(&lock);
+    if (have_current) {
+        tls_cached_session_t *slot = tls_session_slot(host, port);
+        mbedtls_ssl_session_free(&slot->session);
+        slot->session = current;
+        snprintf(slot->host, sizeof(slot->host), "%s", host);
+        slot->port = port;
+        slot->valid = true;
+        slot->last_used = pauk_time_usec();
+    } else {
+        mbedtls_ssl_session_free(&current);
+    }
+    if (conn->resumed)
+        stats.resumed_handshakes++;
+    else
+        stats.full_handshakes++;
+    stats.handshake_usec += conn->handshake_usec;
+    pauk_mutex_unlock(&lock);
+
+    printf("TLS %s:%u: %s handshake, %llu us\n", host, port,
+        conn->resumed ? "resumed" : "full", (unsigned long long)conn->handshake_usec);
+    *out = conn;
+    return EOK;
+}
+
+errno_t tls_conn_send(tls_conn_t *conn, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    while (len > 0) {
+        int n = mbedtls_ssl_write(&conn->ssl, p, len);
+        if (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE)
+            continue;
+        if (n <= 0) {
+            conn->closed = true;
+            return EIO;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return EOK;
+}
+
+errno_t tls_conn_recv(tls_conn_t *conn, void *buf, size_t size, size_t *nrecv)
+{
+    for (;;) {
+        int n = mbedtls_ssl_read(&conn->ssl, buf, size);
+        if (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE)
+            continue;
+#ifdef MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET
+        // TLS 1.3 tickets arrive after the handshake
+        if (n == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET)
+            continue;
+#endif
+        if (n == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || n == MBEDTLS_ERR_SSL_CONN_EOF || n == 0) {
+            conn->closed = true;
+            *nrecv = 0;
+            return EOK;
+        }
+        if (n < 0) {
+            conn->closed = true;
+            return EIO;
+        }
+        *nrecv = (size_t)n;
+        return EOK;
+    }
+}
+
+void tls_conn_close(tls_conn_t *conn)
+{
+    if (!conn)
+        return;
+    if (!conn->closed)
+        (void)mbedtls_ssl_close_notify(&conn->ssl);
+    mbedtls_ssl_free(&conn->ssl);
+    free(conn);
+}
+
+uint64_t tls_conn_handshake_usec(const tls_conn_t *conn)
+{
+    return conn ? conn->handshake_usec : 0;
+}
+
+bool tls_conn_resumed(const tls_conn_t *conn)
+{
+    return conn && conn->resumed;
+}
+
+tls_stats_t tls_stats(void)
+{
+    tls_stats_t s;
+    pauk_mutex_lock(&lock);
+    s = stats;
+    pauk_mutex_unlock(&lock);
+    return s;
+}
+
+#else // PAUK_NO_TLS: host built without mbedtls
+
+errno_t tls_init(void)
+{
+    return ENOTSUP;
+}
+
+void tls_shutdown(void)
+{
+}
+
+errno_t tls_conn_open(tls_conn_t **out, const char *host, uint16_t port,
+    tls_io_send_t send, tls_io_recv_t recv, void *io)
+{
+    (void)out; (void)host; (void)port; (void)send; (void)recv; (void)io;
+    return ENOTSUP;
+}
+
+errno_t tls_conn_send(tls_conn_t *conn, const void *data, size_t len)
+{
+    (void)conn; (void)data; (void)len;
+    return ENOTSUP;
+}
+
+errno_t tls_conn_recv(tls_conn_t *conn, void *buf, size_t size, size_t *nrecv)
+{
+    (void)conn; (void)buf; (void)size; (void)nrecv;
+    return ENOTSUP;
+}
+
+void tls_conn_close(tls_conn_t *conn)
+{
+    (void)conn;
+}
+
+uint64_t tls_conn_handshake_usec(const tls_conn_t *conn)
+{
+    (void)conn;
+    return 0;
+}
+
+bool tls_conn_resumed(const tls_conn_t *conn)
+{
+    (void)conn;
+    return false;
+}
+
+tls_stats_t tls_stats(void)
+{
+    tls_stats_t s = { 0 };
+    return s;
+}
+
+#endif
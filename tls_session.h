@@ -0,0 +1,58 @@
+// tls_session.h - TLS client connections with session resumption (mbedtls)
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Trusted roots, loaded on the first connection (PAUK_CA_FILE overrides on
+// the host)
+#ifdef PAUK_HOST
+#define TLS_CA_FILE "/etc/ssl/certs/ca-certificates.crt"
+#else
+#define TLS_CA_FILE "/data/cert/ca-certificates.crt"
+#endif
+
+// Sessions kept for resumption, one per host:port
+#define TLS_SESSION_CACHE_SIZE 32
+
+// Transport under a TLS connection (blocking). send: bytes written or < 0;
+// recv: bytes read, 0 when the peer closed, < 0 on error.
+typedef int (*tls_io_send_t)(void *io, const unsigned char *data, size_t len);
+typedef int (*tls_io_recv_t)(void *io, unsigned char *buf, size_t size);
+
+typedef struct tls_conn tls_conn_t;
+
+typedef struct {
+    unsigned full_handshakes;
+    unsigned resumed_handshakes;
+    unsigned verify_failures;
+    uint64_t handshake_usec;    // all handshakes together
+} tls_stats_t;
+
+// RNG and shared client config, set up once from any thread; a failure is
+// returned again, not retried. ENOTSUP without TLS support.
+errno_t tls_init(void);
+void tls_shutdown(void);
+
+// Handshake with host over io. mbedtls checks the server chain against
+// the CA store and host on every full handshake; a cached session for
+// host:port is offered first. EPERM when the chain does not verify.
+errno_t tls_conn_open(tls_conn_t **out, const char *host, uint16_t port,
+    tls_io_send_t send, tls_io_recv_t recv, void *io);
+
+errno_t tls_conn_send(tls_conn_t *conn, const void *data, size_t len);
+// *nrecv == 0: the peer closed the connection
+errno_t tls_conn_recv(tls_conn_t *conn, void *buf, size_t size, size_t *nrecv);
+// Sends close_notify if the connection is still good; io is not touched after
+void tls_conn_close(tls_conn_t *conn);
+
+uint64_t tls_conn_handshake_usec(const tls_conn_t *conn);
+// The server took the offered session (abbreviated handshake)
+bool tls_conn_resumed(const tls_conn_t *conn);
+
+tls_stats_t tls_stats(void);
+
+#endif // TLS_SESSION_H